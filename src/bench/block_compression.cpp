@@ -0,0 +1,60 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+#include <chainparams.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <tinyformat.h>
+#include <validation.h>
+
+#include <cassert>
+#include <vector>
+
+/**
+ * Read a mainnet block from a block file, stored compressed or not. The name
+ * of the benchmark is amended with the size it is stored with, which together
+ * with the read latency shows what -blockcompression trades.
+ */
+static void ReadStoredBlock(benchmark::Bench& bench, bool compress)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN)};
+    ChainstateManager& chainman{*testing_setup->m_node.chainman};
+    CBlock block;
+    CDataStream{benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION} >> block;
+
+    node::fBlockCompression = compress;
+    const FlatFilePos pos{WITH_LOCK(::cs_main, return chainman.m_blockman.SaveBlockToDisk(block, 413567, chainman.ActiveChain(), Params(), nullptr))};
+    node::fBlockCompression = node::DEFAULT_BLOCK_COMPRESSION;
+    assert(!pos.IsNull());
+
+    std::vector<uint8_t> data{benchmark::data::block413567};
+    const uint32_t stored_size{compress ? node::CompressBlockData(data) & ~node::BLOCK_RECORD_COMPRESSED : uint32_t(data.size())};
+    bench.name(strprintf("%s (%u of %u bytes stored)", bench.name(), stored_size, benchmark::data::block413567.size()));
+    bench.unit("block").minEpochIterations(10).run([&] {
+        CBlock read;
+        const bool success{node::ReadBlockFromDisk(read, pos, Params().GetConsensus())};
+        assert(success);
+    });
+}
+
+/** Compress a mainnet block, as done for every block written with -blockcompression. */
+static void CompressBlock(benchmark::Bench& bench)
+{
+    bench.batch(benchmark::data::block413567.size()).unit("byte").run([&] {
+        std::vector<uint8_t> data{benchmark::data::block413567};
+        node::CompressBlockData(data);
+    });
+}
+
+static void ReadBlockFromDiskUncompressed(benchmark::Bench& bench) { ReadStoredBlock(bench, /*compress=*/false); }
+static void ReadBlockFromDiskCompressed(benchmark::Bench& bench) { ReadStoredBlock(bench, /*compress=*/true); }
+
+BENCHMARK(ReadBlockFromDiskUncompressed);
+BENCHMARK(ReadBlockFromDiskCompressed);
+BENCHMARK(CompressBlock);
@@ -0,0 +1,156 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <node/blockstorage.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+
+/**
+ * A synthetic block tree database of a main chain of `num_blocks` blocks
+ * (1M by default, pass -asymptote=<n> to change it) with a stale block
+ * forking off every 50th block, as left behind by competing miners.
+ */
+struct SyntheticBlockTree {
+    const std::unique_ptr<const BasicTestingSetup> m_setup;
+    std::unique_ptr<CBlockTreeDB> m_db;
+    size_t m_num_entries{0};
+
+    explicit SyntheticBlockTree(size_t num_blocks) : m_setup{MakeNoLogFileContext<>()}
+    {
+        const Consensus::Params& consensus{Params().GetConsensus()};
+        m_db = std::make_unique<CBlockTreeDB>(/*nCacheSize=*/8 << 20, /*fMemory=*/false, /*fWipe=*/true);
+
+        FastRandomContext rng{/*fDeterministic=*/true};
+        std::vector<uint256> hashes;
+        std::vector<CBlockIndex> entries;
+        hashes.reserve(num_blocks * 51 / 50 + 1);
+        entries.reserve(num_blocks * 51 / 50 + 1);
+        const auto add_block = [&](CBlockIndex* prev) {
+            CBlockHeader header;
+            header.nVersion = 4;
+            header.hashPrevBlock = prev ? prev->GetBlockHash() : uint256{};
+            header.hashMerkleRoot = rng.rand256();
+            header.nTime = prev ? prev->nTime + 600 : 1296688602;
+            header.nBits = UintToArith256(consensus.powLimit).GetCompact();
+            while (!CheckProofOfWork(header.GetHash(), header.nBits, consensus)) ++header.nNonce;
+
+            hashes.push_back(header.GetHash());
+            CBlockIndex& index{entries.emplace_back(header)};
+            index.phashBlock = &hashes.back();
+            index.pprev = prev;
+            index.nHeight = prev ? prev->nHeight + 1 : 0;
+            index.nTx = 1;
+            index.nStatus = BLOCK_VALID_SCRIPTS;
+            return &index;
+        };
+
+        CBlockIndex* tip{add_block(nullptr)};
+        for (size_t i = 1; i < num_blocks; ++i) {
+            if (i % 50 == 0) add_block(tip);
+            tip = add_block(tip);
+        }
+        m_num_entries = entries.size();
+
+        std::vector<const CBlockIndex*> batch;
+        for (const CBlockIndex& index : entries) {
+            batch.push_back(&index);
+            if (batch.size() == 10000 || &index == &entries.back()) {
+                assert(m_db->WriteBatchSync({}, 0, batch));
+                batch.clear();
+            }
+        }
+    }
+
+    /** Load the database into a block manager, as on startup. */
+    void Load(node::BlockManager& blockman) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        blockman.m_block_tree_db = std::move(m_db);
+        assert(blockman.LoadBlockIndexDB());
+        m_db = std::move(blockman.m_block_tree_db);
+        assert(blockman.m_block_index.size() == m_num_entries);
+    }
+};
+
+size_t NumBlocks(const benchmark::Bench& bench)
+{
+    return bench.complexityN() > 1 ? static_cast<size_t>(bench.complexityN()) : 1000000;
+}
+
+} // namespace
+
+static void LoadBlockIndex(benchmark::Bench& bench)
+{
+    SyntheticBlockTree tree{NumBlocks(bench)};
+    bench.batch(tree.m_num_entries).unit("entry").epochs(1).epochIterations(1).run([&] {
+        node::BlockManager blockman;
+        LOCK(cs_main);
+        tree.Load(blockman);
+    });
+}
+
+/** Load the block index from the snapshot written on a clean shutdown instead of the database. */
+static void LoadBlockIndexSnapshot(benchmark::Bench& bench)
+{
+    SyntheticBlockTree tree{NumBlocks(bench)};
+    {
+        node::BlockManager blockman;
+        LOCK(cs_main);
+        tree.Load(blockman);
+        blockman.m_block_tree_db = std::move(tree.m_db);
+        assert(blockman.WriteBlockIndexSnapshot());
+        tree.m_db = std::move(blockman.m_block_tree_db);
+    }
+    // A snapshot is only loaded once, so there is a single iteration.
+    bench.batch(tree.m_num_entries).unit("entry").epochs(1).epochIterations(1).run([&] {
+        node::BlockManager blockman;
+        LOCK(cs_main);
+        tree.Load(blockman);
+        assert(!tree.m_db->ReadIndexSnapshotId());
+    });
+}
+
+/** Ancestor and fork point lookups of random blocks, as done when serving headers and locators. */
+static void BlockIndexFindFork(benchmark::Bench& bench)
+{
+    SyntheticBlockTree tree{NumBlocks(bench)};
+    node::BlockManager blockman;
+    LOCK(cs_main);
+    tree.Load(blockman);
+
+    std::vector<CBlockIndex*> entries{blockman.GetAllBlockIndices()};
+    CChain chain;
+    chain.SetTip(*std::max_element(entries.begin(), entries.end(), [](auto* a, auto* b) { return a->nHeight < b->nHeight; }));
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<std::pair<const CBlockIndex*, int>> queries;
+    for (int i = 0; i < 10000; ++i) {
+        const CBlockIndex* index{entries[rng.randrange(entries.size())]};
+        queries.emplace_back(index, rng.randrange(index->nHeight + 1));
+    }
+
+    bench.batch(queries.size()).unit("lookup").minEpochIterations(10).run([&] {
+        for (const auto& [index, height] : queries) {
+            assert(chain.FindFork(index) != nullptr);
+            assert(index->GetAncestor(height)->nHeight == height);
+        }
+    });
+}
+
+BENCHMARK(LoadBlockIndex);
+BENCHMARK(LoadBlockIndexSnapshot);
+BENCHMARK(BlockIndexFindFork);
@@ -0,0 +1,57 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <index/blockfilterindex.h>
+#include <test/util/mining.h>
+#include <test/util/script.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <vector>
+
+/** Number of filters in a range request, the most allowed by getcfilters */
+static constexpr int FILTER_RANGE_SIZE{1000};
+
+static void LookupFilterRange(benchmark::Bench& bench, size_t filter_cache_size)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    for (int i = 0; i < FILTER_RANGE_SIZE; ++i) {
+        MineBlock(test_setup->m_node, P2WSH_OP_TRUE);
+    }
+
+    BlockFilterIndex filter_index(BlockFilterType::BASIC, 1 << 20, /*f_memory=*/true, /*f_wipe=*/false, filter_cache_size);
+    assert(filter_index.Start(test_setup->m_node.chainman->ActiveChainstate()));
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        UninterruptibleSleep(std::chrono::milliseconds{10});
+    }
+
+    const CBlockIndex* stop_index{WITH_LOCK(::cs_main, return test_setup->m_node.chainman->ActiveChain().Tip())};
+    const int start_height{stop_index->nHeight - FILTER_RANGE_SIZE + 1};
+    std::vector<BlockFilter> filters;
+
+    bench.batch(FILTER_RANGE_SIZE).unit("filter").minEpochIterations(10).run([&] {
+        bool found = filter_index.LookupFilterRange(start_height, stop_index, filters);
+        assert(found);
+        assert(filters.size() == FILTER_RANGE_SIZE);
+    });
+
+    filter_index.Stop();
+    SyncWithValidationInterfaceQueue();
+}
+
+static void BlockFilterIndexLookupRange(benchmark::Bench& bench)
+{
+    LookupFilterRange(bench, /*filter_cache_size=*/0);
+}
+
+static void BlockFilterIndexLookupRangeCached(benchmark::Bench& bench)
+{
+    LookupFilterRange(bench, DEFAULT_BLOCK_FILTER_CACHE_SIZE << 20);
+}
+
+BENCHMARK(BlockFilterIndexLookupRange);
+BENCHMARK(BlockFilterIndexLookupRangeCached);
@@ -0,0 +1,74 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <coins.h>
+#include <node/blockstorage.h>
+#include <node/coinstats.h>
+#include <random.h>
+#include <script/script.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+
+#include <algorithm>
+#include <vector>
+
+using node::CCoinsStats;
+using node::CoinStatsHashType;
+
+/**
+ * Compute the stats of a synthetic on-disk chainstate of 200000 coins (pass
+ * -asymptote=10000000 for a chainstate of mainnet size), walked by one
+ * thread or split into key ranges walked by four threads.
+ */
+static void UTXOStats(benchmark::Bench& bench, CoinStatsHashType hash_type, int threads)
+{
+    const size_t num_coins{bench.complexityN() > 1 ? static_cast<size_t>(bench.complexityN()) : 200000};
+
+    const auto test_setup = MakeNoLogFileContext<>();
+    FastRandomContext rng{/*fDeterministic=*/true};
+    const uint256 best_block{rng.rand256()};
+    CCoinsViewDB coinsdb{test_setup->m_args.GetDataDirBase() / "coin_stats", /*nCacheSize=*/8 << 20, /*fMemory=*/false, /*fWipe=*/true};
+    {
+        std::vector<std::pair<COutPoint, Coin>> coins;
+        for (size_t i = 0; i < num_coins;) {
+            const uint256 txid{rng.rand256()};
+            for (uint32_t n = 0, outputs = 1 + rng.randrange(3); n < outputs && i < num_coins; ++n, ++i) {
+                // P2WPKH outputs, the most common kind in the UTXO set
+                const CScript script{CScript() << OP_0 << rng.randbytes(20)};
+                coins.emplace_back(COutPoint{txid, n}, Coin{CTxOut{static_cast<CAmount>(rng.randrange(100000000)), script}, static_cast<int>(rng.randrange(700000)), false});
+            }
+            if (coins.size() >= 100000 || i == num_coins) {
+                std::sort(coins.begin(), coins.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+                assert(coinsdb.WriteCoins(coins));
+                coins.clear();
+            }
+        }
+        CCoinsViewCache cache{&coinsdb};
+        cache.SetBestBlock(best_block);
+        assert(cache.Flush());
+    }
+
+    node::BlockManager blockman;
+    CBlockIndex index;
+    index.phashBlock = &best_block;
+
+    bench.batch(num_coins).unit("coin").epochs(3).epochIterations(1).run([&] {
+        CCoinsStats stats{hash_type};
+        stats.m_threads = threads;
+        assert(GetUTXOStats(&coinsdb, blockman, stats, [] {}, &index));
+        assert(stats.coins_count == num_coins);
+    });
+}
+
+static void UTXOStatsSerialized1Thread(benchmark::Bench& bench) { UTXOStats(bench, CoinStatsHashType::HASH_SERIALIZED, 1); }
+static void UTXOStatsSerialized4Threads(benchmark::Bench& bench) { UTXOStats(bench, CoinStatsHashType::HASH_SERIALIZED, 4); }
+static void UTXOStatsMuHash1Thread(benchmark::Bench& bench) { UTXOStats(bench, CoinStatsHashType::MUHASH, 1); }
+static void UTXOStatsMuHash4Threads(benchmark::Bench& bench) { UTXOStats(bench, CoinStatsHashType::MUHASH, 4); }
+
+BENCHMARK(UTXOStatsSerialized1Thread);
+BENCHMARK(UTXOStatsSerialized4Threads);
+BENCHMARK(UTXOStatsMuHash1Thread);
+BENCHMARK(UTXOStatsMuHash4Threads);
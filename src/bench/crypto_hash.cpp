@@ -90,6 +90,22 @@ static void SipHash_32b(benchmark::Bench& bench)
     });
 }
 
+static void SipHash_32b_Batch(benchmark::Bench& bench)
+{
+    constexpr size_t count{1024};
+    std::vector<uint8_t> in(count * 32, 0);
+    std::vector<const unsigned char*> data(count);
+    std::vector<size_t> sizes(count, 32);
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = in.data() + i * 32;
+    }
+    std::vector<uint64_t> out(count);
+    uint64_t k1 = 0;
+    bench.batch(count).unit("hash").run([&] {
+        SipHashBatch(0, ++k1, data.data(), sizes.data(), count, out.data());
+    });
+}
+
 static void FastRandom_32bit(benchmark::Bench& bench)
 {
     FastRandomContext rng(true);
@@ -139,6 +155,39 @@ static void MuHashDiv(benchmark::Bench& bench)
     });
 }
 
+static void MuHashFinalize(benchmark::Bench& bench)
+{
+    FastRandomContext rng(true);
+    MuHash3072 acc{rng.randbytes(32)};
+    acc /= MuHash3072(rng.randbytes(32));
+
+    bench.run([&] {
+        uint256 out;
+        acc.Finalize(out);
+        acc /= MuHash3072(out);
+    });
+}
+
+/** The MuHash work of CoinStatsIndex for a block creating and spending 2000 coins each */
+static void MuHashBlock(benchmark::Bench& bench)
+{
+    FastRandomContext rng(true);
+    std::vector<std::vector<unsigned char>> coins;
+    for (int i = 0; i < 4000; ++i) coins.push_back(rng.randbytes(60));
+    MuHash3072 acc;
+
+    bench.batch(coins.size()).unit("coin").run([&] {
+        MuHash3072 delta;
+        for (size_t i = 0; i < coins.size(); i += 2) {
+            delta.Insert(coins[i]);
+            delta.Remove(coins[i + 1]);
+        }
+        acc *= delta;
+        uint256 out;
+        acc.Finalize(out);
+    });
+}
+
 static void MuHashPrecompute(benchmark::Bench& bench)
 {
     MuHash3072 acc;
@@ -158,6 +207,7 @@ BENCHMARK(SHA3_256_1M);
 
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
+BENCHMARK(SipHash_32b_Batch);
 BENCHMARK(SHA256D64_1024);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
@@ -165,4 +215,6 @@ BENCHMARK(FastRandom_1bit);
 BENCHMARK(MuHash);
 BENCHMARK(MuHashMul);
 BENCHMARK(MuHashDiv);
+BENCHMARK(MuHashFinalize);
+BENCHMARK(MuHashBlock);
 BENCHMARK(MuHashPrecompute);
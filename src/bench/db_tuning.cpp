@@ -0,0 +1,124 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <dbwrapper.h>
+#include <random.h>
+#include <serialize.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <vector>
+
+namespace {
+
+/** Key of a coin in the chainstate database */
+struct CoinKey {
+    uint256 txid;
+    uint32_t n;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, uint8_t{'C'});
+        s << txid << VARINT(n);
+    }
+};
+
+/**
+ * A chainstate database workload, recorded as the reads issued while
+ * connecting blocks followed by the batch written when the coins cache is
+ * flushed. Reads look up both coins in the database and new outputs that
+ * are not in it yet.
+ */
+struct ChainstateWorkload {
+    struct Flush {
+        std::vector<CoinKey> reads;
+        std::vector<std::pair<CoinKey, std::vector<unsigned char>>> writes;
+        std::vector<CoinKey> erases;
+    };
+    std::vector<Flush> flushes;
+    size_t ops{0};
+
+    ChainstateWorkload(int num_flushes, int coins_per_flush)
+    {
+        FastRandomContext rng{/*fDeterministic=*/true};
+        std::vector<CoinKey> coins;
+        for (int f = 0; f < num_flushes; ++f) {
+            Flush& flush{flushes.emplace_back()};
+            for (int i = 0; i < coins_per_flush; ++i) {
+                if (!coins.empty() && rng.randbool()) {
+                    flush.reads.push_back(coins[rng.randrange(coins.size())]);
+                } else {
+                    flush.reads.push_back({rng.rand256(), static_cast<uint32_t>(rng.randrange(4))});
+                }
+            }
+            // Spend half as many coins as are created, as the UTXO set grows.
+            for (int i = 0; i < coins_per_flush / 2 && !coins.empty(); ++i) {
+                const size_t pos{rng.randrange(coins.size())};
+                flush.erases.push_back(coins[pos]);
+                coins[pos] = coins.back();
+                coins.pop_back();
+            }
+            for (int i = 0; i < coins_per_flush; ++i) {
+                const CoinKey key{rng.rand256(), static_cast<uint32_t>(rng.randrange(4))};
+                // Height, amount and compressed P2WPKH script
+                flush.writes.emplace_back(key, rng.randbytes(1 + 5 + 21));
+                coins.push_back(key);
+            }
+            ops += flush.reads.size() + flush.writes.size() + flush.erases.size();
+        }
+    }
+
+    void Replay(CDBWrapper& db) const
+    {
+        std::vector<unsigned char> value;
+        for (const Flush& flush : flushes) {
+            for (const CoinKey& key : flush.reads) {
+                db.Read(key, value);
+            }
+            CDBBatch batch{db};
+            for (const CoinKey& key : flush.erases) {
+                batch.Erase(key);
+            }
+            for (const auto& [key, coin] : flush.writes) {
+                batch.Write(key, coin);
+            }
+            db.WriteBatch(batch);
+        }
+    }
+};
+
+void ReplayChainstateWorkload(benchmark::Bench& bench, const std::string& profile, const std::string& backend = "leveldb", const std::string& dbtuning = "")
+{
+    const auto test_setup = MakeNoLogFileContext<>();
+    const ChainstateWorkload workload{/*num_flushes=*/20, /*coins_per_flush=*/5000};
+
+    ArgsManager args;
+    args.ForceSetArg("-dbprofile", profile);
+    args.ForceSetArg("-dbbackend", backend);
+    if (!dbtuning.empty()) args.ForceSetArg("-dbtuning", dbtuning);
+    const DBTuning tuning{GetDBTuning(args, "chainstate")};
+    const fs::path path{test_setup->m_args.GetDataDirBase() / "db_tuning"};
+
+    bench.batch(workload.ops).unit("op").epochs(3).epochIterations(1).run([&] {
+        CDBWrapper db(path, /*nCacheSize=*/8 << 20, /*fMemory=*/false, /*fWipe=*/true, /*obfuscate=*/true, tuning);
+        workload.Replay(db);
+    });
+}
+
+} // namespace
+
+static void ChainstateWorkloadDefault(benchmark::Bench& bench) { ReplayChainstateWorkload(bench, "default"); }
+static void ChainstateWorkloadNVMe(benchmark::Bench& bench) { ReplayChainstateWorkload(bench, "nvme"); }
+static void ChainstateWorkloadNetwork(benchmark::Bench& bench) { ReplayChainstateWorkload(bench, "network"); }
+static void ChainstateWorkloadSubcompactions(benchmark::Bench& bench) { ReplayChainstateWorkload(bench, "default", "leveldb", "chainstate:subcompactions=4"); }
+static void ChainstateWorkloadLogStore(benchmark::Bench& bench) { ReplayChainstateWorkload(bench, "default", "logstore"); }
+
+BENCHMARK(ChainstateWorkloadDefault);
+BENCHMARK(ChainstateWorkloadNVMe);
+BENCHMARK(ChainstateWorkloadNetwork);
+BENCHMARK(ChainstateWorkloadSubcompactions);
+BENCHMARK(ChainstateWorkloadLogStore);
@@ -39,5 +39,63 @@ static void MatchGCSFilter(benchmark::Bench& bench)
     });
 }
 
+/** A filter of a block with many outputs, and wallet-like queries that miss it. */
+static void MatchAnyGCSFilter(benchmark::Bench& bench, bool prepared)
+{
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 5000; ++i) {
+        GCSFilter::Element element(22);
+        element[0] = static_cast<unsigned char>(i);
+        element[1] = static_cast<unsigned char>(i >> 8);
+        elements.insert(std::move(element));
+    }
+    GCSFilter filter({0, 0, BASIC_FILTER_P, BASIC_FILTER_M}, elements);
+
+    GCSFilter::ElementSet queries;
+    for (int i = 0; i < 10000; ++i) {
+        // Mix of P2WPKH, P2SH, P2PKH and P2TR script sizes
+        GCSFilter::Element query(i % 4 == 0 ? 22 : i % 4 == 1 ? 23 : i % 4 == 2 ? 25 : 34);
+        query[2] = static_cast<unsigned char>(i);
+        query[3] = static_cast<unsigned char>(i >> 8);
+        queries.insert(std::move(query));
+    }
+    const GCSFilter::ElementQuery query{queries};
+
+    bench.batch(queries.size()).unit("elem").run([&] {
+        bool match = prepared ? filter.MatchAny(query) : filter.MatchAny(queries);
+        ankerl::nanobench::doNotOptimizeAway(match);
+    });
+}
+
+static void MatchAnyGCSFilterLarge(benchmark::Bench& bench)
+{
+    MatchAnyGCSFilter(bench, /*prepared=*/false);
+}
+
+static void MatchAnyGCSFilterLargePrepared(benchmark::Bench& bench)
+{
+    MatchAnyGCSFilter(bench, /*prepared=*/true);
+}
+
+static void DecodeGCSFilter(benchmark::Bench& bench)
+{
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 10000; ++i) {
+        GCSFilter::Element element(32);
+        element[0] = static_cast<unsigned char>(i);
+        element[1] = static_cast<unsigned char>(i >> 8);
+        elements.insert(std::move(element));
+    }
+    GCSFilter filter({0, 0, BASIC_FILTER_P, BASIC_FILTER_M}, elements);
+
+    bench.batch(elements.size()).unit("elem").run([&] {
+        GCSFilter decoded(filter.GetParams(), filter.GetEncoded());
+        assert(decoded.GetN() == elements.size());
+    });
+}
+
 BENCHMARK(ConstructGCSFilter);
 BENCHMARK(MatchGCSFilter);
+BENCHMARK(MatchAnyGCSFilterLarge);
+BENCHMARK(MatchAnyGCSFilterLargePrepared);
+BENCHMARK(DecodeGCSFilter);
@@ -0,0 +1,88 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/policy.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <vector>
+
+static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    LockPoints lp;
+    pool.addUnchecked(CTxMemPoolEntry(tx, fee, /*time=*/0, /*entry_height=*/1, /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
+}
+
+/**
+ * Connect blocks of 3000 transactions against a large mempool (300 MB of
+ * dynamic memory usage by default, pass -asymptote=<MB> to change it).
+ * removeForBlock() runs with cs_main and the mempool lock held, so the
+ * reported time per block is the lock hold time of the mempool update.
+ *
+ * Transactions spend one confirmed outpoint and, most of the time, an unspent
+ * output of a recent mempool transaction, forming trees of up to 24 ancestors.
+ * Blocks are consecutive slices of the creation order, so each block includes
+ * all in-mempool ancestors of its transactions and leaves descendants behind.
+ */
+static void MempoolConnectBlock(benchmark::Bench& bench)
+{
+    constexpr size_t BLOCK_TXS{3000};
+    constexpr size_t NUM_BLOCKS{10};
+    constexpr size_t MAX_CHAIN_DEPTH{24};
+    constexpr size_t PARENT_WINDOW{1000};
+    const size_t target_usage{static_cast<size_t>(bench.complexityN() > 1 ? bench.complexityN() : 300) * 1000 * 1000};
+
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN);
+    FastRandomContext det_rand{true};
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+
+    std::vector<CTransactionRef> ordered_txs;
+    std::vector<size_t> depth;
+    std::vector<uint32_t> outputs_spent;
+    while (pool.DynamicMemoryUsage() < target_usage || ordered_txs.size() < BLOCK_TXS * (NUM_BLOCKS + 1)) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(uint256{}, ordered_txs.size());
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vin[0].scriptWitness.stack.push_back({1});
+        size_t tx_depth{0};
+        if (!ordered_txs.empty() && det_rand.randrange(4) != 0) {
+            const size_t window{std::min(ordered_txs.size(), PARENT_WINDOW)};
+            const size_t parent{ordered_txs.size() - 1 - det_rand.randrange(window)};
+            if (depth[parent] < MAX_CHAIN_DEPTH && outputs_spent[parent] < 2) {
+                tx.vin.emplace_back(COutPoint(ordered_txs[parent]->GetHash(), outputs_spent[parent]++));
+                tx.vin.back().scriptSig = CScript() << OP_1;
+                tx.vin.back().scriptWitness.stack.push_back({1});
+                tx_depth = depth[parent] + 1;
+            }
+        }
+        tx.vout.resize(2);
+        for (auto& out : tx.vout) {
+            out.scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            out.nValue = COIN;
+        }
+        ordered_txs.push_back(MakeTransactionRef(tx));
+        depth.push_back(tx_depth);
+        outputs_spent.push_back(0);
+        AddTx(ordered_txs.back(), /*fee=*/1000 + det_rand.randrange(10000), pool);
+    }
+
+    std::vector<std::vector<CTransactionRef>> blocks;
+    for (size_t i = 0; i < NUM_BLOCKS; ++i) {
+        blocks.emplace_back(ordered_txs.begin() + i * BLOCK_TXS, ordered_txs.begin() + (i + 1) * BLOCK_TXS);
+    }
+
+    size_t next_block{0};
+    bench.epochs(NUM_BLOCKS).epochIterations(1).run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        assert(next_block < blocks.size());
+        pool.removeForBlock(blocks[next_block], /*nBlockHeight=*/2 + next_block);
+        ++next_block;
+    });
+}
+
+BENCHMARK(MempoolConnectBlock);
@@ -0,0 +1,90 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/fees.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+
+#include <deque>
+#include <vector>
+
+namespace {
+/** Number of transactions in a full block */
+constexpr size_t BLOCK_TXS{3000};
+
+/**
+ * Feeds an estimator with blocks of BLOCK_TXS transactions. Every transaction
+ * is tracked when it enters the mempool, and is confirmed within 1 to 10
+ * blocks, with higher feerate transactions confirming sooner.
+ */
+class EstimatorFeeder
+{
+    CBlockPolicyEstimator& m_estimator;
+    FastRandomContext m_rand{true};
+    unsigned int m_height{0};
+    uint32_t m_tx_counter{0};
+    /** Entries waiting for confirmation, by number of blocks until they confirm */
+    std::deque<std::vector<CTxMemPoolEntry>> m_pending;
+
+public:
+    explicit EstimatorFeeder(CBlockPolicyEstimator& estimator) : m_estimator{estimator} {}
+
+    void ConnectBlock()
+    {
+        m_pending.resize(std::max<size_t>(m_pending.size(), 11));
+        for (size_t i = 0; i < BLOCK_TXS; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(uint256{}, m_tx_counter++);
+            tx.vin[0].scriptSig = CScript() << OP_1;
+            tx.vout.resize(1);
+            tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            tx.vout[0].nValue = COIN;
+            // feerates between 1 and 100 sat/vB
+            const CAmount fee = 100 + m_rand.randrange(10000);
+            const size_t blocks_to_confirm = 1 + m_rand.randrange(1 + 10000 / fee) % 10;
+            LockPoints lp;
+            m_pending[blocks_to_confirm].emplace_back(MakeTransactionRef(tx), fee, /*time=*/0, m_height, /*spends_coinbase=*/false, /*sigops_cost=*/4, lp);
+            m_estimator.processTransaction(m_pending[blocks_to_confirm].back(), /*validFeeEstimate=*/true);
+        }
+        std::vector<CTxMemPoolEntry> confirmed = std::move(m_pending.front());
+        m_pending.pop_front();
+        std::vector<const CTxMemPoolEntry*> entries;
+        for (const CTxMemPoolEntry& entry : confirmed) entries.push_back(&entry);
+        m_estimator.processBlock(++m_height, entries);
+    }
+};
+} // namespace
+
+static void BlockPolicyEstimatorProcessBlock(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<>();
+    CBlockPolicyEstimator estimator;
+    EstimatorFeeder feeder{estimator};
+    for (int i = 0; i < 20; ++i) feeder.ConnectBlock();
+
+    bench.run([&] {
+        feeder.ConnectBlock();
+    });
+}
+
+static void BlockPolicyEstimatorEstimateSmartFee(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<>();
+    CBlockPolicyEstimator estimator;
+    EstimatorFeeder feeder{estimator};
+    for (int i = 0; i < 200; ++i) feeder.ConnectBlock();
+
+    bench.run([&] {
+        for (int i = 0; i < 1000; ++i) {
+            FeeCalculation fee_calc;
+            (void)estimator.estimateSmartFee(/*confTarget=*/1 + i % 144, &fee_calc, /*conservative=*/i % 2);
+        }
+    });
+}
+
+BENCHMARK(BlockPolicyEstimatorProcessBlock);
+BENCHMARK(BlockPolicyEstimatorEstimateSmartFee);
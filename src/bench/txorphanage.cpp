@@ -0,0 +1,83 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <net_processing.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <txorphanage.h>
+
+#include <vector>
+
+/**
+ * One peer floods orphans spending many outputs of a few large parents while
+ * honest peers send a few small orphans each. Every orphan is followed by the
+ * LimitOrphans() call net_processing makes, then the parents arrive and their
+ * children are collected for reprocessing.
+ */
+static void OrphanageFlood(benchmark::Bench& bench)
+{
+    constexpr size_t NUM_PARENTS{10};
+    constexpr uint32_t PARENT_OUTPUTS{2000};
+    constexpr size_t SPAM_ORPHANS{1000};
+    constexpr size_t SPAM_INPUTS{100};
+    constexpr NodeId NUM_HONEST_PEERS{8};
+    constexpr size_t HONEST_ORPHANS_PER_PEER{10};
+
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    FastRandomContext det_rand{true};
+
+    std::vector<CTransactionRef> parents;
+    for (size_t i = 0; i < NUM_PARENTS; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(det_rand.rand256(), 0);
+        tx.vout.resize(PARENT_OUTPUTS);
+        for (auto& out : tx.vout) {
+            out.scriptPubKey = CScript() << OP_1;
+            out.nValue = COIN;
+        }
+        parents.push_back(MakeTransactionRef(tx));
+    }
+
+    std::vector<std::pair<CTransactionRef, NodeId>> orphans;
+    for (size_t i = 0; i < SPAM_ORPHANS; ++i) {
+        const CTransactionRef& parent = parents[i % NUM_PARENTS];
+        CMutableTransaction tx;
+        for (size_t j = 0; j < SPAM_INPUTS; ++j) {
+            tx.vin.emplace_back(COutPoint(parent->GetHash(), det_rand.randrange(PARENT_OUTPUTS)));
+            tx.vin.back().scriptSig = CScript() << std::vector<unsigned char>(72, 1);
+        }
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1;
+        tx.vout[0].nValue = COIN;
+        orphans.emplace_back(MakeTransactionRef(tx), /*peer=*/0);
+        if (i % (SPAM_ORPHANS / (NUM_HONEST_PEERS * HONEST_ORPHANS_PER_PEER)) == 0) {
+            CMutableTransaction honest;
+            honest.vin.emplace_back(COutPoint(parents[det_rand.randrange(NUM_PARENTS)]->GetHash(), det_rand.randrange(PARENT_OUTPUTS)));
+            honest.vout.resize(1);
+            honest.vout[0].scriptPubKey = CScript() << OP_1;
+            honest.vout[0].nValue = COIN;
+            orphans.emplace_back(MakeTransactionRef(honest), /*peer=*/1 + det_rand.randrange(NUM_HONEST_PEERS));
+        }
+    }
+
+    TxOrphanage orphanage;
+    bench.run([&] {
+        LOCK(g_cs_orphans);
+        for (const auto& [tx, peer] : orphans) {
+            orphanage.AddTx(tx, peer);
+            orphanage.LimitOrphans(DEFAULT_MAX_ORPHAN_TRANSACTIONS, DEFAULT_MAX_ORPHAN_MEMORY * 1000000);
+        }
+        std::set<uint256> work_set;
+        for (const auto& parent : parents) {
+            orphanage.AddChildrenToWorkSet(*parent, work_set);
+        }
+        for (NodeId peer = 0; peer <= NUM_HONEST_PEERS; ++peer) {
+            orphanage.EraseForPeer(peer);
+        }
+    });
+}
+
+BENCHMARK(OrphanageFlood);
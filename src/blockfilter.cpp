@@ -32,12 +32,30 @@ uint64_t GCSFilter::HashToRange(const Element& element) const
     return FastRange64(hash, m_F);
 }
 
-std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
+GCSFilter::ElementQuery::ElementQuery(const ElementSet& elements)
 {
-    std::vector<uint64_t> hashed_elements;
-    hashed_elements.reserve(elements.size());
+    std::vector<const Element*> sorted;
+    sorted.reserve(elements.size());
     for (const Element& element : elements) {
-        hashed_elements.push_back(HashToRange(element));
+        sorted.push_back(&element);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Element* a, const Element* b) { return a->size() < b->size(); });
+
+    m_data.reserve(sorted.size());
+    m_sizes.reserve(sorted.size());
+    for (const Element* element : sorted) {
+        m_data.push_back(element->data());
+        m_sizes.push_back(element->size());
+    }
+}
+
+std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementQuery& query) const
+{
+    std::vector<uint64_t> hashed_elements(query.size());
+    SipHashBatch(m_params.m_siphash_k0, m_params.m_siphash_k1,
+                 query.m_data.data(), query.m_sizes.data(), query.size(), hashed_elements.data());
+    for (uint64_t& hash : hashed_elements) {
+        hash = FastRange64(hash, m_F);
     }
     std::sort(hashed_elements.begin(), hashed_elements.end());
     return hashed_elements;
@@ -61,11 +79,11 @@ GCSFilter::GCSFilter(const Params& params, std::vector<unsigned char> encoded_fi
 
     // Verify that the encoded filter contains exactly N elements. If it has too much or too little
     // data, a std::ios_base::failure exception will be raised.
-    BitStreamReader<SpanReader> bitreader{stream};
+    GolombRiceReader reader{Span{m_encoded}.last(stream.size())};
     for (uint64_t i = 0; i < m_N; ++i) {
-        GolombRiceDecode(bitreader, m_params.m_P);
+        reader.Decode(m_params.m_P);
     }
-    if (!stream.empty()) {
+    if (!reader.empty()) {
         throw std::ios_base::failure("encoded_filter contains excess data");
     }
 }
@@ -91,7 +109,7 @@ GCSFilter::GCSFilter(const Params& params, const ElementSet& elements)
     BitStreamWriter<CVectorWriter> bitwriter(stream);
 
     uint64_t last_value = 0;
-    for (uint64_t value : BuildHashedSet(elements)) {
+    for (uint64_t value : BuildHashedSet(ElementQuery{elements})) {
         uint64_t delta = value - last_value;
         GolombRiceEncode(bitwriter, m_params.m_P, delta);
         last_value = value;
@@ -108,12 +126,12 @@ bool GCSFilter::MatchInternal(const uint64_t* element_hashes, size_t size) const
     uint64_t N = ReadCompactSize(stream);
     assert(N == m_N);
 
-    BitStreamReader<SpanReader> bitreader{stream};
+    GolombRiceReader reader{Span{m_encoded}.last(stream.size())};
 
     uint64_t value = 0;
     size_t hashes_index = 0;
     for (uint32_t i = 0; i < m_N; ++i) {
-        uint64_t delta = GolombRiceDecode(bitreader, m_params.m_P);
+        uint64_t delta = reader.Decode(m_params.m_P);
         value += delta;
 
         while (true) {
@@ -140,7 +158,12 @@ bool GCSFilter::Match(const Element& element) const
 
 bool GCSFilter::MatchAny(const ElementSet& elements) const
 {
-    const std::vector<uint64_t> queries = BuildHashedSet(elements);
+    return MatchAny(ElementQuery{elements});
+}
+
+bool GCSFilter::MatchAny(const ElementQuery& query) const
+{
+    const std::vector<uint64_t> queries = BuildHashedSet(query);
     return MatchInternal(queries.data(), queries.size());
 }
 
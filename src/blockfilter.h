@@ -39,6 +39,25 @@ public:
         {}
     };
 
+    /**
+     * A set of elements prepared for matching against many filters, such as
+     * the scripts of a wallet during a rescan. The elements are ordered by
+     * size once, so that each filter can hash them in batches. The query
+     * references the elements of the set, which must outlive it.
+     */
+    class ElementQuery
+    {
+    private:
+        friend class GCSFilter;
+        std::vector<const unsigned char*> m_data;
+        std::vector<size_t> m_sizes;
+
+    public:
+        explicit ElementQuery(const ElementSet& elements);
+
+        size_t size() const { return m_sizes.size(); }
+    };
+
 private:
     Params m_params;
     uint32_t m_N;  //!< Number of elements in the filter
@@ -48,7 +67,8 @@ private:
     /** Hash a data element to an integer in the range [0, N * M). */
     uint64_t HashToRange(const Element& element) const;
 
-    std::vector<uint64_t> BuildHashedSet(const ElementSet& elements) const;
+    /** Hash the elements of a query to the range [0, N * M) and sort the result. */
+    std::vector<uint64_t> BuildHashedSet(const ElementQuery& query) const;
 
     /** Helper method used to implement Match and MatchAny */
     bool MatchInternal(const uint64_t* sorted_element_hashes, size_t size) const;
@@ -80,6 +100,13 @@ public:
      * efficient that checking Match on multiple elements separately.
      */
     bool MatchAny(const ElementSet& elements) const;
+
+    /**
+     * Checks if any element of the query may be in the set. Prefer this over
+     * MatchAny with an ElementSet when matching the same elements against
+     * many filters.
+     */
+    bool MatchAny(const ElementQuery& query) const;
 };
 
 constexpr uint8_t BASIC_FILTER_P = 19;
@@ -141,6 +141,14 @@ enum BlockStatus : uint32_t {
      * on a background chainstate. See `doc/assumeutxo.md`.
      */
     BLOCK_ASSUMED_VALID      =   256,
+
+    /**
+     * The block data was stored by a headers-only reindex (-reindex-headers),
+     * which only reads the header and transaction count of each block. Its
+     * context-free and contextual checks (merkle root, transactions, witness
+     * commitment) are deferred until it is connected.
+     */
+    BLOCK_UNCHECKED_DATA     =   512,
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -146,6 +146,8 @@ public:
 
     virtual bool Valid() const = 0;
     virtual void Next() = 0;
+    //! Move to the first coin at or after the given outpoint
+    virtual void Seek(const COutPoint& start) = 0;
 
     //! Get best block at the time this cursor was created
     const uint256 &GetBestBlock() const { return hashBlock; }
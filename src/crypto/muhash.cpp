@@ -4,6 +4,7 @@
 
 #include <crypto/muhash.h>
 
+#include <compat/cpuid.h>
 #include <crypto/chacha20.h>
 #include <crypto/common.h>
 #include <hash.h>
@@ -12,10 +13,19 @@
 #include <cstdio>
 #include <limits>
 
+#if defined(USE_ASM) && defined(HAVE_GETCPUID) && (defined(__x86_64__) || defined(__amd64__)) && defined(__SIZEOF_INT128__)
+#define ENABLE_MUHASH_X86_ADX
+namespace muhash_x86_adx
+{
+void Multiply(uint64_t (&out)[96], const uint64_t (&a)[48], const uint64_t (&b)[48]);
+}
+#endif
+
 namespace {
 
 using limb_t = Num3072::limb_t;
 using double_limb_t = Num3072::double_limb_t;
+constexpr int LIMBS = Num3072::LIMBS;
 constexpr int LIMB_SIZE = Num3072::LIMB_SIZE;
 /** 2^3072 - 1103717, the largest 3072-bit safe prime number, is used as the modulus. */
 constexpr limb_t MAX_PRIME_DIFF = 1103717;
@@ -113,12 +123,238 @@ inline void addnextract2(limb_t& c0, limb_t& c1, const limb_t& a, limb_t& n)
     c1 = c2;
 }
 
+#ifdef ENABLE_MUHASH_X86_ADX
+/** Whether the CPU supports the mulx (BMI2) and adcx/adox (ADX) instructions. */
+bool UseX86Adx()
+{
+    static const bool use_adx{[] {
+        uint32_t eax, ebx, ecx, edx;
+        GetCPUID(0, 0, eax, ebx, ecx, edx);
+        if (eax < 7) return false;
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        return ((ebx >> 8) & 1) && ((ebx >> 19) & 1);
+    }()};
+    return use_adx;
+}
+
+/**
+ * Reduce the 6144-bit product [t0,t1] to t0 + t1 * MAX_PRIME_DIFF, which is
+ * congruent as 2^3072 = MAX_PRIME_DIFF modulo the prime. Returns the carry
+ * out of the top limb, after which the result needs one more reduction.
+ */
+limb_t ReduceProduct(limb_t (&out)[LIMBS], const limb_t (&t)[2 * LIMBS])
+{
+    double_limb_t c = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        c += (double_limb_t)t[LIMBS + i] * MAX_PRIME_DIFF + t[i];
+        out[i] = c;
+        c >>= LIMB_SIZE;
+    }
+    c *= MAX_PRIME_DIFF;
+    for (int i = 0; i < LIMBS && c; ++i) {
+        c += out[i];
+        out[i] = c;
+        c >>= LIMB_SIZE;
+    }
+    return c;
+}
+#endif
+
+#ifdef __SIZEOF_INT128__
+/*
+ * Modular inversion using the safegcd algorithm by Bernstein and Yang
+ * (https://gcd.cr.yp.to/papers.html), in the variable time variant of
+ * libsecp256k1's modinv64 (see doc/safegcd_implementation.md there),
+ * generalized to the MuHash modulus. MuHash only operates on public data.
+ */
+
+/** Number of 62-bit limbs of the signed numbers used during inversion. */
+constexpr int SIGNED62_LIMBS = 50;
+constexpr uint64_t M62 = std::numeric_limits<uint64_t>::max() >> 2;
+
+/** A signed number as SIGNED62_LIMBS limbs of 62 bits, with the sign in the top limb. */
+struct Signed62 {
+    int64_t v[SIGNED62_LIMBS];
+};
+
+/** The modulus 2^3072 - MAX_PRIME_DIFF as a Signed62. */
+constexpr Signed62 MODULUS62 = [] {
+    Signed62 m{};
+    m.v[0] = int64_t{1} << 62;
+    m.v[0] -= MAX_PRIME_DIFF;
+    for (int i = 1; i < SIGNED62_LIMBS - 1; ++i) m.v[i] = M62;
+    m.v[SIGNED62_LIMBS - 1] = (int64_t{1} << (3072 - 62 * (SIGNED62_LIMBS - 1))) - 1;
+    return m;
+}();
+
+/** The inverse of the modulus modulo 2^62, computed with Newton iterations. */
+constexpr uint64_t MODULUS_INV62 = [] {
+    const uint64_t m = MODULUS62.v[0];
+    uint64_t x = m; // Correct in the bottom 3 bits
+    for (int i = 0; i < 5; ++i) x *= 2 - m * x;
+    return x & M62;
+}();
+static_assert(((MODULUS_INV62 * uint64_t(MODULUS62.v[0])) & M62) == 1, "bad MODULUS_INV62");
+
+/** A 2x2 transition matrix, scaled by 2^62, describing 62 divsteps. */
+struct Trans2x2 {
+    int64_t u, v, q, r;
+};
+
+/** Compute the transition matrix and new eta after 62 divsteps on the bottom bits of f and g. */
+int64_t DivSteps62Var(int64_t eta, uint64_t f0, uint64_t g0, Trans2x2& t)
+{
+    uint64_t u = 1, v = 0, q = 0, r = 1;
+    uint64_t f = f0, g = g0, m;
+    uint32_t w;
+    int i = 62, limit, zeros;
+
+    for (;;) {
+        // Perform the divsteps which just halve g at once, counting zeros
+        // only up to i using a sentinel bit.
+        zeros = __builtin_ctzll(g | (std::numeric_limits<uint64_t>::max() << i));
+        g >>= zeros;
+        u <<= zeros;
+        v <<= zeros;
+        eta -= zeros;
+        i -= zeros;
+        if (i == 0) break;
+        // If eta is negative, negate it and replace f,g with g,-f.
+        if (eta < 0) {
+            uint64_t tmp;
+            eta = -eta;
+            tmp = f; f = g; g = -tmp;
+            tmp = u; u = q; q = -tmp;
+            tmp = v; v = r; r = -tmp;
+            // Cancel out up to 6 bits of g, but no more than i, and no more
+            // than eta+1 as the sign of eta flips again after that.
+            limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+            m = (std::numeric_limits<uint64_t>::max() >> (64 - limit)) & 63U;
+            w = (f * g * (f * f - 2)) & m;
+        } else {
+            // eta tends to be smaller here, so only cancel up to 4 bits.
+            limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+            m = (std::numeric_limits<uint64_t>::max() >> (64 - limit)) & 15U;
+            w = f + (((f + 1) & 4) << 1);
+            w = (-w * g) & m;
+        }
+        g += f * w;
+        q += u * w;
+        r += v * w;
+    }
+    t.u = (int64_t)u;
+    t.v = (int64_t)v;
+    t.q = (int64_t)q;
+    t.r = (int64_t)r;
+    return eta;
+}
+
+/** [d,e] = t * [d,e] / 2^62 modulo the modulus, keeping both in range (-2*modulus, modulus). */
+void UpdateDE62(Signed62& d, Signed62& e, const Trans2x2& t)
+{
+    using int128_t = __int128;
+    const int64_t u = t.u, v = t.v, q = t.q, r = t.r;
+    // [md,me] start as zero, plus [u,q] if d is negative, plus [v,r] if e is negative.
+    const int64_t sd = d.v[SIGNED62_LIMBS - 1] >> 63;
+    const int64_t se = e.v[SIGNED62_LIMBS - 1] >> 63;
+    int64_t md = (u & sd) + (v & se);
+    int64_t me = (q & sd) + (r & se);
+    int128_t cd = (int128_t)u * d.v[0] + (int128_t)v * e.v[0];
+    int128_t ce = (int128_t)q * d.v[0] + (int128_t)r * e.v[0];
+    // Correct md,me so that t*[d,e]+modulus*[md,me] has 62 zero bottom bits.
+    md -= (MODULUS_INV62 * (uint64_t)cd + md) & M62;
+    me -= (MODULUS_INV62 * (uint64_t)ce + me) & M62;
+    cd += (int128_t)MODULUS62.v[0] * md;
+    ce += (int128_t)MODULUS62.v[0] * me;
+    cd >>= 62;
+    ce >>= 62;
+    for (int i = 1; i < SIGNED62_LIMBS; ++i) {
+        cd += (int128_t)u * d.v[i] + (int128_t)v * e.v[i] + (int128_t)MODULUS62.v[i] * md;
+        ce += (int128_t)q * d.v[i] + (int128_t)r * e.v[i] + (int128_t)MODULUS62.v[i] * me;
+        d.v[i - 1] = (uint64_t)cd & M62;
+        e.v[i - 1] = (uint64_t)ce & M62;
+        cd >>= 62;
+        ce >>= 62;
+    }
+    d.v[SIGNED62_LIMBS - 1] = (int64_t)cd;
+    e.v[SIGNED62_LIMBS - 1] = (int64_t)ce;
+}
+
+/** [f,g] = t * [f,g] / 2^62, where f and g have len limbs. */
+void UpdateFG62Var(int len, Signed62& f, Signed62& g, const Trans2x2& t)
+{
+    using int128_t = __int128;
+    const int64_t u = t.u, v = t.v, q = t.q, r = t.r;
+    int128_t cf = (int128_t)u * f.v[0] + (int128_t)v * g.v[0];
+    int128_t cg = (int128_t)q * f.v[0] + (int128_t)r * g.v[0];
+    cf >>= 62;
+    cg >>= 62;
+    for (int i = 1; i < len; ++i) {
+        cf += (int128_t)u * f.v[i] + (int128_t)v * g.v[i];
+        cg += (int128_t)q * f.v[i] + (int128_t)r * g.v[i];
+        f.v[i - 1] = (uint64_t)cf & M62;
+        g.v[i - 1] = (uint64_t)cg & M62;
+        cf >>= 62;
+        cg >>= 62;
+    }
+    f.v[len - 1] = (int64_t)cf;
+    g.v[len - 1] = (int64_t)cg;
+}
+
+/** Bring r from range (-2*modulus, modulus) to [0, modulus), negating it if sign is negative. */
+void Normalize62(Signed62& r, int64_t sign)
+{
+    const auto add_modulus = [&r] {
+        const int64_t cond_add = r.v[SIGNED62_LIMBS - 1] >> 63;
+        for (int i = 0; i < SIGNED62_LIMBS; ++i) r.v[i] += MODULUS62.v[i] & cond_add;
+    };
+    const auto propagate = [&r] {
+        for (int i = 0; i < SIGNED62_LIMBS - 1; ++i) {
+            r.v[i + 1] += r.v[i] >> 62;
+            r.v[i] &= M62;
+        }
+    };
+    add_modulus();
+    const int64_t cond_negate = sign >> 63;
+    for (int i = 0; i < SIGNED62_LIMBS; ++i) r.v[i] = (r.v[i] ^ cond_negate) - cond_negate;
+    propagate();
+    add_modulus();
+    propagate();
+}
+
+Signed62 ToSigned62(const Num3072& in)
+{
+    Signed62 out;
+    for (int i = 0; i < SIGNED62_LIMBS; ++i) {
+        const int bit = 62 * i, limb = bit / 64, shift = bit % 64;
+        uint64_t x = in.limbs[limb] >> shift;
+        if (shift > 2 && limb + 1 < LIMBS) x |= in.limbs[limb + 1] << (64 - shift);
+        out.v[i] = x & M62;
+    }
+    return out;
+}
+
+/** Convert a Signed62 in range [0, modulus) back. */
+Num3072 FromSigned62(const Signed62& in)
+{
+    Num3072 out;
+    for (int i = 0; i < LIMBS; ++i) out.limbs[i] = 0;
+    for (int i = 0; i < SIGNED62_LIMBS; ++i) {
+        const int bit = 62 * i, limb = bit / 64, shift = bit % 64;
+        const uint64_t x = in.v[i];
+        out.limbs[limb] |= x << shift;
+        if (shift > 2 && limb + 1 < LIMBS) out.limbs[limb + 1] |= x >> (64 - shift);
+    }
+    return out;
+}
+#else
 /** in_out = in_out^(2^sq) * mul */
 inline void square_n_mul(Num3072& in_out, const int sq, const Num3072& mul)
 {
     for (int j = 0; j < sq; ++j) in_out.Square();
     in_out.Multiply(mul);
 }
+#endif
 
 } // namespace
 
@@ -143,6 +379,37 @@ void Num3072::FullReduce()
 
 Num3072 Num3072::GetInverse() const
 {
+#ifdef __SIZEOF_INT128__
+    Signed62 d{}, e{}, f{MODULUS62}, g{ToSigned62(*this)};
+    e.v[0] = 1;
+    int len = SIGNED62_LIMBS;
+    int64_t eta = -1; // eta = -delta; delta is initially 1
+    while (true) {
+        Trans2x2 t;
+        eta = DivSteps62Var(eta, f.v[0], g.v[0], t);
+        UpdateDE62(d, e, t);
+        UpdateFG62Var(len, f, g, t);
+        // Stop once g is zero, when f is the gcd of the input and the modulus.
+        if (g.v[0] == 0) {
+            int64_t cond = 0;
+            for (int i = 1; i < len; ++i) cond |= g.v[i];
+            if (cond == 0) break;
+        }
+        // Drop the top limbs of f and g once both are 0 or -1.
+        const int64_t fn = f.v[len - 1], gn = g.v[len - 1];
+        int64_t cond = ((int64_t)len - 2) >> 63;
+        cond |= fn ^ (fn >> 63);
+        cond |= gn ^ (gn >> 63);
+        if (cond == 0) {
+            f.v[len - 2] |= (uint64_t)fn << 62;
+            g.v[len - 2] |= (uint64_t)gn << 62;
+            --len;
+        }
+    }
+    // f is now +1 or -1, and d the inverse of the input times f.
+    Normalize62(d, f.v[len - 1]);
+    return FromSigned62(d);
+#else
     // For fast exponentiation a sliding window exponentiation with repunit
     // precomputation is utilized. See "Fast Point Decompression for Standard
     // Elliptic Curves" (Brumley, Järvinen, 2008).
@@ -176,10 +443,22 @@ Num3072 Num3072::GetInverse() const
     square_n_mul(out, 3, p[0]);
 
     return out;
+#endif
 }
 
 void Num3072::Multiply(const Num3072& a)
 {
+#ifdef ENABLE_MUHASH_X86_ADX
+    if (UseX86Adx()) {
+        limb_t product[2 * LIMBS];
+        muhash_x86_adx::Multiply(product, this->limbs, a.limbs);
+        const limb_t c{ReduceProduct(this->limbs, product)};
+        if (this->IsOverflow()) this->FullReduce();
+        if (c) this->FullReduce();
+        return;
+    }
+#endif
+
     limb_t c0 = 0, c1 = 0, c2 = 0;
     Num3072 tmp;
 
@@ -217,6 +496,13 @@ void Num3072::Multiply(const Num3072& a)
 
 void Num3072::Square()
 {
+#ifdef ENABLE_MUHASH_X86_ADX
+    if (UseX86Adx()) {
+        this->Multiply(*this);
+        return;
+    }
+#endif
+
     limb_t c0 = 0, c1 = 0, c2 = 0;
     Num3072 tmp;
 
@@ -0,0 +1,44 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// 3072-bit by 3072-bit schoolbook multiplication using the BMI2 mulx and the
+// ADX adcx/adox instructions, which allow the low and high halves of the
+// partial products to be accumulated in two independent carry chains.
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+namespace muhash_x86_adx
+{
+void Multiply(uint64_t (&out)[96], const uint64_t (&a)[48], const uint64_t (&b)[48])
+{
+    for (int i = 0; i < 96; ++i) out[i] = 0;
+    for (int i = 0; i < 48; ++i) {
+        // out[i..i+48] += a * b[i]. out[i+48] is still zero. xor clears both
+        // CF and OF, and no instruction of the row but adcx/adox changes them.
+        __asm__ __volatile__(
+            "xorl %%r11d, %%r11d\n"
+            ".set muhash_adx_j, 0\n"
+            ".rept 48\n"
+            "mulxq muhash_adx_j*8(%[a]), %%r8, %%r9\n"
+            "movq muhash_adx_j*8(%[row]), %%r10\n"
+            "adcxq %%r8, %%r10\n"
+            "adoxq %%r11, %%r10\n"
+            "movq %%r10, muhash_adx_j*8(%[row])\n"
+            "movq %%r9, %%r11\n"
+            ".set muhash_adx_j, muhash_adx_j+1\n"
+            ".endr\n"
+            "movl $0, %%r10d\n"
+            "adcxq %%r10, %%r11\n"
+            "adoxq %%r10, %%r11\n"
+            "movq %%r11, 384(%[row])\n"
+            :
+            : [a] "r"(a), [row] "r"(out + i), "d"(b[i])
+            : "r8", "r9", "r10", "r11", "cc", "memory");
+    }
+}
+} // namespace muhash_x86_adx
+
+#endif
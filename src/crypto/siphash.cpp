@@ -3,6 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/siphash.h>
+#include <crypto/common.h>
+
+#include <compat/cpuid.h>
+
+namespace siphash_avx2
+{
+void Hash_4way(uint64_t k0, uint64_t k1, const unsigned char* const* data, size_t size, uint64_t* out);
+}
 
 #define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
 
@@ -171,3 +179,49 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace {
+
+/** Hash four inputs of the same size at once. */
+typedef void (*Hash4WayFn)(uint64_t k0, uint64_t k1, const unsigned char* const* data, size_t size, uint64_t* out);
+
+Hash4WayFn DetectHash4Way()
+{
+#if defined(USE_ASM) && defined(HAVE_GETCPUID) && defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    if (!have_xsave || !have_avx) return nullptr;
+    // Check whether the OS has enabled AVX registers.
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    if ((a & 6) != 6) return nullptr;
+    GetCPUID(7, 0, eax, ebx, ecx, edx);
+    if ((ebx >> 5) & 1) return siphash_avx2::Hash_4way;
+#endif
+    return nullptr;
+}
+
+} // namespace
+
+void SipHashBatch(uint64_t k0, uint64_t k1, const unsigned char* const* data, const size_t* sizes, size_t count, uint64_t* out)
+{
+    static const Hash4WayFn hash_4way{DetectHash4Way()};
+
+    size_t i = 0;
+    if (hash_4way) {
+        while (i + 4 <= count) {
+            if (sizes[i] == sizes[i + 1] && sizes[i] == sizes[i + 2] && sizes[i] == sizes[i + 3]) {
+                hash_4way(k0, k1, data + i, sizes[i], out + i);
+                i += 4;
+            } else {
+                out[i] = CSipHasher(k0, k1).Write(data[i], sizes[i]).Finalize();
+                ++i;
+            }
+        }
+    }
+    for (; i < count; ++i) {
+        out[i] = CSipHasher(k0, k1).Write(data[i], sizes[i]).Finalize();
+    }
+}
@@ -44,4 +44,12 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** Compute the SipHash-2-4 of many byte strings under the same key.
+ *
+ *  out[i] is identical to CSipHasher(k0, k1).Write(data[i], sizes[i]).Finalize().
+ *  Runs of four inputs of equal size are hashed in parallel where the CPU
+ *  supports it, so callers should place inputs of equal size next to each other.
+ */
+void SipHashBatch(uint64_t k0, uint64_t k1, const unsigned char* const* data, const size_t* sizes, size_t count, uint64_t* out);
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
@@ -0,0 +1,80 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+
+namespace siphash_avx2 {
+namespace {
+
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x(x); }
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+template <int n>
+__m256i inline RotL(__m256i x) { return _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - n)); }
+/** Rotations by a multiple of 16 bits only move bytes within each lane. */
+__m256i inline RotL16(__m256i x) { return _mm256_shuffle_epi8(x, _mm256_setr_epi8(6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13, 6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13)); }
+__m256i inline RotL32(__m256i x) { return _mm256_shuffle_epi32(x, 0xB1); }
+
+void inline __attribute__((always_inline)) SipRound(__m256i& v0, __m256i& v1, __m256i& v2, __m256i& v3)
+{
+    v0 = Add(v0, v1); v1 = RotL<13>(v1); v1 = Xor(v1, v0);
+    v0 = RotL32(v0);
+    v2 = Add(v2, v3); v3 = RotL16(v3); v3 = Xor(v3, v2);
+    v0 = Add(v0, v3); v3 = RotL<21>(v3); v3 = Xor(v3, v0);
+    v2 = Add(v2, v1); v1 = RotL<17>(v1); v1 = Xor(v1, v2);
+    v2 = RotL32(v2);
+}
+
+void inline __attribute__((always_inline)) Compress(__m256i& v0, __m256i& v1, __m256i& v2, __m256i& v3, __m256i m)
+{
+    v3 = Xor(v3, m);
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    v0 = Xor(v0, m);
+}
+
+/** The final block of an input: its trailing bytes and the low 8 bits of its size. */
+uint64_t inline LastBlock(const unsigned char* data, size_t size)
+{
+    const size_t offset = size & ~size_t{7};
+    uint64_t block = ((uint64_t)size) << 56;
+    for (size_t i = 0; i < (size & 7); ++i) {
+        block |= ((uint64_t)data[offset + i]) << (8 * i);
+    }
+    return block;
+}
+
+} // namespace
+
+void Hash_4way(uint64_t k0, uint64_t k1, const unsigned char* const* data, size_t size, uint64_t* out)
+{
+    __m256i v0 = K(0x736f6d6570736575ULL ^ k0);
+    __m256i v1 = K(0x646f72616e646f6dULL ^ k1);
+    __m256i v2 = K(0x6c7967656e657261ULL ^ k0);
+    __m256i v3 = K(0x7465646279746573ULL ^ k1);
+
+    const size_t blocks_end = size & ~size_t{7};
+    for (size_t offset = 0; offset < blocks_end; offset += 8) {
+        Compress(v0, v1, v2, v3, _mm256_set_epi64x(ReadLE64(data[3] + offset), ReadLE64(data[2] + offset), ReadLE64(data[1] + offset), ReadLE64(data[0] + offset)));
+    }
+    Compress(v0, v1, v2, v3, _mm256_set_epi64x(LastBlock(data[3], size), LastBlock(data[2], size), LastBlock(data[1], size), LastBlock(data[0], size)));
+
+    v2 = Xor(v2, K(0xFF));
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    _mm256_storeu_si256((__m256i*)out, Xor(Xor(v0, v1), Xor(v2, v3)));
+}
+
+} // namespace siphash_avx2
+
+#endif
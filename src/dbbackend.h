@@ -0,0 +1,114 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_DBBACKEND_H
+#define BITCOIN_DBBACKEND_H
+
+#include <fs.h>
+#include <span.h>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+class dbwrapper_error : public std::runtime_error
+{
+public:
+    explicit dbwrapper_error(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+/** Storage engines a CDBWrapper can be backed by */
+enum class DBBackendType {
+    LEVELDB,  //!< LevelDB, the default
+    LOGSTORE, //!< Append-only log with an in-memory key index, see dbbackend_logstore.cpp
+};
+
+/** Storage settings of a database. Sizes are in bytes. */
+struct DBTuning {
+    //! Storage engine of the database
+    DBBackendType backend{DBBackendType::LEVELDB};
+    //! LevelDB: approximate size of the user data packed in a table block
+    size_t block_size{4 << 10};
+    //! LevelDB: bits per key of the Bloom filter of each table, 0 to disable it
+    int bloom_bits{10};
+    //! LevelDB: compress table blocks with LZ4
+    bool compression{false};
+    //! LevelDB: size of the memtable, or a quarter of the cache size if unset
+    std::optional<size_t> write_buffer_size;
+    //! LevelDB: size of a table file before LevelDB switches to a new one
+    size_t max_file_size{2 << 20};
+    //! LevelDB: number of threads a compaction is split across
+    int subcompactions{1};
+};
+
+std::string DBBackendName(DBBackendType backend);
+std::optional<DBBackendType> ParseDBBackend(const std::string& name);
+
+/**
+ * An ordered key-value store holding the data of a CDBWrapper. Keys and values
+ * are byte strings and keys are ordered bytewise. Failures of the underlying
+ * storage are reported by throwing dbwrapper_error.
+ */
+class DBBackend
+{
+public:
+    using Bytes = Span<const std::byte>;
+
+    /** Changes to be applied atomically by Write() */
+    class Batch
+    {
+    public:
+        virtual ~Batch() = default;
+        virtual void Put(Bytes key, Bytes value) = 0;
+        virtual void Delete(Bytes key) = 0;
+        virtual void Clear() = 0;
+    };
+
+    /**
+     * Cursor over the entries in key order. Whether it sees writes made after
+     * it was created is up to the backend.
+     */
+    class Iterator
+    {
+    public:
+        virtual ~Iterator() = default;
+        virtual bool Valid() const = 0;
+        virtual void SeekToFirst() = 0;
+        //! Move to the first entry with a key at or after the given one
+        virtual void Seek(Bytes key) = 0;
+        virtual void Next() = 0;
+        //! Key and value of the current entry, valid until the iterator moves
+        virtual Bytes Key() const = 0;
+        virtual Bytes Value() const = 0;
+    };
+
+    virtual ~DBBackend() = default;
+
+    //! Read the value of a key. Return false if the key is not found.
+    virtual bool Get(Bytes key, std::string& value) const = 0;
+    virtual std::unique_ptr<Batch> NewBatch() const = 0;
+    //! Apply a batch created by NewBatch(), flushing it to disk if sync is true
+    virtual void Write(Batch& batch, bool sync) = 0;
+    virtual std::unique_ptr<Iterator> NewIterator() const = 0;
+    //! Approximate disk space used by the entries with keys in [begin, end)
+    virtual size_t EstimateSize(Bytes begin, Bytes end) const = 0;
+    //! Compact the entries with keys in [begin, end], nullptr meaning unbounded
+    virtual void CompactRange(const Bytes* begin, const Bytes* end) = 0;
+    //! Approximate memory used by the backend, in bytes
+    virtual size_t DynamicMemoryUsage() const = 0;
+};
+
+/**
+ * @param[in] path        Directory of the database.
+ * @param[in] cache_size  Memory available for caches and write buffers.
+ * @param[in] memory      If true, keep the database in memory only.
+ * @param[in] wipe        If true, remove all existing data.
+ * @param[in] tuning      LevelDB block, filter, compression and file settings.
+ */
+std::unique_ptr<DBBackend> MakeLevelDBBackend(const fs::path& path, size_t cache_size, bool memory, bool wipe, const DBTuning& tuning);
+std::unique_ptr<DBBackend> MakeLogStoreBackend(const fs::path& path, bool memory, bool wipe);
+
+#endif // BITCOIN_DBBACKEND_H
@@ -0,0 +1,357 @@
+// Copyright (c) 2012-2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <dbbackend.h>
+
+#include <crypto/common.h>
+#include <logging.h>
+#include <span.h>
+#include <tinyformat.h>
+#include <util/lz4.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+
+#include <leveldb/cache.h>
+#include <leveldb/compressor.h>
+#include <leveldb/db.h>
+#include <leveldb/env.h>
+#include <leveldb/filter_policy.h>
+#include <leveldb/write_batch.h>
+#include <memenv.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdarg>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+class CBitcoinLevelDBLogger : public leveldb::Logger {
+public:
+    // This code is adapted from posix_logger.h, which is why it is using vsprintf.
+    // Please do not do this in normal code
+    void Logv(const char * format, va_list ap) override {
+            if (!LogAcceptCategory(BCLog::LEVELDB)) {
+                return;
+            }
+            char buffer[500];
+            for (int iter = 0; iter < 2; iter++) {
+                char* base;
+                int bufsize;
+                if (iter == 0) {
+                    bufsize = sizeof(buffer);
+                    base = buffer;
+                }
+                else {
+                    bufsize = 30000;
+                    base = new char[bufsize];
+                }
+                char* p = base;
+                char* limit = base + bufsize;
+
+                // Print the message
+                if (p < limit) {
+                    va_list backup_ap;
+                    va_copy(backup_ap, ap);
+                    // Do not use vsnprintf elsewhere in bitcoin source code, see above.
+                    p += vsnprintf(p, limit - p, format, backup_ap);
+                    va_end(backup_ap);
+                }
+
+                // Truncate to available space if necessary
+                if (p >= limit) {
+                    if (iter == 0) {
+                        continue;       // Try again with larger buffer
+                    }
+                    else {
+                        p = limit - 1;
+                    }
+                }
+
+                // Add newline if necessary
+                if (p == base || p[-1] != '\n') {
+                    *p++ = '\n';
+                }
+
+                assert(p <= limit);
+                base[std::min(bufsize - 1, (int)(p - base))] = '\0';
+                LogPrintf("leveldb: %s", base);  /* Continued */
+                if (base != buffer) {
+                    delete[] base;
+                }
+                break;
+            }
+    }
+};
+
+void SetMaxOpenFiles(leveldb::Options *options) {
+    // On most platforms the default setting of max_open_files (which is 1000)
+    // is optimal. On Windows using a large file count is OK because the handles
+    // do not interfere with select() loops. On 64-bit Unix hosts this value is
+    // also OK, because up to that amount LevelDB will use an mmap
+    // implementation that does not use extra file descriptors (the fds are
+    // closed after being mmap'ed).
+    //
+    // Increasing the value beyond the default is dangerous because LevelDB will
+    // fall back to a non-mmap implementation when the file count is too large.
+    // On 32-bit Unix host we should decrease the value because the handles use
+    // up real fds, and we want to avoid fd exhaustion issues.
+    //
+    // See PR #12495 for further discussion.
+
+    int default_open_files = options->max_open_files;
+#ifndef WIN32
+    if (sizeof(void*) < 8) {
+        options->max_open_files = 64;
+    }
+#endif
+    LogPrint(BCLog::LEVELDB, "LevelDB using max_open_files=%d (default=%d)\n",
+             options->max_open_files, default_open_files);
+}
+
+/**
+ * Compresses LevelDB table blocks with the in-tree LZ4 codec, as a 4 byte
+ * little-endian uncompressed size followed by the LZ4 block.
+ */
+class LZ4Compressor : public leveldb::Compressor
+{
+    static Span<const uint8_t> ToSpan(const leveldb::Slice& slice)
+    {
+        return {reinterpret_cast<const uint8_t*>(slice.data()), slice.size()};
+    }
+
+public:
+    bool Compress(const leveldb::Slice& input, std::string* output) const override
+    {
+        if (input.size() > std::numeric_limits<uint32_t>::max()) return false;
+        const std::vector<uint8_t> compressed{util::LZ4Compress(ToSpan(input))};
+        output->resize(4 + compressed.size());
+        WriteLE32(reinterpret_cast<uint8_t*>(output->data()), input.size());
+        std::copy(compressed.begin(), compressed.end(), output->begin() + 4);
+        return true;
+    }
+
+    bool GetUncompressedLength(const leveldb::Slice& input, size_t* result) const override
+    {
+        if (input.size() < 4) return false;
+        *result = ReadLE32(reinterpret_cast<const uint8_t*>(input.data()));
+        return true;
+    }
+
+    bool Uncompress(const leveldb::Slice& input, char* output) const override
+    {
+        size_t size;
+        if (!GetUncompressedLength(input, &size)) return false;
+        return util::LZ4Decompress(ToSpan(input).subspan(4), Span{reinterpret_cast<uint8_t*>(output), size});
+    }
+};
+
+const LZ4Compressor g_lz4_compressor;
+
+leveldb::Options GetOptions(size_t nCacheSize, const DBTuning& tuning)
+{
+    leveldb::Options options;
+    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
+    options.write_buffer_size = tuning.write_buffer_size.value_or(nCacheSize / 4); // up to two write buffers may be held in memory simultaneously
+    options.block_size = tuning.block_size;
+    options.max_file_size = tuning.max_file_size;
+    options.max_subcompactions = tuning.subcompactions;
+    options.filter_policy = tuning.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(tuning.bloom_bits) : nullptr;
+    options.compression = tuning.compression ? leveldb::kCustomCompression : leveldb::kNoCompression;
+    // Set even without compression, to read tables written while it was enabled.
+    options.compressor = &g_lz4_compressor;
+    options.info_log = new CBitcoinLevelDBLogger();
+    if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
+        // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
+        // on corruption in later versions.
+        options.paranoid_checks = true;
+    }
+    SetMaxOpenFiles(&options);
+    return options;
+}
+
+/** Handle database error by throwing dbwrapper_error exception. */
+void HandleError(const leveldb::Status& status)
+{
+    if (status.ok())
+        return;
+    const std::string errmsg = "Fatal LevelDB error: " + status.ToString();
+    LogPrintf("%s\n", errmsg);
+    LogPrintf("You can use -debug=leveldb to get more complete diagnostic messages\n");
+    throw dbwrapper_error(errmsg);
+}
+
+leveldb::Slice ToSlice(DBBackend::Bytes bytes)
+{
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+DBBackend::Bytes ToBytes(const leveldb::Slice& slice)
+{
+    return MakeByteSpan(slice);
+}
+
+class LevelDBBatch : public DBBackend::Batch
+{
+public:
+    leveldb::WriteBatch m_batch;
+
+    void Put(DBBackend::Bytes key, DBBackend::Bytes value) override { m_batch.Put(ToSlice(key), ToSlice(value)); }
+    void Delete(DBBackend::Bytes key) override { m_batch.Delete(ToSlice(key)); }
+    void Clear() override { m_batch.Clear(); }
+};
+
+class LevelDBIterator : public DBBackend::Iterator
+{
+    const std::unique_ptr<leveldb::Iterator> m_iter;
+
+public:
+    explicit LevelDBIterator(leveldb::Iterator* iter) : m_iter{iter} {}
+
+    bool Valid() const override { return m_iter->Valid(); }
+    void SeekToFirst() override { m_iter->SeekToFirst(); }
+    void Seek(DBBackend::Bytes key) override { m_iter->Seek(ToSlice(key)); }
+    void Next() override { m_iter->Next(); }
+    DBBackend::Bytes Key() const override { return ToBytes(m_iter->key()); }
+    DBBackend::Bytes Value() const override { return ToBytes(m_iter->value()); }
+};
+
+class LevelDBBackend : public DBBackend
+{
+    //! custom environment this database is using (may be nullptr in case of default environment)
+    leveldb::Env* penv{nullptr};
+
+    //! database options used
+    leveldb::Options options;
+
+    //! options used when reading from the database
+    leveldb::ReadOptions readoptions;
+
+    //! options used when iterating over values of the database
+    leveldb::ReadOptions iteroptions;
+
+    //! options used when writing to the database
+    leveldb::WriteOptions writeoptions;
+
+    //! options used when sync writing to the database
+    leveldb::WriteOptions syncoptions;
+
+    //! the database itself
+    leveldb::DB* pdb{nullptr};
+
+public:
+    LevelDBBackend(const fs::path& path, size_t cache_size, bool memory, bool wipe, const DBTuning& tuning)
+    {
+        readoptions.verify_checksums = true;
+        iteroptions.verify_checksums = true;
+        iteroptions.fill_cache = false;
+        syncoptions.sync = true;
+        options = GetOptions(cache_size, tuning);
+        LogPrint(BCLog::LEVELDB, "LevelDB %s using block_size=%u bloom_bits=%d compression=%d write_buffer_size=%u max_file_size=%u subcompactions=%d\n",
+                 fs::PathToString(path.stem()), options.block_size, tuning.bloom_bits, tuning.compression, options.write_buffer_size, options.max_file_size, options.max_subcompactions);
+        options.create_if_missing = true;
+        if (memory) {
+            penv = leveldb::NewMemEnv(leveldb::Env::Default());
+            options.env = penv;
+        } else {
+            if (wipe) {
+                LogPrintf("Wiping LevelDB in %s\n", fs::PathToString(path));
+                leveldb::Status result = leveldb::DestroyDB(fs::PathToString(path), options);
+                HandleError(result);
+            }
+            TryCreateDirectories(path);
+            for (const auto& entry : fs::directory_iterator(path)) {
+                if (fs::PathToString(entry.path().filename()).rfind("logstore-", 0) == 0) {
+                    const std::string errmsg = strprintf("Fatal LevelDB error: %s holds a log store database, use -dbbackend=logstore", fs::PathToString(path));
+                    LogPrintf("%s\n", errmsg);
+                    throw dbwrapper_error(errmsg);
+                }
+            }
+            LogPrintf("Opening LevelDB in %s\n", fs::PathToString(path));
+        }
+        // PathToString() return value is safe to pass to leveldb open function,
+        // because on POSIX leveldb passes the byte string directly to ::open(), and
+        // on Windows it converts from UTF-8 to UTF-16 before calling ::CreateFileW
+        // (see env_posix.cc and env_windows.cc).
+        leveldb::Status status = leveldb::DB::Open(options, fs::PathToString(path), &pdb);
+        HandleError(status);
+        LogPrintf("Opened LevelDB successfully\n");
+    }
+
+    ~LevelDBBackend()
+    {
+        delete pdb;
+        pdb = nullptr;
+        delete options.filter_policy;
+        options.filter_policy = nullptr;
+        delete options.info_log;
+        options.info_log = nullptr;
+        delete options.block_cache;
+        options.block_cache = nullptr;
+        delete penv;
+        options.env = nullptr;
+    }
+
+    bool Get(Bytes key, std::string& value) const override
+    {
+        leveldb::Status status = pdb->Get(readoptions, ToSlice(key), &value);
+        if (!status.ok()) {
+            if (status.IsNotFound())
+                return false;
+            LogPrintf("LevelDB read failure: %s\n", status.ToString());
+            HandleError(status);
+        }
+        return true;
+    }
+
+    std::unique_ptr<Batch> NewBatch() const override { return std::make_unique<LevelDBBatch>(); }
+
+    void Write(Batch& batch, bool sync) override
+    {
+        leveldb::Status status = pdb->Write(sync ? syncoptions : writeoptions, &static_cast<LevelDBBatch&>(batch).m_batch);
+        HandleError(status);
+    }
+
+    std::unique_ptr<Iterator> NewIterator() const override
+    {
+        return std::make_unique<LevelDBIterator>(pdb->NewIterator(iteroptions));
+    }
+
+    size_t EstimateSize(Bytes begin, Bytes end) const override
+    {
+        uint64_t size = 0;
+        leveldb::Range range(ToSlice(begin), ToSlice(end));
+        pdb->GetApproximateSizes(&range, 1, &size);
+        return size;
+    }
+
+    void CompactRange(const Bytes* begin, const Bytes* end) override
+    {
+        std::optional<leveldb::Slice> slice_begin, slice_end;
+        if (begin) slice_begin = ToSlice(*begin);
+        if (end) slice_end = ToSlice(*end);
+        pdb->CompactRange(slice_begin ? &*slice_begin : nullptr, slice_end ? &*slice_end : nullptr);
+    }
+
+    size_t DynamicMemoryUsage() const override
+    {
+        std::string memory;
+        std::optional<size_t> parsed;
+        if (!pdb->GetProperty("leveldb.approximate-memory-usage", &memory) || !(parsed = ToIntegral<size_t>(memory))) {
+            LogPrint(BCLog::LEVELDB, "Failed to get approximate-memory-usage property\n");
+            return 0;
+        }
+        return parsed.value();
+    }
+};
+
+} // namespace
+
+std::unique_ptr<DBBackend> MakeLevelDBBackend(const fs::path& path, size_t cache_size, bool memory, bool wipe, const DBTuning& tuning)
+{
+    return std::make_unique<LevelDBBackend>(path, cache_size, memory, wipe, tuning);
+}
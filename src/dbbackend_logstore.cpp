@@ -0,0 +1,538 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <dbbackend.h>
+
+#include <crypto/common.h>
+#include <hash.h>
+#include <logging.h>
+#include <memusage.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <map>
+#include <string_view>
+#include <vector>
+
+/**
+ * The log store keeps a database in a sequence of append-only log files. Each
+ * write of a batch appends one record to the newest file:
+ *
+ * - uint32_t: size of the operations
+ * - uint32_t: MurmurHash3 checksum of the operations
+ * - the operations, each a put (byte 1, uint32_t key size, uint32_t value
+ *   size, key, value) or a delete (byte 2, uint32_t key size, key)
+ *
+ * All integers are little endian. An in-memory index maps every key to the
+ * location of its latest value, so a read is a single file read and the
+ * index is rebuilt by replaying the log on startup. Overwritten and deleted
+ * values are reclaimed by compactions, which copy the live entries into new
+ * log files and remove the old ones.
+ *
+ * As all keys are held in memory, this suits databases whose key set fits in
+ * memory. Iterators do not read from a snapshot, they see the writes made
+ * while they are in use, so the chainstate is never kept in a log store (see
+ * GetDBTuning()).
+ *
+ * A file is synced before writes move on to the next one, so only the newest
+ * file can hold records lost by a crash. A record cut short at the end of any
+ * file is still discarded on startup rather than treated as corruption.
+ */
+
+namespace {
+
+//! Size of a log file before writes move on to a new one
+constexpr uint64_t LOGSTORE_FILE_SIZE{64 << 20};
+//! Size of the log below which it is not compacted automatically
+constexpr uint64_t LOGSTORE_MIN_COMPACT_SIZE{64 << 20};
+//! Size of the records live entries are copied in during a compaction
+constexpr size_t LOGSTORE_COMPACT_RECORD_SIZE{1 << 20};
+constexpr unsigned int LOGSTORE_CHECKSUM_SEED{0x4c4f4753};
+constexpr size_t RECORD_HEADER_SIZE{8};
+constexpr uint8_t OP_PUT{1};
+constexpr uint8_t OP_DELETE{2};
+
+std::string_view ToStringView(DBBackend::Bytes bytes)
+{
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+//! Bytes of the log taken by a put operation
+uint64_t PutSize(size_t key_size, size_t value_size)
+{
+    return 1 + 4 + 4 + key_size + value_size;
+}
+
+void AppendLE32(std::vector<std::byte>& out, uint32_t value)
+{
+    unsigned char buf[4];
+    WriteLE32(buf, value);
+    out.insert(out.end(), reinterpret_cast<const std::byte*>(buf), reinterpret_cast<const std::byte*>(buf) + sizeof(buf));
+}
+
+uint32_t Checksum(Span<const std::byte> ops)
+{
+    return MurmurHash3(LOGSTORE_CHECKSUM_SEED, UCharSpanCast(ops));
+}
+
+class LogStoreBatch : public DBBackend::Batch
+{
+public:
+    //! A record header, filled in when the batch is written, and the operations
+    std::vector<std::byte> m_record;
+
+    LogStoreBatch() : m_record(RECORD_HEADER_SIZE) {}
+
+    void Put(DBBackend::Bytes key, DBBackend::Bytes value) override
+    {
+        m_record.push_back(std::byte{OP_PUT});
+        AppendLE32(m_record, key.size());
+        AppendLE32(m_record, value.size());
+        m_record.insert(m_record.end(), key.begin(), key.end());
+        m_record.insert(m_record.end(), value.begin(), value.end());
+    }
+
+    void Delete(DBBackend::Bytes key) override
+    {
+        m_record.push_back(std::byte{OP_DELETE});
+        AppendLE32(m_record, key.size());
+        m_record.insert(m_record.end(), key.begin(), key.end());
+    }
+
+    void Clear() override { m_record.resize(RECORD_HEADER_SIZE); }
+
+    bool Empty() const { return m_record.size() == RECORD_HEADER_SIZE; }
+};
+
+struct FileCloser {
+    void operator()(FILE* file) const { fclose(file); }
+};
+
+/** A log file, or its contents if the store is in memory */
+struct LogFile {
+    std::unique_ptr<FILE, FileCloser> file;
+    std::vector<std::byte> data;
+    uint64_t size{0};
+};
+
+class LogStore : public DBBackend
+{
+    /** Location of a value in the log */
+    struct Location {
+        uint32_t file;
+        uint64_t offset;
+        uint32_t size;
+    };
+    using Index = std::map<std::string, Location, std::less<>>;
+
+    const fs::path m_path;
+    const bool m_memory;
+
+    mutable Mutex m_mutex;
+    //! Location of the latest value of every key
+    Index m_index GUARDED_BY(m_mutex);
+    //! Memory used by the keys of the index outside of its nodes
+    size_t m_key_usage GUARDED_BY(m_mutex){0};
+    std::map<uint32_t, LogFile> m_files GUARDED_BY(m_mutex);
+    uint32_t m_next_file GUARDED_BY(m_mutex){1};
+    //! Bytes of the log taken by the latest value of every key
+    uint64_t m_live_size GUARDED_BY(m_mutex){0};
+    //! m_live_size split by the first byte of the keys, for EstimateSize()
+    std::array<uint64_t, 256> m_prefix_size GUARDED_BY(m_mutex){};
+    //! Bytes of the log
+    uint64_t m_log_size GUARDED_BY(m_mutex){0};
+
+    class Iterator : public DBBackend::Iterator
+    {
+        const LogStore& m_store;
+        bool m_valid{false};
+        std::string m_key;
+        std::string m_value;
+
+        void Load(Index::const_iterator it) EXCLUSIVE_LOCKS_REQUIRED(m_store.m_mutex)
+        {
+            m_valid = it != m_store.m_index.end();
+            if (!m_valid) return;
+            m_key = it->first;
+            m_store.ReadValue(it->second, m_value);
+        }
+
+    public:
+        explicit Iterator(const LogStore& store) : m_store{store} {}
+
+        bool Valid() const override { return m_valid; }
+
+        void SeekToFirst() override
+        {
+            LOCK(m_store.m_mutex);
+            Load(m_store.m_index.begin());
+        }
+
+        void Seek(Bytes key) override
+        {
+            LOCK(m_store.m_mutex);
+            Load(m_store.m_index.lower_bound(ToStringView(key)));
+        }
+
+        void Next() override
+        {
+            LOCK(m_store.m_mutex);
+            Load(m_store.m_index.upper_bound(m_key));
+        }
+
+        Bytes Key() const override { return MakeByteSpan(m_key); }
+        Bytes Value() const override { return MakeByteSpan(m_value); }
+    };
+
+    [[noreturn]] void Fail(const std::string& msg) const
+    {
+        const std::string errmsg = "Fatal log store error: " + msg;
+        LogPrintf("%s\n", errmsg);
+        throw dbwrapper_error(errmsg);
+    }
+
+    fs::path FilePath(uint32_t id) const
+    {
+        return m_path / fs::u8path(strprintf("logstore-%06u.dat", id));
+    }
+
+    std::vector<uint32_t> ListFiles() const
+    {
+        std::vector<uint32_t> ids;
+        for (const auto& entry : fs::directory_iterator(m_path)) {
+            const std::string name{fs::PathToString(entry.path().filename())};
+            if (name.size() != 19 || name.compare(0, 9, "logstore-") != 0 || name.compare(15, 4, ".dat") != 0) continue;
+            if (const auto id{ToIntegral<uint32_t>(name.substr(9, 6))}) {
+                ids.push_back(*id);
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    void OpenFile(uint32_t id, LogFile& log_file) const
+    {
+        if (m_memory) return;
+        log_file.file.reset(fsbridge::fopen(FilePath(id), "a+b"));
+        if (!log_file.file) Fail(strprintf("failed to open %s", fs::PathToString(FilePath(id))));
+    }
+
+    void Append(LogFile& log_file, Span<const std::byte> data)
+    {
+        if (!log_file.file) {
+            log_file.data.insert(log_file.data.end(), data.begin(), data.end());
+            return;
+        }
+        // Flush every write, as LevelDB does, so that written data survives a
+        // crash of the process.
+        if (fseek(log_file.file.get(), 0, SEEK_END) != 0 ||
+            fwrite(data.data(), 1, data.size(), log_file.file.get()) != data.size() ||
+            fflush(log_file.file.get()) != 0) {
+            Fail("failed to write to the log");
+        }
+    }
+
+    void SyncFile(const LogFile& log_file) const
+    {
+        if (log_file.file && !FileCommit(log_file.file.get())) Fail("failed to sync the log");
+    }
+
+    //! Index of the m_prefix_size entry of a key
+    static uint8_t Prefix(std::string_view key)
+    {
+        return key.empty() ? 0 : static_cast<uint8_t>(key[0]);
+    }
+
+    void ReadAt(const LogFile& log_file, uint64_t offset, std::string& out) const
+    {
+        if (!log_file.file) {
+            const char* begin{reinterpret_cast<const char*>(log_file.data.data()) + offset};
+            out.assign(begin, begin + out.size());
+            return;
+        }
+        if (fseek(log_file.file.get(), offset, SEEK_SET) != 0 ||
+            fread(out.data(), 1, out.size(), log_file.file.get()) != out.size()) {
+            Fail("failed to read from the log");
+        }
+    }
+
+    void ReadValue(const Location& location, std::string& value) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        value.resize(location.size);
+        ReadAt(m_files.at(location.file), location.offset, value);
+    }
+
+    /**
+     * The file writes go to, which is a new one once the newest is full. The
+     * full file is synced first, so that a crash cannot leave a gap in the
+     * log followed by newer records.
+     */
+    std::pair<const uint32_t, LogFile>& ActiveFile() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        if (m_files.empty() || m_files.rbegin()->second.size >= LOGSTORE_FILE_SIZE) {
+            if (!m_files.empty()) SyncFile(m_files.rbegin()->second);
+            const uint32_t id{m_next_file++};
+            OpenFile(id, m_files[id]);
+            if (!m_memory) DirectoryCommit(m_path);
+        }
+        return *m_files.rbegin();
+    }
+
+    /** Append a batch as a record and apply it to the index */
+    void WriteRecord(LogStoreBatch& batch, bool sync) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        const Span<const std::byte> ops{Span{batch.m_record}.subspan(RECORD_HEADER_SIZE)};
+        WriteLE32(reinterpret_cast<unsigned char*>(batch.m_record.data()), ops.size());
+        WriteLE32(reinterpret_cast<unsigned char*>(batch.m_record.data()) + 4, Checksum(ops));
+
+        auto& [id, log_file]{ActiveFile()};
+        const uint64_t offset{log_file.size};
+        Append(log_file, batch.m_record);
+        if (sync) SyncFile(log_file);
+        log_file.size += batch.m_record.size();
+        m_log_size += batch.m_record.size();
+        Apply(id, offset + RECORD_HEADER_SIZE, ops);
+    }
+
+    /** Apply the operations of a record at the given offset of a log file to the index */
+    void Apply(uint32_t id, uint64_t offset, Span<const std::byte> ops) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        size_t pos{0};
+        const auto read_size{[&]() -> uint32_t {
+            if (ops.size() - pos < 4) Fail("malformed record in the log");
+            pos += 4;
+            return ReadLE32(UCharCast(ops.data()) + pos - 4);
+        }};
+        while (pos < ops.size()) {
+            const uint8_t op{static_cast<uint8_t>(ops[pos++])};
+            if (op == OP_PUT) {
+                const uint32_t key_size{read_size()};
+                const uint32_t value_size{read_size()};
+                if (ops.size() - pos < uint64_t{key_size} + value_size) Fail("malformed record in the log");
+                const std::string_view key{ToStringView(ops.subspan(pos, key_size))};
+                const Location location{id, offset + pos + key_size, value_size};
+                pos += key_size + value_size;
+
+                const auto it{m_index.find(key)};
+                uint64_t& prefix_size{m_prefix_size[Prefix(key)]};
+                if (it == m_index.end()) {
+                    m_index.emplace(key, location);
+                    m_key_usage += memusage::MallocUsage(key.size());
+                } else {
+                    m_live_size -= PutSize(key.size(), it->second.size);
+                    prefix_size -= PutSize(key.size(), it->second.size);
+                    it->second = location;
+                }
+                m_live_size += PutSize(key.size(), value_size);
+                prefix_size += PutSize(key.size(), value_size);
+            } else if (op == OP_DELETE) {
+                const uint32_t key_size{read_size()};
+                if (ops.size() - pos < key_size) Fail("malformed record in the log");
+                const std::string_view key{ToStringView(ops.subspan(pos, key_size))};
+                pos += key_size;
+
+                const auto it{m_index.find(key)};
+                if (it != m_index.end()) {
+                    m_live_size -= PutSize(key.size(), it->second.size);
+                    m_prefix_size[Prefix(key)] -= PutSize(key.size(), it->second.size);
+                    m_key_usage -= memusage::MallocUsage(key.size());
+                    m_index.erase(it);
+                }
+            } else {
+                Fail("malformed record in the log");
+            }
+        }
+    }
+
+    /**
+     * Rebuild the index from the records of a log file. A bad record at the
+     * end of a file is left by an interrupted write and is discarded, as is
+     * anything after a bad record in the newest file. A bad record followed
+     * by more data in an older file is corruption.
+     */
+    void Replay(uint32_t id, LogFile& log_file, bool newest) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        FILE* file{log_file.file.get()};
+        if (fseek(file, 0, SEEK_END) != 0) Fail("failed to read from the log");
+        const long file_size{ftell(file)};
+        if (file_size < 0 || fseek(file, 0, SEEK_SET) != 0) Fail("failed to read from the log");
+        std::vector<std::byte> ops;
+        while (true) {
+            unsigned char header[RECORD_HEADER_SIZE];
+            const size_t header_read{fread(header, 1, sizeof(header), file)};
+            if (header_read == 0 && feof(file)) break;
+            bool complete{header_read == sizeof(header)};
+            bool at_end{!complete};
+            if (complete) {
+                ops.resize(ReadLE32(header));
+                at_end = log_file.size + RECORD_HEADER_SIZE + ops.size() >= uint64_t(file_size);
+                complete = fread(ops.data(), 1, ops.size(), file) == ops.size() && Checksum(ops) == ReadLE32(header + 4);
+            }
+            if (!complete) {
+                if (!newest && !at_end) Fail(strprintf("corrupted record in %s at offset %u", fs::PathToString(FilePath(id)), log_file.size));
+                LogPrintf("Discarding incomplete write at the end of %s\n", fs::PathToString(FilePath(id)));
+                if (!TruncateFile(file, log_file.size)) Fail("failed to truncate the log");
+                break;
+            }
+            Apply(id, log_file.size + RECORD_HEADER_SIZE, ops);
+            log_file.size += RECORD_HEADER_SIZE + ops.size();
+        }
+        m_log_size += log_file.size;
+    }
+
+    /** Copy the live entries into new log files and remove the old ones */
+    void Compact() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        const uint64_t log_size_before{m_log_size};
+        // The copies are written to new files, so the old log must be
+        // complete on disk first, like any file that writes move on from.
+        if (!m_files.empty()) SyncFile(m_files.rbegin()->second);
+        std::map<uint32_t, LogFile> old_files;
+        old_files.swap(m_files);
+        m_log_size = 0;
+
+        LogStoreBatch batch;
+        std::string value;
+        for (const auto& [key, location] : m_index) {
+            value.resize(location.size);
+            ReadAt(old_files.at(location.file), location.offset, value);
+            batch.Put(MakeByteSpan(key), MakeByteSpan(value));
+            if (batch.m_record.size() >= LOGSTORE_COMPACT_RECORD_SIZE) {
+                WriteRecord(batch, /*sync=*/false);
+                batch.Clear();
+            }
+        }
+        if (!batch.Empty()) WriteRecord(batch, /*sync=*/false);
+
+        // The new files must be on disk before the old ones are removed. Old
+        // files are removed oldest first, so that a crash in between leaves
+        // a suffix of the old log followed by the copies, which replays to
+        // the same entries. All but the newest copy were synced by
+        // ActiveFile() when writes moved on from them.
+        if (!m_memory) {
+            SyncFile(m_files.rbegin()->second);
+            DirectoryCommit(m_path);
+            for (auto& [id, log_file] : old_files) {
+                log_file.file.reset();
+                fs::remove(FilePath(id));
+            }
+        }
+        LogPrint(BCLog::LEVELDB, "Compacted log store %s from %u to %u bytes\n", fs::PathToString(m_path), log_size_before, m_log_size);
+    }
+
+public:
+    LogStore(const fs::path& path, bool memory, bool wipe) : m_path{path}, m_memory{memory}
+    {
+        if (m_memory) return;
+
+        TryCreateDirectories(m_path);
+        if (fs::exists(m_path / "CURRENT")) {
+            Fail(strprintf("%s holds a LevelDB database, use -dbbackend=leveldb", fs::PathToString(m_path)));
+        }
+        std::vector<uint32_t> ids{ListFiles()};
+        if (wipe) {
+            LogPrintf("Wiping log store in %s\n", fs::PathToString(m_path));
+            for (const uint32_t id : ids) {
+                fs::remove(FilePath(id));
+            }
+            ids.clear();
+        }
+
+        LogPrintf("Opening log store in %s\n", fs::PathToString(m_path));
+        LOCK(m_mutex);
+        for (const uint32_t id : ids) {
+            LogFile& log_file{m_files[id]};
+            OpenFile(id, log_file);
+            Replay(id, log_file, /*newest=*/id == ids.back());
+            m_next_file = id + 1;
+        }
+        LogPrintf("Opened log store with %u keys in %u bytes of log\n", m_index.size(), m_log_size);
+    }
+
+    bool Get(Bytes key, std::string& value) const override
+    {
+        LOCK(m_mutex);
+        const auto it{m_index.find(ToStringView(key))};
+        if (it == m_index.end()) return false;
+        ReadValue(it->second, value);
+        return true;
+    }
+
+    std::unique_ptr<Batch> NewBatch() const override { return std::make_unique<LogStoreBatch>(); }
+
+    void Write(Batch& batch, bool sync) override
+    {
+        LogStoreBatch& log_batch{static_cast<LogStoreBatch&>(batch)};
+        if (log_batch.Empty()) return;
+        LOCK(m_mutex);
+        WriteRecord(log_batch, sync);
+        // Compact once most of the log is overwritten or deleted entries, so
+        // that the log is at most about twice as large as the live entries.
+        if (m_log_size >= LOGSTORE_MIN_COMPACT_SIZE && m_log_size - m_live_size > m_live_size) {
+            Compact();
+        }
+    }
+
+    std::unique_ptr<DBBackend::Iterator> NewIterator() const override
+    {
+        return std::make_unique<Iterator>(*this);
+    }
+
+    /**
+     * The size of the entries of each first key byte is kept as the index
+     * changes. Within a first byte, keys are assumed to spread evenly over
+     * the next two bytes, as hashes do, so that a range starting or ending
+     * there gets a share of its size.
+     */
+    size_t EstimateSize(Bytes begin, Bytes end) const override
+    {
+        if (ToStringView(end) <= ToStringView(begin)) return 0;
+        // Position of a key among the keys sharing its first byte, in [0, 1]
+        const auto position{[](Bytes key) {
+            double pos{0};
+            if (key.size() > 1) pos += std::to_integer<uint8_t>(key[1]) / 256.0;
+            if (key.size() > 2) pos += std::to_integer<uint8_t>(key[2]) / 65536.0;
+            return pos;
+        }};
+        const unsigned first{begin.empty() ? 0U : std::to_integer<uint8_t>(begin[0])};
+        const unsigned last{end.empty() ? 0U : std::to_integer<uint8_t>(end[0])};
+        LOCK(m_mutex);
+        double size{0};
+        for (unsigned prefix{first}; prefix <= last && prefix < m_prefix_size.size(); ++prefix) {
+            const double from{prefix == first && !begin.empty() ? position(begin) : 0};
+            const double to{prefix == last ? position(end) : 1};
+            if (to > from) size += m_prefix_size[prefix] * (to - from);
+        }
+        return size;
+    }
+
+    //! The log is compacted as a whole, whatever the range.
+    void CompactRange(const Bytes* begin, const Bytes* end) override
+    {
+        LOCK(m_mutex);
+        Compact();
+    }
+
+    size_t DynamicMemoryUsage() const override
+    {
+        LOCK(m_mutex);
+        size_t usage{memusage::DynamicUsage(m_index) + m_key_usage};
+        for (const auto& [id, log_file] : m_files) {
+            usage += memusage::DynamicUsage(log_file.data);
+        }
+        return usage;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<DBBackend> MakeLogStoreBackend(const fs::path& path, bool memory, bool wipe)
+{
+    return std::make_unique<LogStore>(path, memory, wipe);
+}
@@ -6,147 +6,125 @@
 
 #include <memory>
 #include <random.h>
+#include <util/string.h>
 
-#include <leveldb/cache.h>
-#include <leveldb/env.h>
-#include <leveldb/filter_policy.h>
-#include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
 
-class CBitcoinLevelDBLogger : public leveldb::Logger {
-public:
-    // This code is adapted from posix_logger.h, which is why it is using vsprintf.
-    // Please do not do this in normal code
-    void Logv(const char * format, va_list ap) override {
-            if (!LogAcceptCategory(BCLog::LEVELDB)) {
-                return;
-            }
-            char buffer[500];
-            for (int iter = 0; iter < 2; iter++) {
-                char* base;
-                int bufsize;
-                if (iter == 0) {
-                    bufsize = sizeof(buffer);
-                    base = buffer;
-                }
-                else {
-                    bufsize = 30000;
-                    base = new char[bufsize];
-                }
-                char* p = base;
-                char* limit = base + bufsize;
-
-                // Print the message
-                if (p < limit) {
-                    va_list backup_ap;
-                    va_copy(backup_ap, ap);
-                    // Do not use vsnprintf elsewhere in bitcoin source code, see above.
-                    p += vsnprintf(p, limit - p, format, backup_ap);
-                    va_end(backup_ap);
-                }
-
-                // Truncate to available space if necessary
-                if (p >= limit) {
-                    if (iter == 0) {
-                        continue;       // Try again with larger buffer
-                    }
-                    else {
-                        p = limit - 1;
-                    }
-                }
-
-                // Add newline if necessary
-                if (p == base || p[-1] != '\n') {
-                    *p++ = '\n';
-                }
-
-                assert(p <= limit);
-                base[std::min(bufsize - 1, (int)(p - base))] = '\0';
-                LogPrintf("leveldb: %s", base);  /* Continued */
-                if (base != buffer) {
-                    delete[] base;
-                }
-                break;
-            }
+static DBTuning GetProfileTuning(const std::string& profile)
+{
+    DBTuning tuning;
+    if (profile == "default") {
+        return tuning;
+    } else if (profile == "nvme") {
+        // Random reads are cheap, so keep small blocks, but write larger
+        // files to reduce the number of files compactions go through, and
+        // spread compactions over threads, as the device serves concurrent
+        // I/O well.
+        tuning.max_file_size = 32 << 20;
+        tuning.subcompactions = 4;
+        return tuning;
+    } else if (profile == "network") {
+        // Every read is a round trip, so read more data per block, avoid
+        // reads of missing keys with larger Bloom filters and transfer fewer
+        // bytes.
+        tuning.block_size = 64 << 10;
+        tuning.bloom_bits = 16;
+        tuning.compression = true;
+        tuning.max_file_size = 64 << 20;
+        tuning.subcompactions = 4;
+        return tuning;
     }
-};
-
-static void SetMaxOpenFiles(leveldb::Options *options) {
-    // On most platforms the default setting of max_open_files (which is 1000)
-    // is optimal. On Windows using a large file count is OK because the handles
-    // do not interfere with select() loops. On 64-bit Unix hosts this value is
-    // also OK, because up to that amount LevelDB will use an mmap
-    // implementation that does not use extra file descriptors (the fds are
-    // closed after being mmap'ed).
-    //
-    // Increasing the value beyond the default is dangerous because LevelDB will
-    // fall back to a non-mmap implementation when the file count is too large.
-    // On 32-bit Unix host we should decrease the value because the handles use
-    // up real fds, and we want to avoid fd exhaustion issues.
-    //
-    // See PR #12495 for further discussion.
+    throw std::runtime_error(strprintf("Unknown -dbprofile '%s' (expected default, nvme or network)", profile));
+}
 
-    int default_open_files = options->max_open_files;
-#ifndef WIN32
-    if (sizeof(void*) < 8) {
-        options->max_open_files = 64;
-    }
-#endif
-    LogPrint(BCLog::LEVELDB, "LevelDB using max_open_files=%d (default=%d)\n",
-             options->max_open_files, default_open_files);
+std::string DBBackendName(DBBackendType backend)
+{
+    switch (backend) {
+    case DBBackendType::LEVELDB: return "leveldb";
+    case DBBackendType::LOGSTORE: return "logstore";
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+std::optional<DBBackendType> ParseDBBackend(const std::string& name)
 {
-    leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.info_log = new CBitcoinLevelDBLogger();
-    if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
-        // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
-        // on corruption in later versions.
-        options.paranoid_checks = true;
+    for (const DBBackendType backend : {DBBackendType::LEVELDB, DBBackendType::LOGSTORE}) {
+        if (name == DBBackendName(backend)) return backend;
     }
-    SetMaxOpenFiles(&options);
-    return options;
+    return std::nullopt;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
-    : m_name{fs::PathToString(path.stem())}
+DBTuning GetDBTuning(const ArgsManager& args, const std::string& db_kind)
 {
-    penv = nullptr;
-    readoptions.verify_checksums = true;
-    iteroptions.verify_checksums = true;
-    iteroptions.fill_cache = false;
-    syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
-    options.create_if_missing = true;
-    if (fMemory) {
-        penv = leveldb::NewMemEnv(leveldb::Env::Default());
-        options.env = penv;
+    DBTuning tuning{GetProfileTuning(args.GetArg("-dbprofile", DEFAULT_DB_PROFILE))};
+    const std::string backend_name{args.GetArg("-dbbackend", DBBackendName(DEFAULT_DB_BACKEND))};
+    if (const auto backend{ParseDBBackend(backend_name)}) {
+        // Log store iterators are not snapshots, while UTXO set dumps and
+        // statistics need a consistent view of the chainstate as it is
+        // being flushed to, so the chainstate always uses LevelDB.
+        if (db_kind != "chainstate") tuning.backend = *backend;
     } else {
-        if (fWipe) {
-            LogPrintf("Wiping LevelDB in %s\n", fs::PathToString(path));
-            leveldb::Status result = leveldb::DestroyDB(fs::PathToString(path), options);
-            dbwrapper_private::HandleError(result);
+        throw std::runtime_error(strprintf("Unknown -dbbackend '%s' (expected leveldb or logstore)", backend_name));
+    }
+    for (const std::string& arg : args.GetArgs("-dbtuning")) {
+        const size_t colon{arg.find(':')};
+        const size_t equals{arg.find('=')};
+        if (colon == std::string::npos || equals == std::string::npos || equals < colon) {
+            throw std::runtime_error(strprintf("Invalid -dbtuning '%s' (expected <kind>:<option>=<value>)", arg));
+        }
+        const std::string kind{arg.substr(0, colon)};
+        if (std::find(DB_TUNING_KINDS.begin(), DB_TUNING_KINDS.end(), kind) == DB_TUNING_KINDS.end()) {
+            throw std::runtime_error(strprintf("Unknown database kind '%s' in -dbtuning (expected %s)", kind, Join(DB_TUNING_KINDS, ", ")));
+        }
+        const std::string option{arg.substr(colon + 1, equals - colon - 1)};
+        int64_t value;
+        const auto parse_value{[&](int64_t min, int64_t max) {
+            if (!ParseInt64(arg.substr(equals + 1), &value) || value < min || value > max) {
+                throw std::runtime_error(strprintf("Invalid value in -dbtuning '%s' (expected %d to %d)", arg, min, max));
+            }
+        }};
+        if (option == "blocksize") {
+            parse_value(1, 1024);
+            if (kind == db_kind) tuning.block_size = value << 10;
+        } else if (option == "bloombits") {
+            parse_value(0, 64);
+            if (kind == db_kind) tuning.bloom_bits = value;
+        } else if (option == "compression") {
+            parse_value(0, 1);
+            if (kind == db_kind) tuning.compression = value;
+        } else if (option == "writebuffer") {
+            parse_value(1, 1024);
+            if (kind == db_kind) tuning.write_buffer_size = value << 20;
+        } else if (option == "maxfilesize") {
+            parse_value(1, 1024);
+            if (kind == db_kind) tuning.max_file_size = value << 20;
+        } else if (option == "subcompactions") {
+            parse_value(1, 64);
+            if (kind == db_kind) tuning.subcompactions = value;
+        } else {
+            throw std::runtime_error(strprintf("Unknown option '%s' in -dbtuning (expected blocksize, bloombits, compression, writebuffer, maxfilesize or subcompactions)", option));
         }
-        TryCreateDirectories(path);
-        LogPrintf("Opening LevelDB in %s\n", fs::PathToString(path));
     }
-    // PathToString() return value is safe to pass to leveldb open function,
-    // because on POSIX leveldb passes the byte string directly to ::open(), and
-    // on Windows it converts from UTF-8 to UTF-16 before calling ::CreateFileW
-    // (see env_posix.cc and env_windows.cc).
-    leveldb::Status status = leveldb::DB::Open(options, fs::PathToString(path), &pdb);
-    dbwrapper_private::HandleError(status);
-    LogPrintf("Opened LevelDB successfully\n");
+    return tuning;
+}
+
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const DBTuning& tuning)
+    : m_name{fs::PathToString(path.stem())}
+{
+    switch (tuning.backend) {
+    case DBBackendType::LEVELDB:
+        m_db = MakeLevelDBBackend(path, nCacheSize, fMemory, fWipe, tuning);
+        break;
+    case DBBackendType::LOGSTORE:
+        m_db = MakeLogStoreBackend(path, fMemory, fWipe);
+        break;
+    } // no default case, so the compiler can warn about missing cases
+    assert(m_db);
 
     if (gArgs.GetBoolArg("-forcecompactdb", false)) {
         LogPrintf("Starting database compaction of %s\n", fs::PathToString(path));
-        pdb->CompactRange(nullptr, nullptr);
+        m_db->CompactRange(nullptr, nullptr);
         LogPrintf("Finished database compaction of %s\n", fs::PathToString(path));
     }
 
@@ -170,19 +148,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     LogPrintf("Using obfuscation key for %s: %s\n", fs::PathToString(path), HexStr(obfuscate_key));
 }
 
-CDBWrapper::~CDBWrapper()
-{
-    delete pdb;
-    pdb = nullptr;
-    delete options.filter_policy;
-    options.filter_policy = nullptr;
-    delete options.info_log;
-    options.info_log = nullptr;
-    delete options.block_cache;
-    options.block_cache = nullptr;
-    delete penv;
-    options.env = nullptr;
-}
+CDBWrapper::~CDBWrapper() = default;
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
@@ -191,8 +157,7 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
-    leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
-    dbwrapper_private::HandleError(status);
+    m_db->Write(*batch.m_batch, fSync);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
         LogPrint(BCLog::LEVELDB, "WriteBatch memory usage: db=%s, before=%.1fMiB, after=%.1fMiB\n",
@@ -203,13 +168,7 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 
 size_t CDBWrapper::DynamicMemoryUsage() const
 {
-    std::string memory;
-    std::optional<size_t> parsed;
-    if (!pdb->GetProperty("leveldb.approximate-memory-usage", &memory) || !(parsed = ToIntegral<size_t>(memory))) {
-        LogPrint(BCLog::LEVELDB, "Failed to get approximate-memory-usage property\n");
-        return 0;
-    }
-    return parsed.value();
+    return m_db->DynamicMemoryUsage();
 }
 
 // Prefixed with null character to avoid collisions with other keys
@@ -238,23 +197,18 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
-CDBIterator::~CDBIterator() { delete piter; }
+CDBBatch::CDBBatch(const CDBWrapper& _parent)
+    : parent(_parent), m_batch(_parent.m_db->NewBatch()), ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION), size_estimate(0) {}
+
+CDBBatch::~CDBBatch() = default;
+
+CDBIterator::~CDBIterator() = default;
 bool CDBIterator::Valid() const { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
 void CDBIterator::Next() { piter->Next(); }
 
 namespace dbwrapper_private {
 
-void HandleError(const leveldb::Status& status)
-{
-    if (status.ok())
-        return;
-    const std::string errmsg = "Fatal LevelDB error: " + status.ToString();
-    LogPrintf("%s\n", errmsg);
-    LogPrintf("You can use -debug=leveldb to get more complete diagnostic messages\n");
-    throw dbwrapper_error(errmsg);
-}
-
 const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w)
 {
     return w.obfuscate_key;
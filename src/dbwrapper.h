@@ -6,6 +6,7 @@
 #define BITCOIN_DBWRAPPER_H
 
 #include <clientversion.h>
+#include <dbbackend.h>
 #include <fs.h>
 #include <serialize.h>
 #include <span.h>
@@ -13,17 +14,25 @@
 #include <util/strencodings.h>
 #include <util/system.h>
 
-#include <leveldb/db.h>
-#include <leveldb/write_batch.h>
+#include <memory>
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
-class dbwrapper_error : public std::runtime_error
-{
-public:
-    explicit dbwrapper_error(const std::string& msg) : std::runtime_error(msg) {}
-};
+//! Kinds of databases that can be tuned separately with -dbtuning
+static const std::vector<std::string> DB_TUNING_KINDS{"chainstate", "blockindex", "indexes"};
+//! -dbprofile default
+static const std::string DEFAULT_DB_PROFILE{"default"};
+//! -dbbackend default
+static constexpr DBBackendType DEFAULT_DB_BACKEND{DBBackendType::LEVELDB};
+
+/**
+ * Return the tuning of a kind of database: the -dbbackend storage engine
+ * (always LevelDB for the chainstate) and the preset of the -dbprofile
+ * profile with the -dbtuning overrides for that kind applied. Throws
+ * std::runtime_error if an option is invalid.
+ */
+DBTuning GetDBTuning(const ArgsManager& args, const std::string& db_kind);
 
 class CDBWrapper;
 
@@ -31,10 +40,6 @@ class CDBWrapper;
  */
 namespace dbwrapper_private {
 
-/** Handle database error by throwing dbwrapper_error exception.
- */
-void HandleError(const leveldb::Status& status);
-
 /** Work around circular dependency, as well as for testing in dbwrapper_tests.
  * Database obfuscation should be considered an implementation detail of the
  * specific database.
@@ -50,7 +55,7 @@ class CDBBatch
 
 private:
     const CDBWrapper &parent;
-    leveldb::WriteBatch batch;
+    const std::unique_ptr<DBBackend::Batch> m_batch;
 
     CDataStream ssKey;
     CDataStream ssValue;
@@ -61,11 +66,12 @@ public:
     /**
      * @param[in] _parent   CDBWrapper that this batch is to be submitted to
      */
-    explicit CDBBatch(const CDBWrapper &_parent) : parent(_parent), ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION), size_estimate(0) { };
+    explicit CDBBatch(const CDBWrapper &_parent);
+    ~CDBBatch();
 
     void Clear()
     {
-        batch.Clear();
+        m_batch->Clear();
         size_estimate = 0;
     }
 
@@ -74,14 +80,14 @@ public:
     {
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
-        leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
+        const Span<const std::byte> slKey{ssKey};
 
         ssValue.reserve(DBWRAPPER_PREALLOC_VALUE_SIZE);
         ssValue << value;
         ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
-        leveldb::Slice slValue((const char*)ssValue.data(), ssValue.size());
+        const Span<const std::byte> slValue{ssValue};
 
-        batch.Put(slKey, slValue);
+        m_batch->Put(slKey, slValue);
         // LevelDB serializes writes as:
         // - byte: header
         // - varint: key length (1 byte up to 127B, 2 bytes up to 16383B, ...)
@@ -99,9 +105,9 @@ public:
     {
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
-        leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
+        const Span<const std::byte> slKey{ssKey};
 
-        batch.Delete(slKey);
+        m_batch->Delete(slKey);
         // LevelDB serializes erases as:
         // - byte: header
         // - varint: key length
@@ -118,16 +124,16 @@ class CDBIterator
 {
 private:
     const CDBWrapper &parent;
-    leveldb::Iterator *piter;
+    const std::unique_ptr<DBBackend::Iterator> piter;
 
 public:
 
     /**
      * @param[in] _parent          Parent CDBWrapper instance.
-     * @param[in] _piter           The original leveldb iterator.
+     * @param[in] _piter           The iterator of the storage backend.
      */
-    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter) :
-        parent(_parent), piter(_piter) { };
+    CDBIterator(const CDBWrapper &_parent, std::unique_ptr<DBBackend::Iterator> _piter) :
+        parent(_parent), piter(std::move(_piter)) { };
     ~CDBIterator();
 
     bool Valid() const;
@@ -138,16 +144,14 @@ public:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
-        leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
-        piter->Seek(slKey);
+        piter->Seek(ssKey);
     }
 
     void Next();
 
     template<typename K> bool GetKey(K& key) {
-        leveldb::Slice slKey = piter->key();
         try {
-            CDataStream ssKey{MakeByteSpan(slKey), SER_DISK, CLIENT_VERSION};
+            CDataStream ssKey{piter->Key(), SER_DISK, CLIENT_VERSION};
             ssKey >> key;
         } catch (const std::exception&) {
             return false;
@@ -156,9 +160,8 @@ public:
     }
 
     template<typename V> bool GetValue(V& value) {
-        leveldb::Slice slValue = piter->value();
         try {
-            CDataStream ssValue{MakeByteSpan(slValue), SER_DISK, CLIENT_VERSION};
+            CDataStream ssValue{piter->Value(), SER_DISK, CLIENT_VERSION};
             ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
             ssValue >> value;
         } catch (const std::exception&) {
@@ -168,7 +171,7 @@ public:
     }
 
     unsigned int GetValueSize() {
-        return piter->value().size();
+        return piter->Value().size();
     }
 
 };
@@ -176,27 +179,10 @@ public:
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
+    friend class CDBBatch;
 private:
-    //! custom environment this database is using (may be nullptr in case of default environment)
-    leveldb::Env* penv;
-
-    //! database options used
-    leveldb::Options options;
-
-    //! options used when reading from the database
-    leveldb::ReadOptions readoptions;
-
-    //! options used when iterating over values of the database
-    leveldb::ReadOptions iteroptions;
-
-    //! options used when writing to the database
-    leveldb::WriteOptions writeoptions;
-
-    //! options used when sync writing to the database
-    leveldb::WriteOptions syncoptions;
-
-    //! the database itself
-    leveldb::DB* pdb;
+    //! the storage backend holding the database
+    std::unique_ptr<DBBackend> m_db;
 
     //! the name of this database
     std::string m_name;
@@ -214,14 +200,15 @@ private:
 
 public:
     /**
-     * @param[in] path        Location in the filesystem where leveldb data will be stored.
+     * @param[in] path        Location in the filesystem where the database will be stored.
      * @param[in] nCacheSize  Configures various leveldb cache settings.
-     * @param[in] fMemory     If true, use leveldb's memory environment.
+     * @param[in] fMemory     If true, keep the database in memory only.
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] tuning      Storage backend and LevelDB block, filter, compression and file settings.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const DBTuning& tuning = {});
     ~CDBWrapper();
 
     CDBWrapper(const CDBWrapper&) = delete;
@@ -233,15 +220,10 @@ public:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
-        leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
-        if (!status.ok()) {
-            if (status.IsNotFound())
-                return false;
-            LogPrintf("LevelDB read failure: %s\n", status.ToString());
-            dbwrapper_private::HandleError(status);
+        if (!m_db->Get(ssKey, strValue)) {
+            return false;
         }
         try {
             CDataStream ssValue{MakeByteSpan(strValue), SER_DISK, CLIENT_VERSION};
@@ -267,15 +249,10 @@ public:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
-        leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
-        if (!status.ok()) {
-            if (status.IsNotFound())
-                return false;
-            LogPrintf("LevelDB read failure: %s\n", status.ToString());
-            dbwrapper_private::HandleError(status);
+        if (!m_db->Get(ssKey, strValue)) {
+            return false;
         }
         return true;
     }
@@ -290,12 +267,12 @@ public:
 
     bool WriteBatch(CDBBatch& batch, bool fSync = false);
 
-    // Get an estimate of LevelDB memory usage (in bytes).
+    // Get an estimate of the memory usage of the storage backend (in bytes).
     size_t DynamicMemoryUsage() const;
 
     CDBIterator *NewIterator()
     {
-        return new CDBIterator(*this, pdb->NewIterator(iteroptions));
+        return new CDBIterator(*this, m_db->NewIterator());
     }
 
     /**
@@ -311,12 +288,7 @@ public:
         ssKey2.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey1 << key_begin;
         ssKey2 << key_end;
-        leveldb::Slice slKey1((const char*)ssKey1.data(), ssKey1.size());
-        leveldb::Slice slKey2((const char*)ssKey2.data(), ssKey2.size());
-        uint64_t size = 0;
-        leveldb::Range range(slKey1, slKey2);
-        pdb->GetApproximateSizes(&range, 1, &size);
-        return size;
+        return m_db->EstimateSize(ssKey1, ssKey2);
     }
 
     /**
@@ -330,9 +302,8 @@ public:
         ssKey2.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey1 << key_begin;
         ssKey2 << key_end;
-        leveldb::Slice slKey1((const char*)ssKey1.data(), ssKey1.size());
-        leveldb::Slice slKey2((const char*)ssKey2.data(), ssKey2.size());
-        pdb->CompactRange(&slKey1, &slKey2);
+        const Span<const std::byte> slKey1{ssKey1}, slKey2{ssKey2};
+        m_db->CompactRange(&slKey1, &slKey2);
     }
 };
 
@@ -0,0 +1,403 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <crypto/sha256.h>
+#include <node/blockstorage.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+using node::ReadBlockFromDisk;
+using node::UndoReadFromDisk;
+
+constexpr uint8_t DB_ADDRESS_HISTORY{'a'};
+constexpr uint8_t DB_ADDRESS_UTXO{'u'};
+constexpr uint8_t DB_BLOCK_UNDO{'U'};
+constexpr uint8_t DB_LAST_BLOCK{'L'};
+
+std::unique_ptr<AddressIndex> g_address_index;
+
+namespace {
+
+uint256 HashScript(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+struct DBHistoryKey {
+    uint256 script_hash;
+    int height;
+    uint32_t tx_pos;
+    bool spend;
+    uint32_t n;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_HISTORY);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, tx_pos);
+        ser_writedata8(s, spend);
+        ser_writedata32be(s, n);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_ADDRESS_HISTORY) {
+            throw std::ios_base::failure("Invalid format for addressindex DB history key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        tx_pos = ser_readdata32be(s);
+        spend = ser_readdata8(s);
+        n = ser_readdata32be(s);
+    }
+};
+
+struct DBHistoryValue {
+    uint256 txid;
+    CAmount amount;
+
+    SERIALIZE_METHODS(DBHistoryValue, obj)
+    {
+        READWRITE(obj.txid, VARINT_MODE(obj.amount, VarIntMode::NONNEGATIVE_SIGNED));
+    }
+};
+
+struct DBUtxoKey {
+    uint256 script_hash;
+    int height;
+    uint256 txid;
+    uint32_t n;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_UTXO);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        s << txid;
+        ser_writedata32be(s, n);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_ADDRESS_UTXO) {
+            throw std::ios_base::failure("Invalid format for addressindex DB utxo key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        s >> txid;
+        n = ser_readdata32be(s);
+    }
+};
+
+struct DBUtxoValue {
+    CAmount amount;
+    bool coinbase;
+
+    SERIALIZE_METHODS(DBUtxoValue, obj)
+    {
+        READWRITE(VARINT_MODE(obj.amount, VarIntMode::NONNEGATIVE_SIGNED), obj.coinbase);
+    }
+};
+
+/** Index entries for the outputs and inputs of a block */
+struct AddressEntries : public BaseIndex::BlockData {
+    std::vector<std::pair<DBHistoryKey, DBHistoryValue>> history;
+    std::vector<std::pair<DBUtxoKey, DBUtxoValue>> created;
+    std::vector<std::pair<DBUtxoKey, DBUtxoValue>> spent;
+};
+
+void CollectEntries(const CBlock& block, const CBlockUndo& block_undo, int height, AddressEntries& entries)
+{
+    for (uint32_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx{*block.vtx[i]};
+
+        for (uint32_t j = 0; j < tx.vout.size(); ++j) {
+            const CTxOut& out{tx.vout[j]};
+            if (out.scriptPubKey.IsUnspendable()) continue;
+
+            const uint256 script_hash{HashScript(out.scriptPubKey)};
+            entries.history.emplace_back(DBHistoryKey{script_hash, height, i, false, j}, DBHistoryValue{tx.GetHash(), out.nValue});
+            entries.created.emplace_back(DBUtxoKey{script_hash, height, tx.GetHash(), j}, DBUtxoValue{out.nValue, tx.IsCoinBase()});
+        }
+
+        // The coinbase tx has no undo data since no former output is spent
+        if (tx.IsCoinBase()) continue;
+        const CTxUndo& tx_undo{block_undo.vtxundo.at(i - 1)};
+        for (uint32_t j = 0; j < tx.vin.size(); ++j) {
+            const COutPoint& prevout{tx.vin[j].prevout};
+            const Coin& coin{tx_undo.vprevout.at(j)};
+
+            const uint256 script_hash{HashScript(coin.out.scriptPubKey)};
+            entries.history.emplace_back(DBHistoryKey{script_hash, height, i, true, j}, DBHistoryValue{tx.GetHash(), coin.out.nValue});
+            entries.spent.emplace_back(DBUtxoKey{script_hash, static_cast<int>(coin.nHeight), prevout.hash, prevout.n}, DBUtxoValue{coin.out.nValue, static_cast<bool>(coin.fCoinBase)});
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * What is needed to remove the entries of a recently written block, without
+ * reading it from disk. Blocks written just before an unclean shutdown may be
+ * missing from the block index after restarting.
+ */
+struct AddressIndex::BlockUndo {
+    uint256 prev_hash;
+    std::vector<DBHistoryKey> history;
+    std::vector<DBUtxoKey> created;
+    std::vector<std::pair<DBUtxoKey, DBUtxoValue>> spent;
+
+    SERIALIZE_METHODS(BlockUndo, obj) { READWRITE(obj.prev_hash, obj.history, obj.created, obj.spent); }
+};
+
+/** Access to the address index database (indexes/addressindex/) */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::Init()
+{
+    if (!BaseIndex::Init()) return false;
+
+    // Blocks are written as they are indexed, while the best block locator is
+    // only committed from time to time. After an unclean shutdown, reverse the
+    // blocks written past the locator, and write again the ones between the
+    // locator and a fork point the entries were rewound to.
+    uint256 last_block_hash;
+    if (!m_db->Read(DB_LAST_BLOCK, last_block_hash)) return true;
+
+    const CBlockIndex* best_block{CurrentIndex()};
+    if (best_block && best_block->GetBlockHash() == last_block_hash) return true;
+
+    // Walk back from the last block written until reaching the active branch
+    // of the locator, using the undo records of the blocks on the way.
+    const CBlockIndex* fork{nullptr};
+    uint256 block_hash{last_block_hash};
+    while (!block_hash.IsNull()) {
+        const CBlockIndex* pindex{WITH_LOCK(::cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block_hash))};
+        if (pindex && best_block && best_block->GetAncestor(pindex->nHeight) == pindex) {
+            fork = pindex;
+            break;
+        }
+        BlockUndo undo;
+        if (!ReadBlockUndo(block_hash, pindex, undo) || !ReverseBlock(block_hash, undo)) return false;
+        block_hash = undo.prev_hash;
+    }
+
+    std::vector<const CBlockIndex*> replay;
+    for (const CBlockIndex* pindex{best_block}; pindex != fork; pindex = pindex->pprev) {
+        replay.push_back(pindex);
+    }
+    for (auto it = replay.rbegin(); it != replay.rend(); ++it) {
+        if (!ReplayBlock(*it)) return false;
+    }
+    return true;
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo block_undo;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+
+    const auto data{PrepareBlock(block, block_undo, pindex)};
+    return data && WritePreparedBlock(pindex, *data);
+}
+
+std::unique_ptr<BaseIndex::BlockData> AddressIndex::PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const
+{
+    auto entries{std::make_unique<AddressEntries>()};
+
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight > 0) CollectEntries(block, block_undo, pindex->nHeight, *entries);
+    return entries;
+}
+
+bool AddressIndex::WritePreparedBlock(const CBlockIndex* pindex, BlockData& data)
+{
+    const AddressEntries& entries{static_cast<AddressEntries&>(data)};
+
+    BlockUndo undo;
+    if (pindex->pprev) undo.prev_hash = pindex->pprev->GetBlockHash();
+    undo.spent = entries.spent;
+
+    CDBBatch batch(*m_db);
+    for (const auto& [key, value] : entries.history) {
+        batch.Write(key, value);
+        undo.history.push_back(key);
+    }
+    for (const auto& [key, value] : entries.created) {
+        batch.Write(key, value);
+        undo.created.push_back(key);
+    }
+    // Erased after writing the outputs created, which may be spent in the same block.
+    for (const auto& [key, value] : entries.spent) batch.Erase(key);
+
+    batch.Write(std::make_pair(DB_BLOCK_UNDO, pindex->GetBlockHash()), undo);
+    if (pindex->nHeight >= static_cast<int>(MIN_BLOCKS_TO_KEEP)) {
+        batch.Erase(std::make_pair(DB_BLOCK_UNDO, pindex->GetAncestor(pindex->nHeight - MIN_BLOCKS_TO_KEEP)->GetBlockHash()));
+    }
+    batch.Write(DB_LAST_BLOCK, pindex->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool AddressIndex::ReadBlockUndo(const uint256& block_hash, const CBlockIndex* pindex, BlockUndo& undo) const
+{
+    if (m_db->Read(std::make_pair(DB_BLOCK_UNDO, block_hash), undo)) return true;
+
+    // Undo records are only kept for the most recent blocks. Older ones are
+    // read from disk, which needs the block to be in the block index.
+    if (!pindex) {
+        return error("%s: Cannot find block %s to remove from %s; index may be corrupted",
+                     __func__, block_hash.ToString(), GetName());
+    }
+    AddressEntries entries;
+    if (pindex->nHeight > 0) {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()) || !UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, block_hash.ToString());
+        }
+        CollectEntries(block, block_undo, pindex->nHeight, entries);
+    }
+    undo.prev_hash = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256{};
+    for (const auto& [key, value] : entries.history) undo.history.push_back(key);
+    for (const auto& [key, value] : entries.created) undo.created.push_back(key);
+    undo.spent = std::move(entries.spent);
+    return true;
+}
+
+bool AddressIndex::ReverseBlock(const uint256& block_hash, const BlockUndo& undo)
+{
+    CDBBatch batch(*m_db);
+    for (const auto& key : undo.history) batch.Erase(key);
+    for (const auto& [key, value] : undo.spent) batch.Write(key, value);
+    // Erased after restoring the outputs spent, which may have been created in the same block.
+    for (const auto& key : undo.created) batch.Erase(key);
+    batch.Erase(std::make_pair(DB_BLOCK_UNDO, block_hash));
+    if (!undo.prev_hash.IsNull()) {
+        batch.Write(DB_LAST_BLOCK, undo.prev_hash);
+    } else {
+        batch.Erase(DB_LAST_BLOCK);
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool AddressIndex::ReplayBlock(const CBlockIndex* pindex)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        return error("%s: Failed to read block %s from disk",
+                     __func__, pindex->GetBlockHash().ToString());
+    }
+    return WriteBlock(block, pindex);
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    for (const CBlockIndex* pindex{current_tip}; pindex != new_tip; pindex = pindex->pprev) {
+        BlockUndo undo;
+        if (!ReadBlockUndo(pindex->GetBlockHash(), pindex, undo) || !ReverseBlock(pindex->GetBlockHash(), undo)) {
+            return false;
+        }
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::FindHistory(const CScript& script, int start_height, size_t skip, size_t count, std::vector<AddressHistoryEntry>& entries) const
+{
+    const uint256 script_hash{HashScript(script)};
+    std::unique_ptr<CDBIterator> db_it{m_db->NewIterator()};
+
+    DBHistoryKey key{script_hash, std::max(start_height, 0), 0, false, 0};
+    for (db_it->Seek(key); db_it->Valid() && entries.size() < count; db_it->Next()) {
+        if (!db_it->GetKey(key) || key.script_hash != script_hash) break;
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+        DBHistoryValue value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: Cannot read %s history entry", __func__, GetName());
+        }
+        entries.push_back({value.txid, key.height, key.tx_pos, key.spend, key.n, value.amount});
+    }
+    return true;
+}
+
+bool AddressIndex::FindUtxos(const CScript& script, size_t skip, size_t count, std::vector<AddressUtxo>& utxos) const
+{
+    const uint256 script_hash{HashScript(script)};
+    std::unique_ptr<CDBIterator> db_it{m_db->NewIterator()};
+
+    DBUtxoKey key{script_hash, 0, uint256{}, 0};
+    for (db_it->Seek(key); db_it->Valid() && utxos.size() < count; db_it->Next()) {
+        if (!db_it->GetKey(key) || key.script_hash != script_hash) break;
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+        DBUtxoValue value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: Cannot read %s utxo entry", __func__, GetName());
+        }
+        utxos.push_back({COutPoint{key.txid, key.n}, key.height, value.amount, value.coinbase});
+    }
+    return true;
+}
+
+bool AddressIndex::GetBalance(const CScript& script, CAmount& balance, uint64_t& utxo_count) const
+{
+    const uint256 script_hash{HashScript(script)};
+    std::unique_ptr<CDBIterator> db_it{m_db->NewIterator()};
+
+    balance = 0;
+    utxo_count = 0;
+    DBUtxoKey key{script_hash, 0, uint256{}, 0};
+    for (db_it->Seek(key); db_it->Valid(); db_it->Next()) {
+        if (!db_it->GetKey(key) || key.script_hash != script_hash) break;
+        DBUtxoValue value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: Cannot read %s utxo entry", __func__, GetName());
+        }
+        balance += value.amount;
+        ++utxo_count;
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <consensus/amount.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <vector>
+
+class CScript;
+
+/** An output paying to a script, or an input spending from it */
+struct AddressHistoryEntry {
+    uint256 txid;
+    int height;
+    /** Position of the transaction in its block */
+    uint32_t tx_pos;
+    /** Whether this is an input spending an output of the script */
+    bool spend;
+    /** Index of the output or input in the transaction */
+    uint32_t n;
+    CAmount amount;
+};
+
+/** An unspent output paying to a script */
+struct AddressUtxo {
+    COutPoint outpoint;
+    int height;
+    CAmount amount;
+    bool coinbase;
+};
+
+/**
+ * AddressIndex is used to look up the transaction history and unspent outputs
+ * of an output script. Entries are keyed by the SHA256 hash of the script
+ * followed by the block height, so the history or unspent outputs of a script
+ * are read with a single range scan, in chain order.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+    struct BlockUndo;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    bool AllowPrune() const override { return true; }
+
+    /// Get what is needed to remove the entries of a block. pindex may be
+    /// null if the block is not in the block index.
+    bool ReadBlockUndo(const uint256& block_hash, const CBlockIndex* pindex, BlockUndo& undo) const;
+
+    /// Remove the entries of a block being disconnected.
+    bool ReverseBlock(const uint256& block_hash, const BlockUndo& undo);
+
+    /// Apply the entries of a block again.
+    bool ReplayBlock(const CBlockIndex* pindex);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool AllowParallelSync() const override { return true; }
+
+    bool RequiresBlockUndo() const override { return true; }
+
+    std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlockIndex* pindex, BlockData& data) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Look up the outputs paying to a script and the inputs spending them,
+    /// in chain order.
+    ///
+    /// @param[in]   script  The output script.
+    /// @param[in]   start_height  Skip blocks below this height.
+    /// @param[in]   skip  Number of entries to skip after start_height.
+    /// @param[in]   count  Maximum number of entries to return.
+    /// @param[out]  entries  The history entries found.
+    /// @return  false on database errors
+    bool FindHistory(const CScript& script, int start_height, size_t skip, size_t count, std::vector<AddressHistoryEntry>& entries) const;
+
+    /// Look up the unspent outputs paying to a script, in chain order.
+    bool FindUtxos(const CScript& script, size_t skip, size_t count, std::vector<AddressUtxo>& utxos) const;
+
+    /// Sum the unspent outputs paying to a script.
+    bool GetBalance(const CScript& script, CAmount& balance, uint64_t& utxo_count) const;
+};
+
+/// The global address index. May be null.
+extern std::unique_ptr<AddressIndex> g_address_index;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
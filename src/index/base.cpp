@@ -4,23 +4,34 @@
 
 #include <chainparams.h>
 #include <index/base.h>
+#include <index/blockreader.h>
 #include <node/blockstorage.h>
 #include <node/ui_interface.h>
 #include <shutdown.h>
 #include <tinyformat.h>
+#include <undo.h>
 #include <util/syscall_sandbox.h>
 #include <util/thread.h>
+#include <util/threadnames.h>
 #include <util/translation.h>
 #include <validation.h> // For g_chainman
 #include <warnings.h>
 
-using node::ReadBlockFromDisk;
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <optional>
+
 
 constexpr uint8_t DB_BEST_BLOCK{'B'};
 
 constexpr auto SYNC_LOG_INTERVAL{30s};
 constexpr auto SYNC_LOCATOR_WRITE_INTERVAL{30s};
 
+/** Number of blocks prepared ahead of the sync thread, per worker thread */
+constexpr size_t SYNC_PREFETCH_BLOCKS_PER_THREAD{32};
+
 template <typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
 {
@@ -32,7 +43,7 @@ static void FatalError(const char* fmt, const Args&... args)
 }
 
 BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
-    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate)
+    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate, GetDBTuning(gArgs, "indexes"))
 {}
 
 bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
@@ -107,6 +118,131 @@ bool BaseIndex::Init()
     return true;
 }
 
+namespace {
+/**
+ * Runs a prepare function for blocks on a set of worker threads, ahead of the
+ * index sync thread. Blocks are scheduled in chain order and their results
+ * are handed back in the same order.
+ */
+class BlockPrefetcher
+{
+public:
+    using PrepareFn = std::function<std::unique_ptr<BaseIndex::BlockData>(const CBlockIndex*)>;
+
+private:
+    struct Job {
+        const CBlockIndex* pindex;
+        std::unique_ptr<BaseIndex::BlockData> data{};
+        bool done{false};
+    };
+
+    const PrepareFn m_prepare;
+    mutable Mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    /** Scheduled jobs in chain order. Those before m_next_job have been picked up by a worker. */
+    std::deque<std::shared_ptr<Job>> m_jobs GUARDED_BY(m_mutex);
+    size_t m_next_job GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_workers;
+
+    void Loop() LOCKS_EXCLUDED(m_mutex)
+    {
+        SetSyscallSandboxPolicy(SyscallSandboxPolicy::TX_INDEX);
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_work_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || m_next_job < m_jobs.size(); });
+                if (m_stop) return;
+                job = m_jobs[m_next_job++];
+            }
+            auto data{m_prepare(job->pindex)};
+            {
+                LOCK(m_mutex);
+                job->data = std::move(data);
+                job->done = true;
+            }
+            m_done_cv.notify_all();
+        }
+    }
+
+public:
+    BlockPrefetcher(const std::string& name, int threads, PrepareFn prepare) : m_prepare{std::move(prepare)}
+    {
+        for (int n = 0; n < threads; ++n) {
+            m_workers.emplace_back([this, thread_name = strprintf("%s.%d", name, n)] {
+                util::ThreadRename(std::string{thread_name});
+                Loop();
+            });
+        }
+    }
+
+    ~BlockPrefetcher()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_work_cv.notify_all();
+        for (std::thread& worker : m_workers) worker.join();
+    }
+
+    size_t Size() const LOCKS_EXCLUDED(m_mutex) { return WITH_LOCK(m_mutex, return m_jobs.size()); }
+
+    /** The block that Pop() will return next, or nullptr if nothing is scheduled. */
+    const CBlockIndex* Front() const LOCKS_EXCLUDED(m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_jobs.empty() ? nullptr : m_jobs.front()->pindex;
+    }
+
+    /** The block scheduled last, or nullptr if nothing is scheduled. */
+    const CBlockIndex* Back() const LOCKS_EXCLUDED(m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_jobs.empty() ? nullptr : m_jobs.back()->pindex;
+    }
+
+    void Schedule(const CBlockIndex* pindex) LOCKS_EXCLUDED(m_mutex)
+    {
+        WITH_LOCK(m_mutex, m_jobs.push_back(std::make_shared<Job>(Job{pindex})));
+        m_work_cv.notify_one();
+    }
+
+    /** Wait for the first scheduled block to be prepared and return its data. */
+    std::unique_ptr<BaseIndex::BlockData> Pop() LOCKS_EXCLUDED(m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        assert(!m_jobs.empty());
+        m_done_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_jobs.front()->done; });
+        auto data{std::move(m_jobs.front()->data)};
+        m_jobs.pop_front();
+        --m_next_job;
+        return data;
+    }
+
+    /** Drop all scheduled blocks, waiting for the ones already being prepared. */
+    void Clear() LOCKS_EXCLUDED(m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_jobs.resize(m_next_job);
+        m_done_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+            return std::all_of(m_jobs.begin(), m_jobs.end(), [](const auto& job) { return job->done; });
+        });
+        m_jobs.clear();
+        m_next_job = 0;
+    }
+};
+
+/** Registration of a syncing index with g_shared_block_reader */
+class SharedReaderHandle
+{
+public:
+    const SharedBlockReader::ReaderId id;
+
+    explicit SharedReaderHandle(int height) : id{g_shared_block_reader.Register(height)} {}
+    ~SharedReaderHandle() { g_shared_block_reader.Unregister(id); }
+};
+} // namespace
+
 static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindex_prev, CChain& chain) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
@@ -128,7 +264,32 @@ void BaseIndex::ThreadSync()
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::TX_INDEX);
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
-        auto& consensus_params = Params().GetConsensus();
+        m_sync_start_time = std::chrono::steady_clock::now();
+        m_sync_blocks = 0;
+
+        // Blocks are read through g_shared_block_reader, so that indexes
+        // catching up at the same time read each block from disk once.
+        const SharedReaderHandle reader{pindex ? pindex->nHeight : -1};
+        const auto read_block = [this, &reader](const CBlockIndex* block_index, SharedBlock& shared) {
+            if (!g_shared_block_reader.Read(reader.id, block_index, RequiresBlockUndo(), m_interrupt, shared)) {
+                return false;
+            }
+            if (shared.shared) ++m_shared_block_reads;
+            return true;
+        };
+        const auto prepare_block = [this, &read_block](const CBlockIndex* block_index) -> std::unique_ptr<BlockData> {
+            SharedBlock shared;
+            if (!read_block(block_index, shared)) return nullptr;
+            return PrepareBlock(*shared.block, shared.undo ? *shared.undo : CBlockUndo{}, block_index);
+        };
+
+        std::optional<BlockPrefetcher> prefetcher;
+        size_t prefetch_blocks{0};
+        if (m_sync_threads > 1 && AllowParallelSync()) {
+            LogPrintf("Syncing %s using %d threads\n", GetName(), m_sync_threads);
+            prefetch_blocks = SYNC_PREFETCH_BLOCKS_PER_THREAD * m_sync_threads;
+            prefetcher.emplace(GetName(), m_sync_threads, prepare_block);
+        }
 
         std::chrono::steady_clock::time_point last_log_time{0s};
         std::chrono::steady_clock::time_point last_locator_write_time{0s};
@@ -158,6 +319,21 @@ void BaseIndex::ThreadSync()
                     return;
                 }
                 pindex = pindex_next;
+
+                if (prefetcher) {
+                    // Blocks scheduled before a reorg no longer follow the index
+                    // best block, start over from the next block to write.
+                    if (prefetcher->Front() != pindex) {
+                        prefetcher->Clear();
+                        prefetcher->Schedule(pindex);
+                    }
+                    const CBlockIndex* pindex_last{prefetcher->Back()};
+                    while (prefetcher->Size() < prefetch_blocks) {
+                        pindex_last = m_chainstate->m_chain.Next(pindex_last);
+                        if (!pindex_last) break;
+                        prefetcher->Schedule(pindex_last);
+                    }
+                }
             }
 
             auto current_time{std::chrono::steady_clock::now()};
@@ -174,17 +350,40 @@ void BaseIndex::ThreadSync()
                 Commit();
             }
 
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
+            bool written;
+            if (AllowParallelSync()) {
+                const auto data{prefetcher ? prefetcher->Pop() : prepare_block(pindex)};
+                if (!data) {
+                    // Reading was interrupted, the block's parent is the last one written.
+                    if (m_interrupt) {
+                        pindex = pindex->pprev;
+                        continue;
+                    }
+                    FatalError("%s: Failed to read or prepare block %s for index",
+                               __func__, pindex->GetBlockHash().ToString());
+                    return;
+                }
+                written = WritePreparedBlock(pindex, *data);
+            } else {
+                SharedBlock shared;
+                if (!read_block(pindex, shared)) {
+                    if (m_interrupt) {
+                        pindex = pindex->pprev;
+                        continue;
+                    }
+                    FatalError("%s: Failed to read block %s from disk",
+                               __func__, pindex->GetBlockHash().ToString());
+                    return;
+                }
+                written = WriteBlock(*shared.block, pindex);
             }
-            if (!WriteBlock(block, pindex)) {
+            if (!written) {
                 FatalError("%s: Failed to write block %s to index database",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             }
+            g_shared_block_reader.SetPosition(reader.id, pindex->nHeight);
+            ++m_sync_blocks;
         }
     }
 
@@ -346,9 +545,10 @@ void BaseIndex::Interrupt()
     m_interrupt();
 }
 
-bool BaseIndex::Start(CChainState& active_chainstate)
+bool BaseIndex::Start(CChainState& active_chainstate, int sync_threads)
 {
     m_chainstate = &active_chainstate;
+    m_sync_threads = sync_threads;
     // Need to register this ValidationInterface before running Init(), so that
     // callbacks are not missed if Init sets m_synced to true.
     RegisterValidationInterface(this);
@@ -375,6 +575,13 @@ IndexSummary BaseIndex::GetSummary() const
     summary.name = GetName();
     summary.synced = m_synced;
     summary.best_block_height = m_best_block_index ? m_best_block_index.load()->nHeight : 0;
+    const int chain_height{m_chainstate ? WITH_LOCK(::cs_main, return m_chainstate->m_chain.Height()) : 0};
+    summary.progress = summary.synced || chain_height <= 0 ? 1.0 : std::min(1.0, double(summary.best_block_height) / chain_height);
+    if (!summary.synced) {
+        const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - m_sync_start_time.load()};
+        if (elapsed.count() > 0) summary.blocks_per_second = m_sync_blocks / elapsed.count();
+    }
+    summary.shared_block_reads = m_shared_block_reads;
     return summary;
 }
 
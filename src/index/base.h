@@ -9,14 +9,28 @@
 #include <threadinterrupt.h>
 #include <validationinterface.h>
 
+#include <chrono>
+
 class CBlock;
 class CBlockIndex;
+class CBlockUndo;
 class CChainState;
 
+/** Default number of threads reading and preparing blocks while building indexes (0 = auto) */
+static constexpr int DEFAULT_INDEX_SYNC_THREADS{0};
+/** Maximum number of threads reading and preparing blocks while building indexes */
+static constexpr int MAX_INDEX_SYNC_THREADS{16};
+
 struct IndexSummary {
     std::string name;
     bool synced{false};
     int best_block_height{0};
+    /// Fraction of the active chain the index is synced with
+    double progress{0};
+    /// Blocks per second indexed since the sync started, 0 once synced
+    double blocks_per_second{0};
+    /// Blocks that were read from disk once for several indexes syncing at the same time
+    uint64_t shared_block_reads{0};
 };
 
 /**
@@ -26,6 +40,13 @@ struct IndexSummary {
  */
 class BaseIndex : public CValidationInterface
 {
+public:
+    /// Index data for a block that can be computed without knowing the index
+    /// state at its parent. Subclasses supporting parallel sync derive from it.
+    struct BlockData {
+        virtual ~BlockData() = default;
+    };
+
 protected:
     /**
      * The database stores a block locator of the chain the database is synced to
@@ -59,11 +80,25 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    /// Number of threads reading blocks and calling PrepareBlock ahead of the
+    /// sync thread. The index is synced serially if this is 1 or lower, or if
+    /// the subclass does not AllowParallelSync.
+    int m_sync_threads{0};
+
+    /// Time the current sync started, and blocks written since
+    std::atomic<std::chrono::steady_clock::time_point> m_sync_start_time{};
+    std::atomic<uint64_t> m_sync_blocks{0};
+    std::atomic<uint64_t> m_shared_block_reads{0};
+
     /// Sync the index with the block index starting from the current best block.
     /// Intended to be run in its own thread, m_thread_sync, and can be
     /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
     /// flag is set and the BlockConnected ValidationInterface callback takes
     /// over and the sync thread exits.
+    ///
+    /// In parallel mode, blocks are read and prepared by m_sync_threads worker
+    /// threads up to a fixed distance ahead, while this thread writes the
+    /// prepared blocks and commits the locator in chain order.
     void ThreadSync();
 
     /// Write the current index state (eg. chain block locator and subclass-specific items) to disk.
@@ -93,6 +128,23 @@ protected:
     /// Write update index entries for a newly connected block.
     virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
 
+    /// Whether the index implements PrepareBlock and WritePreparedBlock, so that
+    /// ThreadSync can prepare blocks on worker threads.
+    virtual bool AllowParallelSync() const { return false; }
+
+    /// Whether PrepareBlock needs the undo data of the block.
+    virtual bool RequiresBlockUndo() const { return false; }
+
+    /// Compute the order-independent index data for a block. Called from sync
+    /// worker threads in no particular order, so it must not read or modify the
+    /// index state. block_undo is empty unless RequiresBlockUndo. Returns
+    /// nullptr on failure.
+    virtual std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const { return nullptr; }
+
+    /// Write index entries for a block from the data returned by PrepareBlock.
+    /// Called in chain order, like WriteBlock.
+    virtual bool WritePreparedBlock(const CBlockIndex* pindex, BlockData& data) { return false; }
+
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
     virtual bool CommitInternal(CDBBatch& batch);
@@ -124,7 +176,9 @@ public:
 
     /// Start initializes the sync state and registers the instance as a
     /// ValidationInterface so that it stays in sync with blockchain updates.
-    [[nodiscard]] bool Start(CChainState& active_chainstate);
+    /// If sync_threads is greater than 1, blocks are read and prepared on that
+    /// many threads while catching up with the chain.
+    [[nodiscard]] bool Start(CChainState& active_chainstate, int sync_threads = 0);
 
     /// Stops the instance from staying in sync with blockchain updates.
     void Stop();
@@ -2,10 +2,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
 #include <map>
+#include <numeric>
 
 #include <dbwrapper.h>
 #include <index/blockfilterindex.h>
+#include <memusage.h>
 #include <node/blockstorage.h>
 #include <util/system.h>
 
@@ -94,8 +97,9 @@ struct DBHashKey {
 static std::map<BlockFilterType, BlockFilterIndex> g_filter_indexes;
 
 BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type,
-                                   size_t n_cache_size, bool f_memory, bool f_wipe)
-    : m_filter_type(filter_type)
+                                   size_t n_cache_size, bool f_memory, bool f_wipe,
+                                   size_t filter_cache_size)
+    : m_filter_type(filter_type), m_filter_cache_max_usage(filter_cache_size)
 {
     const std::string& filter_name = BlockFilterTypeName(filter_type);
     if (filter_name.empty()) throw std::invalid_argument("unknown filter_type");
@@ -163,6 +167,43 @@ bool BlockFilterIndex::ReadFilterFromDisk(const FlatFilePos& pos, BlockFilter& f
     return true;
 }
 
+bool BlockFilterIndex::ReadFiltersFromDisk(const std::vector<FlatFilePos>& positions, std::vector<BlockFilter>& filters_out) const
+{
+    filters_out.resize(positions.size());
+
+    size_t i = 0;
+    while (i < positions.size()) {
+        const int file_num = positions[i].nFile;
+        CAutoFile filein(m_filter_fileseq->Open(positions[i], true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return false;
+        }
+
+        // Filters of consecutive blocks are usually stored next to each other, in which case no
+        // seek is needed between them.
+        unsigned int file_pos = positions[i].nPos;
+        for (; i < positions.size() && positions[i].nFile == file_num; ++i) {
+            if (positions[i].nPos != file_pos && fseek(filein.Get(), positions[i].nPos, SEEK_SET)) {
+                return error("%s: fseek(...) failed in filter file %d", __func__, file_num);
+            }
+
+            uint256 block_hash;
+            std::vector<uint8_t> encoded_filter;
+            try {
+                filein >> block_hash >> encoded_filter;
+                file_pos = positions[i].nPos + GetSerializeSize(block_hash, CLIENT_VERSION) +
+                           GetSerializeSize(encoded_filter, CLIENT_VERSION);
+                filters_out[i] = BlockFilter(GetFilterType(), block_hash, std::move(encoded_filter));
+            }
+            catch (const std::exception& e) {
+                return error("%s: Failed to deserialize block filter from disk: %s", __func__, e.what());
+            }
+        }
+    }
+
+    return true;
+}
+
 size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter& filter)
 {
     assert(filter.GetFilterType() == GetFilterType());
@@ -209,16 +250,37 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
     return data_size;
 }
 
+namespace {
+/** Filter constructed for a block, before its header is chained to the previous one */
+struct FilterData : public BaseIndex::BlockData {
+    BlockFilter filter;
+};
+} // namespace
+
 bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
 {
     CBlockUndo block_undo;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+
+    const auto data{PrepareBlock(block, block_undo, pindex)};
+    return data && WritePreparedBlock(pindex, *data);
+}
+
+std::unique_ptr<BaseIndex::BlockData> BlockFilterIndex::PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const
+{
+    auto data{std::make_unique<FilterData>()};
+    data->filter = BlockFilter(m_filter_type, block, block_undo);
+    return data;
+}
+
+bool BlockFilterIndex::WritePreparedBlock(const CBlockIndex* pindex, BlockData& data)
+{
+    const BlockFilter& filter{static_cast<FilterData&>(data).filter};
     uint256 prev_header;
 
     if (pindex->nHeight > 0) {
-        if (!UndoReadFromDisk(block_undo, pindex)) {
-            return false;
-        }
-
         std::pair<uint256, DBVal> read_out;
         if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
             return false;
@@ -233,8 +295,6 @@ bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex
         prev_header = read_out.second.header;
     }
 
-    BlockFilter filter(m_filter_type, block, block_undo);
-
     size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter);
     if (bytes_written == 0) return false;
 
@@ -374,14 +434,67 @@ static bool LookupRange(CDBWrapper& db, const std::string& index_name, int start
     return true;
 }
 
+static size_t FilterCacheUsage(const BlockFilter& filter)
+{
+    // List node holding the filter, plus the map node pointing to it.
+    return memusage::DynamicUsage(filter.GetEncodedFilter()) +
+           memusage::MallocUsage(sizeof(BlockFilter) + 2 * sizeof(void*)) +
+           memusage::MallocUsage(sizeof(std::pair<const uint256, std::list<BlockFilter>::iterator>) + sizeof(void*));
+}
+
+bool BlockFilterIndex::GetCachedFilter(const uint256& block_hash, BlockFilter& filter_out) const
+{
+    AssertLockHeld(m_cs_filter_cache);
+
+    auto it = m_filter_cache.find(block_hash);
+    if (it == m_filter_cache.end()) return false;
+
+    m_filter_cache_lru.splice(m_filter_cache_lru.begin(), m_filter_cache_lru, it->second);
+    filter_out = *it->second;
+    return true;
+}
+
+void BlockFilterIndex::CacheFilter(const BlockFilter& filter) const
+{
+    AssertLockHeld(m_cs_filter_cache);
+
+    const size_t usage = FilterCacheUsage(filter);
+    if (usage > m_filter_cache_max_usage) return;
+    if (m_filter_cache.count(filter.GetBlockHash())) return;
+
+    while (m_filter_cache_usage + usage > m_filter_cache_max_usage) {
+        const BlockFilter& oldest = m_filter_cache_lru.back();
+        m_filter_cache_usage -= FilterCacheUsage(oldest);
+        m_filter_cache.erase(oldest.GetBlockHash());
+        m_filter_cache_lru.pop_back();
+    }
+
+    m_filter_cache_lru.push_front(filter);
+    m_filter_cache.emplace(filter.GetBlockHash(), m_filter_cache_lru.begin());
+    m_filter_cache_usage += usage;
+}
+
 bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
 {
+    if (m_filter_cache_max_usage > 0) {
+        LOCK(m_cs_filter_cache);
+        if (GetCachedFilter(block_index->GetBlockHash(), filter_out)) return true;
+    }
+
     DBVal entry;
     if (!LookupOne(*m_db, block_index, entry)) {
         return false;
     }
 
-    return ReadFilterFromDisk(entry.pos, filter_out);
+    if (!ReadFilterFromDisk(entry.pos, filter_out)) {
+        return false;
+    }
+
+    if (m_filter_cache_max_usage > 0) {
+        LOCK(m_cs_filter_cache);
+        CacheFilter(filter_out);
+    }
+    return true;
 }
 
 bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out)
@@ -417,18 +530,54 @@ bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint25
 bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* stop_index,
                                          std::vector<BlockFilter>& filters_out) const
 {
+    if (start_height < 0) {
+        return error("%s: start height (%d) is negative", __func__, start_height);
+    }
+    if (start_height > stop_index->nHeight) {
+        return error("%s: start height (%d) is greater than stop height (%d)",
+                     __func__, start_height, stop_index->nHeight);
+    }
+    filters_out.resize(static_cast<size_t>(stop_index->nHeight - start_height + 1));
+
+    // Take the filters found in the cache first, so that a range served from memory does not
+    // touch the database.
+    std::vector<size_t> missing;
+    if (m_filter_cache_max_usage > 0) {
+        LOCK(m_cs_filter_cache);
+        for (const CBlockIndex* block_index = stop_index;
+             block_index && block_index->nHeight >= start_height;
+             block_index = block_index->pprev) {
+            const size_t i = static_cast<size_t>(block_index->nHeight - start_height);
+            if (!GetCachedFilter(block_index->GetBlockHash(), filters_out[i])) missing.push_back(i);
+        }
+        std::reverse(missing.begin(), missing.end());
+    } else {
+        missing.resize(filters_out.size());
+        std::iota(missing.begin(), missing.end(), 0);
+    }
+    if (missing.empty()) return true;
+
+    // Look up the positions of the missing filters and read them from disk in one pass.
+    const int first_missing_height = start_height + static_cast<int>(missing.front());
+    const CBlockIndex* last_missing_index = stop_index->GetAncestor(start_height + static_cast<int>(missing.back()));
     std::vector<DBVal> entries;
-    if (!LookupRange(*m_db, m_name, start_height, stop_index, entries)) {
+    if (!LookupRange(*m_db, m_name, first_missing_height, last_missing_index, entries)) {
         return false;
     }
 
-    filters_out.resize(entries.size());
-    auto filter_pos_it = filters_out.begin();
-    for (const auto& entry : entries) {
-        if (!ReadFilterFromDisk(entry.pos, *filter_pos_it)) {
-            return false;
-        }
-        ++filter_pos_it;
+    std::vector<FlatFilePos> positions;
+    positions.reserve(missing.size());
+    for (const size_t i : missing) positions.push_back(entries[i - missing.front()].pos);
+
+    std::vector<BlockFilter> filters_read;
+    if (!ReadFiltersFromDisk(positions, filters_read)) {
+        return false;
+    }
+
+    LOCK(m_cs_filter_cache);
+    for (size_t j = 0; j < missing.size(); ++j) {
+        if (m_filter_cache_max_usage > 0) CacheFilter(filters_read[j]);
+        filters_out[missing[j]] = std::move(filters_read[j]);
     }
 
     return true;
@@ -463,12 +612,14 @@ void ForEachBlockFilterIndex(std::function<void (BlockFilterIndex&)> fn)
 }
 
 bool InitBlockFilterIndex(BlockFilterType filter_type,
-                          size_t n_cache_size, bool f_memory, bool f_wipe)
+                          size_t n_cache_size, bool f_memory, bool f_wipe,
+                          size_t filter_cache_size)
 {
     auto result = g_filter_indexes.emplace(std::piecewise_construct,
                                            std::forward_as_tuple(filter_type),
                                            std::forward_as_tuple(filter_type,
-                                                                 n_cache_size, f_memory, f_wipe));
+                                                                 n_cache_size, f_memory, f_wipe,
+                                                                 filter_cache_size));
     return result.second;
 }
 
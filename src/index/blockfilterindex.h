@@ -11,9 +11,14 @@
 #include <index/base.h>
 #include <util/hasher.h>
 
+#include <list>
+
 /** Interval between compact filter checkpoints. See BIP 157. */
 static constexpr int CFCHECKPT_INTERVAL = 1000;
 
+/** Default for -blockfiltercache, the memory used to keep recently read filters (MiB) */
+static constexpr int64_t DEFAULT_BLOCK_FILTER_CACHE_SIZE{32};
+
 /**
  * BlockFilterIndex is used to store and retrieve block filters, hashes, and headers for a range of
  * blocks by height. An index is constructed for each supported filter type with its own database
@@ -32,12 +37,26 @@ private:
     std::unique_ptr<FlatFileSeq> m_filter_fileseq;
 
     bool ReadFilterFromDisk(const FlatFilePos& pos, BlockFilter& filter) const;
+    /** Read filters stored at the given positions, opening each filter file once and reading
+     *  filters stored next to each other sequentially. */
+    bool ReadFiltersFromDisk(const std::vector<FlatFilePos>& positions, std::vector<BlockFilter>& filters_out) const;
     size_t WriteFilterToDisk(FlatFilePos& pos, const BlockFilter& filter);
 
     Mutex m_cs_headers_cache;
     /** cache of block hash to filter header, to avoid disk access when responding to getcfcheckpt. */
     std::unordered_map<uint256, uint256, FilterHeaderHasher> m_headers_cache GUARDED_BY(m_cs_headers_cache);
 
+    mutable Mutex m_cs_filter_cache;
+    /** Filters recently read from disk, most recently used first. Filters are keyed by block
+     *  hash, so entries never go stale on a reorg. */
+    mutable std::list<BlockFilter> m_filter_cache_lru GUARDED_BY(m_cs_filter_cache);
+    mutable std::unordered_map<uint256, std::list<BlockFilter>::iterator, FilterHeaderHasher> m_filter_cache GUARDED_BY(m_cs_filter_cache);
+    mutable size_t m_filter_cache_usage GUARDED_BY(m_cs_filter_cache){0};
+    const size_t m_filter_cache_max_usage;
+
+    bool GetCachedFilter(const uint256& block_hash, BlockFilter& filter_out) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_filter_cache);
+    void CacheFilter(const BlockFilter& filter) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_filter_cache);
+
     bool AllowPrune() const override { return true; }
 
 protected:
@@ -47,6 +66,14 @@ protected:
 
     bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
 
+    bool AllowParallelSync() const override { return true; }
+
+    bool RequiresBlockUndo() const override { return true; }
+
+    std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlockIndex* pindex, BlockData& data) override;
+
     bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
 
     BaseIndex::DB& GetDB() const override { return *m_db; }
@@ -56,7 +83,8 @@ protected:
 public:
     /** Constructs the index, which becomes available to be queried. */
     explicit BlockFilterIndex(BlockFilterType filter_type,
-                              size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+                              size_t n_cache_size, bool f_memory = false, bool f_wipe = false,
+                              size_t filter_cache_size = 0);
 
     BlockFilterType GetFilterType() const { return m_filter_type; }
 
@@ -89,7 +117,8 @@ void ForEachBlockFilterIndex(std::function<void (BlockFilterIndex&)> fn);
  * a new index is created and false if one has already been initialized.
  */
 bool InitBlockFilterIndex(BlockFilterType filter_type,
-                          size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+                          size_t n_cache_size, bool f_memory = false, bool f_wipe = false,
+                          size_t filter_cache_size = 0);
 
 /**
  * Destroy the block filter index with the given type. Returns false if no such index exists. This
@@ -0,0 +1,171 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockreader.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <serialize.h>
+#include <threadinterrupt.h>
+#include <undo.h>
+#include <util/time.h>
+#include <version.h>
+
+#include <algorithm>
+#include <limits>
+
+using node::ReadBlockFromDisk;
+using node::UndoReadFromDisk;
+
+/** How long to wait for other readers before checking for interrupts again */
+static constexpr auto SHARED_READER_WAIT_INTERVAL{100ms};
+
+SharedBlockReader g_shared_block_reader;
+
+SharedBlockReader::ReaderId SharedBlockReader::Register(int height)
+{
+    LOCK(m_mutex);
+    const ReaderId id{m_next_id++};
+    m_positions.emplace(id, height);
+    return id;
+}
+
+void SharedBlockReader::Unregister(ReaderId id)
+{
+    {
+        LOCK(m_mutex);
+        m_positions.erase(id);
+        Trim();
+    }
+    m_cv.notify_all();
+}
+
+void SharedBlockReader::SetPosition(ReaderId id, int height)
+{
+    {
+        LOCK(m_mutex);
+        m_positions.at(id) = height;
+        Trim();
+    }
+    m_cv.notify_all();
+}
+
+bool SharedBlockReader::IsWanted(ReaderId id, int height) const
+{
+    AssertLockHeld(m_mutex);
+    return std::any_of(m_positions.begin(), m_positions.end(), [&](const auto& reader) {
+        return reader.first != id && reader.second < height && height - reader.second <= 2 * SHARED_READER_MAX_SKEW;
+    });
+}
+
+bool SharedBlockReader::MustWait(ReaderId id, int height) const
+{
+    AssertLockHeld(m_mutex);
+    const int position{m_positions.at(id)};
+    return std::any_of(m_positions.begin(), m_positions.end(), [&](const auto& reader) {
+        return reader.first != id && reader.second <= position &&
+               position - reader.second <= SHARED_READER_MAX_SKEW &&
+               height - reader.second > SHARED_READER_MAX_SKEW;
+    });
+}
+
+void SharedBlockReader::Trim()
+{
+    AssertLockHeld(m_mutex);
+    int min_position{std::numeric_limits<int>::max()};
+    for (const auto& [id, position] : m_positions) {
+        min_position = std::min(min_position, position);
+    }
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        const bool passed{it->first.first <= min_position};
+        if (!it->second.loading && (passed || m_cache_size > SHARED_READER_CACHE_SIZE)) {
+            m_cache_size -= it->second.size;
+            it = m_cache.erase(it);
+        } else if (!passed && m_cache_size <= SHARED_READER_CACHE_SIZE) {
+            break;
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool SharedBlockReader::Read(ReaderId id, const CBlockIndex* pindex, bool with_undo, const CThreadInterrupt& interrupt, SharedBlock& result)
+{
+    const bool read_undo{with_undo && pindex->nHeight > 0};
+    const auto key{std::make_pair(pindex->nHeight, pindex)};
+    result = SharedBlock{};
+
+    // Find the block in the cache, or claim it for reading from disk.
+    bool cache_result{false};
+    {
+        WAIT_LOCK(m_mutex, lock);
+        while (true) {
+            if (interrupt) return false;
+            auto it{m_cache.find(key)};
+            if (it != m_cache.end()) {
+                Entry& entry{it->second};
+                if (entry.loading) {
+                    m_cv.wait_for(lock, SHARED_READER_WAIT_INTERVAL);
+                    continue;
+                }
+                result.block = entry.block;
+                result.shared = true;
+                if (!read_undo || entry.undo) {
+                    if (read_undo) result.undo = entry.undo;
+                    return true;
+                }
+                entry.loading = true;
+                cache_result = true;
+                break;
+            }
+            if (MustWait(id, pindex->nHeight)) {
+                m_cv.wait_for(lock, SHARED_READER_WAIT_INTERVAL);
+                continue;
+            }
+            if (IsWanted(id, pindex->nHeight)) {
+                m_cache[key].loading = true;
+                cache_result = true;
+            }
+            break;
+        }
+    }
+
+    bool success{true};
+    if (!result.block) {
+        auto block{std::make_shared<CBlock>()};
+        success = ReadBlockFromDisk(*block, pindex, Params().GetConsensus());
+        result.block = std::move(block);
+    }
+    if (success && read_undo) {
+        auto undo{std::make_shared<CBlockUndo>()};
+        success = UndoReadFromDisk(*undo, pindex);
+        result.undo = std::move(undo);
+    }
+
+    if (cache_result) {
+        {
+            LOCK(m_mutex);
+            auto it{m_cache.find(key)};
+            assert(it != m_cache.end());
+            Entry& entry{it->second};
+            entry.loading = false;
+            if (success) {
+                m_cache_size -= entry.size;
+                entry.block = result.block;
+                if (read_undo) entry.undo = result.undo;
+                entry.size = ::GetSerializeSize(*entry.block, PROTOCOL_VERSION);
+                if (entry.undo) entry.size += ::GetSerializeSize(*entry.undo, CLIENT_VERSION);
+                m_cache_size += entry.size;
+            } else if (!entry.block) {
+                m_cache.erase(it);
+            }
+            Trim();
+        }
+        m_cv.notify_all();
+    }
+    return success;
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BLOCKREADER_H
+#define BITCOIN_INDEX_BLOCKREADER_H
+
+#include <sync.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+class CThreadInterrupt;
+
+/** Blocks a reader may run ahead of another reader syncing close behind it */
+static constexpr int SHARED_READER_MAX_SKEW{128};
+/** Maximum serialized size of the blocks and undo data kept for readers that are behind */
+static constexpr size_t SHARED_READER_CACHE_SIZE{256 << 20};
+
+/** A block and its undo data, as handed out by SharedBlockReader */
+struct SharedBlock {
+    std::shared_ptr<const CBlock> block;
+    /** Null if undo data was not requested or for the genesis block */
+    std::shared_ptr<const CBlockUndo> undo;
+    /** Whether the block was read from disk by another reader */
+    bool shared{false};
+};
+
+/**
+ * Reads blocks and undo data for indexes that are catching up with the chain,
+ * so that a block is read and deserialized once when several indexes sync at
+ * the same time.
+ *
+ * Each syncing index registers as a reader and reports the height it has
+ * written up to. A block read from disk is kept in memory while another
+ * reader still has to get to it, up to SHARED_READER_CACHE_SIZE. To keep
+ * readers that sync at different speeds within reach of the cache, a reader
+ * waits before reading a block more than SHARED_READER_MAX_SKEW blocks ahead
+ * of a reader close behind it. Readers far apart do not wait for each other.
+ */
+class SharedBlockReader
+{
+public:
+    using ReaderId = uint64_t;
+
+private:
+    struct Entry {
+        std::shared_ptr<const CBlock> block;
+        std::shared_ptr<const CBlockUndo> undo;
+        size_t size{0};
+        /** Set while a reader is reading the block or its undo data from disk */
+        bool loading{false};
+    };
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    ReaderId m_next_id GUARDED_BY(m_mutex){0};
+    /** Height each registered reader has written up to */
+    std::map<ReaderId, int> m_positions GUARDED_BY(m_mutex);
+    /** Blocks read for readers that are behind, ordered by height */
+    std::map<std::pair<int, const CBlockIndex*>, Entry> m_cache GUARDED_BY(m_mutex);
+    size_t m_cache_size GUARDED_BY(m_mutex){0};
+
+    /** Whether another reader will get to the block at this height */
+    bool IsWanted(ReaderId id, int height) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    /** Whether the reader should wait before reading the block at this height from disk */
+    bool MustWait(ReaderId id, int height) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    /** Drop cached blocks that all readers are past, and the lowest ones beyond the cache size */
+    void Trim() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    ReaderId Register(int height) LOCKS_EXCLUDED(m_mutex);
+    void Unregister(ReaderId id) LOCKS_EXCLUDED(m_mutex);
+
+    /** Update the height the reader has written up to. */
+    void SetPosition(ReaderId id, int height) LOCKS_EXCLUDED(m_mutex);
+
+    /**
+     * Get a block, and its undo data if with_undo is set. Returns false if
+     * reading from disk failed, or if interrupted while waiting for slower
+     * readers.
+     */
+    bool Read(ReaderId id, const CBlockIndex* pindex, bool with_undo, const CThreadInterrupt& interrupt, SharedBlock& result) LOCKS_EXCLUDED(m_mutex);
+};
+
+/** The reader shared by all indexes */
+extern SharedBlockReader g_shared_block_reader;
+
+#endif // BITCOIN_INDEX_BLOCKREADER_H
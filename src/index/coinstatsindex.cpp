@@ -109,34 +109,43 @@ CoinStatsIndex::CoinStatsIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
     m_db = std::make_unique<CoinStatsIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
 }
 
+namespace {
+/** Changes a single block makes to the UTXO set statistics */
+struct StatsDelta : public BaseIndex::BlockData {
+    MuHash3072 muhash;
+    int64_t transaction_output_count{0};
+    int64_t bogo_size{0};
+    CAmount total_amount{0};
+    CAmount subsidy{0};
+    CAmount unspendable_amount{0};
+    CAmount prevout_spent_amount{0};
+    CAmount new_outputs_ex_coinbase_amount{0};
+    CAmount coinbase_amount{0};
+    CAmount unspendables_genesis_block{0};
+    CAmount unspendables_bip30{0};
+    CAmount unspendables_scripts{0};
+};
+} // namespace
+
 bool CoinStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
 {
     CBlockUndo block_undo;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+
+    const auto data{PrepareBlock(block, block_undo, pindex)};
+    return data && WritePreparedBlock(pindex, *data);
+}
+
+std::unique_ptr<BaseIndex::BlockData> CoinStatsIndex::PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const
+{
+    auto delta{std::make_unique<StatsDelta>()};
     const CAmount block_subsidy{GetBlockSubsidy(pindex->nHeight, Params().GetConsensus())};
-    m_total_subsidy += block_subsidy;
+    delta->subsidy = block_subsidy;
 
     // Ignore genesis block
     if (pindex->nHeight > 0) {
-        if (!UndoReadFromDisk(block_undo, pindex)) {
-            return false;
-        }
-
-        std::pair<uint256, DBVal> read_out;
-        if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
-            return false;
-        }
-
-        uint256 expected_block_hash{pindex->pprev->GetBlockHash()};
-        if (read_out.first != expected_block_hash) {
-            LogPrintf("WARNING: previous block header belongs to unexpected block %s; expected %s\n",
-                      read_out.first.ToString(), expected_block_hash.ToString());
-
-            if (!m_db->Read(DBHashKey(expected_block_hash), read_out)) {
-                return error("%s: previous block header not found; expected %s",
-                             __func__, expected_block_hash.ToString());
-            }
-        }
-
         // TODO: Deduplicate BIP30 related code
         bool is_bip30_block{(pindex->nHeight == 91722 && pindex->GetBlockHash() == uint256S("0x00000000000271a2dc26e7667f8419f2e15416dc6955e5a6c6cdf3f2574dd08e")) ||
                             (pindex->nHeight == 91812 && pindex->GetBlockHash() == uint256S("0x00000000000af0aed4792b1acee3d966af36cf5def14935db8de83d6f9306f2f"))};
@@ -147,8 +156,8 @@ bool CoinStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
 
             // Skip duplicate txid coinbase transactions (BIP30).
             if (is_bip30_block && tx->IsCoinBase()) {
-                m_total_unspendable_amount += block_subsidy;
-                m_total_unspendables_bip30 += block_subsidy;
+                delta->unspendable_amount += block_subsidy;
+                delta->unspendables_bip30 += block_subsidy;
                 continue;
             }
 
@@ -159,22 +168,22 @@ bool CoinStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
 
                 // Skip unspendable coins
                 if (coin.out.scriptPubKey.IsUnspendable()) {
-                    m_total_unspendable_amount += coin.out.nValue;
-                    m_total_unspendables_scripts += coin.out.nValue;
+                    delta->unspendable_amount += coin.out.nValue;
+                    delta->unspendables_scripts += coin.out.nValue;
                     continue;
                 }
 
-                m_muhash.Insert(MakeUCharSpan(TxOutSer(outpoint, coin)));
+                delta->muhash.Insert(MakeUCharSpan(TxOutSer(outpoint, coin)));
 
                 if (tx->IsCoinBase()) {
-                    m_total_coinbase_amount += coin.out.nValue;
+                    delta->coinbase_amount += coin.out.nValue;
                 } else {
-                    m_total_new_outputs_ex_coinbase_amount += coin.out.nValue;
+                    delta->new_outputs_ex_coinbase_amount += coin.out.nValue;
                 }
 
-                ++m_transaction_output_count;
-                m_total_amount += coin.out.nValue;
-                m_bogo_size += GetBogoSize(coin.out.scriptPubKey);
+                ++delta->transaction_output_count;
+                delta->total_amount += coin.out.nValue;
+                delta->bogo_size += GetBogoSize(coin.out.scriptPubKey);
             }
 
             // The coinbase tx has no undo data since no former output is spent
@@ -185,22 +194,60 @@ bool CoinStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
                     Coin coin{tx_undo.vprevout[j]};
                     COutPoint outpoint{tx->vin[j].prevout.hash, tx->vin[j].prevout.n};
 
-                    m_muhash.Remove(MakeUCharSpan(TxOutSer(outpoint, coin)));
+                    delta->muhash.Remove(MakeUCharSpan(TxOutSer(outpoint, coin)));
 
-                    m_total_prevout_spent_amount += coin.out.nValue;
+                    delta->prevout_spent_amount += coin.out.nValue;
 
-                    --m_transaction_output_count;
-                    m_total_amount -= coin.out.nValue;
-                    m_bogo_size -= GetBogoSize(coin.out.scriptPubKey);
+                    --delta->transaction_output_count;
+                    delta->total_amount -= coin.out.nValue;
+                    delta->bogo_size -= GetBogoSize(coin.out.scriptPubKey);
                 }
             }
         }
     } else {
         // genesis block
-        m_total_unspendable_amount += block_subsidy;
-        m_total_unspendables_genesis_block += block_subsidy;
+        delta->unspendable_amount += block_subsidy;
+        delta->unspendables_genesis_block += block_subsidy;
     }
 
+    return delta;
+}
+
+bool CoinStatsIndex::WritePreparedBlock(const CBlockIndex* pindex, BlockData& data)
+{
+    const StatsDelta& delta{static_cast<StatsDelta&>(data)};
+
+    if (pindex->nHeight > 0) {
+        std::pair<uint256, DBVal> read_out;
+        if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
+            return false;
+        }
+
+        uint256 expected_block_hash{pindex->pprev->GetBlockHash()};
+        if (read_out.first != expected_block_hash) {
+            LogPrintf("WARNING: previous block header belongs to unexpected block %s; expected %s\n",
+                      read_out.first.ToString(), expected_block_hash.ToString());
+
+            if (!m_db->Read(DBHashKey(expected_block_hash), read_out)) {
+                return error("%s: previous block header not found; expected %s",
+                             __func__, expected_block_hash.ToString());
+            }
+        }
+    }
+
+    m_muhash *= delta.muhash;
+    m_transaction_output_count += delta.transaction_output_count;
+    m_bogo_size += delta.bogo_size;
+    m_total_amount += delta.total_amount;
+    m_total_subsidy += delta.subsidy;
+    m_total_unspendable_amount += delta.unspendable_amount;
+    m_total_prevout_spent_amount += delta.prevout_spent_amount;
+    m_total_new_outputs_ex_coinbase_amount += delta.new_outputs_ex_coinbase_amount;
+    m_total_coinbase_amount += delta.coinbase_amount;
+    m_total_unspendables_genesis_block += delta.unspendables_genesis_block;
+    m_total_unspendables_bip30 += delta.unspendables_bip30;
+    m_total_unspendables_scripts += delta.unspendables_scripts;
+
     // If spent prevouts + block subsidy are still a higher amount than
     // new outputs + coinbase + current unspendable amount this means
     // the miner did not claim the full block reward. Unclaimed block
@@ -45,6 +45,14 @@ protected:
 
     bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
 
+    bool AllowParallelSync() const override { return true; }
+
+    bool RequiresBlockUndo() const override { return true; }
+
+    std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlockIndex* pindex, BlockData& data) override;
+
     bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
 
     BaseIndex::DB& GetDB() const override { return *m_db; }
@@ -0,0 +1,142 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <node/blockstorage.h>
+#include <serialize.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+using node::ReadBlockFromDisk;
+
+constexpr uint8_t DB_SPENT{'s'};
+
+std::unique_ptr<SpentIndex> g_spent_index;
+
+namespace {
+
+struct DBSpentKey {
+    uint256 txid;
+    uint32_t n;
+
+    explicit DBSpentKey(const COutPoint& outpoint) : txid{outpoint.hash}, n{outpoint.n} {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_SPENT);
+        s << txid;
+        ser_writedata32be(s, n);
+    }
+};
+
+struct DBSpentValue {
+    uint256 txid;
+    uint32_t vin;
+    int height;
+    uint256 block_hash;
+
+    SERIALIZE_METHODS(DBSpentValue, obj)
+    {
+        READWRITE(obj.txid, VARINT(obj.vin), VARINT_MODE(obj.height, VarIntMode::NONNEGATIVE_SIGNED), obj.block_hash);
+    }
+};
+
+/** The outputs spent in a block and their spending inputs */
+struct SpentEntries : public BaseIndex::BlockData {
+    std::vector<std::pair<COutPoint, DBSpentValue>> spends;
+};
+
+void CollectSpends(const CBlock& block, const CBlockIndex& index, SpentEntries& entries)
+{
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (uint32_t i = 0; i < tx->vin.size(); ++i) {
+            entries.spends.emplace_back(tx->vin[i].prevout, DBSpentValue{tx->GetHash(), i, index.nHeight, index.GetBlockHash()});
+        }
+    }
+}
+
+} // namespace
+
+/** Access to the spent index database (indexes/spentindex/) */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+SpentIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe)
+{}
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<SpentIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+bool SpentIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    const auto data{PrepareBlock(block, CBlockUndo{}, pindex)};
+    return data && WritePreparedBlock(pindex, *data);
+}
+
+std::unique_ptr<BaseIndex::BlockData> SpentIndex::PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const
+{
+    auto entries{std::make_unique<SpentEntries>()};
+    CollectSpends(block, *pindex, *entries);
+    return entries;
+}
+
+bool SpentIndex::WritePreparedBlock(const CBlockIndex* pindex, BlockData& data)
+{
+    const auto& spends{static_cast<SpentEntries&>(data).spends};
+    if (spends.empty()) return true;
+
+    CDBBatch batch(*m_db);
+    for (const auto& [outpoint, value] : spends) {
+        batch.Write(DBSpentKey{outpoint}, value);
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool SpentIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex{current_tip}; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                batch.Erase(DBSpentKey{txin.prevout});
+            }
+        }
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+bool SpentIndex::FindSpend(const COutPoint& outpoint, SpentIndexEntry& entry) const
+{
+    DBSpentValue value;
+    if (!m_db->Read(DBSpentKey{outpoint}, value)) {
+        return false;
+    }
+    entry = {value.txid, value.vin, value.height, value.block_hash};
+    return true;
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SPENTINDEX_H
+#define BITCOIN_INDEX_SPENTINDEX_H
+
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+/** The confirmed input spending an output */
+struct SpentIndexEntry {
+    uint256 txid;
+    /** Index of the input in the spending transaction */
+    uint32_t vin;
+    /** Height of the block containing the spending transaction */
+    int height;
+    /** Hash of the block containing the spending transaction */
+    uint256 block_hash;
+};
+
+/**
+ * SpentIndex is used to look up the transaction spending an output. The index
+ * is written to a LevelDB database and records, for each output spent in the
+ * blockchain, the spending transaction, input index, block height and block
+ * hash.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Blocks are only read again to remove them on a reorg, which does not
+    /// reach pruned blocks.
+    bool AllowPrune() const override { return true; }
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool AllowParallelSync() const override { return true; }
+
+    std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlockIndex* pindex, BlockData& data) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Look up the input spending an output.
+    ///
+    /// Entries written for blocks that were lost in an unclean shutdown are
+    /// not removed, so callers should check that the block of the entry is
+    /// in the active chain before relying on the result.
+    ///
+    /// @param[in]   outpoint  The output.
+    /// @param[out]  entry  The spending input.
+    /// @return  true if a spend is found, false otherwise
+    bool FindSpend(const COutPoint& outpoint, SpentIndexEntry& entry) const;
+};
+
+/// The global spent index. May be null.
+extern std::unique_ptr<SpentIndex> g_spent_index;
+
+#endif // BITCOIN_INDEX_SPENTINDEX_H
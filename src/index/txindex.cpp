@@ -6,15 +6,25 @@
 
 #include <index/disktxpos.h>
 #include <node/blockstorage.h>
+#include <undo.h>
 #include <util/system.h>
 #include <validation.h>
 
+using node::BLOCK_RECORD_COMPRESSED;
+using node::DecompressBlockData;
 using node::OpenBlockFile;
+using node::g_block_file_writer;
 
 constexpr uint8_t DB_TXINDEX{'t'};
 
 std::unique_ptr<TxIndex> g_txindex;
 
+namespace {
+/** Disk positions of the transactions in a block */
+struct TxPositions : public BaseIndex::BlockData {
+    std::vector<std::pair<uint256, CDiskTxPos>> v_pos;
+};
+} // namespace
 
 /** Access to the txindex database (indexes/txindex/) */
 class TxIndex::DB : public BaseIndex::DB
@@ -56,19 +66,33 @@ TxIndex::~TxIndex() {}
 
 bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
 {
+    const auto data{PrepareBlock(block, CBlockUndo{}, pindex)};
+    return data && WritePreparedBlock(pindex, *data);
+}
+
+std::unique_ptr<BaseIndex::BlockData> TxIndex::PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const
+{
+    auto data{std::make_unique<TxPositions>()};
+
     // Exclude genesis block transaction because outputs are not spendable.
-    if (pindex->nHeight == 0) return true;
+    if (pindex->nHeight == 0) return data;
 
     CDiskTxPos pos{
         WITH_LOCK(::cs_main, return pindex->GetBlockPos()),
         GetSizeOfCompactSize(block.vtx.size())};
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
+    data->v_pos.reserve(block.vtx.size());
     for (const auto& tx : block.vtx) {
-        vPos.emplace_back(tx->GetHash(), pos);
+        data->v_pos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
-    return m_db->WriteTxs(vPos);
+    return data;
+}
+
+bool TxIndex::WritePreparedBlock(const CBlockIndex* pindex, BlockData& data)
+{
+    const auto& v_pos{static_cast<TxPositions&>(data).v_pos};
+    if (v_pos.empty()) return true;
+    return m_db->WriteTxs(v_pos);
 }
 
 BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
@@ -80,17 +104,35 @@ bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRe
         return false;
     }
 
-    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    // Open the block file at the size of the block's record
+    g_block_file_writer.WaitForRecord(/*undo=*/false, postx);
+    CAutoFile file(OpenBlockFile(FlatFilePos(postx.nFile, postx.nPos - 4), true), SER_DISK, CLIENT_VERSION);
     if (file.IsNull()) {
         return error("%s: OpenBlockFile failed", __func__);
     }
     CBlockHeader header;
     try {
-        file >> header;
-        if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
-            return error("%s: fseek(...) failed", __func__);
+        uint32_t size;
+        file >> size;
+        if (size & BLOCK_RECORD_COMPRESSED) {
+            // The transaction offset is into the uncompressed block.
+            if ((size & ~BLOCK_RECORD_COMPRESSED) > MAX_SIZE) {
+                return error("%s: Block data is larger than maximum deserialization size", __func__);
+            }
+            std::vector<uint8_t> data(size & ~BLOCK_RECORD_COMPRESSED);
+            file.read(MakeWritableByteSpan(data));
+            if (!DecompressBlockData(data) || data.size() < 80 + postx.nTxOffset) {
+                return error("%s: Corrupt compressed block", __func__);
+            }
+            SpanReader{SER_DISK, CLIENT_VERSION, data} >> header;
+            SpanReader{SER_DISK, CLIENT_VERSION, Span{data}.subspan(80 + postx.nTxOffset)} >> tx;
+        } else {
+            file >> header;
+            if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
+                return error("%s: fseek(...) failed", __func__);
+            }
+            file >> tx;
         }
-        file >> tx;
     } catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
     }
@@ -25,6 +25,12 @@ private:
 protected:
     bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
 
+    bool AllowParallelSync() const override { return true; }
+
+    std::unique_ptr<BlockData> PrepareBlock(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlockIndex* pindex, BlockData& data) override;
+
     BaseIndex::DB& GetDB() const override;
 
     const char* GetName() const override { return "txindex"; }
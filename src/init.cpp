@@ -16,13 +16,16 @@
 #include <chainparams.h>
 #include <compat/sanity.h>
 #include <consensus/amount.h>
+#include <dbwrapper.h>
 #include <deploymentstatus.h>
 #include <fs.h>
 #include <hash.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <init/common.h>
 #include <interfaces/chain.h>
@@ -105,14 +108,22 @@ using node::CalculateCacheSizes;
 using node::ChainstateLoadVerifyError;
 using node::ChainstateLoadingError;
 using node::CleanupBlockRevFiles;
+using node::DEFAULT_BLOCK_COMPRESSION;
+using node::DEFAULT_BLOCK_WRITE_BUFFER;
+using node::DEFAULT_PERSIST_BLOCK_INDEX;
 using node::DEFAULT_PRINTPRIORITY;
+using node::DEFAULT_REINDEX_THREADS;
 using node::DEFAULT_STOPAFTERBLOCKIMPORT;
 using node::LoadChainstate;
+using node::MAX_BLOCK_WRITE_BUFFER;
+using node::MAX_REINDEX_THREADS;
 using node::NodeContext;
 using node::ThreadImport;
 using node::VerifyLoadedChainstate;
+using node::fBlockCompression;
 using node::fPruneMode;
 using node::fReindex;
+using node::g_block_file_writer;
 using node::nPruneTarget;
 
 static const bool DEFAULT_PROXYRANDOMIZE = true;
@@ -196,6 +207,12 @@ void Interrupt(NodeContext& node)
     if (g_coin_stats_index) {
         g_coin_stats_index->Interrupt();
     }
+    if (g_address_index) {
+        g_address_index->Interrupt();
+    }
+    if (g_spent_index) {
+        g_spent_index->Interrupt();
+    }
 }
 
 void Shutdown(NodeContext& node)
@@ -244,7 +261,7 @@ void Shutdown(NodeContext& node)
     node.netgroupman.reset();
 
     if (node.mempool && node.mempool->IsLoaded() && node.args->GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
-        DumpMempool(*node.mempool);
+        DumpMempool(*node.mempool, /*use_v1=*/node.args->GetBoolArg("-persistmempoolv1", DEFAULT_PERSIST_V1_DAT));
     }
 
     // Drop transactions we were still watching, and record fee estimations.
@@ -273,6 +290,14 @@ void Shutdown(NodeContext& node)
         g_coin_stats_index->Stop();
         g_coin_stats_index.reset();
     }
+    if (g_address_index) {
+        g_address_index->Stop();
+        g_address_index.reset();
+    }
+    if (g_spent_index) {
+        g_spent_index->Stop();
+        g_spent_index.reset();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -290,7 +315,11 @@ void Shutdown(NodeContext& node)
                 chainstate->ResetCoinsViews();
             }
         }
+        if (node.args->GetBoolArg("-persistblockindex", DEFAULT_PERSIST_BLOCK_INDEX)) {
+            node.chainman->m_blockman.WriteBlockIndexSnapshot();
+        }
     }
+    g_block_file_writer.Stop();
     for (const auto& client : node.chain_clients) {
         client->stop();
     }
@@ -400,7 +429,9 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-alertnotify=<cmd>", "Execute command when an alert is raised (%s in cmd is replaced by message)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex(), signetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockcompression", strprintf("Compress new block and undo data with LZ4, where that saves space. Blocks already stored are read either way, and the repackblockfiles RPC converts them (default: %u)", DEFAULT_BLOCK_COMPRESSION), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockwritebuffer=<n>", strprintf("Write new block and undo data to disk in the background, queueing up to <n> MiB of it. It is made durable before the block index and chainstate are flushed, as when written directly. 0 writes it before validation continues (0 to %d, default: %d)", MAX_BLOCK_WRITE_BUFFER, DEFAULT_BLOCK_WRITE_BUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-fastprune", "Use smaller block files and lower minimum prune height for testing purposes", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
 #if HAVE_SYSTEM
     argsman.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -410,23 +441,35 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-coinstatsindex", strprintf("Maintain coinstats index used by the gettxoutsetinfo RPC (default: %u)", DEFAULT_COINSTATSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-conf=<file>", strprintf("Specify path to read-only configuration file. Relative paths will be prefixed by datadir location (only useable from command line, not configuration file) (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-dbbackend=<backend>", strprintf("Storage engine of the block index and index databases: leveldb or logstore (an append-only log that keeps all keys in memory). The chainstate always uses leveldb. The databases must be created with the engine they are used with (default: %s)", DBBackendName(DEFAULT_DB_BACKEND)), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-dbprofile=<profile>", strprintf("LevelDB tuning of the chainstate, block index and index databases: default, nvme (larger table files and 4 compaction threads) or network (larger blocks, 16 bit Bloom filters, LZ4 compression, larger table files and 4 compaction threads, for storage with high read latency) (default: %s)", DEFAULT_DB_PROFILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-dbtuning=<kind>:<option>=<value>", strprintf("Override a setting of -dbprofile for one kind of database (%s). Options: blocksize (KiB), bloombits (0 = no Bloom filter), compression (0 or 1, compress table blocks with LZ4), writebuffer (MiB), maxfilesize (MiB), subcompactions (number of threads a compaction is split across). Can be specified multiple times", Join(DB_TUNING_KINDS, ", ")), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-indexsyncthreads=<n>", strprintf("Set the number of threads reading blocks and computing index data while building -txindex, -blockfilterindex, -coinstatsindex, -addressindex and -spentindex (0 = auto, 1 = build serially, up to %d, default: %d)", MAX_INDEX_SYNC_THREADS, DEFAULT_INDEX_SYNC_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-loadblock=<file>", "Imports blocks from external file on startup", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-maxorphanmemory=<n>", strprintf("Keep unconnectable transactions below <n> megabytes of memory (default: %u)", DEFAULT_MAX_ORPHAN_MEMORY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex(), signetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-persistblockindex", strprintf("Whether to save the block index on shutdown and load it on restart instead of reading the block index database (default: %u)", DEFAULT_PERSIST_BLOCK_INDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-persistmempoolv1", strprintf("Whether a mempool.dat file created by -persistmempool or the savemempool RPC will be written in the legacy format "
+                                                  "(version 1) or the current format (version 2). This temporary option will be removed in the future. (default: %u)",
+                                                  DEFAULT_PERSIST_V1_DAT),
+                   ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk. This will also rebuild active optional indexes.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead. Deactivate all optional indexes before running this.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-reindex-headers", "Rebuild the block index from the headers and transaction counts of the blocks in the blk*.dat files, without reading the full blocks, and then the chain state. The remaining checks of each block run when it is connected, and a block whose data turns out to be corrupt then shuts the node down; a full -reindex skips such blocks. Much faster than a full -reindex when only the block index is damaged. Implies -reindex.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-reindexthreads=<n>", strprintf("Set the number of threads scanning and reading block files during -reindex (0 = auto, 1 = read them serially, up to %d, default: %d)", MAX_REINDEX_THREADS, DEFAULT_REINDEX_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-settings=<file>", strprintf("Specify path to dynamic settings data file. Can be disabled with -nosettings. File is written at runtime and not meant to be edited by users (use %s instead for custom settings). Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME, BITCOIN_SETTINGS_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #if HAVE_SYSTEM
     argsman.AddArg("-startupnotify=<cmd>", "Execute command on startup.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -437,6 +480,9 @@ void SetupServerArgs(ArgsManager& argsman)
     hidden_args.emplace_back("-sysperms");
 #endif
     argsman.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-addressindex", strprintf("Maintain an index of transaction outputs and inputs by output script, used by the getaddresshistory, getaddressutxos and getaddressbalance rpc calls (default: %u)", DEFAULT_ADDRESSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-spentindex", strprintf("Maintain an index of the inputs spending each transaction output, used by the gettxspendingprevout rpc call (default: %u)", DEFAULT_SPENTINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockfiltercache=<n>", strprintf("Maximum memory used to keep recently read block filters, to serve repeated requests without disk access, in MiB (default: %d)", DEFAULT_BLOCK_FILTER_CACHE_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blockfilterindex=<type>",
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
@@ -662,6 +708,11 @@ void InitParameterInteraction(ArgsManager& args)
             LogPrintf("%s: parameter interaction: -connect set -> setting -listen=0\n", __func__);
     }
 
+    if (args.GetBoolArg("-reindex-headers", false)) {
+        if (args.SoftSetBoolArg("-reindex", true))
+            LogPrintf("%s: parameter interaction: -reindex-headers set -> setting -reindex=1\n", __func__);
+    }
+
     std::string proxy_arg = args.GetArg("-proxy", "");
     if (proxy_arg != "" && proxy_arg != "0") {
         // to protect privacy, do not listen by default if a default proxy server is specified
@@ -961,6 +1012,13 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
         fPruneMode = true;
     }
 
+    fBlockCompression = args.GetBoolArg("-blockcompression", DEFAULT_BLOCK_COMPRESSION);
+
+    const int64_t block_write_buffer{args.GetIntArg("-blockwritebuffer", DEFAULT_BLOCK_WRITE_BUFFER)};
+    if (block_write_buffer < 0 || block_write_buffer > MAX_BLOCK_WRITE_BUFFER) {
+        return InitError(strprintf(_("-blockwritebuffer must be between 0 and %d MiB."), MAX_BLOCK_WRITE_BUFFER));
+    }
+
     nConnectTimeout = args.GetIntArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0) {
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -971,6 +1029,14 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
         return InitError(Untranslated("peertimeout cannot be configured with a negative value."));
     }
 
+    try {
+        for (const std::string& db_kind : DB_TUNING_KINDS) {
+            GetDBTuning(args, db_kind);
+        }
+    } catch (const std::runtime_error& e) {
+        return InitError(Untranslated(e.what()));
+    }
+
     if (args.IsArgSet("-minrelaytxfee")) {
         if (std::optional<CAmount> min_relay_fee = ParseMoney(args.GetArg("-minrelaytxfee", ""))) {
             // High fee check is done afterward in CWallet::Create()
@@ -1037,6 +1103,12 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
         if (args.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
             return InitError(_("-reindex-chainstate option is not compatible with -coinstatsindex. Please temporarily disable coinstatsindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
         }
+        if (args.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -addressindex. Please temporarily disable addressindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
+        if (args.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -spentindex. Please temporarily disable spentindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
         if (g_enabled_filter_types.count(BlockFilterType::BASIC)) {
             return InitError(_("-reindex-chainstate option is not compatible with -blockfilterindex. Please temporarily disable blockfilterindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
         }
@@ -1398,6 +1470,12 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     // ********************************************************* Step 7: load block chain
 
+    const int64_t block_write_buffer{args.GetIntArg("-blockwritebuffer", DEFAULT_BLOCK_WRITE_BUFFER)};
+    if (block_write_buffer > 0) {
+        LogPrintf("Writing block and undo data in the background, queueing up to %d MiB\n", block_write_buffer);
+        g_block_file_writer.Start(size_t(block_write_buffer) << 20);
+    }
+
     fReindex = args.GetBoolArg("-reindex", false);
     bool fReindexChainState = args.GetBoolArg("-reindex-chainstate", false);
 
@@ -1414,6 +1492,12 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   cache_sizes.filter_index * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
     }
+    if (args.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        LogPrintf("* Using %.1f MiB for address index database\n", cache_sizes.address_index * (1.0 / 1024 / 1024));
+    }
+    if (args.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        LogPrintf("* Using %.1f MiB for spent index database\n", cache_sizes.spent_index * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1f MiB for chain state database\n", cache_sizes.coins_db * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", cache_sizes.coins * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1566,27 +1650,46 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     RegisterValidationInterface(node.peerman.get());
 
     // ********************************************************* Step 8: start indexers
+    int index_sync_threads = args.GetIntArg("-indexsyncthreads", DEFAULT_INDEX_SYNC_THREADS);
+    if (index_sync_threads <= 0) index_sync_threads = GetNumCores();
+    index_sync_threads = std::clamp(index_sync_threads, 1, MAX_INDEX_SYNC_THREADS);
+
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         if (const auto error{WITH_LOCK(cs_main, return CheckLegacyTxindex(*Assert(chainman.m_blockman.m_block_tree_db)))}) {
             return InitError(*error);
         }
 
         g_txindex = std::make_unique<TxIndex>(cache_sizes.tx_index, false, fReindex);
-        if (!g_txindex->Start(chainman.ActiveChainstate())) {
+        if (!g_txindex->Start(chainman.ActiveChainstate(), index_sync_threads)) {
             return false;
         }
     }
 
+    const size_t filter_cache_size = std::max<int64_t>(0, args.GetIntArg("-blockfiltercache", DEFAULT_BLOCK_FILTER_CACHE_SIZE)) << 20;
     for (const auto& filter_type : g_enabled_filter_types) {
-        InitBlockFilterIndex(filter_type, cache_sizes.filter_index, false, fReindex);
-        if (!GetBlockFilterIndex(filter_type)->Start(chainman.ActiveChainstate())) {
+        InitBlockFilterIndex(filter_type, cache_sizes.filter_index, false, fReindex, filter_cache_size);
+        if (!GetBlockFilterIndex(filter_type)->Start(chainman.ActiveChainstate(), index_sync_threads)) {
             return false;
         }
     }
 
     if (args.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
         g_coin_stats_index = std::make_unique<CoinStatsIndex>(/* cache size */ 0, false, fReindex);
-        if (!g_coin_stats_index->Start(chainman.ActiveChainstate())) {
+        if (!g_coin_stats_index->Start(chainman.ActiveChainstate(), index_sync_threads)) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        g_address_index = std::make_unique<AddressIndex>(cache_sizes.address_index, false, fReindex);
+        if (!g_address_index->Start(chainman.ActiveChainstate(), index_sync_threads)) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        g_spent_index = std::make_unique<SpentIndex>(cache_sizes.spent_index, false, fReindex);
+        if (!g_spent_index->Start(chainman.ActiveChainstate(), index_sync_threads)) {
             return false;
         }
     }
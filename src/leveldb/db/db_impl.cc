@@ -9,8 +9,12 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "db/builder.h"
@@ -103,6 +107,7 @@ Options SanitizeOptions(const std::string& dbname,
   ClipToRange(&result.write_buffer_size, 64 << 10, 1 << 30);
   ClipToRange(&result.max_file_size, 1 << 20, 1 << 30);
   ClipToRange(&result.block_size, 1 << 10, 4 << 20);
+  ClipToRange(&result.max_subcompactions, 1, 64);
   if (result.info_log == nullptr) {
     // Open a log file in the same directory as the db
     src.env->CreateDir(dbname);  // In case it does not exist
@@ -885,50 +890,95 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
   return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
 }
 
-Status DBImpl::DoCompactionWork(CompactionState* compact) {
-  const uint64_t start_micros = env_->NowMicros();
-  int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
+void DBImpl::CompactMemTableDuringCompaction(int64_t* imm_micros) {
+  // Prioritize immutable compaction work
+  if (has_imm_.load(std::memory_order_relaxed)) {
+    const uint64_t imm_start = env_->NowMicros();
+    mutex_.Lock();
+    if (imm_ != nullptr) {
+      CompactMemTable();
+      // Wake up MakeRoomForWrite() if necessary.
+      background_work_finished_signal_.SignalAll();
+    }
+    mutex_.Unlock();
+    *imm_micros += (env_->NowMicros() - imm_start);
+  }
+}
 
-  Log(options_.info_log, "Compacting %d@%d + %d@%d files",
-      compact->compaction->num_input_files(0), compact->compaction->level(),
-      compact->compaction->num_input_files(1),
-      compact->compaction->level() + 1);
+// Pick up to max_subcompactions - 1 user keys that split the inputs of a
+// compaction into parts of about the same size.  The keys are the largest
+// keys of input files, so every part is made of whole files, except for
+// overlapping level-0 files.
+std::vector<std::string> DBImpl::SubcompactionBoundaries(
+    const Compaction* c) const {
+  std::vector<std::string> boundaries;
+  const int parts = options_.max_subcompactions;
+  if (parts <= 1) {
+    return boundaries;
+  }
+  std::vector<std::pair<Slice, uint64_t>> file_ends;
+  uint64_t total_bytes = 0;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < c->num_input_files(which); i++) {
+      const FileMetaData* f = c->input(which, i);
+      file_ends.emplace_back(f->largest.user_key(), f->file_size);
+      total_bytes += f->file_size;
+    }
+  }
+  const Comparator* ucmp = user_comparator();
+  std::sort(file_ends.begin(), file_ends.end(),
+            [ucmp](const std::pair<Slice, uint64_t>& a,
+                   const std::pair<Slice, uint64_t>& b) {
+              return ucmp->Compare(a.first, b.first) < 0;
+            });
+  // The largest key of all inputs would leave an empty last part.
+  uint64_t bytes = 0;
+  for (size_t i = 0; i + 1 < file_ends.size(); i++) {
+    bytes += file_ends[i].second;
+    const size_t part = boundaries.size() + 1;
+    if (part < static_cast<size_t>(parts) &&
+        bytes >= total_bytes / parts * part &&
+        (boundaries.empty() ||
+         ucmp->Compare(file_ends[i].first, Slice(boundaries.back())) > 0)) {
+      boundaries.push_back(file_ends[i].first.ToString());
+    }
+  }
+  return boundaries;
+}
 
-  assert(versions_->NumLevelFiles(compact->compaction->level()) > 0);
-  assert(compact->builder == nullptr);
-  assert(compact->outfile == nullptr);
-  if (snapshots_.empty()) {
-    compact->smallest_snapshot = versions_->LastSequence();
+Status DBImpl::DoSubcompactionWork(CompactionState* compact, Iterator* input,
+                                   const std::string* begin,
+                                   const std::string* end,
+                                   bool compact_memtable,
+                                   int64_t* imm_micros) {
+  if (begin == nullptr) {
+    input->SeekToFirst();
   } else {
-    compact->smallest_snapshot = snapshots_.oldest()->sequence_number();
+    // Skip all entries of *begin: the sequence number 0 and the smallest
+    // type sort after every other entry of a user key.
+    InternalKey start(*begin, 0, static_cast<ValueType>(0));
+    input->Seek(start.Encode());
+    ParsedInternalKey ikey;
+    while (input->Valid() && ParseInternalKey(input->key(), &ikey) &&
+           user_comparator()->Compare(ikey.user_key, *begin) == 0) {
+      input->Next();
+    }
   }
-
-  Iterator* input = versions_->MakeInputIterator(compact->compaction);
-
-  // Release mutex while we're actually doing the compaction work
-  mutex_.Unlock();
-
-  input->SeekToFirst();
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
   bool has_current_user_key = false;
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
   while (input->Valid() && !shutting_down_.load(std::memory_order_acquire)) {
-    // Prioritize immutable compaction work
-    if (has_imm_.load(std::memory_order_relaxed)) {
-      const uint64_t imm_start = env_->NowMicros();
-      mutex_.Lock();
-      if (imm_ != nullptr) {
-        CompactMemTable();
-        // Wake up MakeRoomForWrite() if necessary.
-        background_work_finished_signal_.SignalAll();
-      }
-      mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
+    if (compact_memtable) {
+      CompactMemTableDuringCompaction(imm_micros);
     }
 
     Slice key = input->key();
+    if (end != nullptr && ParseInternalKey(key, &ikey) &&
+        user_comparator()->Compare(ikey.user_key, *end) > 0) {
+      break;
+    }
     if (compact->compaction->ShouldStopBefore(key) &&
         compact->builder != nullptr) {
       status = FinishCompactionOutputFile(compact, input);
@@ -1018,8 +1068,93 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   if (status.ok()) {
     status = input->status();
   }
-  delete input;
-  input = nullptr;
+  return status;
+}
+
+Status DBImpl::DoCompactionWork(CompactionState* compact) {
+  const uint64_t start_micros = env_->NowMicros();
+  int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
+
+  Log(options_.info_log, "Compacting %d@%d + %d@%d files",
+      compact->compaction->num_input_files(0), compact->compaction->level(),
+      compact->compaction->num_input_files(1),
+      compact->compaction->level() + 1);
+
+  assert(versions_->NumLevelFiles(compact->compaction->level()) > 0);
+  assert(compact->builder == nullptr);
+  assert(compact->outfile == nullptr);
+  if (snapshots_.empty()) {
+    compact->smallest_snapshot = versions_->LastSequence();
+  } else {
+    compact->smallest_snapshot = snapshots_.oldest()->sequence_number();
+  }
+
+  // Split the compaction into subcompactions of disjoint user key ranges.
+  // The first one is run by this thread, the others by their own threads.
+  const std::vector<std::string> boundaries =
+      SubcompactionBoundaries(compact->compaction);
+  std::vector<CompactionState*> subcompactions{compact};
+  std::vector<Iterator*> inputs{
+      versions_->MakeInputIterator(compact->compaction)};
+  for (size_t i = 0; i < boundaries.size(); i++) {
+    CompactionState* sub =
+        new CompactionState(compact->compaction->NewSubcompaction());
+    sub->smallest_snapshot = compact->smallest_snapshot;
+    subcompactions.push_back(sub);
+    inputs.push_back(versions_->MakeInputIterator(sub->compaction));
+  }
+  if (!boundaries.empty()) {
+    Log(options_.info_log, "Compacting in %d subcompactions",
+        static_cast<int>(subcompactions.size()));
+  }
+
+  // Release mutex while we're actually doing the compaction work
+  mutex_.Unlock();
+
+  std::vector<Status> statuses(subcompactions.size());
+  std::mutex done_mu;
+  std::condition_variable done_cv;
+  size_t running = boundaries.size();
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < subcompactions.size(); i++) {
+    threads.emplace_back([&, i]() {
+      int64_t unused_imm_micros = 0;
+      statuses[i] = DoSubcompactionWork(
+          subcompactions[i], inputs[i], &boundaries[i - 1],
+          i < boundaries.size() ? &boundaries[i] : nullptr,
+          /*compact_memtable=*/false, &unused_imm_micros);
+      std::lock_guard<std::mutex> lock(done_mu);
+      running--;
+      done_cv.notify_one();
+    });
+  }
+  statuses[0] = DoSubcompactionWork(
+      compact, inputs[0], nullptr,
+      boundaries.empty() ? nullptr : &boundaries[0],
+      /*compact_memtable=*/true, &imm_micros);
+  {
+    // Keep compacting the memtable until the other subcompactions are done,
+    // so that writes do not stall on it.
+    std::unique_lock<std::mutex> lock(done_mu);
+    while (running > 0) {
+      lock.unlock();
+      CompactMemTableDuringCompaction(&imm_micros);
+      lock.lock();
+      done_cv.wait_for(lock, std::chrono::milliseconds(10),
+                       [&]() { return running == 0; });
+    }
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  Status status;
+  for (size_t i = 0; i < subcompactions.size(); i++) {
+    if (status.ok()) {
+      status = statuses[i];
+    }
+    delete inputs[i];
+  }
 
   CompactionStats stats;
   stats.micros = env_->NowMicros() - start_micros - imm_micros;
@@ -1028,11 +1163,22 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       stats.bytes_read += compact->compaction->input(which, i)->file_size;
     }
   }
+
+  mutex_.Lock();
+  // Gather the outputs of all subcompactions, which are in key order, so
+  // that they are installed or cleaned up with the compaction.
+  for (size_t i = 1; i < subcompactions.size(); i++) {
+    CompactionState* sub = subcompactions[i];
+    compact->outputs.insert(compact->outputs.end(), sub->outputs.begin(),
+                            sub->outputs.end());
+    compact->total_bytes += sub->total_bytes;
+    sub->outputs.clear();
+    delete sub->compaction;
+    CleanupCompaction(sub);
+  }
   for (size_t i = 0; i < compact->outputs.size(); i++) {
     stats.bytes_written += compact->outputs[i].file_size;
   }
-
-  mutex_.Lock();
   stats_[compact->compaction->level() + 1].Add(stats);
 
   if (status.ok()) {
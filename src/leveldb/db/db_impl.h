@@ -20,6 +20,7 @@
 
 namespace leveldb {
 
+class Compaction;
 class MemTable;
 class TableCache;
 class Version;
@@ -145,6 +146,14 @@ class DBImpl : public DB {
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Compact the input entries with user keys in (*begin, *end], where a
+  // null bound is unbounded.  Only the background thread may pass
+  // compact_memtable, to compact the immutable memtable in between.
+  Status DoSubcompactionWork(CompactionState* compact, Iterator* input,
+                             const std::string* begin, const std::string* end,
+                             bool compact_memtable, int64_t* imm_micros);
+  void CompactMemTableDuringCompaction(int64_t* imm_micros);
+  std::vector<std::string> SubcompactionBoundaries(const Compaction* c) const;
 
   Status OpenCompactionOutputFile(CompactionState* compact);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
@@ -1552,6 +1552,17 @@ bool Compaction::ShouldStopBefore(const Slice& internal_key) {
   }
 }
 
+Compaction* Compaction::NewSubcompaction() const {
+  Compaction* c = new Compaction(input_version_->vset_->options_, level_);
+  c->max_output_file_size_ = max_output_file_size_;
+  c->input_version_ = input_version_;
+  c->input_version_->Ref();
+  c->inputs_[0] = inputs_[0];
+  c->inputs_[1] = inputs_[1];
+  c->grandparents_ = grandparents_;
+  return c;
+}
+
 void Compaction::ReleaseInputs() {
   if (input_version_ != nullptr) {
     input_version_->Unref();
@@ -357,6 +357,12 @@ class Compaction {
   // is successful.
   void ReleaseInputs();
 
+  // Return a compaction of the same inputs for compacting part of its key
+  // range, with its own state for IsBaseLevelForKey() and
+  // ShouldStopBefore().  Its edit() is not used.  REQUIRES: the DB mutex
+  // is held when it is created and deleted.
+  Compaction* NewSubcompaction() const;
+
  private:
   friend class Version;
   friend class VersionSet;
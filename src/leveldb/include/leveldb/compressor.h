@@ -0,0 +1,43 @@
+// Copyright (c) 2022 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A database can be configured with a custom Compressor object to compress
+// table blocks with a codec that is not built into leveldb.  Blocks written
+// with it are tagged kCustomCompression.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_COMPRESSOR_H_
+#define STORAGE_LEVELDB_INCLUDE_COMPRESSOR_H_
+
+#include <cstddef>
+#include <string>
+
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+class Slice;
+
+class LEVELDB_EXPORT Compressor {
+ public:
+  virtual ~Compressor();
+
+  // Store the compressed form of input in *output.  Return false if the
+  // input cannot be compressed, in which case the block is stored
+  // uncompressed.
+  virtual bool Compress(const Slice& input, std::string* output) const = 0;
+
+  // Store the size input decompresses to in *result.  Return false if input
+  // is not a valid compressed block.
+  virtual bool GetUncompressedLength(const Slice& input,
+                                     size_t* result) const = 0;
+
+  // Decompress input into output, which has room for the number of bytes
+  // returned by GetUncompressedLength().  Return false if input is corrupt.
+  // Implementations must be thread-safe.
+  virtual bool Uncompress(const Slice& input, char* output) const = 0;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_COMPRESSOR_H_
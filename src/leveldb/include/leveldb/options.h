@@ -13,6 +13,7 @@ namespace leveldb {
 
 class Cache;
 class Comparator;
+class Compressor;
 class Env;
 class FilterPolicy;
 class Logger;
@@ -26,7 +27,11 @@ enum CompressionType {
   // NOTE: do not change the values of existing entries, as these are
   // part of the persistent format on disk.
   kNoCompression = 0x0,
-  kSnappyCompression = 0x1
+  kSnappyCompression = 0x1,
+  // Compressed with Options::compressor, which must be set to read and
+  // write such blocks.  Kept clear of the values leveldb assigns to its own
+  // codecs.
+  kCustomCompression = 0x40
 };
 
 // Options to control the behavior of a database (passed to DB::Open)
@@ -114,6 +119,12 @@ struct LEVELDB_EXPORT Options {
   // initially populating a large database.
   size_t max_file_size = 2 * 1024 * 1024;
 
+  // Split the key range of a compaction into up to this many parts that are
+  // compacted by separate threads.  Larger values make large compactions,
+  // such as level-0 compactions during bulk loads, finish sooner at the cost
+  // of more threads doing disk I/O at the same time.
+  int max_subcompactions = 1;
+
   // Compress blocks using the specified compression algorithm.  This
   // parameter can be changed dynamically.
   //
@@ -130,6 +141,12 @@ struct LEVELDB_EXPORT Options {
   // efficiently detect that and will switch to uncompressed mode.
   CompressionType compression = kSnappyCompression;
 
+  // Codec of kCustomCompression blocks.  It must be set to read tables with
+  // such blocks even if compression is no longer kCustomCompression.
+  //
+  // Default: nullptr
+  const Compressor* compressor = nullptr;
+
   // EXPERIMENTAL: If true, append to existing MANIFEST and log files
   // when a database is opened.  This can significantly speed up open.
   //
@@ -4,6 +4,7 @@
 
 #include "table/format.h"
 
+#include "leveldb/compressor.h"
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "table/block.h"
@@ -61,8 +62,11 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
+Compressor::~Compressor() = default;
+
 Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result) {
+                 const Compressor* compressor, const BlockHandle& handle,
+                 BlockContents* result) {
   result->data = Slice();
   result->cachable = false;
   result->heap_allocated = false;
@@ -130,6 +134,28 @@ Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
       result->cachable = true;
       break;
     }
+    case kCustomCompression: {
+      size_t ulength = 0;
+      if (compressor == nullptr) {
+        delete[] buf;
+        return Status::NotSupported("custom compressed block without a compressor", file->GetName());
+      }
+      if (!compressor->GetUncompressedLength(Slice(data, n), &ulength)) {
+        delete[] buf;
+        return Status::Corruption("corrupted compressed block contents", file->GetName());
+      }
+      char* ubuf = new char[ulength];
+      if (!compressor->Uncompress(Slice(data, n), ubuf)) {
+        delete[] buf;
+        delete[] ubuf;
+        return Status::Corruption("corrupted compressed block contents", file->GetName());
+      }
+      delete[] buf;
+      result->data = Slice(ubuf, ulength);
+      result->heap_allocated = true;
+      result->cachable = true;
+      break;
+    }
     default:
       delete[] buf;
       return Status::Corruption("bad block type", file->GetName());
@@ -16,6 +16,7 @@
 namespace leveldb {
 
 class Block;
+class Compressor;
 class RandomAccessFile;
 struct ReadOptions;
 
@@ -86,9 +87,11 @@ struct BlockContents {
 };
 
 // Read the block identified by "handle" from "file".  On failure
-// return non-OK.  On success fill *result and return OK.
+// return non-OK.  On success fill *result and return OK.  "compressor"
+// decompresses kCustomCompression blocks and may be null.
 Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result);
+                 const Compressor* compressor, const BlockHandle& handle,
+                 BlockContents* result);
 
 // Implementation details follow.  Clients should ignore,
 
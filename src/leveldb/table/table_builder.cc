@@ -7,6 +7,7 @@
 #include <assert.h>
 
 #include "leveldb/comparator.h"
+#include "leveldb/compressor.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
@@ -168,6 +169,21 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
       }
       break;
     }
+
+    case kCustomCompression: {
+      std::string* compressed = &r->compressed_output;
+      if (r->options.compressor != nullptr &&
+          r->options.compressor->Compress(raw, compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        block_contents = *compressed;
+      } else {
+        // No compressor, or compressed less than 12.5%, so just store
+        // uncompressed form
+        block_contents = raw;
+        type = kNoCompression;
+      }
+      break;
+    }
   }
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
@@ -0,0 +1,101 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockmap.h>
+
+#include <util/hasher.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace node {
+size_t BlockMap::Position(const uint256& hash) const
+{
+    // Linear probing. The table is at most half full, so probe sequences are short.
+    const size_t mask{m_table.size() - 1};
+    for (size_t pos{BlockHasher{}(hash) & mask};; pos = (pos + 1) & mask) {
+        const uint32_t slot{m_table[pos]};
+        if (slot == EMPTY || Slot(slot).first == hash) return pos;
+    }
+}
+
+void BlockMap::Rehash(size_t table_size)
+{
+    assert(m_size < EMPTY);
+    m_table.assign(table_size, EMPTY);
+    const size_t mask{table_size - 1};
+    for (uint32_t slot{0}; slot < m_size; ++slot) {
+        size_t pos{BlockHasher{}(Slot(slot).first) & mask};
+        while (m_table[pos] != EMPTY) pos = (pos + 1) & mask;
+        m_table[pos] = slot;
+    }
+}
+
+void BlockMap::reserve(size_t count)
+{
+    m_chunks.reserve((count + CHUNK_ENTRIES - 1) / CHUNK_ENTRIES);
+    size_t table_size{m_table.size()};
+    while (count * 2 > table_size) table_size *= 2;
+    if (table_size != m_table.size()) Rehash(table_size);
+}
+
+void BlockMap::clear()
+{
+    for (uint32_t slot{0}; slot < m_size; ++slot) {
+        Slot(slot).~value_type();
+    }
+    m_size = 0;
+    m_chunks.clear();
+    m_table.assign(MIN_TABLE_SIZE, EMPTY);
+}
+
+void BlockMap::SortByHeight()
+{
+    // order[i] is the slot of the entry that moves to slot i, and parent the
+    // slot of each entry's pprev, found through its hash as the move changes
+    // what lives at an address.
+    std::vector<std::pair<int, uint32_t>> heights;
+    std::vector<uint32_t> parent(m_size, EMPTY);
+    heights.reserve(m_size);
+    for (uint32_t slot{0}; slot < m_size; ++slot) {
+        const CBlockIndex& index{Slot(slot).second};
+        assert(index.pskip == nullptr);
+        heights.emplace_back(index.nHeight, slot);
+        if (index.pprev) parent[slot] = m_table[Position(index.pprev->GetBlockHash())];
+    }
+    std::sort(heights.begin(), heights.end());
+    std::vector<uint32_t> order(m_size), new_slot(m_size);
+    for (uint32_t slot{0}; slot < m_size; ++slot) {
+        order[slot] = heights[slot].second;
+        new_slot[heights[slot].second] = slot;
+    }
+    heights = {};
+
+    // Apply the permutation in place, one cycle at a time.
+    std::vector<bool> done(m_size);
+    for (uint32_t start{0}; start < m_size; ++start) {
+        if (done[start] || order[start] == start) continue;
+        value_type carry{std::move(Slot(start))};
+        uint32_t slot{start};
+        for (uint32_t from{order[slot]}; from != start; slot = from, from = order[slot]) {
+            Slot(slot).~value_type();
+            new (RawSlot(slot)) value_type(std::move(Slot(from)));
+            done[slot] = true;
+        }
+        Slot(slot).~value_type();
+        new (RawSlot(slot)) value_type(std::move(carry));
+        done[slot] = true;
+    }
+
+    for (uint32_t slot{0}; slot < m_size; ++slot) {
+        value_type& entry{Slot(slot)};
+        entry.second.phashBlock = &entry.first;
+        const uint32_t prev{parent[order[slot]]};
+        entry.second.pprev = prev == EMPTY ? nullptr : &Slot(new_slot[prev]).second;
+    }
+    for (uint32_t& slot : m_table) {
+        if (slot != EMPTY) slot = new_slot[slot];
+    }
+}
+} // namespace node
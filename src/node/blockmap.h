@@ -0,0 +1,159 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKMAP_H
+#define BITCOIN_NODE_BLOCKMAP_H
+
+#include <chain.h>
+#include <uint256.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace node {
+/**
+ * The block index: all known CBlockIndex entries, keyed by block hash.
+ *
+ * Validation code takes pointers to the entries, so they must never move.
+ * They are allocated from an arena of fixed size chunks, in insertion order,
+ * and a flat open addressing table maps the hashes to their arena slots.
+ * Iteration follows slot order. Entries loaded on startup are reordered by
+ * height (see SortByHeight), so that a chain of blocks occupies adjacent
+ * memory, which keeps walking it (pprev, pskip, nChainWork accumulation)
+ * cache friendly. Entries added later are appended.
+ *
+ * The interface is the subset of std::unordered_map used on the block index.
+ * Entries cannot be erased.
+ */
+class BlockMap
+{
+public:
+    using key_type = uint256;
+    using mapped_type = CBlockIndex;
+    using value_type = std::pair<const uint256, CBlockIndex>;
+    using size_type = size_t;
+
+private:
+    static constexpr size_t CHUNK_ENTRIES{4096};
+    static constexpr uint32_t EMPTY{std::numeric_limits<uint32_t>::max()};
+    static constexpr size_t MIN_TABLE_SIZE{64};
+
+    struct Chunk {
+        alignas(value_type) unsigned char data[CHUNK_ENTRIES * sizeof(value_type)];
+    };
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    //! Number of entries, which are stored in arena slots [0, m_size)
+    uint32_t m_size{0};
+    //! Arena slots of the entries, at the position given by their hash, or EMPTY. Its size is a power of two.
+    std::vector<uint32_t> m_table;
+
+    void* RawSlot(uint32_t slot) const { return m_chunks[slot / CHUNK_ENTRIES]->data + (slot % CHUNK_ENTRIES) * sizeof(value_type); }
+    value_type& Slot(uint32_t slot) const { return *std::launder(static_cast<value_type*>(RawSlot(slot))); }
+
+    //! Position of hash in m_table: the one holding its slot, or the empty one it would be inserted at.
+    size_t Position(const uint256& hash) const;
+    //! Resize m_table to table_size positions and reinsert all entries.
+    void Rehash(size_t table_size);
+
+    template <typename Value>
+    class Iterator
+    {
+        friend class BlockMap;
+        template <typename>
+        friend class Iterator;
+
+        const BlockMap* m_map{nullptr};
+        uint32_t m_slot{0};
+
+        Iterator(const BlockMap* map, uint32_t slot) : m_map{map}, m_slot{slot} {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value*;
+        using reference = Value&;
+
+        Iterator() = default;
+        operator Iterator<const BlockMap::value_type>() const { return {m_map, m_slot}; }
+
+        Value& operator*() const { return m_map->Slot(m_slot); }
+        Value* operator->() const { return &m_map->Slot(m_slot); }
+        Iterator& operator++()
+        {
+            ++m_slot;
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator ret{*this};
+            ++m_slot;
+            return ret;
+        }
+        friend bool operator==(const Iterator& a, const Iterator& b) { return a.m_slot == b.m_slot; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) { return a.m_slot != b.m_slot; }
+    };
+
+public:
+    using iterator = Iterator<value_type>;
+    using const_iterator = Iterator<const value_type>;
+
+    BlockMap() : m_table(MIN_TABLE_SIZE, EMPTY) {}
+    ~BlockMap() { clear(); }
+    BlockMap(const BlockMap&) = delete;
+    BlockMap& operator=(const BlockMap&) = delete;
+
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, m_size}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, m_size}; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    iterator find(const uint256& hash)
+    {
+        const uint32_t slot{m_table[Position(hash)]};
+        return {this, slot == EMPTY ? m_size : slot};
+    }
+    const_iterator find(const uint256& hash) const { return const_cast<BlockMap*>(this)->find(hash); }
+    size_t count(const uint256& hash) const { return m_table[Position(hash)] != EMPTY; }
+
+    /** Insert an entry constructed from args, unless hash is already present. */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const uint256& hash, Args&&... args)
+    {
+        if ((size_t{m_size} + 1) * 2 > m_table.size()) Rehash(m_table.size() * 2);
+        const size_t pos{Position(hash)};
+        if (m_table[pos] != EMPTY) return {iterator{this, m_table[pos]}, false};
+
+        if (m_size % CHUNK_ENTRIES == 0) m_chunks.push_back(std::make_unique<Chunk>());
+        new (RawSlot(m_size)) value_type(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple(std::forward<Args>(args)...));
+        m_table[pos] = m_size;
+        return {iterator{this, m_size++}, true};
+    }
+    CBlockIndex& operator[](const uint256& hash) { return try_emplace(hash).first->second; }
+
+    /** Make room for count entries without rehashing. */
+    void reserve(size_t count);
+    void clear();
+
+    /**
+     * Move the entries into height order, updating their phashBlock and pprev.
+     * This invalidates all other pointers to entries, so it may only be used
+     * while loading the block index, before pskip is built.
+     */
+    void SortByHeight();
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCKMAP_H
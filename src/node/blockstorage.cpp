@@ -5,29 +5,43 @@
 #include <node/blockstorage.h>
 
 #include <chain.h>
+#include <arith_uint256.h>
 #include <chainparams.h>
 #include <clientversion.h>
+#include <consensus/consensus.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
 #include <flatfile.h>
 #include <fs.h>
 #include <hash.h>
+#include <logging.h>
 #include <pow.h>
+#include <random.h>
 #include <reverse_iterator.h>
 #include <shutdown.h>
 #include <signet.h>
 #include <streams.h>
 #include <undo.h>
+#include <util/lz4.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace node {
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fPruneMode = false;
 uint64_t nPruneTarget = 0;
+bool fBlockCompression = DEFAULT_BLOCK_COMPRESSION;
 
 bool CBlockIndexWorkComparator::operator()(const CBlockIndex* pa, const CBlockIndex* pb) const
 {
@@ -116,6 +130,30 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block, CBlockInde
     return pindexNew;
 }
 
+void BlockManager::UnsetBlockData(CBlockIndex& index)
+{
+    AssertLockHeld(cs_main);
+    index.nStatus &= ~BLOCK_HAVE_DATA;
+    index.nStatus &= ~BLOCK_HAVE_UNDO;
+    index.nFile = 0;
+    index.nDataPos = 0;
+    index.nUndoPos = 0;
+    m_dirty_blockindex.insert(&index);
+
+    // Prune from m_blocks_unlinked -- any block we prune would have
+    // to be downloaded again in order to consider its chain, at which
+    // point it would be considered as a candidate for
+    // m_blocks_unlinked or setBlockIndexCandidates.
+    auto range = m_blocks_unlinked.equal_range(index.pprev);
+    while (range.first != range.second) {
+        std::multimap<CBlockIndex*, CBlockIndex*>::iterator _it = range.first;
+        range.first++;
+        if (_it->second == &index) {
+            m_blocks_unlinked.erase(_it);
+        }
+    }
+}
+
 void BlockManager::PruneOneBlockFile(const int fileNumber)
 {
     AssertLockHeld(cs_main);
@@ -124,25 +162,7 @@ void BlockManager::PruneOneBlockFile(const int fileNumber)
     for (auto& entry : m_block_index) {
         CBlockIndex* pindex = &entry.second;
         if (pindex->nFile == fileNumber) {
-            pindex->nStatus &= ~BLOCK_HAVE_DATA;
-            pindex->nStatus &= ~BLOCK_HAVE_UNDO;
-            pindex->nFile = 0;
-            pindex->nDataPos = 0;
-            pindex->nUndoPos = 0;
-            m_dirty_blockindex.insert(pindex);
-
-            // Prune from m_blocks_unlinked -- any block we prune would have
-            // to be downloaded again in order to consider its chain, at which
-            // point it would be considered as a candidate for
-            // m_blocks_unlinked or setBlockIndexCandidates.
-            auto range = m_blocks_unlinked.equal_range(pindex->pprev);
-            while (range.first != range.second) {
-                std::multimap<CBlockIndex*, CBlockIndex*>::iterator _it = range.first;
-                range.first++;
-                if (_it->second == pindex) {
-                    m_blocks_unlinked.erase(_it);
-                }
-            }
+            UnsetBlockData(*pindex);
         }
     }
 
@@ -255,18 +275,35 @@ CBlockIndex* BlockManager::InsertBlockIndex(const uint256& hash)
 
 bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
 {
-    if (!m_block_tree_db->LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); })) {
-        return false;
+    const bool was_empty{m_block_index.empty()};
+    const int64_t time_start{GetTimeMicros()};
+    // A snapshot holds nChainWork, the database does not.
+    const bool from_snapshot{was_empty && LoadBlockIndexSnapshot()};
+    if (!from_snapshot) {
+        if (!m_block_tree_db->LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); })) {
+            return false;
+        }
+
+        // The database returns entries by hash. Lay them out by height instead,
+        // unless there already were entries which may be pointed to.
+        if (was_empty) m_block_index.SortByHeight();
     }
+    const int64_t time_read{GetTimeMicros()};
+    LogPrint(BCLog::BENCH, "  - Read %u block index entries from %s: %.2fms\n", m_block_index.size(),
+             from_snapshot ? "snapshot" : "database", 0.001 * (time_read - time_start));
 
     // Calculate nChainWork
     std::vector<CBlockIndex*> vSortedByHeight{GetAllBlockIndices()};
-    std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
-              CBlockIndexHeightOnlyComparator());
+    if (!was_empty) {
+        std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
+                  CBlockIndexHeightOnlyComparator());
+    }
 
     for (CBlockIndex* pindex : vSortedByHeight) {
         if (ShutdownRequested()) return false;
-        pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        if (!from_snapshot) {
+            pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        }
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
 
         // We can link the chain of blocks for which we've received transactions at some point, or
@@ -293,10 +330,158 @@ bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
             pindex->BuildSkip();
         }
     }
+    LogPrint(BCLog::BENCH, "  - Link block index: %.2fms\n", 0.001 * (GetTimeMicros() - time_read));
 
     return true;
 }
 
+static fs::path BlockIndexSnapshotPath()
+{
+    return gArgs.GetBlocksDirPath() / "blockindex.dat";
+}
+
+/**
+ * Layout of the block index snapshot: a header, fixed size entries in height
+ * order, and the SHA256 of everything before it. Every field has a fixed
+ * size, so entries could be addressed in a mapped file as well.
+ */
+static constexpr uint32_t BLOCK_INDEX_SNAPSHOT_VERSION{1};
+static constexpr size_t BLOCK_INDEX_SNAPSHOT_HEADER_SIZE{4 + 8 + 4 + 3 * 4 + 8};
+static constexpr size_t BLOCK_INDEX_SNAPSHOT_ENTRY_SIZE{32 + 4 + 7 * 4 + 32 + 3 * 4 + 32};
+static constexpr uint32_t BLOCK_INDEX_SNAPSHOT_NO_PREV{std::numeric_limits<uint32_t>::max()};
+
+bool BlockManager::WriteBlockIndexSnapshot()
+{
+    AssertLockHeld(::cs_main);
+    // Everything must have been flushed, so that the snapshot matches the database.
+    if (!m_block_tree_db || m_block_index.empty() || !m_dirty_blockindex.empty() || !m_dirty_fileinfo.empty()) return false;
+    if (m_last_blockfile < 0 || size_t(m_last_blockfile) >= m_blockfile_info.size()) return false;
+    const int64_t start{GetTimeMicros()};
+
+    std::vector<CBlockIndex*> entries{GetAllBlockIndices()};
+    if (!std::is_sorted(entries.begin(), entries.end(), CBlockIndexHeightOnlyComparator())) {
+        std::sort(entries.begin(), entries.end(), CBlockIndexHeightOnlyComparator());
+    }
+    std::unordered_map<const CBlockIndex*, uint32_t> positions;
+    positions.reserve(entries.size());
+
+    const uint64_t id{GetRand(std::numeric_limits<uint64_t>::max())};
+    const CBlockFileInfo& last_file{m_blockfile_info[m_last_blockfile]};
+    CDataStream stream{SER_DISK, CLIENT_VERSION};
+    stream.reserve(BLOCK_INDEX_SNAPSHOT_HEADER_SIZE + entries.size() * BLOCK_INDEX_SNAPSHOT_ENTRY_SIZE + CSHA256::OUTPUT_SIZE);
+    stream << BLOCK_INDEX_SNAPSHOT_VERSION << id
+           << int32_t{m_last_blockfile} << uint32_t{last_file.nBlocks} << uint32_t{last_file.nSize} << uint32_t{last_file.nUndoSize}
+           << uint64_t{entries.size()};
+    for (const CBlockIndex* index : entries) {
+        const uint32_t prev{index->pprev ? positions.at(index->pprev) : BLOCK_INDEX_SNAPSHOT_NO_PREV};
+        positions.emplace(index, positions.size());
+        stream << index->GetBlockHash() << prev
+               << int32_t{index->nHeight} << uint32_t{index->nStatus} << uint32_t{index->nTx}
+               << int32_t{index->nFile} << uint32_t{index->nDataPos} << uint32_t{index->nUndoPos}
+               << index->nVersion << index->hashMerkleRoot << index->nTime << index->nBits << index->nNonce
+               << ArithToUint256(index->nChainWork);
+    }
+    uint256 checksum;
+    CSHA256().Write(UCharCast(stream.data()), stream.size()).Finalize(checksum.begin());
+    stream << checksum;
+
+    const fs::path path{BlockIndexSnapshotPath()};
+    const fs::path path_new{path + ".new"};
+    try {
+        CAutoFile file{fsbridge::fopen(path_new, "wb"), SER_DISK, CLIENT_VERSION};
+        if (file.IsNull()) throw std::runtime_error("cannot open file");
+        file.write(MakeByteSpan(stream));
+        if (!FileCommit(file.Get())) throw std::runtime_error("FileCommit failed");
+        file.fclose();
+        if (!RenameOver(path_new, path)) throw std::runtime_error("Rename failed");
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to write block index snapshot: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    // Only now that the file is complete, declare it valid for this database.
+    if (!m_block_tree_db->WriteIndexSnapshotId(id)) return false;
+    LogPrintf("Wrote block index snapshot of %u entries in %.2fms\n", entries.size(), 0.001 * (GetTimeMicros() - start));
+    return true;
+}
+
+bool BlockManager::LoadBlockIndexSnapshot()
+{
+    AssertLockHeld(::cs_main);
+    const fs::path path{BlockIndexSnapshotPath()};
+    const std::optional<uint64_t> expected_id{m_block_tree_db->ReadIndexSnapshotId()};
+    if (!expected_id) {
+        // Left behind by a run that did not use it
+        if (fs::exists(path)) fs::remove(path);
+        return false;
+    }
+    // The block index will change from now on, so the snapshot can only be
+    // used once, and must not be used after an unclean shutdown.
+    if (!m_block_tree_db->WriteIndexSnapshotId(std::nullopt)) return false;
+
+    try {
+        std::vector<unsigned char> data;
+        {
+            CAutoFile file{fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION};
+            if (file.IsNull()) throw std::runtime_error("cannot open file");
+            data.resize(fs::file_size(path));
+            file.read(MakeWritableByteSpan(data));
+        }
+        fs::remove(path);
+
+        if (data.size() < BLOCK_INDEX_SNAPSHOT_HEADER_SIZE + CSHA256::OUTPUT_SIZE) throw std::runtime_error("truncated file");
+        const size_t body_size{data.size() - CSHA256::OUTPUT_SIZE};
+        uint256 checksum;
+        CSHA256().Write(data.data(), body_size).Finalize(checksum.begin());
+        if (!std::equal(checksum.begin(), checksum.end(), data.begin() + body_size)) throw std::runtime_error("checksum mismatch");
+
+        SpanReader stream{SER_DISK, CLIENT_VERSION, Span{data}.first(body_size)};
+        uint32_t version;
+        uint64_t id, count;
+        int32_t last_file;
+        CBlockFileInfo last_file_info;
+        stream >> version;
+        if (version != BLOCK_INDEX_SNAPSHOT_VERSION) throw std::runtime_error(strprintf("unknown version %u", version));
+        stream >> id >> last_file >> last_file_info.nBlocks >> last_file_info.nSize >> last_file_info.nUndoSize >> count;
+
+        // Any flush of the block index since the snapshot, even by software
+        // unaware of snapshots, dropped its id. Check the last block file
+        // against the database as well.
+        int db_last_file{0};
+        CBlockFileInfo db_last_file_info;
+        m_block_tree_db->ReadLastBlockFile(db_last_file);
+        m_block_tree_db->ReadBlockFileInfo(db_last_file, db_last_file_info);
+        if (id != *expected_id || last_file != db_last_file || last_file_info.nBlocks != db_last_file_info.nBlocks ||
+            last_file_info.nSize != db_last_file_info.nSize || last_file_info.nUndoSize != db_last_file_info.nUndoSize) {
+            throw std::runtime_error("stale snapshot");
+        }
+        if (stream.size() != count * BLOCK_INDEX_SNAPSHOT_ENTRY_SIZE) throw std::runtime_error("unexpected size");
+
+        std::vector<CBlockIndex*> entries;
+        entries.reserve(count);
+        m_block_index.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            uint256 hash, chain_work;
+            uint32_t prev;
+            stream >> hash >> prev;
+            const auto [it, inserted]{m_block_index.try_emplace(hash)};
+            if (!inserted || (prev != BLOCK_INDEX_SNAPSHOT_NO_PREV && prev >= i)) throw std::runtime_error("inconsistent entries");
+            CBlockIndex& index{it->second};
+            index.phashBlock = &it->first;
+            index.pprev = prev == BLOCK_INDEX_SNAPSHOT_NO_PREV ? nullptr : entries[prev];
+            stream >> index.nHeight >> index.nStatus >> index.nTx >> index.nFile >> index.nDataPos >> index.nUndoPos
+                   >> index.nVersion >> index.hashMerkleRoot >> index.nTime >> index.nBits >> index.nNonce >> chain_work;
+            index.nChainWork = UintToArith256(chain_work);
+            entries.push_back(&index);
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Not using block index snapshot: %s. Loading the block index database.\n", e.what());
+        m_block_index.clear();
+        return false;
+    }
+    LogPrintf("Loaded block index snapshot of %u entries\n", m_block_index.size());
+    return true;
+}
+
 bool BlockManager::WriteBlockIndexDB()
 {
     AssertLockHeld(::cs_main);
@@ -450,45 +635,104 @@ CBlockFileInfo* BlockManager::GetBlockFileInfo(size_t n)
     return &m_blockfile_info.at(n);
 }
 
-static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+/** The size of the length prefix of a serialized vector starting with `first_byte` */
+static size_t CompactSizeLength(uint8_t first_byte)
 {
-    // Open history file to append
-    CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull()) {
-        return error("%s: OpenUndoFile failed", __func__);
-    }
+    return first_byte < 253 ? 1 : first_byte == 253 ? 3 : first_byte == 254 ? 5 : 9;
+}
 
-    // Write index header
-    unsigned int nSize = GetSerializeSize(blockundo, fileout.GetVersion());
-    fileout << messageStart << nSize;
+uint32_t CompressBlockData(std::vector<uint8_t>& data)
+{
+    // The header and transaction count stay uncompressed, for ScanBlockFile.
+    if (data.size() <= 80) return data.size();
+    const size_t prefix{80 + CompactSizeLength(data[80])};
+    if (data.size() <= prefix) return data.size();
+    const std::vector<uint8_t> compressed{util::LZ4Compress(Span{data}.subspan(prefix))};
+    if (prefix + 4 + compressed.size() >= data.size()) return data.size();
+    const uint32_t txs_size = data.size() - prefix;
+    data.resize(prefix + 4);
+    WriteLE32(data.data() + prefix, txs_size);
+    data.insert(data.end(), compressed.begin(), compressed.end());
+    return data.size() | BLOCK_RECORD_COMPRESSED;
+}
 
-    // Write undo data
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0) {
-        return error("%s: ftell failed", __func__);
-    }
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+bool DecompressBlockData(std::vector<uint8_t>& data)
+{
+    if (data.size() <= 80 || data.size() < 80 + CompactSizeLength(data[80]) + 4) return false;
+    const size_t prefix{80 + CompactSizeLength(data[80])};
+    const uint32_t txs_size{ReadLE32(data.data() + prefix)};
+    std::vector<uint8_t> txs;
+    if (txs_size > MAX_SIZE || !util::LZ4Decompress(Span{data}.subspan(prefix + 4), txs_size, txs)) return false;
+    data.resize(prefix);
+    data.insert(data.end(), txs.begin(), txs.end());
+    return true;
+}
 
-    // calculate & write checksum
+/** Replace serialized undo data with its compressed record data, if that is smaller. Returns the record size. */
+static uint32_t CompressUndoData(std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> compressed{util::LZ4Compress(data)};
+    if (4 + compressed.size() >= data.size()) return data.size();
+    const uint32_t size = data.size();
+    data.resize(4);
+    WriteLE32(data.data(), size);
+    data.insert(data.end(), compressed.begin(), compressed.end());
+    return data.size() | BLOCK_RECORD_COMPRESSED;
+}
+
+static bool DecompressUndoData(std::vector<uint8_t>& data)
+{
+    if (data.size() < 4) return false;
+    const uint32_t size{ReadLE32(data.data())};
+    std::vector<uint8_t> undo;
+    if (size > MAX_SIZE || !util::LZ4Decompress(Span{data}.subspan(4), size, undo)) return false;
+    data = std::move(undo);
+    return true;
+}
+
+/** The checksum following the undo data of a block, over its parent's hash and the serialized undo data */
+static uint256 UndoChecksum(const uint256& hashBlock, Span<const uint8_t> undo)
+{
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << hashBlock;
-    hasher << blockundo;
-    fileout << hasher.GetHash();
+    hasher.write(AsBytes(undo));
+    return hasher.GetHash();
+}
 
-    return true;
+/** An undo file record of the undo data of a block, compressed if fBlockCompression is set, followed by its checksum */
+static std::vector<uint8_t> MakeUndoRecord(const CBlockUndo& blockundo, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+{
+    std::vector<uint8_t> data;
+    CVectorWriter{SER_DISK, CLIENT_VERSION, data, 0, blockundo};
+    const uint256 checksum{UndoChecksum(hashBlock, data)};
+    const uint32_t size{fBlockCompression ? CompressUndoData(data) : uint32_t(data.size())};
+    std::vector<uint8_t> record;
+    record.reserve(8 + data.size() + uint256::size());
+    CVectorWriter{SER_DISK, CLIENT_VERSION, record, 0, messageStart, size};
+    record.insert(record.end(), data.begin(), data.end());
+    CVectorWriter{SER_DISK, CLIENT_VERSION, record, record.size(), checksum};
+    return record;
 }
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 {
-    const FlatFilePos pos{WITH_LOCK(::cs_main, return pindex->GetUndoPos())};
-
-    if (pos.IsNull()) {
-        return error("%s: no undo data available", __func__);
+    // Open history file to read, at the size of the record. The file is
+    // opened along with looking up the position, as RepackBlockFiles moves
+    // the record and unlinks the file under cs_main.
+    FlatFilePos pos;
+    FILE* file;
+    {
+        LOCK(::cs_main);
+        pos = pindex->GetUndoPos();
+        if (pos.IsNull()) {
+            return error("%s: no undo data available", __func__);
+        }
+        g_block_file_writer.WaitForRecord(/*undo=*/true, pos);
+        FlatFilePos hpos = pos;
+        hpos.nPos -= 4;
+        file = OpenUndoFile(hpos, true);
     }
-
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
     if (filein.IsNull()) {
         return error("%s: OpenUndoFile failed", __func__);
     }
@@ -497,6 +741,24 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     uint256 hashChecksum;
     CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
     try {
+        uint32_t size;
+        filein >> size;
+        if (size & BLOCK_RECORD_COMPRESSED) {
+            if ((size & ~BLOCK_RECORD_COMPRESSED) > MAX_SIZE) {
+                return error("%s: Undo data is larger than maximum deserialization size", __func__);
+            }
+            std::vector<uint8_t> data(size & ~BLOCK_RECORD_COMPRESSED);
+            filein.read(MakeWritableByteSpan(data));
+            filein >> hashChecksum;
+            if (!DecompressUndoData(data)) {
+                return error("%s: Corrupt compressed undo data", __func__);
+            }
+            if (hashChecksum != UndoChecksum(pindex->pprev->GetBlockHash(), data)) {
+                return error("%s: Checksum mismatch", __func__);
+            }
+            CDataStream{data, SER_DISK, CLIENT_VERSION} >> blockundo;
+            return true;
+        }
         verifier << pindex->pprev->GetBlockHash();
         verifier >> blockundo;
         filein >> hashChecksum;
@@ -515,7 +777,7 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 void BlockManager::FlushUndoFile(int block_file, bool finalize)
 {
     FlatFilePos undo_pos_old(block_file, m_blockfile_info[block_file].nUndoSize);
-    if (!UndoFileSeq().Flush(undo_pos_old, finalize)) {
+    if (!g_block_file_writer.Drain() || !UndoFileSeq().Flush(undo_pos_old, finalize)) {
         AbortNode("Flushing undo file to disk failed. This is likely the result of an I/O error.");
     }
 }
@@ -524,7 +786,9 @@ void BlockManager::FlushBlockFile(bool fFinalize, bool finalize_undo)
 {
     LOCK(cs_LastBlockFile);
     FlatFilePos block_pos_old(m_last_blockfile, m_blockfile_info[m_last_blockfile].nSize);
-    if (!BlockFileSeq().Flush(block_pos_old, fFinalize)) {
+    // Queued records must be written before the files are synced, and before
+    // a finalized file is truncated.
+    if (!g_block_file_writer.Drain() || !BlockFileSeq().Flush(block_pos_old, fFinalize)) {
         AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
     }
     // we do not always flush the undo file, as the chain tip may be lagging behind the incoming blocks,
@@ -656,41 +920,146 @@ bool BlockManager::FindUndoPos(BlockValidationState& state, int nFile, FlatFileP
     return true;
 }
 
-static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
+/** A block file record of the serialized block, compressed if fBlockCompression is set */
+static std::vector<uint8_t> MakeBlockRecord(const CBlock& block, const CMessageHeader::MessageStartChars& messageStart)
+{
+    std::vector<uint8_t> record;
+    if (!fBlockCompression) {
+        CVectorWriter{SER_DISK, CLIENT_VERSION, record, 0, messageStart, uint32_t(::GetSerializeSize(block, CLIENT_VERSION)), block};
+        return record;
+    }
+    std::vector<uint8_t> data;
+    CVectorWriter{SER_DISK, CLIENT_VERSION, data, 0, block};
+    const uint32_t size{CompressBlockData(data)};
+    record.reserve(8 + data.size());
+    CVectorWriter{SER_DISK, CLIENT_VERSION, record, 0, messageStart, size};
+    record.insert(record.end(), data.begin(), data.end());
+    return record;
+}
+
+/** Write a block or undo file record at pos, the position of its message start. */
+static bool WriteRecord(bool undo, const FlatFilePos& pos, Span<const uint8_t> data)
 {
-    // Open history file to append
-    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull()) {
-        return error("WriteBlockToDisk: OpenBlockFile failed");
+    FILE* file{undo ? OpenUndoFile(pos) : OpenBlockFile(pos)};
+    if (!file) {
+        return error("%s: Failed to open %s", __func__, fs::PathToString((undo ? UndoFileSeq() : BlockFileSeq()).FileName(pos)));
     }
+    const bool written{fwrite(data.data(), 1, data.size(), file) == data.size()};
+    if (fclose(file) != 0 || !written) {
+        return error("%s: Failed to write %u bytes at %s", __func__, data.size(), pos.ToString());
+    }
+    return true;
+}
+
+BlockFileWriter g_block_file_writer;
+
+BlockFileWriter::~BlockFileWriter()
+{
+    Stop();
+}
 
-    // Write index header
-    unsigned int nSize = GetSerializeSize(block, fileout.GetVersion());
-    fileout << messageStart << nSize;
+void BlockFileWriter::Start(size_t max_bytes)
+{
+    LOCK(m_mutex);
+    assert(!m_running);
+    m_max_bytes = max_bytes;
+    m_stop = false;
+    m_running = true;
+    m_thread = std::thread(&util::TraceThread, "blockwrite", [this] { ThreadWrite(); });
+}
+
+void BlockFileWriter::Stop()
+{
+    {
+        LOCK(m_mutex);
+        if (!m_running) return;
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    LOCK(m_mutex);
+    m_running = false;
+}
 
-    // Write block
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0) {
-        return error("WriteBlockToDisk: ftell failed");
+void BlockFileWriter::ThreadWrite()
+{
+    while (true) {
+        const Record* record;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) return;
+            record = &m_queue.front();
+        }
+        // The front record is left alone by the other threads, so it is
+        // written without holding the lock.
+        const bool undo{record->undo};
+        const bool written{WriteRecord(undo, record->pos, record->data)};
+        {
+            LOCK(m_mutex);
+            if (!written) m_failed = true;
+            m_queued_bytes -= record->data.size();
+            m_queue.pop_front();
+        }
+        m_cv.notify_all();
+        if (!written) AbortNode(undo ? "Failed to write undo data" : "Failed to write block");
     }
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+}
 
+bool BlockFileWriter::Write(bool undo, const FlatFilePos& pos, std::vector<uint8_t>&& data)
+{
+    {
+        WAIT_LOCK(m_mutex, lock);
+        // Wait for room in the queue. A record larger than the queue is
+        // queued alone, and once stopping, records are written here after
+        // the queued ones.
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+            return m_failed || m_queue.empty() || (!m_stop && m_queued_bytes + data.size() <= m_max_bytes);
+        });
+        if (m_failed) return false;
+        if (!m_running || m_stop) {
+            REVERSE_LOCK(lock);
+            return WriteRecord(undo, pos, data);
+        }
+        m_queued_bytes += data.size();
+        m_queue.push_back(Record{undo, pos, std::move(data)});
+    }
+    m_cv.notify_all();
     return true;
 }
 
+bool BlockFileWriter::Drain()
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_queue.empty(); });
+    return !m_failed;
+}
+
+void BlockFileWriter::WaitForRecord(bool undo, const FlatFilePos& pos)
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+        return std::none_of(m_queue.begin(), m_queue.end(), [&](const Record& record) {
+            return record.undo == undo && record.pos.nFile == pos.nFile &&
+                   pos.nPos >= record.pos.nPos && pos.nPos < record.pos.nPos + record.data.size();
+        });
+    });
+}
+
 bool BlockManager::WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValidationState& state, CBlockIndex* pindex, const CChainParams& chainparams)
 {
     AssertLockHeld(::cs_main);
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
         FlatFilePos _pos;
-        if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, CLIENT_VERSION) + 40)) {
+        std::vector<uint8_t> record{MakeUndoRecord(blockundo, pindex->pprev->GetBlockHash(), chainparams.MessageStart())};
+        if (!FindUndoPos(state, pindex->nFile, _pos, record.size())) {
             return error("ConnectBlock(): FindUndoPos failed");
         }
-        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart())) {
+        if (!g_block_file_writer.Write(/*undo=*/true, _pos, std::move(record))) {
             return AbortNode(state, "Failed to write undo data");
         }
+        _pos.nPos += 8;
         // rev files are written in block height order, whereas blk files are written as blocks come in (often out of order)
         // we want to flush the rev (undo) file once we've written the last block, which is indicated by the last height
         // in the block file info as below; note that this does not catch the case where the undo writes are keeping up
@@ -709,19 +1078,40 @@ bool BlockManager::WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValid
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
+/** Open the block file at the size of the record at pos, for ReadBlockFromFile */
+static FILE* OpenBlockRecord(const FlatFilePos& pos)
+{
+    g_block_file_writer.WaitForRecord(/*undo=*/false, pos);
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 4;
+    return OpenBlockFile(hpos, true);
+}
+
+static bool ReadBlockFromFile(CBlock& block, CAutoFile& filein, const FlatFilePos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull()) {
         return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
     }
 
     // Read block
     try {
-        filein >> block;
+        uint32_t size;
+        filein >> size;
+        if (size & BLOCK_RECORD_COMPRESSED) {
+            if ((size & ~BLOCK_RECORD_COMPRESSED) > MAX_SIZE) {
+                return error("ReadBlockFromDisk: Block data is larger than maximum deserialization size at %s", pos.ToString());
+            }
+            std::vector<uint8_t> data(size & ~BLOCK_RECORD_COMPRESSED);
+            filein.read(MakeWritableByteSpan(data));
+            if (!DecompressBlockData(data)) {
+                return error("ReadBlockFromDisk: Corrupt compressed block at %s", pos.ToString());
+            }
+            SpanReader{SER_DISK, CLIENT_VERSION, data} >> block;
+        } else {
+            filein >> block;
+        }
     } catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
@@ -739,11 +1129,26 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::P
     return true;
 }
 
+bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
+{
+    CAutoFile filein(OpenBlockRecord(pos), SER_DISK, CLIENT_VERSION);
+    return ReadBlockFromFile(block, filein, pos, consensusParams);
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    const FlatFilePos block_pos{WITH_LOCK(cs_main, return pindex->GetBlockPos())};
+    // The file is opened along with looking up the position, as
+    // RepackBlockFiles moves the block and unlinks the file under cs_main.
+    FlatFilePos block_pos;
+    FILE* file;
+    {
+        LOCK(cs_main);
+        block_pos = pindex->GetBlockPos();
+        file = OpenBlockRecord(block_pos);
+    }
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
 
-    if (!ReadBlockFromDisk(block, block_pos, consensusParams)) {
+    if (!ReadBlockFromFile(block, filein, block_pos, consensusParams)) {
         return false;
     }
     if (block.GetHash() != pindex->GetBlockHash()) {
@@ -755,6 +1160,7 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
+    g_block_file_writer.WaitForRecord(/*undo=*/false, pos);
     FlatFilePos hpos = pos;
     hpos.nPos -= 8; // Seek back 8 bytes for meta header
     CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
@@ -767,6 +1173,8 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
         unsigned int blk_size;
 
         filein >> blk_start >> blk_size;
+        const bool compressed{(blk_size & BLOCK_RECORD_COMPRESSED) != 0};
+        blk_size &= ~BLOCK_RECORD_COMPRESSED;
 
         if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
             return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
@@ -781,6 +1189,9 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
 
         block.resize(blk_size); // Zeroing of memory is intentional here
         filein.read(MakeWritableByteSpan(block));
+        if (compressed && !DecompressBlockData(block)) {
+            return error("%s: Corrupt compressed block at %s", __func__, pos.ToString());
+        }
     } catch (const std::exception& e) {
         return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
     }
@@ -788,23 +1199,357 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
     return true;
 }
 
-/** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
-FlatFilePos BlockManager::SaveBlockToDisk(const CBlock& block, int nHeight, CChain& active_chain, const CChainParams& chainparams, const FlatFilePos* dbp)
+std::vector<BlockFileRecord> ScanBlockFile(int file, const CChainParams& chainparams)
+{
+    std::vector<BlockFileRecord> records;
+    CAutoFile filein(OpenBlockFile(FlatFilePos(file, 0), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) return records;
+
+    // Read a page at the current position, look for a message start in it and
+    // check the size and header that follow. After a block, continue behind
+    // it, and after anything else, one byte behind the message start. The
+    // zeroes of the pre-allocated tail are skipped a page at a time.
+    constexpr size_t PREFIX_SIZE{CMessageHeader::MESSAGE_START_SIZE + 4};
+    constexpr size_t RECORD_HEADER_SIZE{PREFIX_SIZE + 80};
+    constexpr size_t MAX_COMPACT_SIZE_SIZE{9};
+    const CMessageHeader::MessageStartChars& message_start{chainparams.MessageStart()};
+    std::array<uint8_t, 4096> page;
+    uint64_t pos{0};
+    while (!ShutdownRequested()) {
+        if (fseek(filein.Get(), pos, SEEK_SET)) break;
+        const size_t len{fread(page.data(), 1, page.size(), filein.Get())};
+        const uint8_t* found{std::search(page.data(), page.data() + len, message_start, message_start + CMessageHeader::MESSAGE_START_SIZE)};
+        const size_t offset = found - page.data();
+        if (len - offset < RECORD_HEADER_SIZE + MAX_COMPACT_SIZE_SIZE && len == page.size()) {
+            // The record header may continue in the next page.
+            pos += std::min(offset, len - CMessageHeader::MESSAGE_START_SIZE + 1);
+            continue;
+        }
+        if (len - offset < RECORD_HEADER_SIZE) break; // end of file
+        pos += offset;
+        const uint32_t size{ReadLE32(found + CMessageHeader::MESSAGE_START_SIZE)};
+        BlockFileRecord record{FlatFilePos(file, pos + PREFIX_SIZE), size & ~BLOCK_RECORD_COMPRESSED};
+        record.compressed = size & BLOCK_RECORD_COMPRESSED;
+        SpanReader{SER_DISK, CLIENT_VERSION, Span{found + PREFIX_SIZE, 80}} >> record.header;
+        if (record.size < 80 || record.size > MAX_BLOCK_SERIALIZED_SIZE || !CheckProofOfWork(record.header.GetHash(), record.header.nBits, chainparams.GetConsensus())) {
+            ++pos;
+            continue;
+        }
+        try {
+            SpanReader txs{SER_DISK, CLIENT_VERSION, Span{found + RECORD_HEADER_SIZE, std::min({len - offset - RECORD_HEADER_SIZE, size_t{record.size} - 80, MAX_COMPACT_SIZE_SIZE})}};
+            record.num_tx = ReadCompactSize(txs);
+        } catch (const std::ios_base::failure&) {
+            // Left at zero, which no valid block has
+        }
+        records.push_back(record);
+        pos += PREFIX_SIZE + record.size;
+    }
+    return records;
+}
+
+/** Read the serialized undo data at pos and its checksum. */
+static bool ReadRawUndoFromDisk(std::vector<uint8_t>& undo, uint256& checksum, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
+{
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8; // Seek back 8 bytes for meta header
+    CAutoFile filein(OpenUndoFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return error("%s: OpenUndoFile failed for %s", __func__, pos.ToString());
+    }
+
+    try {
+        CMessageHeader::MessageStartChars undo_start;
+        unsigned int undo_size;
+        filein >> undo_start >> undo_size;
+        const bool compressed{(undo_size & BLOCK_RECORD_COMPRESSED) != 0};
+        undo_size &= ~BLOCK_RECORD_COMPRESSED;
+        if (memcmp(undo_start, message_start, CMessageHeader::MESSAGE_START_SIZE) || undo_size > MAX_SIZE) {
+            return error("%s: Bad undo data record header for %s", __func__, pos.ToString());
+        }
+        undo.resize(undo_size);
+        filein.read(MakeWritableByteSpan(undo));
+        filein >> checksum;
+        if (compressed && !DecompressUndoData(undo)) {
+            return error("%s: Corrupt compressed undo data for %s", __func__, pos.ToString());
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Read from undo file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
+namespace {
+/**
+ * Appends block and undo records to new block and undo files in a staging
+ * directory, for RepackBlockFiles, as SaveBlockToDisk and
+ * WriteUndoDataForBlock would, without deserializing them. The records are
+ * stored compressed or not as new records are, so a repack also converts the
+ * files after -blockcompression is changed. File numbers of the positions it
+ * returns count the new files from 0.
+ */
+class BlockRecordCopier
+{
+    FlatFileSeq m_block_seq;
+    FlatFileSeq m_undo_seq;
+    const CMessageHeader::MessageStartChars& m_message_start;
+    const unsigned int m_max_file_size;
+    std::vector<CBlockFileInfo> m_infos{1};
+    std::optional<CAutoFile> m_block_file;
+    std::optional<CAutoFile> m_undo_file;
+    std::vector<uint8_t> m_data;
+
+public:
+    BlockRecordCopier(const fs::path& dir, const CMessageHeader::MessageStartChars& message_start, unsigned int max_file_size)
+        : m_block_seq{dir, "blk", BLOCKFILE_CHUNK_SIZE}, m_undo_seq{dir, "rev", UNDOFILE_CHUNK_SIZE},
+          m_message_start{message_start}, m_max_file_size{max_file_size} {}
+
+    /** Copy the block record at `from`, and return the position of the copy in `to` */
+    bool CopyBlock(const CBlockIndex& index, const FlatFilePos& from, FlatFilePos& to)
+    {
+        if (!ReadRawBlockFromDisk(m_data, from, m_message_start)) return false;
+        const uint32_t size{fBlockCompression ? CompressBlockData(m_data) : uint32_t(m_data.size())};
+        if (m_infos.back().nSize > 0 && m_infos.back().nSize + 8 + m_data.size() > m_max_file_size) {
+            if (!FinishFile()) return false;
+            m_infos.emplace_back();
+        }
+        const int file = m_infos.size() - 1;
+        CBlockFileInfo& info = m_infos.back();
+        if (!m_block_file) {
+            m_block_file.emplace(m_block_seq.Open(FlatFilePos(file, 0)), SER_DISK, CLIENT_VERSION);
+            if (m_block_file->IsNull()) return error("%s: Failed to open block file %d", __func__, file);
+        }
+        *m_block_file << m_message_start << size;
+        m_block_file->write(MakeByteSpan(m_data));
+        to = FlatFilePos(file, info.nSize + 8);
+        info.nSize += 8 + m_data.size();
+        info.AddBlock(index.nHeight, index.GetBlockTime());
+        return true;
+    }
+
+    /** Copy the undo record at `from` to the undo file of the new block file `file` */
+    bool CopyUndo(int file, const FlatFilePos& from, FlatFilePos& to)
+    {
+        uint256 checksum;
+        if (!ReadRawUndoFromDisk(m_data, checksum, from, m_message_start)) return false;
+        const uint32_t size{fBlockCompression ? CompressUndoData(m_data) : uint32_t(m_data.size())};
+        CBlockFileInfo& info = m_infos.at(file);
+        // Undo data of a block in an earlier, finished file is appended to
+        // its undo file, which is then finished again.
+        const bool current{file == int(m_infos.size()) - 1};
+        std::optional<CAutoFile> earlier_file;
+        std::optional<CAutoFile>& undo_file{current ? m_undo_file : earlier_file};
+        if (!undo_file) {
+            undo_file.emplace(m_undo_seq.Open(FlatFilePos(file, info.nUndoSize)), SER_DISK, CLIENT_VERSION);
+            if (undo_file->IsNull()) return error("%s: Failed to open undo file %d", __func__, file);
+        }
+        *undo_file << m_message_start << size;
+        undo_file->write(MakeByteSpan(m_data));
+        *undo_file << checksum;
+        to = FlatFilePos(file, info.nUndoSize + 8);
+        info.nUndoSize += 8 + m_data.size() + uint256::size();
+        if (!current) {
+            undo_file.reset();
+            if (!m_undo_seq.Flush(FlatFilePos(file, info.nUndoSize), /*finalize=*/true)) return error("%s: Failed to sync undo file %d", __func__, file);
+        }
+        return true;
+    }
+
+    /** Sync the files being written and truncate them to their size */
+    bool FinishFile()
+    {
+        const int file = m_infos.size() - 1;
+        const CBlockFileInfo& info = m_infos.back();
+        m_block_file.reset();
+        m_undo_file.reset();
+        if ((info.nSize > 0 && !m_block_seq.Flush(FlatFilePos(file, info.nSize), /*finalize=*/true)) ||
+            (info.nUndoSize > 0 && !m_undo_seq.Flush(FlatFilePos(file, info.nUndoSize), /*finalize=*/true))) {
+            return error("%s: Failed to sync block file %d", __func__, file);
+        }
+        return true;
+    }
+
+    const std::vector<CBlockFileInfo>& Infos() const { return m_infos; }
+    fs::path BlockFileName(int file) const { return m_block_seq.FileName(FlatFilePos(file, 0)); }
+    fs::path UndoFileName(int file) const { return m_undo_seq.FileName(FlatFilePos(file, 0)); }
+};
+} // namespace
+
+bool BlockManager::RepackBlockFiles(const std::function<std::vector<CBlockIndex*>()>& blocks_to_keep, const CChainParams& chainparams, BlockRepackStats& stats)
+{
+    AssertLockNotHeld(::cs_main);
+
+    // The copies are written to a staging directory, which is removed again
+    // on every return, and left by an interrupted repack otherwise.
+    struct StagingDir {
+        const fs::path path{gArgs.GetBlocksDirPath() / "repack"};
+        ~StagingDir()
+        {
+            std::error_code ec;
+            fs::remove_all(path, ec);
+        }
+    } staging;
+    const unsigned int max_file_size{gArgs.GetBoolArg("-fastprune", false) ? 0x10000 /* 64kb */ : MAX_BLOCKFILE_SIZE};
+    BlockRecordCopier copier{staging.path, chainparams.MessageStart(), max_file_size};
+
+    // The blocks whose data is copied, where it is in the old files, and where
+    // the copies are in the new ones
+    struct Copy {
+        CBlockIndex* index;
+        FlatFilePos block_from, undo_from;
+        FlatFilePos block_to, undo_to;
+    };
+    std::vector<Copy> copies;
+    int old_files_end;
+    try {
+        fs::remove_all(staging.path);
+        TryCreateDirectories(staging.path);
+
+        {
+            LOCK2(::cs_main, cs_LastBlockFile);
+            if (!g_block_file_writer.Drain()) return false;
+            stats = {};
+            for (const CBlockFileInfo& info : m_blockfile_info) {
+                if (info.nSize > 0) ++stats.files_before;
+            }
+            stats.bytes_before = CalculateCurrentUsage();
+            for (CBlockIndex* pindex : blocks_to_keep()) {
+                copies.push_back({pindex, pindex->GetBlockPos(), pindex->nStatus & BLOCK_HAVE_UNDO ? pindex->GetUndoPos() : FlatFilePos{}, {}, {}});
+            }
+            // New blocks go to a new file from here on, which is kept. The
+            // old files only still get the undo data of blocks connected
+            // during the copy.
+            old_files_end = std::max<int>(m_last_blockfile + 1, m_blockfile_info.size());
+            FlushBlockFile(/*fFinalize=*/true, /*finalize_undo=*/false);
+            m_last_blockfile = old_files_end;
+            m_blockfile_info.resize(old_files_end + 1);
+        }
+
+        // Copy without holding cs_main, so that validation continues.
+        for (Copy& copy : copies) {
+            if (ShutdownRequested()) return false;
+            if (!copier.CopyBlock(*copy.index, copy.block_from, copy.block_to)) return false;
+            if (!copy.undo_from.IsNull() && !copier.CopyUndo(copy.block_to.nFile, copy.undo_from, copy.undo_to)) return false;
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Failed to write block file: %s", __func__, e.what());
+    }
+
+    LOCK2(::cs_main, cs_LastBlockFile);
+    if (!g_block_file_writer.Drain()) return false;
+    const auto in_old_files{[&](const CBlockIndex& index) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+        return (index.nStatus & BLOCK_HAVE_DATA) && index.nFile < old_files_end;
+    }};
+    try {
+        // Copy what changed meanwhile: the undo data of blocks connected
+        // during the copy, and blocks that are to be kept now, e.g. after a
+        // reorg.
+        std::unordered_set<const CBlockIndex*> copied;
+        for (Copy& copy : copies) {
+            copied.insert(copy.index);
+            if (in_old_files(*copy.index) && (copy.index->nStatus & BLOCK_HAVE_UNDO) && copy.undo_from.IsNull()) {
+                copy.undo_from = copy.index->GetUndoPos();
+                if (!copier.CopyUndo(copy.block_to.nFile, copy.undo_from, copy.undo_to)) return false;
+            }
+        }
+        for (CBlockIndex* pindex : blocks_to_keep()) {
+            if (!in_old_files(*pindex) || copied.count(pindex)) continue;
+            Copy& copy = copies.emplace_back(Copy{pindex, pindex->GetBlockPos(), pindex->nStatus & BLOCK_HAVE_UNDO ? pindex->GetUndoPos() : FlatFilePos{}, {}, {}});
+            if (!copier.CopyBlock(*copy.index, copy.block_from, copy.block_to)) return false;
+            if (!copy.undo_from.IsNull() && !copier.CopyUndo(copy.block_to.nFile, copy.undo_from, copy.undo_to)) return false;
+        }
+        if (!copier.FinishFile()) return false;
+
+        // Move the copies behind all block files, including those written
+        // during the copy.
+        for (size_t i = 0; i < copier.Infos().size(); ++i) {
+            const FlatFilePos pos(m_blockfile_info.size() + i, 0);
+            fs::rename(copier.BlockFileName(i), BlockFileSeq().FileName(pos));
+            if (copier.Infos()[i].nUndoSize > 0) fs::rename(copier.UndoFileName(i), UndoFileSeq().FileName(pos));
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Failed to write block file: %s", __func__, e.what());
+    }
+
+    // Point the block index at the copies, drop the data of the blocks left
+    // in the old files and replace their file info. Readers open the files
+    // while holding cs_main, so none of them still reads the old files once
+    // they are unlinked.
+    const int first_file = m_blockfile_info.size();
+    stats.blocks = 0;
+    for (const Copy& copy : copies) {
+        CBlockIndex& index = *copy.index;
+        if (!in_old_files(index)) continue; // pruned during the copy
+        index.nFile = first_file + copy.block_to.nFile;
+        index.nDataPos = copy.block_to.nPos;
+        index.nUndoPos = copy.undo_to.nPos;
+        m_dirty_blockindex.insert(&index);
+        ++stats.blocks;
+    }
+    // Without pruning, the block index must not hold blocks whose data is
+    // gone, so those become headers only, as if never downloaded.
+    const bool pruned{m_have_pruned || fPruneMode};
+    for (auto& [_, index] : m_block_index) {
+        if ((index.nStatus & BLOCK_HAVE_MASK) && index.nFile < old_files_end) {
+            UnsetBlockData(index);
+            if (!pruned) {
+                index.nTx = 0;
+                index.nChainTx = 0;
+                index.nSequenceId = 0;
+                if ((index.nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) {
+                    index.nStatus = (index.nStatus & ~BLOCK_VALID_MASK) | BLOCK_VALID_TREE;
+                }
+            }
+            ++stats.dropped;
+        }
+    }
+    std::set<int> old_files;
+    for (int file = 0; file < old_files_end; ++file) {
+        m_blockfile_info[file].SetNull();
+        m_dirty_fileinfo.insert(file);
+        old_files.insert(file);
+    }
+    for (const CBlockFileInfo& info : copier.Infos()) {
+        m_dirty_fileinfo.insert(m_blockfile_info.size());
+        m_blockfile_info.push_back(info);
+    }
+    if (stats.dropped > 0 && pruned && !m_have_pruned) {
+        m_have_pruned = true;
+        m_block_tree_db->WriteFlag("prunedblockfiles", true);
+    }
+    if (!WriteBlockIndexDB()) return error("%s: Failed to write block index database", __func__);
+    UnlinkPrunedFiles(old_files);
+
+    for (const CBlockFileInfo& info : m_blockfile_info) {
+        if (info.nSize > 0) ++stats.files_after;
+    }
+    stats.bytes_after = CalculateCurrentUsage();
+    LogPrintf("Repacked %u blocks into %d block files, dropped the data of %u blocks\n", stats.blocks, copier.Infos().size(), stats.dropped);
+    return true;
+}
+
+FlatFilePos BlockManager::SaveBlockToDisk(const CBlock& block, int nHeight, CChain& active_chain, const CChainParams& chainparams, const FlatFilePos* dbp, uint32_t dbp_size)
 {
-    unsigned int nBlockSize = ::GetSerializeSize(block, CLIENT_VERSION);
+    std::vector<uint8_t> record;
+    unsigned int nRecordSize;
     FlatFilePos blockPos;
     if (dbp != nullptr) {
         blockPos = *dbp;
+        // A block found in the block files takes the space it is stored with.
+        nRecordSize = (dbp_size ? dbp_size : ::GetSerializeSize(block, CLIENT_VERSION)) + 8;
+    } else {
+        record = MakeBlockRecord(block, chainparams.MessageStart());
+        nRecordSize = record.size();
     }
-    if (!FindBlockPos(blockPos, nBlockSize + 8, nHeight, active_chain, block.GetBlockTime(), dbp != nullptr)) {
+    if (!FindBlockPos(blockPos, nRecordSize, nHeight, active_chain, block.GetBlockTime(), dbp != nullptr)) {
         error("%s: FindBlockPos failed", __func__);
         return FlatFilePos();
     }
     if (dbp == nullptr) {
-        if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart())) {
+        if (!g_block_file_writer.Write(/*undo=*/false, blockPos, std::move(record))) {
             AbortNode("Failed to write block");
             return FlatFilePos();
         }
+        blockPos.nPos += 8;
     }
     return blockPos;
 }
@@ -833,23 +1578,15 @@ void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFile
 
         // -reindex
         if (fReindex) {
-            int nFile = 0;
-            while (true) {
-                FlatFilePos pos(nFile, 0);
-                if (!fs::exists(GetBlockPosFilename(pos))) {
-                    break; // No block files left to reindex
-                }
-                FILE* file = OpenBlockFile(pos, true);
-                if (!file) {
-                    break; // This error is logged in OpenBlockFile
-                }
-                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-                chainman.ActiveChainstate().LoadExternalBlockFile(file, &pos);
-                if (ShutdownRequested()) {
-                    LogPrintf("Shutdown requested. Exit %s\n", __func__);
-                    return;
-                }
-                nFile++;
+            int threads = args.GetIntArg("-reindexthreads", DEFAULT_REINDEX_THREADS);
+            if (threads <= 0) threads = GetNumCores();
+            threads = std::clamp(threads, 1, MAX_REINDEX_THREADS);
+            const bool headers_only{args.GetBoolArg("-reindex-headers", false)};
+            LogPrintf("Reindexing block files using %d threads%s\n", threads, headers_only ? ", from the block headers only" : "");
+            chainman.ActiveChainstate().ReindexBlockFiles(threads, headers_only);
+            if (ShutdownRequested()) {
+                LogPrintf("Shutdown requested. Exit %s\n", __func__);
+                return;
             }
             WITH_LOCK(::cs_main, chainman.m_blockman.m_block_tree_db->WriteReindexing(false));
             fReindex = false;
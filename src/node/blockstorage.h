@@ -7,13 +7,20 @@
 
 #include <attributes.h>
 #include <chain.h>
+#include <flatfile.h>
 #include <fs.h>
+#include <node/blockmap.h>
+#include <primitives/block.h>
 #include <protocol.h>
 #include <sync.h>
 #include <txdb.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -29,13 +36,18 @@ class CChainParams;
 class CChainState;
 class ChainstateManager;
 struct CCheckpointData;
-struct FlatFilePos;
 namespace Consensus {
 struct Params;
 }
 
 namespace node {
 static constexpr bool DEFAULT_STOPAFTERBLOCKIMPORT{false};
+/** Default for -persistblockindex */
+static constexpr bool DEFAULT_PERSIST_BLOCK_INDEX{true};
+/** Default for -reindexthreads, 0 = number of cores */
+static constexpr int DEFAULT_REINDEX_THREADS{0};
+/** Maximum number of threads scanning and reading block files during -reindex */
+static constexpr int MAX_REINDEX_THREADS{16};
 
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
@@ -43,6 +55,19 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
+/** Default for -blockcompression */
+static constexpr bool DEFAULT_BLOCK_COMPRESSION{false};
+/**
+ * Set in the size of a block or undo file record whose data is compressed.
+ * A compressed block keeps its header and transaction count uncompressed,
+ * followed by the size of its serialized transactions and their LZ4
+ * compression. Compressed undo data is its size followed by its compression.
+ */
+static constexpr uint32_t BLOCK_RECORD_COMPRESSED{0x80000000};
+/** Default for -blockwritebuffer, in MiB. 0 writes block and undo data on the validation thread. */
+static constexpr int64_t DEFAULT_BLOCK_WRITE_BUFFER{0};
+/** Maximum for -blockwritebuffer, in MiB */
+static constexpr int64_t MAX_BLOCK_WRITE_BUFFER{1024};
 
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
@@ -51,12 +76,8 @@ extern std::atomic_bool fReindex;
 extern bool fPruneMode;
 /** Number of MiB of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
-
-// Because validation code takes pointers to the map's CBlockIndex objects, if
-// we ever switch to another associative container, we need to either use a
-// container that has stable addressing (true of all std associative
-// containers), or make the key a `std::unique_ptr<CBlockIndex>`
-using BlockMap = std::unordered_map<uint256, CBlockIndex, BlockHasher>;
+/** True if new block and undo data is compressed (-blockcompression). */
+extern bool fBlockCompression;
 
 struct CBlockIndexWorkComparator {
     bool operator()(const CBlockIndex* pa, const CBlockIndex* pb) const;
@@ -71,6 +92,19 @@ struct PruneLockInfo {
     int height_first{std::numeric_limits<int>::max()}; //! Height of earliest block that should be kept and not pruned
 };
 
+/** Outcome of BlockManager::RepackBlockFiles */
+struct BlockRepackStats {
+    //! Number of block files before and after the repack
+    int files_before{0};
+    int files_after{0};
+    //! Number of blocks copied, and of blocks whose data was dropped
+    uint64_t blocks{0};
+    uint64_t dropped{0};
+    //! Size of the block and undo files before and after the repack
+    uint64_t bytes_before{0};
+    uint64_t bytes_after{0};
+};
+
 /**
  * Maintains a tree of blocks (stored in `m_block_index`) which is consulted
  * to determine where the most-work tip is.
@@ -91,6 +125,12 @@ private:
      */
     bool LoadBlockIndex(const Consensus::Params& consensus_params)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /**
+     * Load the block index from the snapshot written on the last clean
+     * shutdown, if one exists and matches the block tree database. Populates
+     * the same per entry metadata as the database, plus nChainWork.
+     */
+    bool LoadBlockIndexSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void FlushBlockFile(bool fFinalize = false, bool finalize_undo = false);
     void FlushUndoFile(int block_file, bool finalize = false);
     bool FindBlockPos(FlatFilePos& pos, unsigned int nAddSize, unsigned int nHeight, CChain& active_chain, uint64_t nTime, bool fKnown);
@@ -116,6 +156,9 @@ private:
      */
     void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight, int chain_tip_height, int prune_height, bool is_ibd);
 
+    //! Unset the block and undo data of a block whose files are deleted
+    void UnsetBlockData(CBlockIndex& index) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     RecursiveMutex cs_LastBlockFile;
     std::vector<CBlockFileInfo> m_blockfile_info;
     int m_last_blockfile = 0;
@@ -154,6 +197,13 @@ public:
 
     bool WriteBlockIndexDB() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool LoadBlockIndexDB() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    /**
+     * Write the block index to a snapshot file for the next startup to load
+     * instead of reading the block tree database. All changes to the block
+     * index must have been flushed, and it must not change anymore, as on
+     * shutdown.
+     */
+    bool WriteBlockIndexSnapshot() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     CBlockIndex* AddToBlockIndex(const CBlockHeader& block, CBlockIndex*& best_header) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
@@ -162,6 +212,24 @@ public:
     //! Mark one block file as pruned (modify associated database entries)
     void PruneOneBlockFile(const int fileNumber) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Copy the block and undo data of the blocks returned by `blocks_to_keep`,
+     * in that order, to new block and undo files numbered after the existing
+     * ones, point their block index entries at the copies and delete the old
+     * files. The data of all other blocks is dropped: as if pruned in prune
+     * mode, or else as if only their headers had been received. Needs free
+     * disk space for the copies. The block index is only changed once all
+     * copies are written and synced, so an interrupted repack leaves it intact.
+     *
+     * The copies are written without holding cs_main. New blocks are stored
+     * in new files meanwhile, which are kept. `blocks_to_keep` is called with
+     * cs_main held before the copy and again before the files are swapped,
+     * when blocks it returns in addition and undo data written meanwhile are
+     * copied as well.
+     */
+    bool RepackBlockFiles(const std::function<std::vector<CBlockIndex*>()>& blocks_to_keep, const CChainParams& chainparams, BlockRepackStats& stats)
+        LOCKS_EXCLUDED(::cs_main);
+
     CBlockIndex* LookupBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     const CBlockIndex* LookupBlockIndex(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -171,7 +239,11 @@ public:
     bool WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValidationState& state, CBlockIndex* pindex, const CChainParams& chainparams)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
-    FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, CChain& active_chain, const CChainParams& chainparams, const FlatFilePos* dbp);
+    /**
+     * Store a block on disk. If dbp is non-nullptr, the block is known to
+     * already reside on disk at *dbp, with `dbp_size` bytes of record data.
+     */
+    FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, CChain& active_chain, const CChainParams& chainparams, const FlatFilePos* dbp, uint32_t dbp_size = 0);
 
     /** Calculate the amount of disk space the block & undo files currently use */
     uint64_t CalculateCurrentUsage();
@@ -211,6 +283,82 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
+/** Replace the serialized block `data` with its compressed record data, if that is smaller. Returns the record size. */
+uint32_t CompressBlockData(std::vector<uint8_t>& data);
+/** Replace compressed block record data with the serialized block. */
+bool DecompressBlockData(std::vector<uint8_t>& data);
+
+/** Position, stored size, header, transaction count and compression of a block stored in a block file. */
+struct BlockFileRecord {
+    FlatFilePos pos;
+    uint32_t size;
+    CBlockHeader header{};
+    uint64_t num_tx{0};
+    bool compressed{false};
+};
+
+/**
+ * Find the blocks stored in block file `file`: the records of a message
+ * start and size followed by a block header with valid proof of work, as
+ * written by SaveBlockToDisk. Only the headers and transaction counts are
+ * read, the rest of each block is skipped.
+ */
+std::vector<BlockFileRecord> ScanBlockFile(int file, const CChainParams& chainparams);
+
+/**
+ * Appends block and undo file records (message start, size and data) on a
+ * background thread, so that validation does not wait for the disk. Records
+ * are written in the order they are queued, to positions already reserved by
+ * FindBlockPos and FindUndoPos. They are durable only once the queue is
+ * drained and the files are flushed: FlushBlockFile and FlushUndoFile drain
+ * it first, so the block index and chainstate written by FlushStateToDisk
+ * never refer to data that is not on disk. Reads of a record that is still
+ * queued wait for it to be written.
+ *
+ * Without a running thread (the default, and in tests) records are written
+ * synchronously by Write.
+ */
+class BlockFileWriter
+{
+    struct Record {
+        bool undo;
+        //! Position of the message start of the record
+        FlatFilePos pos;
+        std::vector<uint8_t> data;
+    };
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    //! Records to write. The front one stays queued while it is written.
+    std::deque<Record> m_queue GUARDED_BY(m_mutex);
+    size_t m_queued_bytes GUARDED_BY(m_mutex){0};
+    size_t m_max_bytes GUARDED_BY(m_mutex){0};
+    bool m_running GUARDED_BY(m_mutex){false};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    //! Set when a write failed; the node is shutting down then.
+    bool m_failed GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+
+    void ThreadWrite() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+public:
+    ~BlockFileWriter();
+
+    /** Start the writer thread, which queues up to max_bytes of records before Write waits. */
+    void Start(size_t max_bytes) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Write the queued records and stop the thread. */
+    void Stop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Queue the record `data` to be written at `pos`. Returns false if it or an earlier write failed. */
+    bool Write(bool undo, const FlatFilePos& pos, std::vector<uint8_t>&& data) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Wait until the queued records are written. Returns false if any write failed. */
+    bool Drain() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Wait until no queued record covers pos, the position of block or undo data to read. */
+    void WaitForRecord(bool undo, const FlatFilePos& pos) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+extern BlockFileWriter g_block_file_writer;
+
 void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFiles, const ArgsManager& args);
 } // namespace node
 
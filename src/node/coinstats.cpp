@@ -13,11 +13,20 @@
 #include <uint256.h>
 #include <util/overflow.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <map>
+#include <optional>
+#include <vector>
 
 namespace node {
+/** Number of txid ranges the UTXO set is split into to compute its stats in parallel */
+static constexpr uint32_t UTXO_STATS_PARTITIONS{4096};
+/** Number of partitions processed ahead of the combining thread, per worker thread */
+static constexpr size_t UTXO_STATS_PARTITIONS_AHEAD_PER_THREAD{4};
+
 // Database-independent metric indicating the UTXO set size
 uint64_t GetBogoSize(const CScript& script_pub_key)
 {
@@ -49,7 +58,8 @@ CDataStream TxOutSer(const COutPoint& outpoint, const Coin& coin) {
 //! It is also possible, though very unlikely, that a change in this
 //! construction could cause a previously invalid (and potentially malicious)
 //! UTXO snapshot to be considered valid.
-static void ApplyHash(CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+template <typename Stream>
+static void SerializeHashOutputs(Stream& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
 {
     for (auto it = outputs.begin(); it != outputs.end(); ++it) {
         if (it == outputs.begin()) {
@@ -67,6 +77,16 @@ static void ApplyHash(CHashWriter& ss, const uint256& hash, const std::map<uint3
     }
 }
 
+static void ApplyHash(CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+{
+    SerializeHashOutputs(ss, hash, outputs);
+}
+
+void AppendHashSerialized(CVectorWriter& writer, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+{
+    SerializeHashOutputs(writer, hash, outputs);
+}
+
 static void ApplyHash(std::nullptr_t, const uint256& hash, const std::map<uint32_t, Coin>& outputs) {}
 
 static void ApplyHash(MuHash3072& muhash, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
@@ -91,35 +111,59 @@ static void ApplyStats(CCoinsStats& stats, const uint256& hash, const std::map<u
     }
 }
 
-//! Calculate statistics about the unspent transaction output set
-template <typename T>
-static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point, const CBlockIndex* pindex)
+static void ApplyHash(std::vector<unsigned char>& preimage, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
+    CVectorWriter writer{SER_GETHASH, PROTOCOL_VERSION, preimage, preimage.size()};
+    SerializeHashOutputs(writer, hash, outputs);
+}
 
-    if (!pindex) {
-        LOCK(cs_main);
-        pindex = blockman.LookupBlockIndex(view->GetBestBlock());
-    }
-    stats.nHeight = Assert(pindex)->nHeight;
-    stats.hashBlock = pindex->GetBlockHash();
+//! Hash of the coins of one partition of the UTXO set. The HASH_SERIALIZED
+//! hash is sequential, so partitions collect its preimage instead.
+template <typename T>
+struct PartitionHash {
+    using Type = T;
+};
+template <>
+struct PartitionHash<CHashWriter> {
+    using Type = std::vector<unsigned char>;
+};
 
-    // Use CoinStatsIndex if it is requested and available and a hash_type of Muhash or None was requested
-    if ((stats.m_hash_type == CoinStatsHashType::MUHASH || stats.m_hash_type == CoinStatsHashType::NONE) && g_coin_stats_index && stats.index_requested) {
-        stats.index_used = true;
-        return g_coin_stats_index->LookUpStats(pindex, stats);
-    }
+static void CombineHash(CHashWriter& ss, const std::vector<unsigned char>& preimage)
+{
+    ss.write(MakeByteSpan(preimage));
+}
+static void CombineHash(MuHash3072& muhash, const MuHash3072& part)
+{
+    muhash *= part;
+}
+static void CombineHash(std::nullptr_t, std::nullptr_t) {}
 
-    PrepareHash(hash_obj, stats);
+static void CombineStats(CCoinsStats& stats, const CCoinsStats& part)
+{
+    stats.nTransactions += part.nTransactions;
+    stats.nTransactionOutputs += part.nTransactionOutputs;
+    stats.nBogoSize += part.nBogoSize;
+    stats.coins_count += part.coins_count;
+    if (stats.total_amount.has_value() && part.total_amount.has_value()) {
+        stats.total_amount = CheckedAdd(*stats.total_amount, *part.total_amount);
+    } else {
+        stats.total_amount.reset();
+    }
+}
 
+//! Apply the coins from the cursor position up to the end of the UTXO set,
+//! or up to the first coin with a txid at or after `end`.
+template <typename T>
+static bool ApplyCoins(CCoinsViewCursor& cursor, const std::optional<uint256>& end, CCoinsStats& stats, T& hash_obj, const std::function<void()>& interruption_point)
+{
     uint256 prevkey;
     std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
+    while (cursor.Valid()) {
         interruption_point();
         COutPoint key;
         Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+        if (cursor.GetKey(key) && cursor.GetValue(coin)) {
+            if (end && !(key.hash < *end)) break;
             if (!outputs.empty() && key.hash != prevkey) {
                 ApplyStats(stats, prevkey, outputs);
                 ApplyHash(hash_obj, prevkey, outputs);
@@ -131,12 +175,80 @@ static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats&
         } else {
             return error("%s: unable to read value", __func__);
         }
-        pcursor->Next();
+        cursor.Next();
     }
     if (!outputs.empty()) {
         ApplyStats(stats, prevkey, outputs);
         ApplyHash(hash_obj, prevkey, outputs);
     }
+    return true;
+}
+
+//! Calculate statistics about the unspent transaction output set
+template <typename T>
+static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point, const CBlockIndex* pindex)
+{
+    const int threads{stats.m_threads > 0 ? std::min(stats.m_threads, MAX_UTXO_STATS_THREADS) : std::clamp(GetNumCores(), 1, MAX_UTXO_STATS_THREADS)};
+
+    // Cursors of all threads are created under cs_main, which is held while
+    // the coins cache is flushed, so that they see the same database state.
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < threads; ++i) {
+            cursors.push_back(view->Cursor());
+            assert(cursors.back());
+        }
+    }
+
+    if (!pindex) {
+        LOCK(cs_main);
+        pindex = blockman.LookupBlockIndex(view->GetBestBlock());
+    }
+    stats.nHeight = Assert(pindex)->nHeight;
+    stats.hashBlock = pindex->GetBlockHash();
+
+    // Use CoinStatsIndex if it is requested and available and a hash_type of Muhash or None was requested
+    if ((stats.m_hash_type == CoinStatsHashType::MUHASH || stats.m_hash_type == CoinStatsHashType::NONE) && g_coin_stats_index && stats.index_requested) {
+        stats.index_used = true;
+        return g_coin_stats_index->LookUpStats(pindex, stats);
+    }
+
+    PrepareHash(hash_obj, stats);
+
+    if (threads == 1) {
+        if (!ApplyCoins(*cursors[0], std::nullopt, stats, hash_obj, interruption_point)) return false;
+    } else {
+        // Each thread walks its own cursor over a series of txid ranges, whose
+        // results are combined in key order on this thread.
+        struct Partition {
+            CCoinsStats stats;
+            typename PartitionHash<T>::Type hash{};
+            explicit Partition(CoinStatsHashType hash_type) : stats{hash_type} {}
+        };
+        std::vector<Partition> partitions;
+        partitions.reserve(UTXO_STATS_PARTITIONS);
+        for (uint32_t i = 0; i < UTXO_STATS_PARTITIONS; ++i) partitions.emplace_back(stats.m_hash_type);
+
+        const auto apply_partition = [&](size_t index, int worker) {
+            CCoinsViewCursor& cursor{*cursors[worker]};
+            std::optional<uint256> end;
+            if (index + 1 < UTXO_STATS_PARTITIONS) end = UTXOSetPartitionBegin(index + 1, UTXO_STATS_PARTITIONS);
+            cursor.Seek(COutPoint{UTXOSetPartitionBegin(index, UTXO_STATS_PARTITIONS), 0});
+            return ApplyCoins(cursor, end, partitions[index].stats, partitions[index].hash, [] {});
+        };
+        const auto combine_partition = [&](size_t index) {
+            interruption_point();
+            CombineStats(stats, partitions[index].stats);
+            CombineHash(hash_obj, partitions[index].hash);
+            partitions[index].hash = {};
+            return true;
+        };
+        if (!util::RunOrderedJobs(UTXO_STATS_PARTITIONS, threads, UTXO_STATS_PARTITIONS_AHEAD_PER_THREAD * threads,
+                                  "coinstats", apply_partition, combine_partition)) {
+            return false;
+        }
+    }
 
     FinalizeHash(hash_obj, stats);
 
@@ -144,6 +256,16 @@ static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats&
     return true;
 }
 
+uint256 UTXOSetPartitionBegin(uint32_t index, uint32_t count)
+{
+    assert(count > 0 && count <= MAX_UTXO_SET_PARTITIONS && index < count);
+    const uint32_t prefix{static_cast<uint32_t>(uint64_t{index} * MAX_UTXO_SET_PARTITIONS / count)};
+    uint256 begin;
+    begin.begin()[0] = prefix >> 8;
+    begin.begin()[1] = prefix & 0xff;
+    return begin;
+}
+
 bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, const std::function<void()>& interruption_point, const CBlockIndex* pindex)
 {
     switch (stats.m_hash_type) {
@@ -14,6 +14,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <map>
 
 class CCoinsView;
 namespace node {
@@ -21,6 +22,11 @@ class BlockManager;
 } // namespace node
 
 namespace node {
+//! Maximum number of threads computing UTXO set statistics
+static constexpr int MAX_UTXO_STATS_THREADS{16};
+//! Maximum number of ranges the UTXO set can be split into by UTXOSetPartitionBegin()
+static constexpr uint32_t MAX_UTXO_SET_PARTITIONS{1 << 16};
+
 enum class CoinStatsHashType {
     HASH_SERIALIZED,
     MUHASH,
@@ -49,6 +55,9 @@ struct CCoinsStats {
     //! Signals if the coinstatsindex was used to retrieve the statistics.
     bool index_used{false};
 
+    //! Number of threads walking the UTXO set, or 0 for one per core.
+    int m_threads{0};
+
     // Following values are only available from coinstats index
 
     //! Total cumulative amount of block subsidies up to and including this block
@@ -78,7 +87,17 @@ bool GetUTXOStats(CCoinsView* view, node::BlockManager& blockman, CCoinsStats& s
 
 uint64_t GetBogoSize(const CScript& script_pub_key);
 
+//! Lowest txid of range `index` when the UTXO set is split into `count` ranges
+//! of about the same number of coins.
+uint256 UTXOSetPartitionBegin(uint32_t index, uint32_t count);
+
 CDataStream TxOutSer(const COutPoint& outpoint, const Coin& coin);
+
+//! Append the unspent outputs of one transaction to the data hashed by
+//! CoinStatsHashType::HASH_SERIALIZED. Transactions appended in txid order
+//! after the block hash hash to the same value as GetUTXOStats, so parts of
+//! the UTXO set can be serialized separately and hashed together in order.
+void AppendHashSerialized(CVectorWriter& writer, const uint256& hash, const std::map<uint32_t, Coin>& outputs);
 } // namespace node
 
 #endif // BITCOIN_NODE_COINSTATS_H
@@ -0,0 +1,298 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/utxo_snapshot.h>
+
+#include <clientversion.h>
+#include <coins.h>
+#include <hash.h>
+#include <logging.h>
+#include <node/coinstats.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <util/thread.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <map>
+#include <optional>
+
+namespace node {
+namespace {
+/** Number of coins a chunk loader collects before writing them to the database */
+constexpr size_t SNAPSHOT_WRITE_BATCH_COINS{100000};
+/** Number of chunks processed ahead of the calling thread, per worker thread */
+constexpr size_t SNAPSHOT_CHUNKS_AHEAD_PER_THREAD{2};
+
+/** Collects the outputs of one transaction at a time for AppendHashSerialized. */
+class HashSerializedWriter
+{
+    CVectorWriter m_writer;
+    uint256 m_txid;
+    std::map<uint32_t, Coin> m_outputs;
+
+public:
+    explicit HashSerializedWriter(std::vector<unsigned char>& data) : m_writer{SER_GETHASH, PROTOCOL_VERSION, data, 0} {}
+
+    void Add(const COutPoint& outpoint, const Coin& coin)
+    {
+        if (!m_outputs.empty() && outpoint.hash != m_txid) Finish();
+        m_txid = outpoint.hash;
+        m_outputs.emplace(outpoint.n, coin);
+    }
+
+    void Finish()
+    {
+        if (m_outputs.empty()) return;
+        AppendHashSerialized(m_writer, m_txid, m_outputs);
+        m_outputs.clear();
+    }
+};
+
+/** Serialized coins of a chunk, and their part of the HASH_SERIALIZED preimage. */
+struct ChunkData {
+    std::vector<unsigned char> coins;
+    std::vector<unsigned char> hash_data;
+};
+
+void ReadChunk(CAutoFile& file, CDataStream& data, uint64_t size)
+{
+    // Grow the buffer as data is read, so that a bogus chunk size cannot
+    // allocate more memory than the file holds.
+    constexpr uint64_t STEP{1 << 20};
+    data.clear();
+    while (data.size() < size) {
+        const size_t step{static_cast<size_t>(std::min(size - data.size(), STEP))};
+        data.resize(data.size() + step);
+        file.read(MakeWritableByteSpan(data).last(step));
+    }
+}
+} // namespace
+
+uint256 SnapshotChunkBegin(uint32_t index, uint32_t count)
+{
+    static_assert(MAX_SNAPSHOT_CHUNKS <= MAX_UTXO_SET_PARTITIONS);
+    return UTXOSetPartitionBegin(index, count);
+}
+
+int SnapshotThreads()
+{
+    return std::clamp(GetNumCores(), 1, MAX_SNAPSHOT_THREADS);
+}
+
+bool WriteChunkedSnapshot(
+    std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors,
+    CAutoFile& afile,
+    uint32_t chunk_count,
+    SnapshotMetadata& metadata,
+    uint256& hash_serialized,
+    const std::function<void()>& interruption_point)
+{
+    assert(!cursors.empty() && chunk_count > 0 && chunk_count <= MAX_SNAPSHOT_CHUNKS);
+
+    // Chunk entries have a fixed size, so a placeholder of the metadata can
+    // be written now and overwritten once the chunks are known.
+    metadata.m_coins_count = 0;
+    metadata.m_chunks.assign(chunk_count, SnapshotChunk{});
+    afile << metadata;
+
+    CHashWriter ss{SER_GETHASH, PROTOCOL_VERSION};
+    ss << metadata.m_base_blockhash;
+
+    std::vector<ChunkData> chunks(chunk_count);
+    const auto write_chunk = [&](size_t index, int worker) {
+        SnapshotChunk& chunk{metadata.m_chunks[index]};
+        ChunkData& data{chunks[index]};
+        chunk.m_begin = SnapshotChunkBegin(index, chunk_count);
+        std::optional<uint256> end;
+        if (index + 1 < chunk_count) end = SnapshotChunkBegin(index + 1, chunk_count);
+
+        CCoinsViewCursor& cursor{*cursors[worker]};
+        CVectorWriter coins_writer{SER_DISK, CLIENT_VERSION, data.coins, 0};
+        HashSerializedWriter hash_writer{data.hash_data};
+        COutPoint outpoint;
+        Coin coin;
+        for (cursor.Seek(COutPoint{chunk.m_begin, 0}); cursor.Valid(); cursor.Next()) {
+            if (!cursor.GetKey(outpoint) || !cursor.GetValue(coin)) return false;
+            if (end && !(outpoint.hash < *end)) break;
+            coins_writer << outpoint << coin;
+            hash_writer.Add(outpoint, coin);
+            ++chunk.m_coins_count;
+        }
+        hash_writer.Finish();
+        chunk.m_size = data.coins.size();
+        chunk.m_hash = Hash(data.coins);
+        return true;
+    };
+    const auto consume_chunk = [&](size_t index) {
+        interruption_point();
+        afile.write(MakeByteSpan(chunks[index].coins));
+        ss.write(MakeByteSpan(chunks[index].hash_data));
+        metadata.m_coins_count += metadata.m_chunks[index].m_coins_count;
+        chunks[index] = {};
+        return true;
+    };
+    if (!util::RunOrderedJobs(chunk_count, cursors.size(), SNAPSHOT_CHUNKS_AHEAD_PER_THREAD * cursors.size(), "snapshot", write_chunk, consume_chunk)) return false;
+
+    hash_serialized = ss.GetHash();
+    if (std::fseek(afile.Get(), 0, SEEK_SET) != 0) {
+        throw std::ios_base::failure("Unable to rewind UTXO snapshot file");
+    }
+    afile << metadata;
+    return true;
+}
+
+bool LoadChunkedSnapshot(
+    CAutoFile& coins_file,
+    const SnapshotMetadata& metadata,
+    int base_height,
+    CCoinsViewDB& coinsdb,
+    int threads,
+    uint256& hash_serialized)
+{
+    const std::vector<SnapshotChunk>& chunks{metadata.m_chunks};
+    assert(!chunks.empty());
+
+    // Chunks must cover the whole key space in order, so that coins checked to
+    // be within their chunk and in order within it are unique.
+    uint64_t coins_count{0};
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (i == 0 ? !chunks[i].m_begin.IsNull() : !(chunks[i - 1].m_begin < chunks[i].m_begin)) {
+            LogPrintf("[snapshot] bad snapshot - chunk %u does not follow the previous chunk\n", i);
+            return false;
+        }
+        if (chunks[i].m_coins_count > metadata.m_coins_count - coins_count) {
+            LogPrintf("[snapshot] bad snapshot - chunks hold more coins than the metadata\n");
+            return false;
+        }
+        coins_count += chunks[i].m_coins_count;
+    }
+    if (coins_count != metadata.m_coins_count) {
+        LogPrintf("[snapshot] bad snapshot - chunks hold %d coins, expected %d\n", coins_count, metadata.m_coins_count);
+        return false;
+    }
+
+    LogPrintf("[snapshot] loading %u chunks using %d threads\n", chunks.size(), threads);
+
+    CHashWriter ss{SER_GETHASH, PROTOCOL_VERSION};
+    ss << metadata.m_base_blockhash;
+
+    // Chunks are read from the file in order by the job threads. Jobs are
+    // started in chunk order, so each waits only for jobs already running.
+    Mutex file_mutex;
+    std::condition_variable file_cv;
+    size_t next_read{0};
+
+    std::vector<std::vector<unsigned char>> hash_data(chunks.size());
+    const auto load_chunk = [&](size_t index, int worker) {
+        const SnapshotChunk& chunk{chunks[index]};
+        CDataStream coins{SER_DISK, CLIENT_VERSION};
+        bool read_ok{true};
+        {
+            WAIT_LOCK(file_mutex, lock);
+            file_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(file_mutex) { return next_read == index; });
+            try {
+                ReadChunk(coins_file, coins, chunk.m_size);
+            } catch (const std::ios_base::failure&) {
+                read_ok = false;
+            }
+            ++next_read;
+        }
+        file_cv.notify_all();
+        if (!read_ok) {
+            LogPrintf("[snapshot] bad snapshot - truncated in chunk %u\n", index);
+            return false;
+        }
+        if (Hash(coins) != chunk.m_hash) {
+            LogPrintf("[snapshot] bad snapshot - hash mismatch in chunk %u\n", index);
+            return false;
+        }
+
+        std::optional<uint256> end;
+        if (index + 1 < chunks.size()) end = chunks[index + 1].m_begin;
+
+        HashSerializedWriter hash_writer{hash_data[index]};
+        std::vector<std::pair<COutPoint, Coin>> run;
+        run.reserve(std::min<uint64_t>(chunk.m_coins_count, SNAPSHOT_WRITE_BATCH_COINS));
+        COutPoint outpoint;
+        COutPoint prev_outpoint;
+        Coin coin;
+        for (uint64_t n = 0; n < chunk.m_coins_count; ++n) {
+            try {
+                coins >> outpoint;
+                coins >> coin;
+            } catch (const std::ios_base::failure&) {
+                LogPrintf("[snapshot] bad snapshot format in chunk %u after deserializing %d coins\n", index, n);
+                return false;
+            }
+            if (outpoint.hash < chunk.m_begin || (end && !(outpoint.hash < *end)) || (n > 0 && !(prev_outpoint < outpoint))) {
+                LogPrintf("[snapshot] bad snapshot - coin out of order in chunk %u after %d coins\n", index, n);
+                return false;
+            }
+            if (coin.IsSpent() || coin.nHeight > base_height ||
+                outpoint.n >= std::numeric_limits<decltype(outpoint.n)>::max() // Avoid integer wrap-around in coinstats.cpp:ApplyHash
+            ) {
+                LogPrintf("[snapshot] bad snapshot data in chunk %u after %d coins\n", index, n);
+                return false;
+            }
+            hash_writer.Add(outpoint, coin);
+            prev_outpoint = outpoint;
+            run.emplace_back(outpoint, std::move(coin));
+            if (run.size() == SNAPSHOT_WRITE_BATCH_COINS) {
+                if (!coinsdb.WriteCoins(run)) {
+                    LogPrintf("[snapshot] failed to write coins of chunk %u\n", index);
+                    return false;
+                }
+                run.clear();
+            }
+        }
+        if (!coins.empty()) {
+            LogPrintf("[snapshot] bad snapshot - data left over in chunk %u\n", index);
+            return false;
+        }
+        hash_writer.Finish();
+        coins = CDataStream{SER_DISK, CLIENT_VERSION};
+        if (!coinsdb.WriteCoins(run)) {
+            LogPrintf("[snapshot] failed to write coins of chunk %u\n", index);
+            return false;
+        }
+        return true;
+    };
+
+    uint64_t coins_loaded{0};
+    const auto consume_chunk = [&](size_t index) {
+        if (ShutdownRequested()) return false;
+        ss.write(MakeByteSpan(hash_data[index]));
+        hash_data[index] = {};
+        const uint64_t prev_millions{coins_loaded / 1000000};
+        coins_loaded += chunks[index].m_coins_count;
+        if (coins_loaded / 1000000 > prev_millions) {
+            LogPrintf("[snapshot] %d coins loaded (%.2f%%)\n",
+                coins_loaded, static_cast<float>(coins_loaded) * 100 / static_cast<float>(coins_count));
+        }
+        return true;
+    };
+    if (!util::RunOrderedJobs(chunks.size(), threads, SNAPSHOT_CHUNKS_AHEAD_PER_THREAD * threads, "snapshot", load_chunk, consume_chunk)) return false;
+
+    bool out_of_data{false};
+    try {
+        uint8_t byte;
+        coins_file >> byte;
+    } catch (const std::ios_base::failure&) {
+        out_of_data = true;
+    }
+    if (!out_of_data) {
+        LogPrintf("[snapshot] bad snapshot - data left over after the last chunk\n");
+        return false;
+    }
+
+    hash_serialized = ss.GetHash();
+    return true;
+}
+} // namespace node
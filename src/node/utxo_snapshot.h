@@ -9,12 +9,53 @@
 #include <uint256.h>
 #include <serialize.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <ios>
+#include <memory>
+#include <vector>
+
+class CAutoFile;
+class CCoinsViewCursor;
+class CCoinsViewDB;
+
 namespace node {
+//! Maximum number of chunks a UTXO snapshot can be split into
+static constexpr uint32_t MAX_SNAPSHOT_CHUNKS{1 << 16};
+//! Maximum number of threads writing or loading a chunked UTXO snapshot
+static constexpr int MAX_SNAPSHOT_THREADS{16};
+
+/**
+ * A contiguous range of the UTXO set in a chunked snapshot. Chunk i holds the
+ * coins with a txid from its m_begin up to the m_begin of chunk i+1, in key
+ * order, serialized like the coins of an unchunked snapshot.
+ */
+struct SnapshotChunk {
+    //! Lowest txid of the range
+    uint256 m_begin;
+    //! Number of coins in the chunk
+    uint64_t m_coins_count{0};
+    //! Size of the serialized coins in bytes
+    uint64_t m_size{0};
+    //! Double SHA256 of the serialized coins
+    uint256 m_hash;
+
+    SERIALIZE_METHODS(SnapshotChunk, obj) { READWRITE(obj.m_begin, obj.m_coins_count, obj.m_size, obj.m_hash); }
+};
+
 //! Metadata describing a serialized version of a UTXO set from which an
 //! assumeutxo CChainState can be constructed.
 class SnapshotMetadata
 {
 public:
+    /**
+     * Leading marker of chunked snapshots. Unchunked snapshots start with the
+     * base block hash, which is below every proof of work limit and so can
+     * never be all ones.
+     */
+    static constexpr uint8_t CHUNKED_MARKER{0xff};
+
     //! The hash of the block that reflects the tip of the chain for the
     //! UTXO set contained in this snapshot.
     uint256 m_base_blockhash;
@@ -23,6 +64,10 @@ public:
     //! during snapshot load to estimate progress of UTXO set reconstruction.
     uint64_t m_coins_count = 0;
 
+    //! The chunks following the metadata, in key order, or empty for an
+    //! unchunked snapshot in which the coins directly follow the metadata.
+    std::vector<SnapshotChunk> m_chunks;
+
     SnapshotMetadata() { }
     SnapshotMetadata(
         const uint256& base_blockhash,
@@ -31,8 +76,77 @@ public:
             m_base_blockhash(base_blockhash),
             m_coins_count(coins_count) { }
 
-    SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_coins_count); }
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        if (!m_chunks.empty()) {
+            uint256 marker;
+            std::fill(marker.begin(), marker.end(), CHUNKED_MARKER);
+            s << marker;
+        }
+        s << m_base_blockhash << m_coins_count;
+        if (!m_chunks.empty()) s << m_chunks;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> m_base_blockhash;
+        const bool chunked{std::all_of(m_base_blockhash.begin(), m_base_blockhash.end(), [](uint8_t b) { return b == CHUNKED_MARKER; })};
+        if (chunked) s >> m_base_blockhash;
+        s >> m_coins_count;
+        m_chunks.clear();
+        if (chunked) {
+            s >> m_chunks;
+            if (m_chunks.empty()) throw std::ios_base::failure("Chunked snapshot without chunks");
+        }
+    }
 };
+
+//! Lowest txid of chunk `index` when the UTXO set is split into `count`
+//! chunks of about the same size.
+uint256 SnapshotChunkBegin(uint32_t index, uint32_t count);
+
+//! Number of threads used to write and load chunked snapshots.
+int SnapshotThreads();
+
+/**
+ * Write the UTXO set as `chunk_count` chunks following the metadata, one
+ * chunk per thread at a time, in key order. `cursors` must all have been
+ * created at the same database state, and one thread is started per cursor.
+ *
+ * @param[out] metadata        Metadata of the written snapshot, with the
+ *                             base block hash already set.
+ * @param[out] hash_serialized The CoinStatsHashType::HASH_SERIALIZED hash
+ *                             of the written coins.
+ * @param[in] interruption_point Called from the calling thread between chunks.
+ * @return false if a coin could not be read.
+ */
+bool WriteChunkedSnapshot(
+    std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors,
+    CAutoFile& afile,
+    uint32_t chunk_count,
+    SnapshotMetadata& metadata,
+    uint256& hash_serialized,
+    const std::function<void()>& interruption_point);
+
+/**
+ * Load the coins of a chunked snapshot into `coinsdb`, writing every chunk
+ * as a sorted run straight to the database from one of `threads` threads.
+ * Chunk hashes, key ranges and coin heights are checked, with failures
+ * logged and reported by returning false.
+ *
+ * @param[in] coins_file       The snapshot, positioned after the metadata.
+ * @param[out] hash_serialized The CoinStatsHashType::HASH_SERIALIZED hash
+ *                             of the loaded coins.
+ */
+bool LoadChunkedSnapshot(
+    CAutoFile& coins_file,
+    const SnapshotMetadata& metadata,
+    int base_height,
+    CCoinsViewDB& coinsdb,
+    int threads,
+    uint256& hash_serialized);
 } // namespace node
 
 #endif // BITCOIN_NODE_UTXO_SNAPSHOT_H
@@ -44,6 +44,19 @@ struct EncodedDoubleFormatter
     }
 };
 
+/** Serialize a row-major matrix of doubles the same way as a vector of row vectors. */
+void WriteDoubleMatrix(CAutoFile& fileout, const std::vector<double>& matrix, size_t num_rows, size_t num_cols)
+{
+    assert(matrix.size() == num_rows * num_cols);
+    WriteCompactSize(fileout, num_rows);
+    for (size_t row = 0; row < num_rows; ++row) {
+        WriteCompactSize(fileout, num_cols);
+        for (size_t col = 0; col < num_cols; ++col) {
+            fileout << Using<EncodedDoubleFormatter>(matrix[row * num_cols + col]);
+        }
+    }
+}
+
 } // namespace
 
 /**
@@ -60,6 +73,11 @@ private:
     //Define the buckets we will group transactions into
     const std::vector<double>& buckets;              // The upper-bound of the range for the bucket (inclusive)
     const std::map<double, unsigned int>& bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
+    size_t m_num_buckets;                            // Number of buckets, the row length of all matrices below
+
+    // The per-period and per-block statistics are kept in flat row-major
+    // matrices with one row of m_num_buckets entries per period (or block),
+    // so decaying and scanning them are simple loops over contiguous memory.
 
     // For each bucket X:
     // Count the total # of txs in each bucket
@@ -68,11 +86,11 @@ private:
 
     // Count the total # of txs confirmed within Y blocks in each bucket
     // Track the historical moving average of these totals over blocks
-    std::vector<std::vector<double>> confAvg; // confAvg[Y][X]
+    std::vector<double> confAvg; // confAvg[Y * m_num_buckets + X]
 
     // Track moving avg of txs which have been evicted from the mempool
     // after failing to be confirmed within Y blocks
-    std::vector<std::vector<double>> failAvg; // failAvg[Y][X]
+    std::vector<double> failAvg; // failAvg[Y * m_num_buckets + X]
 
     // Sum the total feerate of all tx's in each bucket
     // Track the historical moving average of this total over blocks
@@ -86,10 +104,13 @@ private:
     // Resolution (# of blocks) with which confirmations are tracked
     unsigned int scale;
 
+    // Number of periods tracked, the number of rows of confAvg and failAvg
+    size_t m_num_periods;
+
     // Mempool counts of outstanding transactions
     // For each bucket X, track the number of transactions in the mempool
     // that are unconfirmed for each possible confirmation value Y
-    std::vector<std::vector<int> > unconfTxs;  //unconfTxs[Y][X]
+    std::vector<int> unconfTxs;  // unconfTxs[Y * m_num_buckets + X]
     // transactions still unconfirmed after GetMaxConfirms for each bucket
     std::vector<int> oldUnconfTxs;
 
@@ -142,7 +163,7 @@ public:
                              EstimationResult *result = nullptr) const;
 
     /** Return the max number of confirms we're tracking */
-    unsigned int GetMaxConfirms() const { return scale * confAvg.size(); }
+    unsigned int GetMaxConfirms() const { return scale * m_num_periods; }
 
     /** Write state of estimation data to a file*/
     void Write(CAutoFile& fileout) const;
@@ -158,37 +179,31 @@ public:
 TxConfirmStats::TxConfirmStats(const std::vector<double>& defaultBuckets,
                                 const std::map<double, unsigned int>& defaultBucketMap,
                                unsigned int maxPeriods, double _decay, unsigned int _scale)
-    : buckets(defaultBuckets), bucketMap(defaultBucketMap), decay(_decay), scale(_scale)
+    : buckets(defaultBuckets), bucketMap(defaultBucketMap), m_num_buckets(defaultBuckets.size()), decay(_decay), scale(_scale), m_num_periods(maxPeriods)
 {
     assert(_scale != 0 && "_scale must be non-zero");
-    confAvg.resize(maxPeriods);
-    failAvg.resize(maxPeriods);
-    for (unsigned int i = 0; i < maxPeriods; i++) {
-        confAvg[i].resize(buckets.size());
-        failAvg[i].resize(buckets.size());
-    }
+    confAvg.assign(m_num_periods * m_num_buckets, 0);
+    failAvg.assign(m_num_periods * m_num_buckets, 0);
 
-    txCtAvg.resize(buckets.size());
-    m_feerate_avg.resize(buckets.size());
+    txCtAvg.resize(m_num_buckets);
+    m_feerate_avg.resize(m_num_buckets);
 
-    resizeInMemoryCounters(buckets.size());
+    resizeInMemoryCounters(m_num_buckets);
 }
 
 void TxConfirmStats::resizeInMemoryCounters(size_t newbuckets) {
     // newbuckets must be passed in because the buckets referred to during Read have not been updated yet.
-    unconfTxs.resize(GetMaxConfirms());
-    for (unsigned int i = 0; i < unconfTxs.size(); i++) {
-        unconfTxs[i].resize(newbuckets);
-    }
+    unconfTxs.assign(GetMaxConfirms() * newbuckets, 0);
     oldUnconfTxs.resize(newbuckets);
 }
 
 // Roll the unconfirmed txs circular buffer
 void TxConfirmStats::ClearCurrent(unsigned int nBlockHeight)
 {
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        oldUnconfTxs[j] += unconfTxs[nBlockHeight % unconfTxs.size()][j];
-        unconfTxs[nBlockHeight%unconfTxs.size()][j] = 0;
+    int* const current = &unconfTxs[(nBlockHeight % GetMaxConfirms()) * m_num_buckets];
+    for (size_t j = 0; j < m_num_buckets; j++) {
+        oldUnconfTxs[j] += current[j];
+        current[j] = 0;
     }
 }
 
@@ -200,8 +215,8 @@ void TxConfirmStats::Record(int blocksToConfirm, double feerate)
         return;
     int periodsToConfirm = (blocksToConfirm + scale - 1) / scale;
     unsigned int bucketindex = bucketMap.lower_bound(feerate)->second;
-    for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+    for (size_t i = periodsToConfirm; i <= m_num_periods; i++) {
+        confAvg[(i - 1) * m_num_buckets + bucketindex]++;
     }
     txCtAvg[bucketindex]++;
     m_feerate_avg[bucketindex] += feerate;
@@ -210,14 +225,10 @@ void TxConfirmStats::Record(int blocksToConfirm, double feerate)
 void TxConfirmStats::UpdateMovingAverages()
 {
     assert(confAvg.size() == failAvg.size());
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++) {
-            confAvg[i][j] *= decay;
-            failAvg[i][j] *= decay;
-        }
-        m_feerate_avg[j] *= decay;
-        txCtAvg[j] *= decay;
-    }
+    for (double& avg : confAvg) avg *= decay;
+    for (double& avg : failAvg) avg *= decay;
+    for (double& avg : m_feerate_avg) avg *= decay;
+    for (double& avg : txCtAvg) avg *= decay;
 }
 
 // returns -1 on error conditions
@@ -231,7 +242,20 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     int extraNum = 0;  // Number of tx's still in mempool for confTarget or longer
     double failNum = 0; // Number of tx's that were never confirmed but removed from the mempool after confTarget
     const int periodTarget = (confTarget + scale - 1) / scale;
-    const int maxbucketindex = buckets.size() - 1;
+    const int maxbucketindex = m_num_buckets - 1;
+    const double* const conf_row = &confAvg[(periodTarget - 1) * m_num_buckets];
+    const double* const fail_row = &failAvg[(periodTarget - 1) * m_num_buckets];
+
+    // Number of tx's still in mempool for confTarget or longer, per bucket.
+    // Summed one block row at a time, rather than one bucket at a time.
+    std::vector<int> extra(oldUnconfTxs);
+    const unsigned int bins = GetMaxConfirms();
+    for (unsigned int confct = confTarget; confct < bins; confct++) {
+        const int* const row = &unconfTxs[((nBlockHeight - confct) % bins) * m_num_buckets];
+        for (size_t j = 0; j < m_num_buckets; j++) {
+            extra[j] += row[j];
+        }
+    }
 
     // We'll combine buckets until we have enough samples.
     // The near and far variables will define the range we've combined
@@ -244,7 +268,6 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     unsigned int bestFarBucket = maxbucketindex;
 
     bool foundAnswer = false;
-    unsigned int bins = unconfTxs.size();
     bool newBucketRange = true;
     bool passing = true;
     EstimatorBucket passBucket;
@@ -257,12 +280,10 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
+        nConf += conf_row[bucket];
         totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
-        for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
-            extraNum += unconfTxs[(nBlockHeight - confct) % bins][bucket];
-        extraNum += oldUnconfTxs[bucket];
+        failNum += fail_row[bucket];
+        extraNum += extra[bucket];
         // If we have enough transaction data points in this range of buckets,
         // we can test for success
         // (Only count the confirmed data points, so that each confirmation count
@@ -380,8 +401,8 @@ void TxConfirmStats::Write(CAutoFile& fileout) const
     fileout << scale;
     fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(m_feerate_avg);
     fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(txCtAvg);
-    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(confAvg);
-    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(failAvg);
+    WriteDoubleMatrix(fileout, confAvg, m_num_periods, m_num_buckets);
+    WriteDoubleMatrix(fileout, failAvg, m_num_periods, m_num_buckets);
 }
 
 void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets)
@@ -409,29 +430,40 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
     if (txCtAvg.size() != numBuckets) {
         throw std::runtime_error("Corrupt estimates file. Mismatch in tx count bucket count");
     }
-    filein >> Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(confAvg);
-    maxPeriods = confAvg.size();
+    std::vector<std::vector<double>> file_conf_avg;
+    filein >> Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(file_conf_avg);
+    maxPeriods = file_conf_avg.size();
     maxConfirms = scale * maxPeriods;
 
     if (maxConfirms <= 0 || maxConfirms > 6 * 24 * 7) { // one week
         throw std::runtime_error("Corrupt estimates file.  Must maintain estimates for between 1 and 1008 (one week) confirms");
     }
     for (unsigned int i = 0; i < maxPeriods; i++) {
-        if (confAvg[i].size() != numBuckets) {
+        if (file_conf_avg[i].size() != numBuckets) {
             throw std::runtime_error("Corrupt estimates file. Mismatch in feerate conf average bucket count");
         }
     }
 
-    filein >> Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(failAvg);
-    if (maxPeriods != failAvg.size()) {
+    std::vector<std::vector<double>> file_fail_avg;
+    filein >> Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(file_fail_avg);
+    if (maxPeriods != file_fail_avg.size()) {
         throw std::runtime_error("Corrupt estimates file. Mismatch in confirms tracked for failures");
     }
     for (unsigned int i = 0; i < maxPeriods; i++) {
-        if (failAvg[i].size() != numBuckets) {
+        if (file_fail_avg[i].size() != numBuckets) {
             throw std::runtime_error("Corrupt estimates file. Mismatch in one of failure average bucket counts");
         }
     }
 
+    m_num_buckets = numBuckets;
+    m_num_periods = maxPeriods;
+    confAvg.clear();
+    failAvg.clear();
+    for (unsigned int i = 0; i < maxPeriods; i++) {
+        confAvg.insert(confAvg.end(), file_conf_avg[i].begin(), file_conf_avg[i].end());
+        failAvg.insert(failAvg.end(), file_fail_avg[i].begin(), file_fail_avg[i].end());
+    }
+
     // Resize the current block variables which aren't stored in the data file
     // to match the number of confirms and buckets
     resizeInMemoryCounters(numBuckets);
@@ -443,8 +475,8 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
 unsigned int TxConfirmStats::NewTx(unsigned int nBlockHeight, double val)
 {
     unsigned int bucketindex = bucketMap.lower_bound(val)->second;
-    unsigned int blockIndex = nBlockHeight % unconfTxs.size();
-    unconfTxs[blockIndex][bucketindex]++;
+    unsigned int blockIndex = nBlockHeight % GetMaxConfirms();
+    unconfTxs[blockIndex * m_num_buckets + bucketindex]++;
     return bucketindex;
 }
 
@@ -459,7 +491,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         return;  //This can't happen because we call this with our best seen height, no entries can have higher
     }
 
-    if (blocksAgo >= (int)unconfTxs.size()) {
+    if (blocksAgo >= (int)GetMaxConfirms()) {
         if (oldUnconfTxs[bucketindex] > 0) {
             oldUnconfTxs[bucketindex]--;
         } else {
@@ -468,9 +500,9 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         }
     }
     else {
-        unsigned int blockIndex = entryHeight % unconfTxs.size();
-        if (unconfTxs[blockIndex][bucketindex] > 0) {
-            unconfTxs[blockIndex][bucketindex]--;
+        unsigned int blockIndex = entryHeight % GetMaxConfirms();
+        if (unconfTxs[blockIndex * m_num_buckets + bucketindex] > 0) {
+            unconfTxs[blockIndex * m_num_buckets + bucketindex]--;
         } else {
             LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy error, mempool tx removed from blockIndex=%u,bucketIndex=%u already\n",
                      blockIndex, bucketindex);
@@ -479,8 +511,8 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
     if (!inBlock && (unsigned int)blocksAgo >= scale) { // Only counts as a failure if not confirmed for entire period
         assert(scale != 0);
         unsigned int periodsAgo = blocksAgo / scale;
-        for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
+        for (size_t i = 0; i < periodsAgo && i < m_num_periods; i++) {
+            failAvg[i * m_num_buckets + bucketindex]++;
         }
     }
 }
@@ -501,6 +533,7 @@ bool CBlockPolicyEstimator::_removeTx(const uint256& hash, bool inBlock)
     AssertLockHeld(m_cs_fee_estimator);
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
+        ClearSmartFeeCache();
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
@@ -560,6 +593,12 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
         return;
     }
 
+    // Estimates only count transactions that have been unconfirmed for at
+    // least one block, so a new transaction leaves cached estimates valid.
+    // The exception is a chain shorter than the longest tracked target, where
+    // the block index into the unconfirmed counters wraps around.
+    if (nBestSeenHeight < longStats->GetMaxConfirms()) ClearSmartFeeCache();
+
     // Only want to be updating estimates when our blockchain is synced,
     // otherwise we'll miscalculate how many blocks its taking to get included.
     if (!validFeeEstimate) {
@@ -625,6 +664,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     // calls to removeTx (via processBlockTx) correctly calculate age
     // of unconfirmed txs to remove from tracking.
     nBestSeenHeight = nBlockHeight;
+    ClearSmartFeeCache();
 
     // Update unconfirmed circular buffer
     feeStats->ClearCurrent(nBlockHeight);
@@ -819,14 +859,37 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
         feeCalc->returnedTarget = confTarget;
     }
 
-    double median = -1;
-    EstimationResult tempResult;
-
     // Return failure if trying to analyze a target we're not tracking
     if (confTarget <= 0 || (unsigned int)confTarget > longStats->GetMaxConfirms()) {
         return CFeeRate(0);  // error condition
     }
 
+    std::vector<std::optional<CachedSmartFee>>& cache = m_smart_fee_cache[conservative];
+    if (cache.empty()) cache.resize(longStats->GetMaxConfirms() + 1);
+    std::optional<CachedSmartFee>& cached = cache[confTarget];
+    if (!cached) {
+        FeeCalculation calc;
+        calc.desiredTarget = confTarget;
+        calc.returnedTarget = confTarget;
+        const CFeeRate feerate = CalculateSmartFee(confTarget, calc, conservative);
+        cached = CachedSmartFee{feerate, calc};
+    }
+    if (feeCalc) *feeCalc = cached->calc;
+    return cached->feerate;
+}
+
+void CBlockPolicyEstimator::ClearSmartFeeCache()
+{
+    AssertLockHeld(m_cs_fee_estimator);
+    for (auto& cache : m_smart_fee_cache) cache.clear();
+}
+
+CFeeRate CBlockPolicyEstimator::CalculateSmartFee(int confTarget, FeeCalculation& feeCalc, bool conservative) const
+{
+    AssertLockHeld(m_cs_fee_estimator);
+    double median = -1;
+    EstimationResult tempResult;
+
     // It's not possible to get reasonable estimates for confTarget of 1
     if (confTarget == 1) confTarget = 2;
 
@@ -834,7 +897,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     if ((unsigned int)confTarget > maxUsableEstimate) {
         confTarget = maxUsableEstimate;
     }
-    if (feeCalc) feeCalc->returnedTarget = confTarget;
+    feeCalc.returnedTarget = confTarget;
 
     if (confTarget <= 1) return CFeeRate(0); // error condition
 
@@ -850,36 +913,28 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
      * fluctuations lower our estimates by too much.
      */
     double halfEst = estimateCombinedFee(confTarget/2, HALF_SUCCESS_PCT, true, &tempResult);
-    if (feeCalc) {
-        feeCalc->est = tempResult;
-        feeCalc->reason = FeeReason::HALF_ESTIMATE;
-    }
+    feeCalc.est = tempResult;
+    feeCalc.reason = FeeReason::HALF_ESTIMATE;
     median = halfEst;
     double actualEst = estimateCombinedFee(confTarget, SUCCESS_PCT, true, &tempResult);
     if (actualEst > median) {
         median = actualEst;
-        if (feeCalc) {
-            feeCalc->est = tempResult;
-            feeCalc->reason = FeeReason::FULL_ESTIMATE;
-        }
+        feeCalc.est = tempResult;
+        feeCalc.reason = FeeReason::FULL_ESTIMATE;
     }
     double doubleEst = estimateCombinedFee(2 * confTarget, DOUBLE_SUCCESS_PCT, !conservative, &tempResult);
     if (doubleEst > median) {
         median = doubleEst;
-        if (feeCalc) {
-            feeCalc->est = tempResult;
-            feeCalc->reason = FeeReason::DOUBLE_ESTIMATE;
-        }
+        feeCalc.est = tempResult;
+        feeCalc.reason = FeeReason::DOUBLE_ESTIMATE;
     }
 
     if (conservative || median == -1) {
         double consEst =  estimateConservativeFee(2 * confTarget, &tempResult);
         if (consEst > median) {
             median = consEst;
-            if (feeCalc) {
-                feeCalc->est = tempResult;
-                feeCalc->reason = FeeReason::CONSERVATIVE;
-            }
+            feeCalc.est = tempResult;
+            feeCalc.reason = FeeReason::CONSERVATIVE;
         }
     }
 
@@ -976,6 +1031,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            ClearSmartFeeCache();
         }
     }
     catch (const std::exception& e) {
@@ -14,6 +14,7 @@
 #include <array>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -266,6 +267,24 @@ private:
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
 
+    struct CachedSmartFee
+    {
+        CFeeRate feerate;
+        FeeCalculation calc;
+    };
+
+    /** Results of estimateSmartFee by requested target, for economical [0]
+     *  and conservative [1] estimates. The statistics only change when a block
+     *  is processed or a tracked transaction is removed, so between those
+     *  events repeated estimates are a table lookup. */
+    mutable std::array<std::vector<std::optional<CachedSmartFee>>, 2> m_smart_fee_cache GUARDED_BY(m_cs_fee_estimator);
+
+    /** Drop all cached estimateSmartFee results */
+    void ClearSmartFeeCache() EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+
+    /** Helper for estimateSmartFee, computing an estimate that is not cached */
+    CFeeRate CalculateSmartFee(int confTarget, FeeCalculation& feeCalc, bool conservative) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
@@ -10,8 +10,10 @@
 #include <chainparams.h>
 #include <core_io.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/txindex.h>
+#include <key_io.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <primitives/block.h>
@@ -637,6 +639,115 @@ static bool rest_mempool_contents(const std::any& context, HTTPRequest* req, con
     }
 }
 
+static bool rest_mempool_feehistogram(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req)) return false;
+    const CTxMemPool* mempool = GetMemPool(context, req);
+    if (!mempool) return false;
+    std::string param;
+    const RESTResponseFormat rf = ParseDataFormat(param, strURIPart);
+
+    switch (rf) {
+    case RESTResponseFormat::JSON: {
+        UniValue histogramObject = MempoolFeeHistogramToJSON(*mempool);
+
+        std::string strJSON = histogramObject.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
+static bool rest_address(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req)) return false;
+    std::string param;
+    const RESTResponseFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path = SplitString(param, '/');
+
+    if (path.size() != 2) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/address/<history|utxos|balance>/<address>.json");
+    }
+    const std::string& query = path[0];
+    if (query != "history" && query != "utxos" && query != "balance") {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Unknown address query: " + query);
+    }
+
+    const CTxDestination dest = DecodeDestination(path[1]);
+    if (!IsValidDestination(dest)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + path[1]);
+    }
+    const CScript script = GetScriptForDestination(dest);
+
+    const std::string raw_count = req->GetQueryParameter("count").value_or("100");
+    const auto parsed_count{ToIntegral<size_t>(raw_count)};
+    if (!parsed_count.has_value() || *parsed_count < 1 || *parsed_count > MAX_ADDRESS_INDEX_RESULTS) {
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Count is invalid or out of acceptable range (1-%u): %s", MAX_ADDRESS_INDEX_RESULTS, raw_count));
+    }
+    const size_t count = *parsed_count;
+
+    const std::string raw_skip = req->GetQueryParameter("skip").value_or("0");
+    const auto parsed_skip{ToIntegral<size_t>(raw_skip)};
+    if (!parsed_skip.has_value()) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid skip: " + raw_skip);
+    }
+    const size_t skip = *parsed_skip;
+
+    const std::string raw_start_height = req->GetQueryParameter("start_height").value_or("0");
+    const auto parsed_start_height{ToIntegral<int>(raw_start_height)};
+    if (!parsed_start_height.has_value()) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start_height: " + raw_start_height);
+    }
+    const int start_height = *parsed_start_height;
+
+    if (!g_address_index) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Address index is not enabled (use -addressindex)");
+    }
+    if (!g_address_index->BlockUntilSyncedToCurrentChain()) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Address index is still syncing");
+    }
+
+    UniValue result;
+    if (query == "history") {
+        std::vector<AddressHistoryEntry> entries;
+        if (!g_address_index->FindHistory(script, start_height, skip, count, entries)) {
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Unable to read address history");
+        }
+        result = AddressHistoryToJSON(entries);
+    } else if (query == "utxos") {
+        std::vector<AddressUtxo> utxos;
+        if (!g_address_index->FindUtxos(script, skip, count, utxos)) {
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Unable to read address utxos");
+        }
+        result = AddressUtxosToJSON(utxos);
+    } else {
+        CAmount balance;
+        uint64_t utxo_count;
+        if (!g_address_index->GetBalance(script, balance, utxo_count)) {
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Unable to read address balance");
+        }
+        result = UniValue(UniValue::VOBJ);
+        result.pushKV("balance", ValueFromAmount(balance));
+        result.pushKV("utxos", utxo_count);
+    }
+
+    switch (rf) {
+    case RESTResponseFormat::JSON: {
+        std::string strJSON = result.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
 static bool rest_tx(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -948,9 +1059,11 @@ static const struct {
       {"/rest/chaininfo", rest_chaininfo},
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
+      {"/rest/mempool/feehistogram", rest_mempool_feehistogram},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/address/", rest_address},
 };
 
 void StartREST(const std::any& context)
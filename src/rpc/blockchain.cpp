@@ -17,8 +17,12 @@
 #include <deploymentstatus.h>
 #include <fs.h>
 #include <hash.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <index/spentindex.h>
+#include <index/txindex.h>
+#include <key_io.h>
 #include <logging/timer.h>
 #include <net.h>
 #include <net_processing.h>
@@ -55,10 +59,13 @@ using node::BlockManager;
 using node::CCoinsStats;
 using node::CoinStatsHashType;
 using node::GetUTXOStats;
+using node::MAX_SNAPSHOT_CHUNKS;
 using node::NodeContext;
 using node::ReadBlockFromDisk;
 using node::SnapshotMetadata;
+using node::SnapshotThreads;
 using node::UndoReadFromDisk;
+using node::WriteChunkedSnapshot;
 
 struct CUpdatedBlock
 {
@@ -795,6 +802,118 @@ static RPCHelpMan pruneblockchain()
     };
 }
 
+static RPCHelpMan repackblockfiles()
+{
+    return RPCHelpMan{"repackblockfiles",
+                "\nCopy the blocks of the active chain, and any blocks received beyond its tip, to new block files in height order, and delete\n"
+                "the old files. The data of stale blocks is dropped. This compacts the files left behind by out of order\n"
+                "download and stale blocks, and stores the copies compressed or not as set by -blockcompression, which converts existing\n"
+                "block files. Requires free disk space for the copies, and is not available with -txindex, whose entries point into the\n"
+                "block files, or while an index is syncing. A transaction index left from an earlier run with -txindex is removed.\n"
+                "Without pruning, stale blocks are forgotten, as if only their headers had been received. Validation continues while\n"
+                "the blocks are copied.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "files_before", "number of block files before the repack"},
+                        {RPCResult::Type::NUM, "files_after", "number of block files after the repack"},
+                        {RPCResult::Type::NUM, "blocks", "number of blocks copied"},
+                        {RPCResult::Type::NUM, "dropped", "number of stale blocks whose data was dropped"},
+                        {RPCResult::Type::NUM, "bytes_before", "size of the block and undo files before the repack"},
+                        {RPCResult::Type::NUM, "bytes_after", "size of the block and undo files after the repack"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("repackblockfiles", "")
+            + HelpExampleRpc("repackblockfiles", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    if (g_txindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Cannot repack block files with -txindex enabled.");
+    }
+    if (node::fImporting || node::fReindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Cannot repack block files while importing or reindexing.");
+    }
+
+    // Indexes that are still syncing read the blocks they have not indexed
+    // yet from the files being replaced, by positions they looked up earlier.
+    bool indexes_synced{(!g_coin_stats_index || g_coin_stats_index->GetSummary().synced) &&
+                        (!g_address_index || g_address_index->GetSummary().synced) &&
+                        (!g_spent_index || g_spent_index->GetSummary().synced)};
+    ForEachBlockFilterIndex([&indexes_synced](const BlockFilterIndex& index) {
+        indexes_synced = indexes_synced && index.GetSummary().synced;
+    });
+    if (!indexes_synced) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Cannot repack block files while an index is syncing.");
+    }
+
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    CChainState* active_chainstate;
+    {
+        LOCK(cs_main);
+        if (chainman.IsSnapshotActive()) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Cannot repack block files while a UTXO snapshot is in use.");
+        }
+        active_chainstate = &chainman.ActiveChainstate();
+        if (active_chainstate->IsInitialBlockDownload()) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Cannot repack block files during initial block download.");
+        }
+        active_chainstate->ForceFlushStateToDisk();
+    }
+
+    // The active chain, then the blocks towards the best header that are
+    // stored but not connected yet.
+    const auto blocks_to_keep{[&]() EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+        AssertLockHeld(::cs_main);
+        const CChain& active_chain = active_chainstate->m_chain;
+        std::vector<CBlockIndex*> keep;
+        keep.reserve(active_chain.Height() + 1);
+        for (CBlockIndex* pindex = active_chain.Genesis(); pindex; pindex = active_chain.Next(pindex)) {
+            if (pindex->nStatus & BLOCK_HAVE_DATA) keep.push_back(pindex);
+        }
+        const CBlockIndex* tip{CHECK_NONFATAL(active_chain.Tip())};
+        if (chainman.m_best_header && chainman.m_best_header->GetAncestor(tip->nHeight) == tip) {
+            for (int height = tip->nHeight + 1; height <= chainman.m_best_header->nHeight; ++height) {
+                CBlockIndex* pindex = chainman.m_best_header->GetAncestor(height);
+                if (pindex->nStatus & BLOCK_HAVE_DATA) keep.push_back(pindex);
+            }
+        }
+        return keep;
+    }};
+
+    node::BlockRepackStats stats;
+    if (!active_chainstate->m_blockman.RepackBlockFiles(blocks_to_keep, Params(), stats)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Failed to repack block files, see debug log for details.");
+    }
+    // A transaction index kept from an earlier run with -txindex points into
+    // the deleted files, so it is removed, to be rebuilt when enabled again.
+    const fs::path txindex_path{gArgs.GetDataDirNet() / "indexes" / "txindex"};
+    if (fs::exists(txindex_path)) {
+        LogPrintf("Removing the transaction index, whose block file positions are stale after repacking\n");
+        fs::remove_all(txindex_path);
+    }
+    // Stale blocks may have been forgotten, which makes them no candidates for the tip any more.
+    LOCK(cs_main);
+    for (CChainState* chainstate : chainman.GetAll()) {
+        auto& candidates = chainstate->setBlockIndexCandidates;
+        for (auto it = candidates.begin(); it != candidates.end();) {
+            it = (*it)->HaveTxsDownloaded() ? std::next(it) : candidates.erase(it);
+        }
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("files_before", stats.files_before);
+    ret.pushKV("files_after", stats.files_after);
+    ret.pushKV("blocks", stats.blocks);
+    ret.pushKV("dropped", stats.dropped);
+    ret.pushKV("bytes_before", stats.bytes_before);
+    ret.pushKV("bytes_after", stats.bytes_after);
+    return ret;
+},
+    };
+}
+
 CoinStatsHashType ParseHashType(const std::string& hash_type_input)
 {
     if (hash_type_input == "hash_serialized_2") {
@@ -2158,6 +2277,201 @@ static RPCHelpMan scantxoutset()
     };
 }
 
+UniValue AddressHistoryToJSON(const std::vector<AddressHistoryEntry>& entries)
+{
+    UniValue result(UniValue::VARR);
+    for (const AddressHistoryEntry& entry : entries) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", entry.txid.GetHex());
+        obj.pushKV("height", entry.height);
+        obj.pushKV("position", (uint64_t)entry.tx_pos);
+        obj.pushKV("type", entry.spend ? "spend" : "receive");
+        obj.pushKV(entry.spend ? "vin" : "vout", (uint64_t)entry.n);
+        obj.pushKV("amount", ValueFromAmount(entry.amount));
+        result.push_back(obj);
+    }
+    return result;
+}
+
+UniValue AddressUtxosToJSON(const std::vector<AddressUtxo>& utxos)
+{
+    UniValue result(UniValue::VARR);
+    for (const AddressUtxo& utxo : utxos) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", utxo.outpoint.hash.GetHex());
+        obj.pushKV("vout", (uint64_t)utxo.outpoint.n);
+        obj.pushKV("height", utxo.height);
+        obj.pushKV("amount", ValueFromAmount(utxo.amount));
+        obj.pushKV("coinbase", utxo.coinbase);
+        result.push_back(obj);
+    }
+    return result;
+}
+
+static CScript AddressScriptFromParam(const UniValue& param)
+{
+    std::string error_msg;
+    const CTxDestination dest = DecodeDestination(param.get_str(), error_msg);
+    if (!IsValidDestination(dest)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + error_msg);
+    }
+    return GetScriptForDestination(dest);
+}
+
+static AddressIndex& EnsureSyncedAddressIndex()
+{
+    if (!g_address_index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Querying addresses requires -addressindex to be enabled.");
+    }
+    if (!g_address_index->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to query address, address index is still syncing.");
+    }
+    return *g_address_index;
+}
+
+static size_t ParseAddressCount(const UniValue& param)
+{
+    const int count{param.isNull() ? 100 : param.get_int()};
+    if (count < 1 || count > (int)MAX_ADDRESS_INDEX_RESULTS) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be between 1 and %u", MAX_ADDRESS_INDEX_RESULTS));
+    }
+    return count;
+}
+
+static size_t ParseAddressSkip(const UniValue& param)
+{
+    const int skip{param.isNull() ? 0 : param.get_int()};
+    if (skip < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "skip must not be negative");
+    }
+    return skip;
+}
+
+static RPCHelpMan getaddresshistory()
+{
+    return RPCHelpMan{"getaddresshistory",
+                "\nReturns the confirmed outputs paying to an address and the inputs spending them, in chain order.\n"
+                "Requires -addressindex. Use start_height, skip and count to page through long histories.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                    {"start_height", RPCArg::Type::NUM, RPCArg::Default{0}, "Skip blocks below this height"},
+                    {"count", RPCArg::Type::NUM, RPCArg::Default{100}, strprintf("The number of entries to return (1-%u)", MAX_ADDRESS_INDEX_RESULTS)},
+                    {"skip", RPCArg::Type::NUM, RPCArg::Default{0}, "The number of entries to skip, counting from start_height"},
+                },
+                RPCResult{
+                    RPCResult::Type::ARR, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR_HEX, "txid", "The transaction id"},
+                            {RPCResult::Type::NUM, "height", "The height of the block containing the transaction"},
+                            {RPCResult::Type::NUM, "position", "The position of the transaction in the block"},
+                            {RPCResult::Type::STR, "type", "\"receive\" for an output paying to the address, \"spend\" for an input spending from it"},
+                            {RPCResult::Type::NUM, "vout", /*optional=*/true, "The output index, for a receive"},
+                            {RPCResult::Type::NUM, "vin", /*optional=*/true, "The input index, for a spend"},
+                            {RPCResult::Type::STR_AMOUNT, "amount", "The value of the output received or spent in " + CURRENCY_UNIT},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getaddresshistory", "\"" + EXAMPLE_ADDRESS[0] + "\"") +
+                    HelpExampleCli("getaddresshistory", "\"" + EXAMPLE_ADDRESS[0] + "\" 700000 100 0") +
+                    HelpExampleRpc("getaddresshistory", "\"" + EXAMPLE_ADDRESS[0] + "\", 700000, 100, 0")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const CScript script{AddressScriptFromParam(request.params[0])};
+    const int start_height{request.params[1].isNull() ? 0 : request.params[1].get_int()};
+    const size_t count{ParseAddressCount(request.params[2])};
+    const size_t skip{ParseAddressSkip(request.params[3])};
+
+    const AddressIndex& index{EnsureSyncedAddressIndex()};
+    std::vector<AddressHistoryEntry> entries;
+    if (!index.FindHistory(script, start_height, skip, count, entries)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read address history");
+    }
+    return AddressHistoryToJSON(entries);
+},
+    };
+}
+
+static RPCHelpMan getaddressutxos()
+{
+    return RPCHelpMan{"getaddressutxos",
+                "\nReturns the confirmed unspent outputs paying to an address, in chain order.\n"
+                "Requires -addressindex. Use skip and count to page through the outputs.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                    {"count", RPCArg::Type::NUM, RPCArg::Default{100}, strprintf("The number of outputs to return (1-%u)", MAX_ADDRESS_INDEX_RESULTS)},
+                    {"skip", RPCArg::Type::NUM, RPCArg::Default{0}, "The number of outputs to skip"},
+                },
+                RPCResult{
+                    RPCResult::Type::ARR, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR_HEX, "txid", "The transaction id"},
+                            {RPCResult::Type::NUM, "vout", "The output index"},
+                            {RPCResult::Type::NUM, "height", "The height of the block containing the transaction"},
+                            {RPCResult::Type::STR_AMOUNT, "amount", "The value of the output in " + CURRENCY_UNIT},
+                            {RPCResult::Type::BOOL, "coinbase", "Whether the output was created by a coinbase transaction"},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getaddressutxos", "\"" + EXAMPLE_ADDRESS[0] + "\"") +
+                    HelpExampleRpc("getaddressutxos", "\"" + EXAMPLE_ADDRESS[0] + "\", 100, 0")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const CScript script{AddressScriptFromParam(request.params[0])};
+    const size_t count{ParseAddressCount(request.params[1])};
+    const size_t skip{ParseAddressSkip(request.params[2])};
+
+    const AddressIndex& index{EnsureSyncedAddressIndex()};
+    std::vector<AddressUtxo> utxos;
+    if (!index.FindUtxos(script, skip, count, utxos)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read address utxos");
+    }
+    return AddressUtxosToJSON(utxos);
+},
+    };
+}
+
+static RPCHelpMan getaddressbalance()
+{
+    return RPCHelpMan{"getaddressbalance",
+                "\nReturns the total value of the confirmed unspent outputs paying to an address.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::STR_AMOUNT, "balance", "The total value of the unspent outputs in " + CURRENCY_UNIT},
+                        {RPCResult::Type::NUM, "utxos", "The number of unspent outputs"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getaddressbalance", "\"" + EXAMPLE_ADDRESS[0] + "\"") +
+                    HelpExampleRpc("getaddressbalance", "\"" + EXAMPLE_ADDRESS[0] + "\"")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const CScript script{AddressScriptFromParam(request.params[0])};
+
+    const AddressIndex& index{EnsureSyncedAddressIndex()};
+    CAmount balance;
+    uint64_t utxo_count;
+    if (!index.GetBalance(script, balance, utxo_count)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read address balance");
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("balance", ValueFromAmount(balance));
+    ret.pushKV("utxos", utxo_count);
+    return ret;
+},
+    };
+}
+
 static RPCHelpMan getblockfilter()
 {
     return RPCHelpMan{"getblockfilter",
@@ -2249,6 +2563,7 @@ static RPCHelpMan dumptxoutset()
         "Write the serialized UTXO set to disk.",
         {
             {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
+            {"chunks", RPCArg::Type::NUM, RPCArg::Default{0}, strprintf("Split the UTXO set into this many chunks with their own hashes, written and loaded in parallel (0 to %u, 0 = unchunked)", MAX_SNAPSHOT_CHUNKS)},
         },
         RPCResult{
             RPCResult::Type::OBJ, "", "",
@@ -2259,10 +2574,12 @@ static RPCHelpMan dumptxoutset()
                     {RPCResult::Type::STR, "path", "the absolute path that the snapshot was written to"},
                     {RPCResult::Type::STR_HEX, "txoutset_hash", "the hash of the UTXO set contents"},
                     {RPCResult::Type::NUM, "nchaintx", "the number of transactions in the chain up to and including the base block"},
+                    {RPCResult::Type::NUM, "chunks", "the number of chunks the snapshot is split into, 0 if unchunked"},
                 }
         },
         RPCExamples{
             HelpExampleCli("dumptxoutset", "utxo.dat")
+            + HelpExampleCli("dumptxoutset", "utxo.dat 256")
         },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
@@ -2279,11 +2596,16 @@ static RPCHelpMan dumptxoutset()
             "move it out of the way first");
     }
 
+    const int64_t chunks{request.params[1].isNull() ? 0 : request.params[1].get_int64()};
+    if (chunks < 0 || chunks > MAX_SNAPSHOT_CHUNKS) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("chunks must be between 0 and %u", MAX_SNAPSHOT_CHUNKS));
+    }
+
     FILE* file{fsbridge::fopen(temppath, "wb")};
     CAutoFile afile{file, SER_DISK, CLIENT_VERSION};
     NodeContext& node = EnsureAnyNodeContext(request.context);
     UniValue result = CreateUTXOSnapshot(
-        node, node.chainman->ActiveChainstate(), afile, path, temppath);
+        node, node.chainman->ActiveChainstate(), afile, path, temppath, chunks);
     fs::rename(temppath, path);
 
     result.pushKV("path", path.u8string());
@@ -2297,9 +2619,11 @@ UniValue CreateUTXOSnapshot(
     CChainState& chainstate,
     CAutoFile& afile,
     const fs::path& path,
-    const fs::path& temppath)
+    const fs::path& temppath,
+    uint32_t chunks)
 {
     std::unique_ptr<CCoinsViewCursor> pcursor;
+    std::vector<std::unique_ptr<CCoinsViewCursor>> chunk_cursors;
     CCoinsStats stats{CoinStatsHashType::HASH_SERIALIZED};
     const CBlockIndex* tip;
 
@@ -2316,16 +2640,27 @@ UniValue CreateUTXOSnapshot(
         // See discussion here:
         //   https://github.com/bitcoin/bitcoin/pull/15606#discussion_r274479369
         //
+        // Chunked snapshots are written from one cursor per thread, all
+        // created here so that they see the same coinsdb contents. Their
+        // stats are computed while writing the chunks.
+        //
         LOCK(::cs_main);
 
         chainstate.ForceFlushStateToDisk();
 
-        if (!GetUTXOStats(&chainstate.CoinsDB(), chainstate.m_blockman, stats, node.rpc_interruption_point)) {
-            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
-        }
+        if (chunks > 0) {
+            for (int i = 0; i < SnapshotThreads(); ++i) {
+                chunk_cursors.push_back(chainstate.CoinsDB().Cursor());
+            }
+            tip = CHECK_NONFATAL(chainstate.m_blockman.LookupBlockIndex(chainstate.CoinsDB().GetBestBlock()));
+        } else {
+            if (!GetUTXOStats(&chainstate.CoinsDB(), chainstate.m_blockman, stats, node.rpc_interruption_point)) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+            }
 
-        pcursor = chainstate.CoinsDB().Cursor();
-        tip = CHECK_NONFATAL(chainstate.m_blockman.LookupBlockIndex(stats.hashBlock));
+            pcursor = chainstate.CoinsDB().Cursor();
+            tip = CHECK_NONFATAL(chainstate.m_blockman.LookupBlockIndex(stats.hashBlock));
+        }
     }
 
     LOG_TIME_SECONDS(strprintf("writing UTXO snapshot at height %s (%s) to file %s (via %s)",
@@ -2334,21 +2669,28 @@ UniValue CreateUTXOSnapshot(
 
     SnapshotMetadata metadata{tip->GetBlockHash(), stats.coins_count, tip->nChainTx};
 
-    afile << metadata;
-
-    COutPoint key;
-    Coin coin;
-    unsigned int iter{0};
-
-    while (pcursor->Valid()) {
-        if (iter % 5000 == 0) node.rpc_interruption_point();
-        ++iter;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            afile << key;
-            afile << coin;
+    if (chunks > 0) {
+        if (!WriteChunkedSnapshot(chunk_cursors, afile, chunks, metadata, stats.hashSerialized, node.rpc_interruption_point)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
         }
+        stats.coins_count = metadata.m_coins_count;
+    } else {
+        afile << metadata;
+
+        COutPoint key;
+        Coin coin;
+        unsigned int iter{0};
+
+        while (pcursor->Valid()) {
+            if (iter % 5000 == 0) node.rpc_interruption_point();
+            ++iter;
+            if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+                afile << key;
+                afile << coin;
+            }
 
-        pcursor->Next();
+            pcursor->Next();
+        }
     }
 
     afile.fclose();
@@ -2362,6 +2704,7 @@ UniValue CreateUTXOSnapshot(
     // Cast required because univalue doesn't have serialization specified for
     // `unsigned int`, nChainTx's type.
     result.pushKV("nchaintx", uint64_t{tip->nChainTx});
+    result.pushKV("chunks", uint64_t{chunks});
     return result;
 }
 
@@ -2383,10 +2726,14 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &gettxout},
         {"blockchain", &gettxoutsetinfo},
         {"blockchain", &pruneblockchain},
+        {"blockchain", &repackblockfiles},
         {"blockchain", &verifychain},
         {"blockchain", &preciousblock},
         {"blockchain", &scantxoutset},
         {"blockchain", &getblockfilter},
+        {"blockchain", &getaddresshistory},
+        {"blockchain", &getaddressutxos},
+        {"blockchain", &getaddressbalance},
         {"hidden", &invalidateblock},
         {"hidden", &reconsiderblock},
         {"hidden", &waitfornewblock},
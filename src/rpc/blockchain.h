@@ -22,11 +22,15 @@ class CBlock;
 class CBlockIndex;
 class CChainState;
 class UniValue;
+struct AddressHistoryEntry;
+struct AddressUtxo;
 namespace node {
 struct NodeContext;
 } // namespace node
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
+/** Maximum number of address index entries returned by a single request */
+static constexpr size_t MAX_ADDRESS_INDEX_RESULTS = 10000;
 
 /**
  * Get the difficulty of the net wrt to the given block index.
@@ -45,11 +49,16 @@ UniValue blockToJSON(node::BlockManager& blockman, const CBlock& block, const CB
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex) LOCKS_EXCLUDED(cs_main);
 
+/** Address index lookups to JSON, as returned by getaddresshistory and getaddressutxos */
+UniValue AddressHistoryToJSON(const std::vector<AddressHistoryEntry>& entries);
+UniValue AddressUtxosToJSON(const std::vector<AddressUtxo>& utxos);
+
 /** Used by getblockstats to get feerates at different percentiles by weight  */
 void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
 
 /**
  * Helper to create UTXO snapshots given a chainstate and a file handle.
+ * @param[in] chunks Number of chunks to split the snapshot into, 0 for an unchunked snapshot.
  * @return a UniValue map containing metadata about the snapshot.
  */
 UniValue CreateUTXOSnapshot(
@@ -57,6 +66,7 @@ UniValue CreateUTXOSnapshot(
     CChainState& chainstate,
     CAutoFile& afile,
     const fs::path& path,
-    const fs::path& tmppath);
+    const fs::path& tmppath,
+    uint32_t chunks = 0);
 
 #endif // BITCOIN_RPC_BLOCKCHAIN_H
@@ -83,6 +83,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "sendmany", 9, "verbose" },
     { "deriveaddresses", 1, "range" },
     { "scantxoutset", 1, "scanobjects" },
+    { "dumptxoutset", 1, "chunks" },
     { "addmultisigaddress", 0, "nrequired" },
     { "addmultisigaddress", 1, "keys" },
     { "createmultisig", 0, "nrequired" },
@@ -158,6 +159,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "verifychain", 1, "nblocks" },
     { "getblockstats", 0, "hash_or_height" },
     { "getblockstats", 1, "stats" },
+    { "getaddresshistory", 1, "start_height" },
+    { "getaddresshistory", 2, "count" },
+    { "getaddresshistory", 3, "skip" },
+    { "getaddressutxos", 1, "count" },
+    { "getaddressutxos", 2, "skip" },
+    { "gettxspendingprevout", 0, "outputs" },
     { "pruneblockchain", 0, "height" },
     { "keypoolrefill", 0, "newsize" },
     { "getrawmempool", 0, "verbose" },
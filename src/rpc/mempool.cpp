@@ -7,6 +7,7 @@
 
 #include <core_io.h>
 #include <fs.h>
+#include <index/spentindex.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
@@ -634,6 +635,185 @@ static RPCHelpMan getmempoolinfo()
     };
 }
 
+UniValue MempoolFeeHistogramToJSON(const CTxMemPool& pool)
+{
+    FeeHistogram histogram;
+    {
+        LOCK(pool.cs);
+        histogram = pool.GetFeeHistogram();
+    }
+    // Walk from the highest feerate down so every bucket can report the
+    // cumulative size of the transactions at or above its lower bound.
+    std::vector<UniValue> buckets(histogram.size());
+    int64_t vsize_above{0};
+    for (size_t i = histogram.size(); i-- > 0;) {
+        const FeeHistogramBucket& bucket = histogram[i];
+        vsize_above += bucket.vsize;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("from", FEE_HISTOGRAM_BOUNDS[i]);
+        if (i + 1 < FEE_HISTOGRAM_BOUNDS.size()) obj.pushKV("to", FEE_HISTOGRAM_BOUNDS[i + 1]);
+        obj.pushKV("count", bucket.count);
+        obj.pushKV("vsize", bucket.vsize);
+        obj.pushKV("fees", ValueFromAmount(bucket.fees));
+        obj.pushKV("vsize_above", vsize_above);
+        buckets[i] = std::move(obj);
+    }
+    UniValue ret(UniValue::VOBJ);
+    UniValue arr(UniValue::VARR);
+    arr.push_backV(buckets);
+    ret.pushKV("buckets", arr);
+    ret.pushKV("total_vsize", vsize_above);
+    return ret;
+}
+
+static RPCHelpMan getmempoolfeehistogram()
+{
+    return RPCHelpMan{"getmempoolfeehistogram",
+        "\nReturns the mempool grouped into fixed feerate buckets.\n"
+        "Each transaction is counted in the bucket of its ancestor feerate (its modified fee and size\n"
+        "together with all its in-mempool ancestors), which is the feerate it is mined at.\n"
+        "The histogram is maintained as transactions enter and leave the mempool, so this call does not\n"
+        "scale with the mempool size.\n",
+        {},
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+            {
+                {RPCResult::Type::ARR, "buckets", "Buckets in increasing feerate order",
+                {
+                    {RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "from", "Lower bound of the bucket in " + CURRENCY_ATOM + "/vB (inclusive)"},
+                        {RPCResult::Type::NUM, "to", /*optional=*/true, "Upper bound of the bucket in " + CURRENCY_ATOM + "/vB (exclusive), omitted for the last bucket"},
+                        {RPCResult::Type::NUM, "count", "Number of transactions in the bucket"},
+                        {RPCResult::Type::NUM, "vsize", "Sum of the virtual sizes of the transactions in the bucket"},
+                        {RPCResult::Type::STR_AMOUNT, "fees", "Sum of the modified fees of the transactions in the bucket in " + CURRENCY_UNIT},
+                        {RPCResult::Type::NUM, "vsize_above", "Sum of the virtual sizes of all transactions with an ancestor feerate of at least \"from\""},
+                    }},
+                }},
+                {RPCResult::Type::NUM, "total_vsize", "Sum of the virtual sizes of all transactions in the mempool"},
+            }},
+        RPCExamples{
+            HelpExampleCli("getmempoolfeehistogram", "")
+            + HelpExampleRpc("getmempoolfeehistogram", "")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    return MempoolFeeHistogramToJSON(EnsureAnyMemPool(request.context));
+},
+    };
+}
+
+static RPCHelpMan gettxspendingprevout()
+{
+    return RPCHelpMan{"gettxspendingprevout",
+        "\nScans the mempool to find transactions spending any of the given outputs.\n"
+        "With -spentindex, outputs spent in the active chain are looked up in the index as well.\n",
+        {
+            {"outputs", RPCArg::Type::ARR, RPCArg::Optional::NO, "The transaction outputs that we want to check, and within each, the txid (string) vout (numeric).",
+                {
+                    {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                        {
+                            {"txid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The transaction id"},
+                            {"vout", RPCArg::Type::NUM, RPCArg::Optional::NO, "The output number"},
+                        },
+                    },
+                },
+            },
+        },
+        RPCResult{
+            RPCResult::Type::ARR, "", "",
+            {
+                {RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::STR_HEX, "txid", "the transaction id of the checked output"},
+                    {RPCResult::Type::NUM, "vout", "the vout value of the checked output"},
+                    {RPCResult::Type::STR_HEX, "spendingtxid", /*optional=*/true, "the transaction id of the transaction spending this output (only if a spend was found)"},
+                    {RPCResult::Type::NUM, "spendingvin", /*optional=*/true, "the input of the transaction spending this output (only if a spend was found)"},
+                    {RPCResult::Type::NUM, "blockheight", /*optional=*/true, "the height of the block containing the spending transaction (only if it is confirmed)"},
+                }},
+            }
+        },
+        RPCExamples{
+            HelpExampleCli("gettxspendingprevout", "\"[{\\\"txid\\\":\\\"a08e6907dbbd3d809776dbfc5d82e371b764ed838b5655e72f463568df1aadf0\\\",\\\"vout\\\":3}]\"")
+            + HelpExampleRpc("gettxspendingprevout", "\"[{\\\"txid\\\":\\\"a08e6907dbbd3d809776dbfc5d82e371b764ed838b5655e72f463568df1aadf0\\\",\\\"vout\\\":3}]\"")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    RPCTypeCheckArgument(request.params[0], UniValue::VARR);
+    const UniValue& output_params = request.params[0];
+    if (output_params.empty()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, outputs are missing");
+    }
+
+    std::vector<COutPoint> prevouts;
+    prevouts.reserve(output_params.size());
+
+    for (unsigned int idx = 0; idx < output_params.size(); idx++) {
+        const UniValue& o = output_params[idx].get_obj();
+
+        RPCTypeCheckObj(o,
+                        {
+                            {"txid", UniValueType(UniValue::VSTR)},
+                            {"vout", UniValueType(UniValue::VNUM)},
+                        }, /*fAllowNull=*/false, /*fStrict=*/true);
+
+        const uint256 txid(ParseHashO(o, "txid"));
+        const int nOutput = find_value(o, "vout").get_int();
+        if (nOutput < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, vout cannot be negative");
+        }
+
+        prevouts.emplace_back(txid, nOutput);
+    }
+
+    if (g_spent_index && !g_spent_index->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to look up confirmed spends, spent index is still syncing.");
+    }
+
+    const CTxMemPool& mempool = EnsureAnyMemPool(request.context);
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+
+    UniValue result{UniValue::VARR};
+
+    for (const COutPoint& prevout : prevouts) {
+        UniValue o(UniValue::VOBJ);
+        o.pushKV("txid", prevout.hash.ToString());
+        o.pushKV("vout", (uint64_t)prevout.n);
+
+        {
+            LOCK(mempool.cs);
+            const CTransaction* spendingTx = mempool.GetConflictTx(prevout);
+            if (spendingTx != nullptr) {
+                o.pushKV("spendingtxid", spendingTx->GetHash().ToString());
+                for (size_t i = 0; i < spendingTx->vin.size(); ++i) {
+                    if (spendingTx->vin[i].prevout == prevout) o.pushKV("spendingvin", (uint64_t)i);
+                }
+                result.push_back(o);
+                continue;
+            }
+        }
+
+        SpentIndexEntry spend;
+        if (g_spent_index && g_spent_index->FindSpend(prevout, spend)) {
+            // Entries of blocks lost in an unclean shutdown may remain in the
+            // index, so only trust them if their block is in the active chain.
+            LOCK(cs_main);
+            const CChain& active_chain = chainman.ActiveChain();
+            if (spend.height <= active_chain.Height() && active_chain[spend.height]->GetBlockHash() == spend.block_hash) {
+                o.pushKV("spendingtxid", spend.txid.ToString());
+                o.pushKV("spendingvin", (uint64_t)spend.vin);
+                o.pushKV("blockheight", spend.height);
+            }
+        }
+
+        result.push_back(o);
+    }
+
+    return result;
+},
+    };
+}
+
 static RPCHelpMan savemempool()
 {
     return RPCHelpMan{"savemempool",
@@ -657,7 +837,7 @@ static RPCHelpMan savemempool()
         throw JSONRPCError(RPC_MISC_ERROR, "The mempool was not loaded yet");
     }
 
-    if (!DumpMempool(mempool)) {
+    if (!DumpMempool(mempool, /*use_v1=*/args.GetBoolArg("-persistmempoolv1", DEFAULT_PERSIST_V1_DAT))) {
         throw JSONRPCError(RPC_MISC_ERROR, "Unable to dump mempool to disk");
     }
 
@@ -677,8 +857,10 @@ void RegisterMempoolRPCCommands(CRPCTable& t)
         {"blockchain", &getmempoolancestors},
         {"blockchain", &getmempooldescendants},
         {"blockchain", &getmempoolentry},
+        {"blockchain", &getmempoolfeehistogram},
         {"blockchain", &getmempoolinfo},
         {"blockchain", &getrawmempool},
+        {"blockchain", &gettxspendingprevout},
         {"blockchain", &savemempool},
     };
     for (const auto& c : commands) {
@@ -550,6 +550,43 @@ static RPCHelpMan getnettotals()
     };
 }
 
+static RPCHelpMan getorphaninfo()
+{
+    return RPCHelpMan{"getorphaninfo",
+                "\nReturns information about the orphan transactions (transactions with missing inputs) kept in memory.\n",
+                {},
+                RPCResult{
+                   RPCResult::Type::OBJ, "", "",
+                   {
+                       {RPCResult::Type::NUM, "size", "Number of orphan transactions"},
+                       {RPCResult::Type::NUM, "usage", "Memory used by the orphan transactions, in bytes"},
+                       {RPCResult::Type::NUM, "peers", "Number of peers that announced at least one orphan transaction"},
+                       {RPCResult::Type::NUM, "maxorphantx", "Maximum number of orphan transactions"},
+                       {RPCResult::Type::NUM, "maxorphanmemory", "Maximum memory used by orphan transactions, in bytes"},
+                   }
+                },
+                RPCExamples{
+                    HelpExampleCli("getorphaninfo", "")
+            + HelpExampleRpc("getorphaninfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    NodeContext& node = EnsureAnyNodeContext(request.context);
+    const PeerManager& peerman = EnsurePeerman(node);
+    const ArgsManager& args = EnsureArgsman(node);
+
+    const TxOrphanageStats stats{peerman.GetOrphanageStats()};
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("size", uint64_t{stats.count});
+    obj.pushKV("usage", uint64_t{stats.usage});
+    obj.pushKV("peers", uint64_t{stats.peers});
+    obj.pushKV("maxorphantx", std::max<int64_t>(0, args.GetIntArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS)));
+    obj.pushKV("maxorphanmemory", std::max<int64_t>(0, args.GetIntArg("-maxorphanmemory", DEFAULT_MAX_ORPHAN_MEMORY)) * 1000000);
+    return obj;
+},
+    };
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -969,6 +1006,7 @@ void RegisterNetRPCCommands(CRPCTable& t)
         {"network", &disconnectnode},
         {"network", &getaddednodeinfo},
         {"network", &getnettotals},
+        {"network", &getorphaninfo},
         {"network", &getnetworkinfo},
         {"network", &setban},
         {"network", &listbanned},
@@ -5,8 +5,10 @@
 
 #include <chainparams.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <interfaces/echo.h>
@@ -369,6 +371,11 @@ static UniValue SummaryToJSON(const IndexSummary&& summary, std::string index_na
     UniValue entry(UniValue::VOBJ);
     entry.pushKV("synced", summary.synced);
     entry.pushKV("best_block_height", summary.best_block_height);
+    entry.pushKV("progress", summary.progress);
+    if (!summary.synced) {
+        entry.pushKV("blocks_per_second", summary.blocks_per_second);
+    }
+    entry.pushKV("shared_block_reads", summary.shared_block_reads);
     ret_summary.pushKV(summary.name, entry);
     return ret_summary;
 }
@@ -387,6 +394,9 @@ static RPCHelpMan getindexinfo()
                             {
                                 {RPCResult::Type::BOOL, "synced", "Whether the index is synced or not"},
                                 {RPCResult::Type::NUM, "best_block_height", "The block height to which the index is synced"},
+                                {RPCResult::Type::NUM, "progress", "The fraction of the active chain the index is synced with"},
+                                {RPCResult::Type::NUM, "blocks_per_second", /*optional=*/true, "The number of blocks indexed per second since the index started syncing, only present while syncing"},
+                                {RPCResult::Type::NUM, "shared_block_reads", "The number of blocks the index got from another index syncing at the same time, instead of reading them from disk"},
                             }
                         },
                     },
@@ -410,6 +420,14 @@ static RPCHelpMan getindexinfo()
         result.pushKVs(SummaryToJSON(g_coin_stats_index->GetSummary(), index_name));
     }
 
+    if (g_address_index) {
+        result.pushKVs(SummaryToJSON(g_address_index->GetSummary(), index_name));
+    }
+
+    if (g_spent_index) {
+        result.pushKVs(SummaryToJSON(g_spent_index->GetSummary(), index_name));
+    }
+
     ForEachBlockFilterIndex([&result, &index_name](const BlockFilterIndex& index) {
         result.pushKVs(SummaryToJSON(index.GetSummary(), index_name));
     });
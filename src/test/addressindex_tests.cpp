@@ -0,0 +1,100 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <index/addressindex.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(addressindex_initial_sync, TestChain100Setup)
+{
+    AddressIndex address_index(1 << 20, true);
+
+    const CScript coinbase_script = m_coinbase_txns[0]->vout[0].scriptPubKey;
+    std::vector<AddressHistoryEntry> history;
+    std::vector<AddressUtxo> utxos;
+    CAmount balance;
+    uint64_t utxo_count;
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!address_index.BlockUntilSyncedToCurrentChain());
+
+    BOOST_REQUIRE(address_index.Start(m_node.chainman->ActiveChainstate()));
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!address_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    // Every coinbase output of the setup chain pays to the same script.
+    BOOST_REQUIRE(address_index.FindHistory(coinbase_script, 0, 0, 1000, history));
+    BOOST_CHECK_EQUAL(history.size(), m_coinbase_txns.size());
+    for (size_t i = 0; i < history.size(); ++i) {
+        BOOST_CHECK(history[i].txid == m_coinbase_txns[i]->GetHash());
+        BOOST_CHECK_EQUAL(history[i].height, static_cast<int>(i + 1));
+        BOOST_CHECK(!history[i].spend);
+    }
+    BOOST_REQUIRE(address_index.GetBalance(coinbase_script, balance, utxo_count));
+    BOOST_CHECK_EQUAL(utxo_count, m_coinbase_txns.size());
+
+    // Pagination returns consecutive slices of the same range.
+    std::vector<AddressHistoryEntry> page;
+    BOOST_REQUIRE(address_index.FindHistory(coinbase_script, 0, 10, 5, page));
+    BOOST_REQUIRE_EQUAL(page.size(), 5U);
+    BOOST_CHECK(page[0].txid == history[10].txid);
+    page.clear();
+    BOOST_REQUIRE(address_index.FindHistory(coinbase_script, 50, 0, 1, page));
+    BOOST_REQUIRE_EQUAL(page.size(), 1U);
+    BOOST_CHECK_EQUAL(page[0].height, 50);
+
+    // Spend the first coinbase output to another script and check both sides.
+    CKey dest_key;
+    dest_key.MakeNewKey(true);
+    const CScript other_script = GetScriptForDestination(PKHash(dest_key.GetPubKey()));
+    const CMutableTransaction spend = CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 0, coinbaseKey, other_script, 49 * COIN, /*submit=*/false);
+    CreateAndProcessBlock({spend}, coinbase_script);
+    BOOST_CHECK(address_index.BlockUntilSyncedToCurrentChain());
+
+    history.clear();
+    BOOST_REQUIRE(address_index.FindHistory(coinbase_script, 0, 0, 1000, history));
+    BOOST_REQUIRE_EQUAL(history.size(), m_coinbase_txns.size() + 2);
+    const AddressHistoryEntry& spend_entry = history[history.size() - 1];
+    BOOST_CHECK(spend_entry.spend);
+    BOOST_CHECK(spend_entry.txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(spend_entry.amount, m_coinbase_txns[0]->vout[0].nValue);
+
+    BOOST_REQUIRE(address_index.FindUtxos(coinbase_script, 0, 1000, utxos));
+    BOOST_CHECK_EQUAL(utxos.size(), m_coinbase_txns.size());
+    for (const AddressUtxo& utxo : utxos) {
+        BOOST_CHECK(utxo.outpoint.hash != m_coinbase_txns[0]->GetHash());
+        BOOST_CHECK(utxo.coinbase);
+    }
+
+    utxos.clear();
+    BOOST_REQUIRE(address_index.FindUtxos(other_script, 0, 1000, utxos));
+    BOOST_REQUIRE_EQUAL(utxos.size(), 1U);
+    BOOST_CHECK(utxos[0].outpoint == COutPoint(spend.GetHash(), 0));
+    BOOST_CHECK_EQUAL(utxos[0].amount, 49 * COIN);
+    BOOST_CHECK(!utxos[0].coinbase);
+    BOOST_REQUIRE(address_index.GetBalance(other_script, balance, utxo_count));
+    BOOST_CHECK_EQUAL(balance, 49 * COIN);
+    BOOST_CHECK_EQUAL(utxo_count, 1U);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    address_index.Stop();
+
+    // Let scheduler events finish running to avoid accessing any memory related to the index after it is destructed
+    SyncWithValidationInterfaceQueue();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 #include <chainparams.h>
 #include <consensus/merkle.h>
 #include <consensus/validation.h>
+#include <fs.h>
 #include <index/blockfilterindex.h>
 #include <node/miner.h>
 #include <pow.h>
@@ -273,6 +274,101 @@ BOOST_FIXTURE_TEST_CASE(blockfilter_index_initial_sync, BuildChainTestingSetup)
     filter_index.Stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_filter_cache, TestChain100Setup)
+{
+    // Room for a small fraction of the filters of the test chain, so that looking up the
+    // whole chain evicts most of them.
+    BlockFilterIndex filter_index(BlockFilterType::BASIC, 1 << 20, true, false, /*filter_cache_size=*/4096);
+    BOOST_REQUIRE(filter_index.Start(m_node.chainman->ActiveChainstate()));
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    std::vector<const CBlockIndex*> chain;
+    std::vector<BlockFilter> expected;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* block_index = m_node.chainman->ActiveChain().Genesis();
+             block_index != nullptr;
+             block_index = m_node.chainman->ActiveChain().Next(block_index)) {
+            chain.push_back(block_index);
+            BOOST_REQUIRE(ComputeFilter(BlockFilterType::BASIC, block_index, expected.emplace_back()));
+        }
+    }
+    const int tip_height = chain.back()->nHeight;
+
+    // Moving the filter file away makes every lookup that is not served from the cache fail.
+    const fs::path filter_file{gArgs.GetDataDirNet() / "indexes" / "blockfilter" / "basic" / "fltr00000.dat"};
+    const fs::path moved_file{filter_file + ".moved"};
+    BOOST_REQUIRE(fs::exists(filter_file));
+    const auto hide_filters = [&] { fs::rename(filter_file, moved_file); };
+    const auto restore_filters = [&] { fs::rename(moved_file, filter_file); };
+
+    const auto lookup = [&](int height) {
+        BlockFilter filter;
+        if (!filter_index.LookupFilter(chain[height], filter)) return false;
+        BOOST_CHECK_EQUAL(filter.GetBlockHash(), chain[height]->GetBlockHash());
+        BOOST_CHECK_EQUAL(filter.GetHash(), expected[height].GetHash());
+        return true;
+    };
+    const auto check_range = [&](int start_height, int stop_height) {
+        std::vector<BlockFilter> filters;
+        BOOST_REQUIRE(filter_index.LookupFilterRange(start_height, chain[stop_height], filters));
+        BOOST_REQUIRE_EQUAL(filters.size(), static_cast<size_t>(stop_height - start_height + 1));
+        for (size_t i = 0; i < filters.size(); ++i) {
+            BOOST_CHECK_EQUAL(filters[i].GetBlockHash(), chain[start_height + i]->GetBlockHash());
+            BOOST_CHECK_EQUAL(filters[i].GetHash(), expected[start_height + i].GetHash());
+        }
+    };
+
+    // Ranges with cached filters scattered through them merge the cached filters with the
+    // ones read from disk, seeking over the cached ones.
+    for (const int height : {5, 6, 20, 50, 51, 52}) {
+        BOOST_CHECK(lookup(height));
+    }
+    hide_filters();
+    check_range(50, 52);
+    std::vector<BlockFilter> filters;
+    BOOST_CHECK(!filter_index.LookupFilterRange(49, chain[52], filters));
+    restore_filters();
+    check_range(0, tip_height);
+    check_range(tip_height - 40, tip_height - 10);
+    check_range(10, 60);
+    check_range(tip_height, tip_height);
+
+    // Looking up the whole chain in order leaves only the most recent filters cached.
+    for (int height = 0; height <= tip_height; ++height) {
+        BOOST_CHECK(lookup(height));
+    }
+    hide_filters();
+    int oldest_cached = 0;
+    while (oldest_cached <= tip_height && !lookup(oldest_cached)) ++oldest_cached;
+    BOOST_REQUIRE_GT(oldest_cached, 0);
+    BOOST_REQUIRE_LT(oldest_cached, tip_height - 1);
+    // Looking up the cached filters in order keeps their order in the cache.
+    for (int height = oldest_cached + 1; height <= tip_height; ++height) {
+        BOOST_CHECK(lookup(height));
+    }
+    restore_filters();
+
+    // A hit makes the filter the most recently used, so the next filter is evicted instead.
+    BOOST_CHECK(lookup(oldest_cached));
+    BOOST_CHECK(lookup(0));
+    hide_filters();
+    BOOST_CHECK(lookup(0));
+    BOOST_CHECK(lookup(oldest_cached));
+    BOOST_CHECK(!lookup(oldest_cached + 1));
+    BOOST_CHECK(lookup(tip_height));
+    restore_filters();
+
+    filter_index.Interrupt();
+    filter_index.Stop();
+}
+
 BOOST_FIXTURE_TEST_CASE(blockfilter_index_init_destroy, BasicTestingSetup)
 {
     BlockFilterIndex* filter_index;
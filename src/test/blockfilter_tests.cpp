@@ -35,10 +35,53 @@ BOOST_AUTO_TEST_CASE(gcsfilter_test)
 
         auto insertion = excluded_elements.insert(element);
         BOOST_CHECK(filter.MatchAny(excluded_elements));
+        BOOST_CHECK(filter.MatchAny(GCSFilter::ElementQuery{excluded_elements}));
         excluded_elements.erase(insertion.first);
     }
 }
 
+BOOST_AUTO_TEST_CASE(gcsfilter_query_test)
+{
+    // Elements of mixed sizes, as scripts of a wallet would be.
+    GCSFilter::ElementSet included_elements, excluded_elements;
+    for (int i = 0; i < 200; ++i) {
+        GCSFilter::Element element1(22 + (i % 4) * 3);
+        element1[0] = i;
+        included_elements.insert(std::move(element1));
+
+        GCSFilter::Element element2(22 + (i % 4) * 3);
+        element2[1] = i;
+        excluded_elements.insert(std::move(element2));
+    }
+
+    GCSFilter filter({1, 2, 19, 784931}, included_elements);
+    const GCSFilter::ElementQuery included_query{included_elements};
+    const GCSFilter::ElementQuery excluded_query{excluded_elements};
+    BOOST_CHECK_EQUAL(included_query.size(), included_elements.size());
+    BOOST_CHECK(filter.MatchAny(included_query));
+    BOOST_CHECK_EQUAL(filter.MatchAny(excluded_query), filter.MatchAny(excluded_elements));
+    for (const auto& element : excluded_elements) {
+        if (filter.Match(element)) {
+            BOOST_CHECK(filter.MatchAny(excluded_query));
+        }
+    }
+
+    // Filters decoded from their encoding match the same elements.
+    GCSFilter decoded(filter.GetParams(), filter.GetEncoded());
+    BOOST_CHECK_EQUAL(decoded.GetN(), filter.GetN());
+    for (const auto& element : included_elements) {
+        BOOST_CHECK(decoded.Match(element));
+    }
+
+    // Truncated or padded encodings are rejected.
+    std::vector<unsigned char> truncated{filter.GetEncoded()};
+    truncated.pop_back();
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), truncated), std::ios_base::failure);
+    std::vector<unsigned char> padded{filter.GetEncoded()};
+    padded.push_back(0);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), padded), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(gcsfilter_default_constructor)
 {
     GCSFilter filter;
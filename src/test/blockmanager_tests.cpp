@@ -0,0 +1,287 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chainparamsbase.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <flatfile.h>
+#include <fs.h>
+#include <node/blockstorage.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <streams.h>
+#include <sync.h>
+#include <test/util/logging.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using node::BLOCK_RECORD_COMPRESSED;
+using node::BlockFileRecord;
+using node::BlockFileWriter;
+using node::BlockManager;
+using node::CompressBlockData;
+using node::DecompressBlockData;
+using node::OpenBlockFile;
+using node::ScanBlockFile;
+
+namespace {
+struct BlockTreeSetup : public BasicTestingSetup {
+    std::unique_ptr<CBlockTreeDB> m_db{std::make_unique<CBlockTreeDB>(1 << 20, /*fMemory=*/true)};
+    std::vector<uint256> m_hashes;
+
+    BlockTreeSetup() : BasicTestingSetup{CBaseChainParams::REGTEST}
+    {
+        // A chain of 300 headers with a fork at every 10th block
+        const Consensus::Params& consensus{Params().GetConsensus()};
+        std::vector<CBlockIndex> entries;
+        m_hashes.reserve(400);
+        entries.reserve(400);
+        const auto add_block = [&](CBlockIndex* prev) {
+            CBlockHeader header;
+            header.hashPrevBlock = prev ? prev->GetBlockHash() : uint256{};
+            header.hashMerkleRoot = InsecureRand256();
+            header.nTime = prev ? prev->nTime + 600 : 1296688602;
+            header.nBits = UintToArith256(consensus.powLimit).GetCompact();
+            while (!CheckProofOfWork(header.GetHash(), header.nBits, consensus)) ++header.nNonce;
+            m_hashes.push_back(header.GetHash());
+            CBlockIndex& index{entries.emplace_back(header)};
+            index.phashBlock = &m_hashes.back();
+            index.pprev = prev;
+            index.nHeight = prev ? prev->nHeight + 1 : 0;
+            index.nStatus = BLOCK_VALID_TREE;
+            return &index;
+        };
+        CBlockIndex* tip{add_block(nullptr)};
+        for (int i = 1; i < 300; ++i) {
+            if (i % 10 == 0) add_block(tip);
+            tip = add_block(tip);
+        }
+        std::vector<const CBlockIndex*> batch;
+        for (const CBlockIndex& index : entries) batch.push_back(&index);
+        BOOST_REQUIRE(m_db->WriteBatchSync({}, 0, batch));
+    }
+
+    /** Load the block index from m_db, optionally writing a snapshot afterwards. */
+    void Load(BlockManager& blockman, bool write_snapshot) EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
+    {
+        blockman.m_block_tree_db = std::move(m_db);
+        BOOST_REQUIRE(blockman.LoadBlockIndexDB());
+        BOOST_CHECK_EQUAL(blockman.m_block_index.size(), m_hashes.size());
+        if (write_snapshot) BOOST_CHECK(blockman.WriteBlockIndexSnapshot());
+        m_db = std::move(blockman.m_block_tree_db);
+    }
+};
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockmanager_tests, BlockTreeSetup)
+
+BOOST_AUTO_TEST_CASE(block_index_snapshot)
+{
+    LOCK(::cs_main);
+    const fs::path path{gArgs.GetBlocksDirPath() / "blockindex.dat"};
+    BlockManager from_db;
+    Load(from_db, /*write_snapshot=*/true);
+    BOOST_CHECK(fs::exists(path));
+    BOOST_CHECK(m_db->ReadIndexSnapshotId());
+
+    // The snapshot yields the same block index, and is used only once.
+    BlockManager from_snapshot;
+    {
+        ASSERT_DEBUG_LOG("Loaded block index snapshot of 329 entries");
+        Load(from_snapshot, /*write_snapshot=*/false);
+    }
+    BOOST_CHECK(!fs::exists(path));
+    BOOST_CHECK(!m_db->ReadIndexSnapshotId());
+    for (const uint256& hash : m_hashes) {
+        const CBlockIndex* expected{from_db.LookupBlockIndex(hash)};
+        const CBlockIndex* loaded{from_snapshot.LookupBlockIndex(hash)};
+        BOOST_REQUIRE(loaded);
+        BOOST_CHECK(loaded->GetBlockHeader().GetHash() == hash);
+        BOOST_CHECK_EQUAL(loaded->nHeight, expected->nHeight);
+        BOOST_CHECK_EQUAL(loaded->nStatus, expected->nStatus);
+        BOOST_CHECK(loaded->nChainWork == expected->nChainWork);
+        BOOST_CHECK_EQUAL(loaded->nTimeMax, expected->nTimeMax);
+        BOOST_CHECK_EQUAL(loaded->pprev == nullptr, expected->pprev == nullptr);
+        if (loaded->pprev) {
+            BOOST_CHECK(loaded->pprev->GetBlockHash() == expected->pprev->GetBlockHash());
+            BOOST_CHECK(loaded->pskip->GetBlockHash() == expected->pskip->GetBlockHash());
+        }
+    }
+
+    // A snapshot that does not match the database is not used.
+    BlockManager writer;
+    Load(writer, /*write_snapshot=*/true);
+    BOOST_REQUIRE(m_db->WriteIndexSnapshotId(42));
+    BlockManager stale;
+    {
+        ASSERT_DEBUG_LOG("stale snapshot");
+        Load(stale, /*write_snapshot=*/false);
+    }
+    BOOST_CHECK(!fs::exists(path));
+    BOOST_CHECK(!m_db->ReadIndexSnapshotId());
+
+    // A block index flush, as made by software that does not know about
+    // snapshots, discards the snapshot too.
+    Load(writer, /*write_snapshot=*/true);
+    int last_file{-1};
+    BOOST_CHECK(m_db->ReadLastBlockFile(last_file));
+    BOOST_CHECK_EQUAL(last_file, 0);
+    BOOST_REQUIRE(m_db->WriteBatchSync({}, 0, {}));
+    BOOST_CHECK(!m_db->ReadIndexSnapshotId());
+    BlockManager flushed;
+    {
+        DebugLogHelper no_snapshot{"Loaded block index snapshot", [](const std::string* s) {
+            BOOST_CHECK_MESSAGE(!s, "unexpected snapshot load");
+            return false;
+        }};
+        Load(flushed, /*write_snapshot=*/false);
+    }
+    BOOST_CHECK(!fs::exists(path));
+
+    // Neither is a corrupted one.
+    Load(writer, /*write_snapshot=*/true);
+    {
+        FILE* file{fsbridge::fopen(path, "r+b")};
+        BOOST_REQUIRE(file);
+        BOOST_REQUIRE(fseek(file, 100, SEEK_SET) == 0);
+        const int byte{fgetc(file)};
+        BOOST_REQUIRE(fseek(file, 100, SEEK_SET) == 0);
+        fputc(byte ^ 1, file);
+        fclose(file);
+    }
+    BlockManager corrupted;
+    {
+        ASSERT_DEBUG_LOG("checksum mismatch");
+        Load(corrupted, /*write_snapshot=*/false);
+    }
+    BOOST_CHECK(corrupted.LookupBlockIndex(m_hashes.back()));
+}
+
+BOOST_AUTO_TEST_CASE(scan_block_file)
+{
+    const CChainParams& params{Params()};
+    const Consensus::Params& consensus{params.GetConsensus()};
+    CDataStream file{SER_DISK, CLIENT_VERSION};
+    std::vector<BlockFileRecord> expected;
+    const auto fill = [&](size_t count, uint8_t byte) { file.write(MakeByteSpan(std::vector<uint8_t>(count, byte))); };
+    const auto add_record = [&](bool valid_pow, size_t size, uint64_t num_tx) {
+        CBlockHeader header;
+        header.nTime = InsecureRand32();
+        header.nBits = UintToArith256(consensus.powLimit).GetCompact();
+        while (CheckProofOfWork(header.GetHash(), header.nBits, consensus) != valid_pow) ++header.nNonce;
+        file << params.MessageStart() << uint32_t(size) << header;
+        if (valid_pow) expected.push_back({FlatFilePos{0, uint32_t(file.size() - 80)}, uint32_t(size), header, num_tx});
+        if (size == 80) return;
+        WriteCompactSize(file, num_tx);
+        // The first byte of the message start, but not all of it
+        fill(size - 80 - GetSizeOfCompactSize(num_tx), params.MessageStart()[0]);
+    };
+    for (int i = 0; i < 100; ++i) file << uint8_t(InsecureRandBits(8));
+    add_record(/*valid_pow=*/true, 300, /*num_tx=*/1);
+    add_record(/*valid_pow=*/false, 300, /*num_tx=*/1);
+    add_record(/*valid_pow=*/true, 200, /*num_tx=*/1000);
+    // A message start with a size out of range, then records across page boundaries
+    file << params.MessageStart() << uint32_t{79};
+    fill(4096 - 50 - file.size(), 0);
+    add_record(/*valid_pow=*/true, 5000, /*num_tx=*/70000);
+    fill(3 * 4096 - 2 - file.size(), 0);
+    add_record(/*valid_pow=*/true, 80, /*num_tx=*/0);
+    // The pre-allocated tail
+    fill(3 * 4096 + 10, 0);
+    {
+        CAutoFile out{OpenBlockFile(FlatFilePos{0, 0}), SER_DISK, CLIENT_VERSION};
+        out.write(MakeByteSpan(file));
+    }
+
+    const std::vector<BlockFileRecord> records{ScanBlockFile(0, params)};
+    BOOST_REQUIRE_EQUAL(records.size(), expected.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        BOOST_CHECK_EQUAL(records[i].pos.ToString(), expected[i].pos.ToString());
+        BOOST_CHECK_EQUAL(records[i].size, expected[i].size);
+        BOOST_CHECK(records[i].header.GetHash() == expected[i].header.GetHash());
+        BOOST_CHECK_EQUAL(records[i].num_tx, expected[i].num_tx);
+    }
+    BOOST_CHECK(ScanBlockFile(1, params).empty());
+}
+
+BOOST_AUTO_TEST_CASE(compressed_block_data)
+{
+    // A block of similar transactions, as paying to the same kind of scripts
+    CBlock block;
+    block.nTime = InsecureRand32();
+    for (int i = 0; i < 300; ++i) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint{InsecureRand256(), 0});
+        tx.vout.emplace_back(i, CScript() << OP_DUP << OP_HASH160 << std::vector<uint8_t>(20, i % 8) << OP_EQUALVERIFY << OP_CHECKSIG);
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    std::vector<uint8_t> serialized;
+    CVectorWriter{SER_DISK, CLIENT_VERSION, serialized, 0, block};
+
+    std::vector<uint8_t> data{serialized};
+    const uint32_t size{CompressBlockData(data)};
+    BOOST_CHECK(size & BLOCK_RECORD_COMPRESSED);
+    BOOST_CHECK_EQUAL(size & ~BLOCK_RECORD_COMPRESSED, data.size());
+    BOOST_CHECK_LT(data.size(), serialized.size());
+    // The header and transaction count are kept, for ScanBlockFile.
+    BOOST_CHECK(std::equal(serialized.begin(), serialized.begin() + 83, data.begin()));
+    BOOST_REQUIRE(DecompressBlockData(data));
+    BOOST_CHECK(data == serialized);
+
+    // Data that does not compress is stored as it is.
+    for (uint8_t& byte : data) byte = InsecureRandBits(8);
+    data[80] = 1;
+    const std::vector<uint8_t> random{data};
+    BOOST_CHECK_EQUAL(CompressBlockData(data), data.size());
+    BOOST_CHECK(data == random);
+    BOOST_CHECK(!DecompressBlockData(data));
+}
+
+BOOST_AUTO_TEST_CASE(block_file_writer)
+{
+    const auto read_file = [](const fs::path& path) {
+        std::vector<uint8_t> data(fs::file_size(path));
+        CAutoFile file{fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION};
+        file.read(MakeWritableByteSpan(data));
+        return data;
+    };
+    std::vector<uint8_t> expected;
+    const auto make_record = [&](size_t size) {
+        std::vector<uint8_t> record(size);
+        for (uint8_t& byte : record) byte = InsecureRandBits(8);
+        expected.insert(expected.end(), record.begin(), record.end());
+        return record;
+    };
+
+    // Records that fill the queue, and one larger than all of it, are written
+    // in order at their positions.
+    BlockFileWriter writer;
+    writer.Start(/*max_bytes=*/1000);
+    for (size_t size : {10, 300, 300, 300, 300, 5000, 1, 400}) {
+        const FlatFilePos pos{0, uint32_t(expected.size())};
+        BOOST_CHECK(writer.Write(/*undo=*/false, pos, make_record(size)));
+    }
+    writer.WaitForRecord(/*undo=*/false, FlatFilePos{0, uint32_t(expected.size() - 1)});
+    BOOST_CHECK(read_file(gArgs.GetBlocksDirPath() / "blk00000.dat") == expected);
+    BOOST_CHECK(writer.Drain());
+    writer.Stop();
+
+    // Without the thread, they are written right away.
+    expected.clear();
+    BOOST_CHECK(writer.Write(/*undo=*/true, FlatFilePos{0, 0}, make_record(100)));
+    BOOST_CHECK(read_file(gArgs.GetBlocksDirPath() / "rev00000.dat") == expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
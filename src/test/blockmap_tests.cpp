@@ -0,0 +1,100 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <node/blockmap.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using node::BlockMap;
+
+BOOST_FIXTURE_TEST_SUITE(blockmap_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(insert_and_find)
+{
+    BlockMap map;
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.find(uint256::ONE) == map.end());
+
+    // Enough entries to span several arena chunks and table resizes
+    std::vector<uint256> hashes;
+    std::vector<const CBlockIndex*> addresses;
+    for (int i = 0; i < 10000; ++i) {
+        hashes.push_back(InsecureRand256());
+        const auto [it, inserted]{map.try_emplace(hashes.back())};
+        BOOST_REQUIRE(inserted);
+        it->second.nHeight = i;
+        addresses.push_back(&it->second);
+    }
+    BOOST_CHECK_EQUAL(map.size(), hashes.size());
+    BOOST_CHECK(!map.try_emplace(hashes[42]).second);
+
+    // Entries do not move and iterate in insertion order.
+    int height{0};
+    for (const auto& [hash, index] : map) {
+        BOOST_CHECK(hash == hashes[height]);
+        BOOST_CHECK_EQUAL(&index, addresses[height]);
+        BOOST_CHECK_EQUAL(index.nHeight, height++);
+    }
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        BOOST_CHECK_EQUAL(&map.find(hashes[i])->second, addresses[i]);
+        BOOST_CHECK_EQUAL(map.count(hashes[i]), 1U);
+    }
+    BOOST_CHECK_EQUAL(map.count(InsecureRand256()), 0U);
+    BOOST_CHECK_EQUAL(&map[hashes[7]], addresses[7]);
+    BOOST_CHECK_EQUAL(map.size(), hashes.size());
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.find(hashes[0]) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(sort_by_height)
+{
+    // A tree of blocks with random hashes, inserted in hash order as when loaded from disk.
+    std::vector<std::pair<uint256, int>> blocks; // hash and index of the parent, or -1
+    for (int i = 0; i < 5000; ++i) {
+        blocks.emplace_back(InsecureRand256(), i == 0 ? -1 : (InsecureRandBool() ? i - 1 : static_cast<int>(InsecureRandRange(i))));
+    }
+    std::vector<int> heights(blocks.size());
+    for (size_t i = 1; i < blocks.size(); ++i) heights[i] = heights[blocks[i].second] + 1;
+
+    std::vector<size_t> hash_order(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) hash_order[i] = i;
+    std::sort(hash_order.begin(), hash_order.end(), [&](size_t a, size_t b) { return blocks[a].first < blocks[b].first; });
+
+    BlockMap map;
+    for (size_t i : hash_order) {
+        CBlockIndex& index{map[blocks[i].first]};
+        index.phashBlock = &map.find(blocks[i].first)->first;
+        index.nHeight = heights[i];
+        if (blocks[i].second >= 0) index.pprev = &map[blocks[blocks[i].second].first];
+    }
+
+    map.SortByHeight();
+    BOOST_CHECK_EQUAL(map.size(), blocks.size());
+    int last_height{0};
+    for (const auto& [hash, index] : map) {
+        BOOST_CHECK_GE(index.nHeight, last_height);
+        last_height = index.nHeight;
+        BOOST_CHECK_EQUAL(index.phashBlock, &hash);
+        BOOST_CHECK_EQUAL(&map.find(hash)->second, &index);
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const CBlockIndex& index{map.find(blocks[i].first)->second};
+        BOOST_CHECK_EQUAL(index.nHeight, heights[i]);
+        if (blocks[i].second < 0) {
+            BOOST_CHECK(index.pprev == nullptr);
+        } else {
+            BOOST_CHECK(index.pprev->GetBlockHash() == blocks[blocks[i].second].first);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,57 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockreader.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <threadinterrupt.h>
+#include <undo.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockreader_tests)
+
+BOOST_FIXTURE_TEST_CASE(shared_block_reader, TestChain100Setup)
+{
+    SharedBlockReader reader;
+    CThreadInterrupt interrupt;
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip())};
+
+    const auto ahead{reader.Register(tip->nHeight - 1)};
+    const auto behind{reader.Register(tip->nHeight - 2)};
+
+    // The first reader gets the block from disk.
+    SharedBlock first;
+    BOOST_REQUIRE(reader.Read(ahead, tip, /*with_undo=*/false, interrupt, first));
+    BOOST_CHECK(!first.shared);
+    BOOST_CHECK(!first.undo);
+    BOOST_CHECK_EQUAL(first.block->GetHash(), tip->GetBlockHash());
+
+    // The block is kept for the reader behind, which reads the undo data on top.
+    SharedBlock second;
+    BOOST_REQUIRE(reader.Read(behind, tip, /*with_undo=*/true, interrupt, second));
+    BOOST_CHECK(second.shared);
+    BOOST_CHECK(second.block == first.block);
+    BOOST_REQUIRE(second.undo);
+    BOOST_CHECK_EQUAL(second.undo->vtxundo.size(), first.block->vtx.size() - 1);
+
+    // Once all readers are past the block it is dropped.
+    reader.SetPosition(ahead, tip->nHeight);
+    reader.SetPosition(behind, tip->nHeight);
+    SharedBlock third;
+    BOOST_REQUIRE(reader.Read(ahead, tip, /*with_undo=*/false, interrupt, third));
+    BOOST_CHECK(!third.shared);
+    BOOST_CHECK(third.block != first.block);
+
+    // Reading fails once interrupted.
+    interrupt();
+    SharedBlock interrupted;
+    BOOST_CHECK(!reader.Read(ahead, tip, /*with_undo=*/false, interrupt, interrupted));
+
+    reader.Unregister(ahead);
+    reader.Unregister(behind);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,78 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <coins.h>
+#include <node/blockstorage.h>
+#include <node/coinstats.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+using node::CCoinsStats;
+using node::CoinStatsHashType;
+using node::GetUTXOStats;
+
+BOOST_FIXTURE_TEST_SUITE(coinstats_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(parallel_stats)
+{
+    const uint256 best_block{InsecureRand256()};
+    CCoinsViewDB coinsdb{"coinstats", 1 << 20, /*fMemory=*/true, /*fWipe=*/false};
+    {
+        CCoinsViewCache cache{&coinsdb};
+        for (int i = 0; i < 3000; ++i) {
+            const uint256 txid{InsecureRand256()};
+            for (uint32_t n = 0, outputs = 1 + InsecureRandRange(3); n < outputs; ++n) {
+                Coin coin{CTxOut{static_cast<CAmount>(InsecureRandRange(1000000)), CScript() << OP_TRUE << static_cast<int64_t>(InsecureRandRange(100))},
+                          static_cast<int>(InsecureRandRange(100)), InsecureRandBool()};
+                cache.AddCoin(COutPoint{txid, n * 3}, std::move(coin), /*possible_overwrite=*/false);
+            }
+        }
+        cache.SetBestBlock(best_block);
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    node::BlockManager blockman;
+    CBlockIndex index;
+    index.phashBlock = &best_block;
+    index.nHeight = 100;
+
+    for (CoinStatsHashType hash_type : {CoinStatsHashType::HASH_SERIALIZED, CoinStatsHashType::MUHASH, CoinStatsHashType::NONE}) {
+        CCoinsStats serial{hash_type};
+        serial.m_threads = 1;
+        BOOST_REQUIRE(GetUTXOStats(&coinsdb, blockman, serial, [] {}, &index));
+        BOOST_CHECK(serial.coins_count > 3000);
+
+        for (int threads : {2, 5}) {
+            CCoinsStats parallel{hash_type};
+            parallel.m_threads = threads;
+            int interruption_points{0};
+            BOOST_REQUIRE(GetUTXOStats(&coinsdb, blockman, parallel, [&] { ++interruption_points; }, &index));
+            BOOST_CHECK(interruption_points > 0);
+            BOOST_CHECK(parallel.hashSerialized == serial.hashSerialized);
+            BOOST_CHECK_EQUAL(parallel.nHeight, 100);
+            BOOST_CHECK(parallel.hashBlock == best_block);
+            BOOST_CHECK_EQUAL(parallel.coins_count, serial.coins_count);
+            BOOST_CHECK_EQUAL(parallel.nTransactions, serial.nTransactions);
+            BOOST_CHECK_EQUAL(parallel.nTransactionOutputs, serial.nTransactionOutputs);
+            BOOST_CHECK_EQUAL(parallel.nBogoSize, serial.nBogoSize);
+            BOOST_CHECK(parallel.total_amount == serial.total_amount);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(partitions)
+{
+    for (uint32_t count : {1U, 3U, 4096U, node::MAX_UTXO_SET_PARTITIONS}) {
+        BOOST_CHECK(node::UTXOSetPartitionBegin(0, count).IsNull());
+        for (uint32_t i = 1; i < count; ++i) {
+            BOOST_CHECK(node::UTXOSetPartitionBegin(i - 1, count) < node::UTXOSetPartitionBegin(i, count));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -85,6 +85,36 @@ BOOST_FIXTURE_TEST_CASE(coinstatsindex_initial_sync, TestChain100Setup)
     // Rest of shutdown sequence and destructors happen in ~TestingSetup()
 }
 
+BOOST_FIXTURE_TEST_CASE(coinstatsindex_parallel_sync, TestChain100Setup)
+{
+    CoinStatsIndex serial_index{1 << 20, true};
+    CoinStatsIndex parallel_index{1 << 20, true};
+
+    BOOST_REQUIRE(serial_index.Start(m_node.chainman->ActiveChainstate()));
+    BOOST_REQUIRE(parallel_index.Start(m_node.chainman->ActiveChainstate(), /*sync_threads=*/4));
+    IndexWaitSynced(serial_index);
+    IndexWaitSynced(parallel_index);
+
+    // Block deltas prepared out of order must add up to the same statistics.
+    LOCK(cs_main);
+    for (const CBlockIndex* block_index{m_node.chainman->ActiveChain().Genesis()};
+         block_index != nullptr;
+         block_index = m_node.chainman->ActiveChain().Next(block_index)) {
+        CCoinsStats serial_stats{CoinStatsHashType::MUHASH};
+        CCoinsStats parallel_stats{CoinStatsHashType::MUHASH};
+        BOOST_REQUIRE(serial_index.LookUpStats(block_index, serial_stats));
+        BOOST_REQUIRE(parallel_index.LookUpStats(block_index, parallel_stats));
+        BOOST_CHECK_EQUAL(serial_stats.hashSerialized, parallel_stats.hashSerialized);
+        BOOST_CHECK_EQUAL(serial_stats.nTransactionOutputs, parallel_stats.nTransactionOutputs);
+        BOOST_CHECK_EQUAL(serial_stats.nBogoSize, parallel_stats.nBogoSize);
+        BOOST_CHECK_EQUAL(serial_stats.total_amount.value(), parallel_stats.total_amount.value());
+        BOOST_CHECK_EQUAL(serial_stats.total_unspendable_amount, parallel_stats.total_unspendable_amount);
+    }
+
+    serial_index.Stop();
+    parallel_index.Stop();
+}
+
 // Test shutdown between BlockConnected and ChainStateFlushed notifications,
 // make sure index is not corrupted and is able to reload.
 BOOST_FIXTURE_TEST_CASE(coinstatsindex_unclean_shutdown, TestChain100Setup)
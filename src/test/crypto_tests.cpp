@@ -2,9 +2,15 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <compat/cpuid.h>
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
 #include <crypto/chacha_poly_aead.h>
+#include <crypto/common.h>
 #include <crypto/hkdf_sha256_32.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
@@ -24,6 +30,14 @@
 
 #include <boost/test/unit_test.hpp>
 
+#if defined(USE_ASM) && defined(HAVE_GETCPUID) && (defined(__x86_64__) || defined(__amd64__)) && defined(__SIZEOF_INT128__)
+#define ENABLE_MUHASH_X86_ADX
+namespace muhash_x86_adx
+{
+void Multiply(uint64_t (&out)[96], const uint64_t (&a)[48], const uint64_t (&b)[48]);
+}
+#endif
+
 BOOST_FIXTURE_TEST_SUITE(crypto_tests, BasicTestingSetup)
 
 template<typename Hasher, typename In, typename Out>
@@ -947,4 +961,98 @@ BOOST_AUTO_TEST_CASE(muhash_tests)
     BOOST_CHECK_EQUAL(HexStr(out4), "3a31e6903aff0de9f62f9a9f7f8b861de76ce2cda09822b90014319ae5dc2271");
 }
 
+BOOST_AUTO_TEST_CASE(muhash_inverse)
+{
+    // Dividing a number by itself must give the empty set, for numbers close
+    // to 0, to the modulus 2^3072 - 1103717 and in between.
+    uint256 empty;
+    MuHash3072{}.Finalize(empty);
+
+    const auto check = [&](const std::vector<unsigned char>& num) {
+        CDataStream ss{SER_DISK, PROTOCOL_VERSION};
+        ss.write(MakeByteSpan(num));
+        ss.write(MakeByteSpan(num));
+        MuHash3072 muhash;
+        ss >> muhash;
+        uint256 out;
+        muhash.Finalize(out);
+        BOOST_CHECK_EQUAL(out, empty);
+    };
+    std::vector<unsigned char> num(384);
+    for (unsigned char i : {1, 2, 3, 255}) {
+        num[0] = i;
+        check(num);
+    }
+    std::fill(num.begin(), num.end(), 0xff);
+    for (uint32_t diff : {1103718, 1103719, 1103720, 1200000}) {
+        WriteLE32(num.data(), ~uint32_t{0} - diff + 1);
+        check(num);
+    }
+    for (int i = 0; i < 100; ++i) {
+        num = g_insecure_rand_ctx.randbytes(384);
+        // Random numbers with long runs of zero and one bits
+        for (int j = g_insecure_rand_ctx.randrange(3); j > 0; --j) {
+            const size_t begin{g_insecure_rand_ctx.randrange(384)};
+            std::fill(num.begin() + begin, num.begin() + begin + g_insecure_rand_ctx.randrange(385 - begin), g_insecure_rand_ctx.randbool() ? 0xff : 0);
+        }
+        check(num);
+    }
+}
+
+#ifdef ENABLE_MUHASH_X86_ADX
+BOOST_AUTO_TEST_CASE(muhash_x86_adx_multiply)
+{
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    if (eax < 7) return;
+    GetCPUID(7, 0, eax, ebx, ecx, edx);
+    // The rows use the BMI2 mulx and the ADX adcx/adox instructions.
+    if (!((ebx >> 8) & 1) || !((ebx >> 19) & 1)) {
+        BOOST_TEST_MESSAGE("Skipping muhash_x86_adx_multiply: the CPU lacks BMI2 or ADX");
+        return;
+    }
+
+    const auto check = [](const uint64_t (&a)[48], const uint64_t (&b)[48]) {
+        // Portable schoolbook product.
+        uint64_t expected[96] = {};
+        for (int i = 0; i < 48; ++i) {
+            uint64_t carry = 0;
+            for (int j = 0; j < 48; ++j) {
+                const unsigned __int128 t{static_cast<unsigned __int128>(a[j]) * b[i] + expected[i + j] + carry};
+                expected[i + j] = static_cast<uint64_t>(t);
+                carry = static_cast<uint64_t>(t >> 64);
+            }
+            expected[i + 48] = carry;
+        }
+        uint64_t out[96];
+        muhash_x86_adx::Multiply(out, a, b);
+        BOOST_CHECK(std::equal(std::begin(out), std::end(out), std::begin(expected)));
+    };
+
+    uint64_t a[48], b[48];
+    // All ones maximizes the carries in both chains, zero has none.
+    for (const uint64_t x : {~uint64_t{0}, uint64_t{0}}) {
+        for (const uint64_t y : {~uint64_t{0}, uint64_t{0}, uint64_t{1}}) {
+            std::fill(std::begin(a), std::end(a), x);
+            std::fill(std::begin(b), std::end(b), y);
+            check(a, b);
+        }
+    }
+    for (int i = 0; i < 1000; ++i) {
+        for (int j = 0; j < 48; ++j) {
+            a[j] = g_insecure_rand_ctx.rand64();
+            b[j] = g_insecure_rand_ctx.rand64();
+        }
+        // Random numbers with runs of all-zero and all-one limbs
+        for (uint64_t* num : {a, b}) {
+            for (int k = g_insecure_rand_ctx.randrange(3); k > 0; --k) {
+                const int begin = g_insecure_rand_ctx.randrange(48);
+                std::fill(num + begin, num + begin + g_insecure_rand_ctx.randrange(49 - begin), g_insecure_rand_ctx.randbool() ? ~uint64_t{0} : 0);
+            }
+        }
+        check(a, b);
+    }
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
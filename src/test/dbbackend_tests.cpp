@@ -0,0 +1,372 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <dbbackend.h>
+#include <dbwrapper.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const std::vector<DBBackendType> ALL_BACKENDS{DBBackendType::LEVELDB, DBBackendType::LOGSTORE};
+
+std::unique_ptr<DBBackend> MakeBackend(DBBackendType backend, const fs::path& path, bool memory, bool wipe)
+{
+    switch (backend) {
+    case DBBackendType::LEVELDB: return MakeLevelDBBackend(path, 1 << 20, memory, wipe, {});
+    case DBBackendType::LOGSTORE: return MakeLogStoreBackend(path, memory, wipe);
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+DBBackend::Bytes Bytes(const std::string& str) { return MakeByteSpan(str); }
+
+std::string String(DBBackend::Bytes bytes) { return {reinterpret_cast<const char*>(bytes.data()), bytes.size()}; }
+
+void Put(DBBackend& db, const std::string& key, const std::string& value, bool sync = false)
+{
+    const auto batch{db.NewBatch()};
+    batch->Put(Bytes(key), Bytes(value));
+    db.Write(*batch, sync);
+}
+
+std::optional<std::string> Get(const DBBackend& db, const std::string& key)
+{
+    std::string value;
+    if (!db.Get(Bytes(key), value)) return std::nullopt;
+    return value;
+}
+
+/** Check that the entries of a backend are those of a model, in order */
+void CheckContents(const DBBackend& db, const std::map<std::string, std::string>& model)
+{
+    const auto it{db.NewIterator()};
+    it->SeekToFirst();
+    for (const auto& [key, value] : model) {
+        BOOST_REQUIRE(it->Valid());
+        BOOST_CHECK(String(it->Key()) == key);
+        BOOST_CHECK(String(it->Value()) == value);
+        it->Next();
+    }
+    BOOST_CHECK(!it->Valid());
+    for (const auto& [key, value] : model) {
+        BOOST_CHECK(Get(db, key) == value);
+    }
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(dbbackend_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(dbbackend_basic)
+{
+    for (const DBBackendType backend : ALL_BACKENDS) {
+        for (const bool memory : {true, false}) {
+            const auto db{MakeBackend(backend, m_args.GetDataDirBase() / fs::u8path("basic_" + DBBackendName(backend)), memory, /*wipe=*/true)};
+            BOOST_CHECK(!Get(*db, "a"));
+            const auto empty_it{db->NewIterator()};
+            empty_it->SeekToFirst();
+            BOOST_CHECK(!empty_it->Valid());
+
+            Put(*db, "a", "1");
+            Put(*db, "b", "");
+            BOOST_CHECK(Get(*db, "a") == "1");
+            BOOST_CHECK(Get(*db, "b") == "");
+            Put(*db, "a", "2", /*sync=*/true);
+            BOOST_CHECK(Get(*db, "a") == "2");
+
+            // Operations of a batch are applied in order.
+            auto batch{db->NewBatch()};
+            batch->Put(Bytes("c"), Bytes("3"));
+            batch->Delete(Bytes("c"));
+            batch->Delete(Bytes("d"));
+            batch->Put(Bytes("d"), Bytes("4"));
+            batch->Delete(Bytes("missing"));
+            db->Write(*batch, /*sync=*/false);
+            BOOST_CHECK(!Get(*db, "c"));
+            BOOST_CHECK(Get(*db, "d") == "4");
+
+            // A cleared batch writes nothing.
+            batch->Clear();
+            batch->Put(Bytes("e"), Bytes("5"));
+            batch->Clear();
+            db->Write(*batch, /*sync=*/false);
+            BOOST_CHECK(!Get(*db, "e"));
+
+            batch = db->NewBatch();
+            batch->Delete(Bytes("a"));
+            db->Write(*batch, /*sync=*/false);
+            BOOST_CHECK(!Get(*db, "a"));
+            CheckContents(*db, {{"b", ""}, {"d", "4"}});
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbbackend_ordering)
+{
+    // Keys are ordered bytewise, including zero bytes and bytes above 0x7f.
+    const std::vector<std::string> keys{
+        std::string(""), std::string("\x00", 1), std::string("\x00\x00", 2), std::string("\x01"),
+        std::string("a"), std::string("a\x00", 2), std::string("ab"), std::string("b"),
+        std::string("\x7f"), std::string("\x80"), std::string("\xff"), std::string("\xff\xff"),
+        std::string(1000, 'z')};
+    for (const DBBackendType backend : ALL_BACKENDS) {
+        const auto db{MakeBackend(backend, m_args.GetDataDirBase() / fs::u8path("ordering_" + DBBackendName(backend)), /*memory=*/true, /*wipe=*/false)};
+        std::map<std::string, std::string> model;
+        // Write the keys in reverse order, so that the order is not the insertion order.
+        for (auto key{keys.rbegin()}; key != keys.rend(); ++key) {
+            Put(*db, *key, "v" + *key);
+            model.emplace(*key, "v" + *key);
+        }
+        CheckContents(*db, model);
+
+        const auto it{db->NewIterator()};
+        it->Seek(Bytes(std::string("a\x00\x00", 3)));
+        BOOST_REQUIRE(it->Valid());
+        BOOST_CHECK(String(it->Key()) == "ab");
+        it->Seek(Bytes("\x80"));
+        BOOST_REQUIRE(it->Valid());
+        BOOST_CHECK(String(it->Key()) == "\x80");
+        it->Seek(Bytes("\xff\xff\xff"));
+        BOOST_CHECK(!it->Valid());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbbackend_random_ops)
+{
+    // Random puts, deletes and compactions agree with a std::map model.
+    for (const DBBackendType backend : ALL_BACKENDS) {
+        for (const bool memory : {true, false}) {
+            const fs::path path{m_args.GetDataDirBase() / fs::u8path("random_" + DBBackendName(backend))};
+            auto db{MakeBackend(backend, path, memory, /*wipe=*/true)};
+            std::map<std::string, std::string> model;
+            for (int round = 0; round < 20; ++round) {
+                const auto batch{db->NewBatch()};
+                for (int i = 0; i < 200; ++i) {
+                    const std::string key{"k" + ToString(InsecureRandRange(500))};
+                    if (InsecureRandBool()) {
+                        const std::string value(InsecureRandRange(100), static_cast<char>(InsecureRandBits(8)));
+                        batch->Put(Bytes(key), Bytes(value));
+                        model[key] = value;
+                    } else {
+                        batch->Delete(Bytes(key));
+                        model.erase(key);
+                    }
+                }
+                db->Write(*batch, /*sync=*/InsecureRandBool());
+                if (round % 5 == 4) db->CompactRange(nullptr, nullptr);
+                if (round % 7 == 6 && !memory) {
+                    db.reset();
+                    db = MakeBackend(backend, path, memory, /*wipe=*/false);
+                }
+            }
+            CheckContents(*db, model);
+            BOOST_CHECK(db->DynamicMemoryUsage() > 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbbackend_iterator_during_writes)
+{
+    // An iterator stays usable while the database is written to and compacted.
+    for (const DBBackendType backend : ALL_BACKENDS) {
+        const auto db{MakeBackend(backend, m_args.GetDataDirBase() / fs::u8path("iter_" + DBBackendName(backend)), /*memory=*/true, /*wipe=*/false)};
+        for (char c = 'a'; c <= 'j'; ++c) {
+            Put(*db, std::string(1, c), std::string(1, c));
+        }
+        const auto it{db->NewIterator()};
+        it->SeekToFirst();
+        std::string seen;
+        while (it->Valid()) {
+            BOOST_CHECK(String(it->Key()) == String(it->Value()));
+            seen += String(it->Key());
+            const auto batch{db->NewBatch()};
+            batch->Delete(it->Key());
+            db->Write(*batch, /*sync=*/false);
+            db->CompactRange(nullptr, nullptr);
+            it->Next();
+        }
+        BOOST_CHECK_EQUAL(seen, "abcdefghij");
+        const auto after{db->NewIterator()};
+        after->SeekToFirst();
+        BOOST_CHECK(!after->Valid());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbbackend_persistence)
+{
+    for (const DBBackendType backend : ALL_BACKENDS) {
+        const fs::path path{m_args.GetDataDirBase() / fs::u8path("persist_" + DBBackendName(backend))};
+        {
+            const auto db{MakeBackend(backend, path, /*memory=*/false, /*wipe=*/true)};
+            Put(*db, "a", "1");
+            Put(*db, "b", "2", /*sync=*/true);
+            const auto batch{db->NewBatch()};
+            batch->Delete(Bytes("a"));
+            db->Write(*batch, /*sync=*/false);
+        }
+        {
+            const auto db{MakeBackend(backend, path, /*memory=*/false, /*wipe=*/false)};
+            CheckContents(*db, {{"b", "2"}});
+            BOOST_CHECK(db->EstimateSize(Bytes("c"), Bytes("a")) == 0);
+        }
+        {
+            // Wiping removes all entries.
+            const auto db{MakeBackend(backend, path, /*memory=*/false, /*wipe=*/true)};
+            CheckContents(*db, {});
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbbackend_mismatch)
+{
+    // A database can only be opened with the backend that created it.
+    const fs::path leveldb_path{m_args.GetDataDirBase() / "mismatch_leveldb"};
+    const fs::path logstore_path{m_args.GetDataDirBase() / "mismatch_logstore"};
+    Put(*MakeBackend(DBBackendType::LEVELDB, leveldb_path, /*memory=*/false, /*wipe=*/false), "a", "1");
+    Put(*MakeBackend(DBBackendType::LOGSTORE, logstore_path, /*memory=*/false, /*wipe=*/false), "a", "1");
+    BOOST_CHECK_THROW(MakeBackend(DBBackendType::LOGSTORE, leveldb_path, /*memory=*/false, /*wipe=*/false), dbwrapper_error);
+    BOOST_CHECK_THROW(MakeBackend(DBBackendType::LEVELDB, logstore_path, /*memory=*/false, /*wipe=*/false), dbwrapper_error);
+}
+
+BOOST_AUTO_TEST_CASE(logstore_interrupted_write)
+{
+    // An incomplete record at the end of the log is discarded on startup and
+    // later writes are not lost behind it.
+    const fs::path path{m_args.GetDataDirBase() / "logstore_interrupted"};
+    {
+        const auto db{MakeLogStoreBackend(path, /*memory=*/false, /*wipe=*/true)};
+        Put(*db, "a", "1");
+        Put(*db, "b", std::string(100, 'x'));
+    }
+    const fs::path log_path{path / "logstore-000001.dat"};
+    const auto log_size{fs::file_size(log_path)};
+    fs::resize_file(log_path, log_size - 10);
+    {
+        const auto db{MakeLogStoreBackend(path, /*memory=*/false, /*wipe=*/false)};
+        CheckContents(*db, {{"a", "1"}});
+        Put(*db, "c", "3");
+    }
+    {
+        const auto db{MakeLogStoreBackend(path, /*memory=*/false, /*wipe=*/false)};
+        CheckContents(*db, {{"a", "1"}, {"c", "3"}});
+    }
+
+    // A record that fails its checksum in the middle of the log is corruption.
+    {
+        FILE* file{fsbridge::fopen(log_path, "r+b")};
+        BOOST_REQUIRE(file);
+        BOOST_REQUIRE(fseek(file, 8, SEEK_SET) == 0);
+        BOOST_REQUIRE(fputc(0xff, file) != EOF);
+        fclose(file);
+    }
+    {
+        // Make the corrupted file not the newest one.
+        FILE* file{fsbridge::fopen(path / "logstore-000002.dat", "wb")};
+        BOOST_REQUIRE(file);
+        fclose(file);
+    }
+    BOOST_CHECK_THROW(MakeLogStoreBackend(path, /*memory=*/false, /*wipe=*/false), dbwrapper_error);
+}
+
+BOOST_AUTO_TEST_CASE(logstore_torn_older_file)
+{
+    // A record cut short at the end of a file that is not the newest, as a
+    // crash can leave while writes move on to a new file, is discarded too.
+    const fs::path path{m_args.GetDataDirBase() / "logstore_torn"};
+    {
+        const auto db{MakeLogStoreBackend(path, /*memory=*/false, /*wipe=*/true)};
+        Put(*db, "a", "1");
+        Put(*db, "b", std::string(100, 'x'));
+    }
+    const fs::path log_path{path / "logstore-000001.dat"};
+    fs::resize_file(log_path, fs::file_size(log_path) - 10);
+    {
+        FILE* file{fsbridge::fopen(path / "logstore-000002.dat", "wb")};
+        BOOST_REQUIRE(file);
+        fclose(file);
+    }
+    {
+        const auto db{MakeLogStoreBackend(path, /*memory=*/false, /*wipe=*/false)};
+        CheckContents(*db, {{"a", "1"}});
+        Put(*db, "c", "3");
+    }
+    const auto db{MakeLogStoreBackend(path, /*memory=*/false, /*wipe=*/false)};
+    CheckContents(*db, {{"a", "1"}, {"c", "3"}});
+}
+
+BOOST_AUTO_TEST_CASE(logstore_estimate_size)
+{
+    // Sizes are estimated from the running size of the entries of each first
+    // key byte, shared out evenly over the following bytes.
+    const auto db{MakeLogStoreBackend(m_args.GetDataDirBase() / "logstore_estimate", /*memory=*/true, /*wipe=*/false)};
+    const auto batch{db->NewBatch()};
+    for (int i = 0; i < 65536; i += 16) {
+        const std::string key{'k', char(i >> 8), char(i & 0xff)};
+        batch->Put(Bytes(key), Bytes("value"));
+    }
+    batch->Put(Bytes("z"), Bytes("value"));
+    db->Write(*batch, /*sync=*/false);
+    // 4096 puts of a 3 byte key and a 5 byte value, each taking 17 bytes
+    const size_t total{4096 * 17};
+    BOOST_CHECK_EQUAL(db->EstimateSize(Bytes("k"), Bytes("l")), total);
+    BOOST_CHECK_EQUAL(db->EstimateSize(Bytes("a"), Bytes("z")), total);
+    BOOST_CHECK_EQUAL(db->EstimateSize(Bytes("k"), Bytes("z")), total);
+    BOOST_CHECK_EQUAL(db->EstimateSize(Bytes(std::string{'k', '\x40'}), Bytes(std::string{'k', '\xc0'})), total / 2);
+    BOOST_CHECK_EQUAL(db->EstimateSize(Bytes("l"), Bytes("z")), 0U);
+
+    // Deleted and overwritten entries no longer count.
+    const auto update{db->NewBatch()};
+    for (int i = 0; i < 65536; i += 32) {
+        const std::string key{'k', char(i >> 8), char(i & 0xff)};
+        update->Delete(Bytes(key));
+    }
+    update->Put(Bytes(std::string{'k', '\0', '\x10'}), Bytes("longer value"));
+    db->Write(*update, /*sync=*/false);
+    BOOST_CHECK_EQUAL(db->EstimateSize(Bytes("k"), Bytes("l")), total / 2 + 7);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_backends)
+{
+    // CDBWrapper behaves the same on every backend.
+    for (const DBBackendType backend : ALL_BACKENDS) {
+        for (const bool obfuscate : {false, true}) {
+            DBTuning tuning;
+            tuning.backend = backend;
+            const fs::path path{m_args.GetDataDirBase() / fs::u8path("wrapper_" + DBBackendName(backend))};
+            {
+                CDBWrapper dbw(path, 1 << 20, /*fMemory=*/false, /*fWipe=*/true, obfuscate, tuning);
+                for (uint8_t i = 0; i < 10; ++i) {
+                    BOOST_CHECK(dbw.Write(std::make_pair(uint8_t{'k'}, i), uint256{i}));
+                }
+                BOOST_CHECK(dbw.Erase(std::make_pair(uint8_t{'k'}, uint8_t{3}), /*fSync=*/true));
+                BOOST_CHECK(dbw.Exists(std::make_pair(uint8_t{'k'}, uint8_t{4})));
+                BOOST_CHECK(!dbw.Exists(std::make_pair(uint8_t{'k'}, uint8_t{3})));
+            }
+            CDBWrapper dbw(path, 1 << 20, /*fMemory=*/false, /*fWipe=*/false, obfuscate, tuning);
+            std::unique_ptr<CDBIterator> it(dbw.NewIterator());
+            it->Seek(std::make_pair(uint8_t{'k'}, uint8_t{0}));
+            for (uint8_t i = 0; i < 10; ++i) {
+                if (i == 3) continue;
+                BOOST_REQUIRE(it->Valid());
+                std::pair<uint8_t, uint8_t> key;
+                uint256 value;
+                BOOST_REQUIRE(it->GetKey(key));
+                BOOST_REQUIRE(it->GetValue(value));
+                BOOST_CHECK_EQUAL(key.second, i);
+                BOOST_CHECK(value == uint256{i});
+                it->Next();
+            }
+            BOOST_CHECK(!it->Valid());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
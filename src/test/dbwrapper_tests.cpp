@@ -6,6 +6,8 @@
 #include <test/util/setup_common.h>
 #include <uint256.h>
 
+#include <limits>
+#include <map>
 #include <memory>
 
 #include <boost/test/unit_test.hpp>
@@ -411,5 +413,149 @@ BOOST_AUTO_TEST_CASE(unicodepath)
     BOOST_CHECK(fs::exists(lockPath));
 }
 
+/** Return the tuning of a kind of database for the given command line. */
+static DBTuning GetTuning(std::vector<const char*> argv, const std::string& db_kind)
+{
+    ArgsManager args;
+    args.AddArg("-dbbackend=<backend>", "", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    args.AddArg("-dbprofile=<profile>", "", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    args.AddArg("-dbtuning=<kind>:<option>=<value>", "", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argv.insert(argv.begin(), "ignored");
+    std::string error;
+    BOOST_REQUIRE(args.ParseParameters(argv.size(), argv.data(), error));
+    return GetDBTuning(args, db_kind);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_tuning)
+{
+    // The default profile matches the built-in LevelDB settings.
+    const DBTuning defaults{GetTuning({}, "chainstate")};
+    BOOST_CHECK_EQUAL(defaults.block_size, 4U << 10);
+    BOOST_CHECK_EQUAL(defaults.bloom_bits, 10);
+    BOOST_CHECK(!defaults.compression);
+    BOOST_CHECK(!defaults.write_buffer_size);
+
+    // Overrides only apply to their kind of database.
+    const std::vector<const char*> argv{"-dbprofile=network", "-dbtuning=chainstate:bloombits=0", "-dbtuning=indexes:writebuffer=8", "-dbtuning=indexes:compression=0"};
+    const DBTuning chainstate{GetTuning(argv, "chainstate")};
+    BOOST_CHECK_EQUAL(chainstate.block_size, 64U << 10);
+    BOOST_CHECK_EQUAL(chainstate.bloom_bits, 0);
+    BOOST_CHECK(chainstate.compression);
+    const DBTuning indexes{GetTuning(argv, "indexes")};
+    BOOST_CHECK_EQUAL(indexes.bloom_bits, 16);
+    BOOST_CHECK(!indexes.compression);
+    BOOST_CHECK_EQUAL(indexes.write_buffer_size.value(), 8U << 20);
+
+    // The chainstate is kept in LevelDB whatever the -dbbackend.
+    BOOST_CHECK(GetTuning({"-dbbackend=logstore"}, "chainstate").backend == DBBackendType::LEVELDB);
+    BOOST_CHECK(GetTuning({"-dbbackend=logstore"}, "blockindex").backend == DBBackendType::LOGSTORE);
+    BOOST_CHECK(GetTuning({"-dbbackend=logstore"}, "indexes").backend == DBBackendType::LOGSTORE);
+    BOOST_CHECK_THROW(GetTuning({"-dbbackend=rocksdb"}, "chainstate"), std::runtime_error);
+
+    BOOST_CHECK_THROW(GetTuning({"-dbprofile=tape"}, "chainstate"), std::runtime_error);
+    BOOST_CHECK_THROW(GetTuning({"-dbtuning=wallet:bloombits=10"}, "chainstate"), std::runtime_error);
+    BOOST_CHECK_THROW(GetTuning({"-dbtuning=chainstate:bloombits"}, "chainstate"), std::runtime_error);
+    BOOST_CHECK_THROW(GetTuning({"-dbtuning=chainstate:cachesize=1"}, "chainstate"), std::runtime_error);
+    // Invalid values are rejected even for other kinds of databases.
+    BOOST_CHECK_THROW(GetTuning({"-dbtuning=indexes:blocksize=0"}, "chainstate"), std::runtime_error);
+
+    // Data written with one tuning can be read with another.
+    fs::path ph = m_args.GetDataDirBase() / "dbwrapper_tuning";
+    const uint256 in = InsecureRand256();
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, true, false, chainstate);
+        for (uint8_t key = 0; key < 100; ++key) {
+            BOOST_CHECK(dbw.Write(key, in));
+        }
+    }
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, false, false, defaults);
+        uint256 res;
+        BOOST_CHECK(dbw.Read(uint8_t{99}, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compression)
+{
+    // Tables compressed with LZ4 are smaller, and stay readable once
+    // compression is turned off.
+    DBTuning compressed;
+    compressed.compression = true;
+    const auto write_and_compact = [](CDBWrapper& dbw, uint8_t prefix) {
+        CDBBatch batch(dbw);
+        for (uint32_t key = 0; key < 2000; ++key) {
+            batch.Write(std::make_pair(prefix, key), std::vector<uint8_t>(200, key % 7));
+        }
+        BOOST_REQUIRE(dbw.WriteBatch(batch, true));
+        const auto begin{std::make_pair(prefix, uint32_t{0})}, end{std::make_pair(prefix, std::numeric_limits<uint32_t>::max())};
+        dbw.CompactRange(begin, end);
+        return dbw.EstimateSize(begin, end);
+    };
+    const auto check_values = [](CDBWrapper& dbw, uint8_t prefix) {
+        for (uint32_t key = 0; key < 2000; key += 37) {
+            std::vector<uint8_t> value;
+            BOOST_REQUIRE(dbw.Read(std::make_pair(prefix, key), value));
+            BOOST_CHECK(value == std::vector<uint8_t>(200, key % 7));
+        }
+    };
+
+    const fs::path ph = m_args.GetDataDirBase() / "dbwrapper_compression";
+    size_t compressed_size, uncompressed_size;
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, true, false, compressed);
+        compressed_size = write_and_compact(dbw, 'a');
+        check_values(dbw, 'a');
+    }
+    {
+        CDBWrapper dbw(ph, (1 << 20), false, false, false, {});
+        check_values(dbw, 'a');
+        uncompressed_size = write_and_compact(dbw, 'b');
+        check_values(dbw, 'a');
+        check_values(dbw, 'b');
+    }
+    BOOST_CHECK_GT(compressed_size, 0U);
+    BOOST_CHECK_LT(compressed_size * 4, uncompressed_size);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_subcompactions)
+{
+    // Compactions split across threads keep every entry and deletion.
+    DBTuning tuning;
+    tuning.write_buffer_size = 64 << 10;
+    tuning.max_file_size = 1 << 20;
+    tuning.subcompactions = 4;
+    CDBWrapper dbw(m_args.GetDataDirBase() / "dbwrapper_subcompactions", (1 << 20), false, true, false, tuning);
+
+    std::map<uint32_t, uint256> model;
+    for (int round = 0; round < 40; ++round) {
+        CDBBatch batch(dbw);
+        for (int i = 0; i < 500; ++i) {
+            const uint32_t key = InsecureRandRange(20000);
+            if (InsecureRandRange(4) == 0) {
+                batch.Erase(std::make_pair(uint8_t{'k'}, key));
+                model.erase(key);
+            } else {
+                const uint256 value = InsecureRand256();
+                batch.Write(std::make_pair(uint8_t{'k'}, key), value);
+                model[key] = value;
+            }
+        }
+        dbw.WriteBatch(batch);
+    }
+    dbw.CompactRange(std::make_pair(uint8_t{'k'}, uint32_t{0}), std::make_pair(uint8_t{'k'}, std::numeric_limits<uint32_t>::max()));
+
+    size_t count = 0;
+    std::unique_ptr<CDBIterator> it(dbw.NewIterator());
+    for (it->Seek(std::make_pair(uint8_t{'k'}, uint32_t{0})); it->Valid(); it->Next()) {
+        std::pair<uint8_t, uint32_t> key;
+        uint256 value;
+        BOOST_REQUIRE(it->GetKey(key) && key.first == 'k');
+        BOOST_REQUIRE(it->GetValue(value));
+        BOOST_CHECK(model.at(key.second) == value);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, model.size());
+}
 
 BOOST_AUTO_TEST_SUITE_END()
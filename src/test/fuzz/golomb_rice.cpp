@@ -15,6 +15,7 @@
 #include <cassert>
 #include <cstdint>
 #include <iosfwd>
+#include <optional>
 #include <unordered_set>
 #include <vector>
 
@@ -78,6 +79,14 @@ FUZZ_TARGET(golomb_rice)
 
     assert(encoded_deltas == decoded_deltas);
 
+    {
+        GolombRiceReader reader{Span{golomb_rice_data}.subspan(GetSizeOfCompactSize(encoded_deltas.size()))};
+        for (const uint64_t delta : encoded_deltas) {
+            assert(reader.Decode(BASIC_FILTER_P) == delta);
+        }
+        assert(reader.empty());
+    }
+
     {
         const std::vector<uint8_t> random_bytes = ConsumeRandomLengthByteVector(fuzzed_data_provider, 1024);
         SpanReader stream{SER_NETWORK, 0, random_bytes};
@@ -88,11 +97,19 @@ FUZZ_TARGET(golomb_rice)
             return;
         }
         BitStreamReader<SpanReader> bitreader{stream};
+        GolombRiceReader reader{Span{random_bytes}.last(stream.size())};
         for (uint32_t i = 0; i < std::min<uint32_t>(n, 1024); ++i) {
+            std::optional<uint64_t> decoded, read;
+            try {
+                decoded = GolombRiceDecode(bitreader, BASIC_FILTER_P);
+            } catch (const std::ios_base::failure&) {
+            }
             try {
-                (void)GolombRiceDecode(bitreader, BASIC_FILTER_P);
+                read = reader.Decode(BASIC_FILTER_P);
             } catch (const std::ios_base::failure&) {
             }
+            assert(decoded == read);
+            if (!decoded) break;
         }
     }
 }
@@ -80,6 +80,7 @@ const std::vector<std::string> RPC_COMMANDS_NOT_SAFE_FOR_FUZZING{
     "importwallet", // avoid reading from disk
     "loadwallet",   // avoid reading from disk
     "prioritisetransaction", // avoid signed integer overflow in CTxMemPool::PrioritiseTransaction(uint256 const&, long const&) (https://github.com/bitcoin/bitcoin/issues/20626)
+    "repackblockfiles",      // avoid rewriting and deleting block files
     "savemempool",           // disabled as a precautionary measure: may take a file path argument in the future
     "setban",                // avoid DNS lookups
     "stop",                  // avoid shutdown state
@@ -107,6 +108,9 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "generate",
     "generateblock",
     "getaddednodeinfo",
+    "getaddressbalance",
+    "getaddresshistory",
+    "getaddressutxos",
     "getbestblockhash",
     "getblock",
     "getblockchaininfo",
@@ -128,18 +132,21 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getmempoolancestors",
     "getmempooldescendants",
     "getmempoolentry",
+    "getmempoolfeehistogram",
     "getmempoolinfo",
     "getmininginfo",
     "getnettotals",
     "getnetworkhashps",
     "getnetworkinfo",
     "getnodeaddresses",
+    "getorphaninfo",
     "getpeerinfo",
     "getrawmempool",
     "getrawtransaction",
     "getrpcinfo",
     "gettxout",
     "gettxoutsetinfo",
+    "gettxspendingprevout",
     "help",
     "invalidateblock",
     "joinpsbts",
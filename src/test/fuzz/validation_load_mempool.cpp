@@ -35,5 +35,5 @@ FUZZ_TARGET_INIT(validation_load_mempool, initialize_validation_load_mempool)
         return fuzzed_file_provider.open();
     };
     (void)LoadMempool(pool, g_setup->m_node.chainman->ActiveChainstate(), fuzzed_fopen);
-    (void)DumpMempool(pool, fuzzed_fopen, true);
+    (void)DumpMempool(pool, /*use_v1=*/fuzzed_data_provider.ConsumeBool(), fuzzed_fopen, true);
 }
@@ -145,6 +145,28 @@ BOOST_AUTO_TEST_CASE(siphash)
         BOOST_CHECK_EQUAL(SipHashUint256(k1, k2, x), sip256.Finalize());
         BOOST_CHECK_EQUAL(SipHashUint256Extra(k1, k2, x, n), sip288.Finalize());
     }
+
+    // Check consistency between CSipHasher and SipHashBatch, with runs of
+    // equal and mixed sizes.
+    std::vector<std::vector<unsigned char>> inputs;
+    for (size_t size = 0; size <= 40; ++size) {
+        for (int i = 0; i < 5; ++i) {
+            inputs.push_back(ctx.randbytes(size));
+        }
+        inputs.push_back(ctx.randbytes(ctx.randrange(41)));
+    }
+    std::vector<const unsigned char*> data;
+    std::vector<size_t> sizes;
+    for (const auto& input : inputs) {
+        data.push_back(input.data());
+        sizes.push_back(input.size());
+    }
+    const uint64_t k0 = ctx.rand64(), k1 = ctx.rand64();
+    std::vector<uint64_t> hashes(inputs.size());
+    SipHashBatch(k0, k1, data.data(), sizes.data(), inputs.size(), hashes.data());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        BOOST_CHECK_EQUAL(hashes[i], CSipHasher(k0, k1).Write(inputs[i].data(), inputs[i].size()).Finalize());
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,76 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/util/setup_common.h>
+#include <util/lz4.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using util::LZ4Compress;
+using util::LZ4Decompress;
+
+BOOST_FIXTURE_TEST_SUITE(lz4_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(roundtrip)
+{
+    std::vector<std::vector<uint8_t>> inputs{{}, {42}, std::vector<uint8_t>(12, 7), std::vector<uint8_t>(13, 7), std::vector<uint8_t>(100000, 0)};
+    // Random data, which does not compress
+    std::vector<uint8_t>& random{inputs.emplace_back()};
+    for (int i = 0; i < 5000; ++i) random.push_back(InsecureRandBits(8));
+    // Repeated random snippets at distances up to and beyond the 64 KiB window,
+    // with literal runs and matches of lengths that need length extensions
+    std::vector<uint8_t>& snippets{inputs.emplace_back()};
+    while (snippets.size() < 300000) {
+        const size_t length{1 + InsecureRandRange(600)};
+        if (snippets.size() > length && InsecureRandBool()) {
+            const size_t from{snippets.size() - 1 - InsecureRandRange(std::min<size_t>(snippets.size() - length, 70000))};
+            for (size_t i = 0; i < length; ++i) snippets.push_back(snippets[from + i]);
+        } else {
+            for (size_t i = 0; i < length; ++i) snippets.push_back(InsecureRandBits(2));
+        }
+    }
+
+    for (const std::vector<uint8_t>& input : inputs) {
+        const std::vector<uint8_t> compressed{LZ4Compress(input)};
+        BOOST_CHECK_LE(compressed.size(), input.size() + input.size() / 255 + 16);
+        std::vector<uint8_t> output;
+        BOOST_REQUIRE(LZ4Decompress(compressed, input.size(), output));
+        BOOST_CHECK(output == input);
+        // The size must match.
+        BOOST_CHECK(!LZ4Decompress(compressed, input.size() + 1, output));
+        if (!input.empty()) BOOST_CHECK(!LZ4Decompress(compressed, input.size() - 1, output));
+    }
+    BOOST_CHECK_LT(LZ4Compress(inputs[4]).size(), 500U);
+    BOOST_CHECK_LT(LZ4Compress(snippets).size(), snippets.size() * 3 / 4);
+}
+
+BOOST_AUTO_TEST_CASE(block_format)
+{
+    // Three literals, a back reference of length 15 at distance 3 and five
+    // literals at the end
+    const std::vector<uint8_t> block{0x3b, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'c', 'a', 'b', 'c', 'a'};
+    std::vector<uint8_t> output;
+    BOOST_REQUIRE(LZ4Decompress(block, 23, output));
+    BOOST_CHECK_EQUAL(std::string(output.begin(), output.end()), "abcabcabcabcabcabccabca");
+
+    // Malformed input is rejected: references before the start, truncated
+    // input and lengths beyond the output.
+    const std::vector<std::vector<uint8_t>> malformed{
+        {},
+        {0x3b, 'a', 'b', 'c', 0x04, 0x00, 0x50, 'c', 'a', 'b', 'c', 'a'},
+        {0x3b, 'a', 'b', 'c', 0x00, 0x00, 0x50, 'c', 'a', 'b', 'c', 'a'},
+        {0x3b, 'a', 'b', 'c', 0x03},
+        {0xf0, 0xff},
+        {0x50, 'a', 'b'},
+    };
+    for (const std::vector<uint8_t>& input : malformed) {
+        BOOST_CHECK(!LZ4Decompress(input, 23, output));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
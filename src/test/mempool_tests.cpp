@@ -108,6 +108,160 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     BOOST_CHECK_EQUAL(testPool.size(), 0U);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolRemoveForBlockTest)
+{
+    // Test that removing a block's transactions as one stage leaves correct
+    // ancestor/descendant state on the remaining entries.
+
+    TestMemPoolEntryHelper entry;
+    // Parent transaction with three children, and a grand-child for each child:
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(3);
+    for (int i = 0; i < 3; i++)
+    {
+        txParent.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txParent.vout[i].nValue = 33000LL;
+    }
+    CMutableTransaction txChild[3];
+    CMutableTransaction txGrandChild[3];
+    for (int i = 0; i < 3; i++)
+    {
+        txChild[i].vin.resize(1);
+        txChild[i].vin[0].scriptSig = CScript() << OP_11;
+        txChild[i].vin[0].prevout.hash = txParent.GetHash();
+        txChild[i].vin[0].prevout.n = i;
+        txChild[i].vout.resize(1);
+        txChild[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txChild[i].vout[0].nValue = 11000LL;
+
+        txGrandChild[i].vin.resize(1);
+        txGrandChild[i].vin[0].scriptSig = CScript() << OP_11;
+        txGrandChild[i].vin[0].prevout.hash = txChild[i].GetHash();
+        txGrandChild[i].vin[0].prevout.n = 0;
+        txGrandChild[i].vout.resize(1);
+        txGrandChild[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txGrandChild[i].vout[0].nValue = 11000LL;
+    }
+
+    CTxMemPool testPool;
+    LOCK2(cs_main, testPool.cs);
+
+    testPool.addUnchecked(entry.Fee(1000LL).FromTx(txParent));
+    for (int i = 0; i < 3; i++)
+    {
+        testPool.addUnchecked(entry.Fee(2000LL).FromTx(txChild[i]));
+        testPool.addUnchecked(entry.Fee(4000LL).FromTx(txGrandChild[i]));
+    }
+    BOOST_CHECK_EQUAL(testPool.size(), 7U);
+
+    // Mine the parent and the first two children.
+    std::vector<CTransactionRef> vtx{MakeTransactionRef(txParent), MakeTransactionRef(txChild[0]), MakeTransactionRef(txChild[1])};
+    testPool.removeForBlock(vtx, 1);
+    BOOST_CHECK_EQUAL(testPool.size(), 4U);
+
+    for (int i = 0; i < 2; i++)
+    {
+        const auto it = testPool.GetIter(txGrandChild[i].GetHash()).value();
+        BOOST_CHECK_EQUAL(it->GetCountWithAncestors(), 1U);
+        BOOST_CHECK_EQUAL(it->GetSizeWithAncestors(), it->GetTxSize());
+        BOOST_CHECK_EQUAL(it->GetModFeesWithAncestors(), 4000LL);
+        BOOST_CHECK(it->GetMemPoolParentsConst().empty());
+    }
+    const auto child_it = testPool.GetIter(txChild[2].GetHash()).value();
+    BOOST_CHECK_EQUAL(child_it->GetCountWithAncestors(), 1U);
+    BOOST_CHECK_EQUAL(child_it->GetModFeesWithAncestors(), 2000LL);
+    BOOST_CHECK_EQUAL(child_it->GetCountWithDescendants(), 2U);
+    BOOST_CHECK_EQUAL(child_it->GetModFeesWithDescendants(), 6000LL);
+    const auto grandchild_it = testPool.GetIter(txGrandChild[2].GetHash()).value();
+    BOOST_CHECK_EQUAL(grandchild_it->GetCountWithAncestors(), 2U);
+    BOOST_CHECK_EQUAL(grandchild_it->GetSizeWithAncestors(), grandchild_it->GetTxSize() + child_it->GetTxSize());
+    BOOST_CHECK_EQUAL(grandchild_it->GetModFeesWithAncestors(), 6000LL);
+
+    // Removing several transactions recursively in one stage, one of which
+    // is not in the mempool itself.
+    std::vector<CTransactionRef> vtxRemove{MakeTransactionRef(txChild[0]), MakeTransactionRef(txChild[2])};
+    testPool.removeRecursive(vtxRemove, REMOVAL_REASON_DUMMY);
+    BOOST_CHECK_EQUAL(testPool.size(), 1U);
+    BOOST_CHECK(testPool.exists(GenTxid::Txid(txGrandChild[1].GetHash())));
+}
+
+static FeeHistogram ComputeFeeHistogram(const CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    FeeHistogram histogram{};
+    for (const CTxMemPoolEntry& e : pool.mapTx) {
+        FeeHistogramBucket& bucket = histogram[GetFeeHistogramBucket(e)];
+        ++bucket.count;
+        bucket.vsize += e.GetTxSize();
+        bucket.fees += e.GetModifiedFee();
+    }
+    return histogram;
+}
+
+BOOST_AUTO_TEST_CASE(MempoolFeeHistogramTest)
+{
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(1);
+    txParent.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txParent.vout[0].nValue = 10 * COIN;
+
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].scriptSig = CScript() << OP_11;
+    txChild.vin[0].prevout.hash = txParent.GetHash();
+    txChild.vin[0].prevout.n = 0;
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild.vout[0].nValue = 10 * COIN;
+
+    CTxMemPool testPool;
+    LOCK2(cs_main, testPool.cs);
+
+    // Bucket boundaries are inclusive lower bounds.
+    const CTxMemPoolEntry parent_entry{entry.Fee(0).FromTx(txParent)};
+    const int64_t parent_size = parent_entry.GetTxSize();
+    BOOST_CHECK_EQUAL(GetFeeHistogramBucket(parent_entry), 0U);
+    BOOST_CHECK_EQUAL(GetFeeHistogramBucket(entry.Fee(parent_size - 1).FromTx(txParent)), 0U);
+    BOOST_CHECK_EQUAL(GetFeeHistogramBucket(entry.Fee(parent_size).FromTx(txParent)), 1U);
+    BOOST_CHECK_EQUAL(GetFeeHistogramBucket(entry.Fee(100000 * parent_size).FromTx(txParent)), FEE_HISTOGRAM_BOUNDS.size() - 1);
+    BOOST_CHECK_EQUAL(GetFeeHistogramBucket(entry.Fee(-1000).FromTx(txParent)), 0U);
+
+    testPool.addUnchecked(parent_entry);
+    BOOST_CHECK(testPool.GetFeeHistogram() == ComputeFeeHistogram(testPool));
+    BOOST_CHECK_EQUAL(testPool.GetFeeHistogram()[0].count, 1U);
+    BOOST_CHECK_EQUAL(testPool.GetFeeHistogram()[0].vsize, parent_size);
+
+    // The child pays 20 sat/vB for itself, but is bucketed at its ancestor
+    // feerate, which the zero-fee parent drags down.
+    const CTxMemPoolEntry child_entry{entry.Fee(20 * parent_size).FromTx(txChild)};
+    const int64_t child_size = child_entry.GetTxSize();
+    testPool.addUnchecked(child_entry);
+    BOOST_CHECK(testPool.GetFeeHistogram() == ComputeFeeHistogram(testPool));
+    const size_t child_bucket = GetFeeHistogramBucket(*testPool.GetIter(txChild.GetHash()).value());
+    BOOST_CHECK(FEE_HISTOGRAM_BOUNDS[child_bucket] < 20);
+    BOOST_CHECK_EQUAL(testPool.GetFeeHistogram()[child_bucket].fees, 20 * parent_size);
+    BOOST_CHECK_EQUAL(testPool.GetFeeHistogram()[child_bucket].vsize, child_size);
+
+    // Prioritising the parent moves both entries.
+    testPool.PrioritiseTransaction(txParent.GetHash(), 100 * parent_size);
+    BOOST_CHECK(testPool.GetFeeHistogram() == ComputeFeeHistogram(testPool));
+    BOOST_CHECK_EQUAL(testPool.GetFeeHistogram()[0].count, 0U);
+
+    // Mining the parent leaves the child at its own feerate.
+    testPool.removeForBlock({MakeTransactionRef(txParent)}, 1);
+    BOOST_CHECK(testPool.GetFeeHistogram() == ComputeFeeHistogram(testPool));
+    const FeeHistogram& histogram = testPool.GetFeeHistogram();
+    BOOST_CHECK_EQUAL(histogram[GetFeeHistogramBucket(child_entry)].count, 1U);
+    BOOST_CHECK(FEE_HISTOGRAM_BOUNDS[GetFeeHistogramBucket(child_entry)] >= 15);
+
+    testPool.removeRecursive(CTransaction(txChild), REMOVAL_REASON_DUMMY);
+    BOOST_CHECK(testPool.GetFeeHistogram() == FeeHistogram{});
+}
+
 template<typename name>
 static void CheckSort(CTxMemPool &pool, std::vector<std::string> &sortedOrder) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
 {
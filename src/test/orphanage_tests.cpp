@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <arith_uint256.h>
+#include <core_memusage.h>
 #include <pubkey.h>
 #include <script/sign.h>
 #include <script/signingprovider.h>
@@ -12,6 +13,7 @@
 
 #include <array>
 #include <cstdint>
+#include <limits>
 
 #include <boost/test/unit_test.hpp>
 
@@ -126,12 +128,102 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     }
 
     // Test LimitOrphanTxSize() function:
-    orphanage.LimitOrphans(40);
+    const size_t no_usage_limit{std::numeric_limits<size_t>::max()};
+    orphanage.LimitOrphans(40, no_usage_limit);
     BOOST_CHECK(orphanage.CountOrphans() <= 40);
-    orphanage.LimitOrphans(10);
+    orphanage.LimitOrphans(10, no_usage_limit);
     BOOST_CHECK(orphanage.CountOrphans() <= 10);
-    orphanage.LimitOrphans(0);
+    orphanage.LimitOrphans(0, no_usage_limit);
     BOOST_CHECK(orphanage.CountOrphans() == 0);
 }
 
+static CTransactionRef MakeOrphan(const uint256& parent, uint32_t n, size_t script_size)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(parent, n);
+    tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(script_size, 0);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 1 * CENT;
+    tx.vout[0].scriptPubKey = CScript() << OP_1;
+    return MakeTransactionRef(tx);
+}
+
+BOOST_AUTO_TEST_CASE(orphan_memory_limit)
+{
+    TxOrphanageTest orphanage;
+
+    // Peer 0 floods large orphans, peers 1 and 2 send one small orphan each.
+    for (uint32_t i = 0; i < 20; ++i) {
+        BOOST_CHECK(WITH_LOCK(g_cs_orphans, return orphanage.AddTx(MakeOrphan(InsecureRand256(), i, 10000), /*peer=*/0)));
+    }
+    const CTransactionRef small1{MakeOrphan(InsecureRand256(), 0, 10)};
+    const CTransactionRef small2{MakeOrphan(InsecureRand256(), 0, 10)};
+    BOOST_CHECK(WITH_LOCK(g_cs_orphans, return orphanage.AddTx(small1, /*peer=*/1)));
+    BOOST_CHECK(WITH_LOCK(g_cs_orphans, return orphanage.AddTx(small2, /*peer=*/2)));
+
+    TxOrphanageStats stats{orphanage.GetStats()};
+    BOOST_CHECK_EQUAL(stats.count, 22U);
+    BOOST_CHECK_EQUAL(stats.peers, 3U);
+    BOOST_CHECK(stats.usage > 20 * 10000);
+
+    // Evicting down to half the usage only removes orphans of the flooding peer.
+    const size_t max_usage{stats.usage / 2};
+    BOOST_CHECK(WITH_LOCK(g_cs_orphans, return orphanage.LimitOrphans(/*max_orphans=*/100, max_usage)) > 0);
+    stats = orphanage.GetStats();
+    BOOST_CHECK(stats.usage <= max_usage);
+    BOOST_CHECK(orphanage.HaveTx(GenTxid::Txid(small1->GetHash())));
+    BOOST_CHECK(orphanage.HaveTx(GenTxid::Txid(small2->GetHash())));
+
+    // Erasing by peer releases all of its usage.
+    WITH_LOCK(g_cs_orphans, orphanage.EraseForPeer(0));
+    stats = orphanage.GetStats();
+    BOOST_CHECK_EQUAL(stats.count, 2U);
+    BOOST_CHECK_EQUAL(stats.peers, 2U);
+    BOOST_CHECK_EQUAL(stats.usage, RecursiveDynamicUsage(small1) + RecursiveDynamicUsage(small2));
+
+    WITH_LOCK(g_cs_orphans, orphanage.LimitOrphans(/*max_orphans=*/100, /*max_usage=*/0));
+    stats = orphanage.GetStats();
+    BOOST_CHECK_EQUAL(stats.count, 0U);
+    BOOST_CHECK_EQUAL(stats.usage, 0U);
+    BOOST_CHECK_EQUAL(stats.peers, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(orphan_parent_index)
+{
+    TxOrphanageTest orphanage;
+
+    CMutableTransaction parent;
+    parent.vin.resize(1);
+    parent.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    parent.vout.resize(3);
+    for (auto& out : parent.vout) {
+        out.nValue = 1 * CENT;
+        out.scriptPubKey = CScript() << OP_1;
+    }
+    const CTransaction parent_tx{parent};
+
+    const CTransactionRef child0{MakeOrphan(parent_tx.GetHash(), 0, 10)};
+    const CTransactionRef child2{MakeOrphan(parent_tx.GetHash(), 2, 10)};
+    const CTransactionRef unrelated{MakeOrphan(InsecureRand256(), 0, 10)};
+    BOOST_CHECK(WITH_LOCK(g_cs_orphans, return orphanage.AddTx(child0, /*peer=*/0)));
+    BOOST_CHECK(WITH_LOCK(g_cs_orphans, return orphanage.AddTx(child2, /*peer=*/1)));
+    BOOST_CHECK(WITH_LOCK(g_cs_orphans, return orphanage.AddTx(unrelated, /*peer=*/1)));
+
+    std::set<uint256> work_set;
+    WITH_LOCK(g_cs_orphans, orphanage.AddChildrenToWorkSet(parent_tx, work_set));
+    BOOST_CHECK(work_set == std::set<uint256>({child0->GetHash(), child2->GetHash()}));
+
+    // A block spending the parent's output 0 conflicts with child0 only.
+    CBlock block;
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(parent_tx.GetHash(), 0);
+    block.vtx.push_back(MakeTransactionRef(spend));
+    orphanage.EraseForBlock(block);
+    BOOST_CHECK(!orphanage.HaveTx(GenTxid::Txid(child0->GetHash())));
+    BOOST_CHECK(orphanage.HaveTx(GenTxid::Txid(child2->GetHash())));
+    BOOST_CHECK(orphanage.HaveTx(GenTxid::Txid(unrelated->GetHash())));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,8 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <uint256.h>
 #include <util/time.h>
@@ -178,6 +180,33 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     for (int i = 2; i < 9; i++) { // At 9, the original estimate was already at the bottom (b/c scale = 2)
         BOOST_CHECK(feeEst.estimateFee(i).GetFeePerK() < origFeeEst[i-1] - deltaFee);
     }
+
+    // Repeated smart fee estimates return the same (cached) result
+    for (int i = 1; i < 50; i++) {
+        FeeCalculation feeCalc1, feeCalc2;
+        const CFeeRate smartFee = feeEst.estimateSmartFee(i, &feeCalc1, /*conservative=*/i % 2);
+        BOOST_CHECK(feeEst.estimateSmartFee(i, &feeCalc2, /*conservative=*/i % 2) == smartFee);
+        BOOST_CHECK_EQUAL(feeCalc1.desiredTarget, i);
+        BOOST_CHECK_EQUAL(feeCalc1.returnedTarget, feeCalc2.returnedTarget);
+        BOOST_CHECK(feeCalc1.reason == feeCalc2.reason);
+    }
+
+    // Estimates survive writing and reading the estimates file
+    const fs::path est_path = m_path_root / "fee_estimates_test.dat";
+    {
+        CAutoFile est_file(fsbridge::fopen(est_path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEst.Write(est_file));
+    }
+    CBlockPolicyEstimator feeEstRead;
+    {
+        CAutoFile est_file(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEstRead.Read(est_file));
+    }
+    for (const FeeEstimateHorizon horizon : ALL_FEE_ESTIMATE_HORIZONS) {
+        for (unsigned int i = 1; i <= feeEst.HighestTargetTracked(horizon); i++) {
+            BOOST_CHECK(feeEstRead.estimateRawFee(i, 0.85, horizon) == feeEst.estimateRawFee(i, 0.85, horizon));
+        }
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
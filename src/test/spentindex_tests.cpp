@@ -0,0 +1,64 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <index/spentindex.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(spentindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(spentindex_initial_sync, TestChain100Setup)
+{
+    SpentIndex spent_index(1 << 20, true);
+    SpentIndexEntry entry;
+
+    // Spend the first two coinbase outputs before the index is started.
+    const CScript script = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
+    const CMutableTransaction spend_a = CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 0, coinbaseKey, script, 49 * COIN, /*submit=*/false);
+    CreateAndProcessBlock({spend_a}, script);
+    const int height_a = WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Height());
+
+    BOOST_CHECK(!spent_index.FindSpend(COutPoint(m_coinbase_txns[0]->GetHash(), 0), entry));
+    BOOST_REQUIRE(spent_index.Start(m_node.chainman->ActiveChainstate()));
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!spent_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    BOOST_REQUIRE(spent_index.FindSpend(COutPoint(m_coinbase_txns[0]->GetHash(), 0), entry));
+    BOOST_CHECK(entry.txid == spend_a.GetHash());
+    BOOST_CHECK_EQUAL(entry.vin, 0U);
+    BOOST_CHECK_EQUAL(entry.height, height_a);
+    BOOST_CHECK(entry.block_hash == WITH_LOCK(cs_main, return m_node.chainman->ActiveChain()[height_a]->GetBlockHash()));
+
+    // Unspent outputs are not found.
+    BOOST_CHECK(!spent_index.FindSpend(COutPoint(m_coinbase_txns[1]->GetHash(), 0), entry));
+    BOOST_CHECK(!spent_index.FindSpend(COutPoint(spend_a.GetHash(), 0), entry));
+
+    // Spends in new blocks make it into the index.
+    const CMutableTransaction spend_b = CreateValidMempoolTransaction(MakeTransactionRef(spend_a), 0, height_a, coinbaseKey, script, 48 * COIN, /*submit=*/false);
+    CreateAndProcessBlock({spend_b}, script);
+    BOOST_CHECK(spent_index.BlockUntilSyncedToCurrentChain());
+    BOOST_REQUIRE(spent_index.FindSpend(COutPoint(spend_a.GetHash(), 0), entry));
+    BOOST_CHECK(entry.txid == spend_b.GetHash());
+    BOOST_CHECK_EQUAL(entry.height, height_a + 1);
+    BOOST_CHECK(entry.block_hash == WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip()->GetBlockHash()));
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    spent_index.Stop();
+
+    // Let scheduler events finish running to avoid accessing any memory related to the index after it is destructed
+    SyncWithValidationInterfaceQueue();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <clientversion.h>
+#include <coins.h>
+#include <node/blockstorage.h>
+#include <node/coinstats.h>
+#include <node/utxo_snapshot.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <uint256.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using node::CCoinsStats;
+using node::CoinStatsHashType;
+using node::LoadChunkedSnapshot;
+using node::SnapshotMetadata;
+using node::WriteChunkedSnapshot;
+
+namespace {
+
+struct SnapshotSetup : public BasicTestingSetup {
+    const uint256 m_base_blockhash{InsecureRand256()};
+    node::BlockManager m_blockman;
+    CCoinsViewDB m_source{"source", 1 << 20, /*fMemory=*/true, /*fWipe=*/false};
+    std::map<COutPoint, Coin> m_coins;
+
+    SnapshotSetup()
+    {
+        CCoinsViewCache cache{&m_source};
+        for (int i = 0; i < 2000; ++i) {
+            const uint256 txid{InsecureRand256()};
+            // Several outputs of the same transaction, to exercise the per
+            // transaction grouping of HASH_SERIALIZED.
+            for (uint32_t n = 0, outputs = 1 + InsecureRandRange(3); n < outputs; ++n) {
+                const COutPoint outpoint{txid, n * 7};
+                Coin coin{CTxOut{static_cast<CAmount>(InsecureRandRange(1000000)), CScript() << OP_TRUE << static_cast<int64_t>(InsecureRandRange(100))},
+                          static_cast<int>(InsecureRandRange(100)), InsecureRandBool()};
+                m_coins.emplace(outpoint, coin);
+                cache.AddCoin(outpoint, std::move(coin), /*possible_overwrite=*/false);
+            }
+        }
+        cache.SetBestBlock(m_base_blockhash);
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    uint256 HashSerialized(CCoinsViewDB& view)
+    {
+        CBlockIndex index;
+        index.phashBlock = &m_base_blockhash;
+        CCoinsStats stats{CoinStatsHashType::HASH_SERIALIZED};
+        BOOST_REQUIRE(GetUTXOStats(&view, m_blockman, stats, [] {}, &index));
+        return stats.hashSerialized;
+    }
+
+    fs::path WriteSnapshot(uint32_t chunk_count, int threads)
+    {
+        const fs::path path{m_args.GetDataDirBase() / "snapshot.dat"};
+        CAutoFile file{fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION};
+        std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+        for (int i = 0; i < threads; ++i) cursors.push_back(m_source.Cursor());
+        SnapshotMetadata metadata{m_base_blockhash, 0, 0};
+        uint256 hash_serialized;
+        BOOST_REQUIRE(WriteChunkedSnapshot(cursors, file, chunk_count, metadata, hash_serialized, [] {}));
+        BOOST_CHECK_EQUAL(metadata.m_coins_count, m_coins.size());
+        BOOST_CHECK_EQUAL(metadata.m_chunks.size(), chunk_count);
+        BOOST_CHECK(hash_serialized == HashSerialized(m_source));
+        return path;
+    }
+
+    /** Load a snapshot into a new database and return it if the load succeeds. */
+    std::unique_ptr<CCoinsViewDB> LoadSnapshot(const fs::path& path, int threads)
+    {
+        CAutoFile file{fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION};
+        SnapshotMetadata metadata;
+        file >> metadata;
+        BOOST_CHECK(metadata.m_base_blockhash == m_base_blockhash);
+        auto coinsdb{std::make_unique<CCoinsViewDB>("loaded", 1 << 20, /*fMemory=*/true, /*fWipe=*/false)};
+        uint256 hash_serialized;
+        if (!LoadChunkedSnapshot(file, metadata, /*base_height=*/100, *coinsdb, threads, hash_serialized)) return nullptr;
+
+        CCoinsViewCache cache{coinsdb.get()};
+        cache.SetBestBlock(m_base_blockhash);
+        BOOST_REQUIRE(cache.Flush());
+        BOOST_CHECK(hash_serialized == HashSerialized(*coinsdb));
+        BOOST_CHECK(hash_serialized == HashSerialized(m_source));
+        return coinsdb;
+    }
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(utxo_snapshot_tests, SnapshotSetup)
+
+BOOST_AUTO_TEST_CASE(metadata_serialization)
+{
+    // Unchunked snapshots keep their original metadata format.
+    SnapshotMetadata metadata{m_base_blockhash, 42, 0};
+    CDataStream ss{SER_DISK, CLIENT_VERSION};
+    ss << metadata;
+    BOOST_CHECK_EQUAL(ss.size(), 32U + 8U);
+
+    metadata.m_chunks.resize(3);
+    metadata.m_chunks[1].m_begin = node::SnapshotChunkBegin(1, 3);
+    ss.clear();
+    ss << metadata;
+    SnapshotMetadata read;
+    ss >> read;
+    BOOST_CHECK(read.m_base_blockhash == m_base_blockhash);
+    BOOST_CHECK_EQUAL(read.m_coins_count, 42U);
+    BOOST_REQUIRE_EQUAL(read.m_chunks.size(), 3U);
+    BOOST_CHECK(read.m_chunks[1].m_begin == metadata.m_chunks[1].m_begin);
+}
+
+BOOST_AUTO_TEST_CASE(write_and_load)
+{
+    for (const auto& [chunk_count, threads] : std::vector<std::pair<uint32_t, int>>{{1, 1}, {7, 1}, {7, 4}, {64, 3}}) {
+        const fs::path path{WriteSnapshot(chunk_count, threads)};
+        const auto loaded{LoadSnapshot(path, threads)};
+        BOOST_REQUIRE(loaded);
+        for (const auto& [outpoint, coin] : m_coins) {
+            Coin loaded_coin;
+            BOOST_REQUIRE(loaded->GetCoin(outpoint, loaded_coin));
+            BOOST_CHECK(loaded_coin.out == coin.out);
+            BOOST_CHECK_EQUAL(loaded_coin.nHeight, coin.nHeight);
+            BOOST_CHECK_EQUAL(loaded_coin.fCoinBase, coin.fCoinBase);
+        }
+        fs::remove(path);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(load_corrupted)
+{
+    const fs::path path{WriteSnapshot(/*chunk_count=*/8, /*threads=*/2)};
+    std::vector<unsigned char> data;
+    {
+        CAutoFile file{fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION};
+        data.resize(fs::file_size(path));
+        file.read(MakeWritableByteSpan(data));
+    }
+    const auto write_and_load = [&](const std::vector<unsigned char>& contents) {
+        {
+            CAutoFile file{fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION};
+            file.write(MakeByteSpan(contents));
+        }
+        return LoadSnapshot(path, /*threads=*/3) != nullptr;
+    };
+    BOOST_CHECK(write_and_load(data));
+
+    // A flipped bit in the coins of a chunk
+    std::vector<unsigned char> corrupted{data};
+    corrupted[corrupted.size() - 10] ^= 1;
+    BOOST_CHECK(!write_and_load(corrupted));
+
+    // Truncated and extended files
+    BOOST_CHECK(!write_and_load({data.begin(), data.end() - 1}));
+    corrupted = data;
+    corrupted.push_back(0);
+    BOOST_CHECK(!write_and_load(corrupted));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
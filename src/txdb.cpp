@@ -71,7 +71,7 @@ struct CoinEntry {
 } // namespace
 
 CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) :
-    m_db(std::make_unique<CDBWrapper>(ldb_path, nCacheSize, fMemory, fWipe, true)),
+    m_db(std::make_unique<CDBWrapper>(ldb_path, nCacheSize, fMemory, fWipe, true, GetDBTuning(gArgs, "chainstate"))),
     m_ldb_path(ldb_path),
     m_is_memory(fMemory) { }
 
@@ -84,7 +84,7 @@ void CCoinsViewDB::ResizeCache(size_t new_cache_size)
         // filesystem lock.
         m_db.reset();
         m_db = std::make_unique<CDBWrapper>(
-            m_ldb_path, new_cache_size, m_is_memory, /*fWipe=*/false, /*obfuscate=*/true);
+            m_ldb_path, new_cache_size, m_is_memory, /*fWipe=*/false, /*obfuscate=*/true, GetDBTuning(gArgs, "chainstate"));
     }
 }
 
@@ -172,12 +172,26 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::WriteCoins(Span<const std::pair<COutPoint, Coin>> coins)
+{
+    CDBBatch batch(*m_db);
+    const size_t batch_size = (size_t)gArgs.GetIntArg("-dbbatchsize", nDefaultDbBatchSize);
+    for (const auto& [outpoint, coin] : coins) {
+        batch.Write(CoinEntry(&outpoint), coin);
+        if (batch.SizeEstimate() > batch_size) {
+            if (!m_db->WriteBatch(batch)) return false;
+            batch.Clear();
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return m_db->EstimateSize(DB_COIN, uint8_t(DB_COIN + 1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.GetDataDirNet() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.GetDataDirNet() / "blocks" / "index", nCacheSize, fMemory, fWipe, /*obfuscate=*/false, GetDBTuning(gArgs, "blockindex")) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -199,6 +213,25 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
     return Read(DB_LAST_BLOCK, nFile);
 }
 
+// The snapshot id follows the last block file number in DB_LAST_BLOCK. Every
+// block index flush rewrites that entry with the number alone, including the
+// flushes of software that does not know about snapshots and reads the number
+// only, so any change to the database since the snapshot drops its id.
+bool CBlockTreeDB::WriteIndexSnapshotId(std::optional<uint64_t> id)
+{
+    int last_file;
+    if (!ReadLastBlockFile(last_file)) return false;
+    if (id) return Write(DB_LAST_BLOCK, std::make_pair(last_file, *id), /*fSync=*/true);
+    return Write(DB_LAST_BLOCK, last_file, /*fSync=*/true);
+}
+
+std::optional<uint64_t> CBlockTreeDB::ReadIndexSnapshotId()
+{
+    std::pair<int, uint64_t> last_file_and_id;
+    if (!Read(DB_LAST_BLOCK, last_file_and_id)) return std::nullopt;
+    return last_file_and_id.second;
+}
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
@@ -215,6 +248,7 @@ public:
 
     bool Valid() const override;
     void Next() override;
+    void Seek(const COutPoint& start) override;
 
 private:
     std::unique_ptr<CDBIterator> pcursor;
@@ -278,6 +312,17 @@ void CCoinsViewDBCursor::Next()
     }
 }
 
+void CCoinsViewDBCursor::Seek(const COutPoint& start)
+{
+    pcursor->Seek(CoinEntry(&start));
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
+        keyTmp.first = 0;
+    } else {
+        keyTmp.first = entry.key;
+    }
+}
+
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
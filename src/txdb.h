@@ -8,6 +8,7 @@
 
 #include <coins.h>
 #include <dbwrapper.h>
+#include <span.h>
 
 #include <memory>
 #include <optional>
@@ -39,6 +40,10 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! Max memory allocated to address index DB specific cache (MiB)
+static const int64_t max_address_index_cache = 1024;
+//! Max memory allocated to spent index DB specific cache (MiB)
+static const int64_t max_spent_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -65,6 +70,11 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
 
+    //! Write coins straight to the database, bypassing the coins cache and the
+    //! best block markers. May be called from several threads at once, which
+    //! is how UTXO snapshots are bulk loaded.
+    bool WriteCoins(Span<const std::pair<COutPoint, Coin>> coins);
+
     //! Whether an unsupported database format is used.
     bool NeedsUpgrade();
     size_t EstimateSize() const override;
@@ -86,6 +96,9 @@ public:
     void ReadReindexing(bool &fReindexing);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    //! Record (or with std::nullopt, forget) the id of the block index snapshot matching this database
+    bool WriteIndexSnapshotId(std::optional<uint64_t> id);
+    std::optional<uint64_t> ReadIndexSnapshotId();
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 };
@@ -19,6 +19,7 @@
 #include <util/time.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <cmath>
 #include <optional>
 
@@ -144,7 +145,9 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendan
             modifyCount++;
             cachedDescendants[updateIt].insert(mapTx.iterator_to(descendant));
             // Update ancestor state for each descendant
+            UpdateFeeHistogram(descendant, false);
             mapTx.modify(mapTx.iterator_to(descendant), update_ancestor_state(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCost()));
+            UpdateFeeHistogram(descendant, true);
             // Don't directly remove the transaction here -- doing so would
             // invalidate iterators in cachedDescendants. Mark it for removal
             // by inserting into descendants_to_remove.
@@ -371,10 +374,49 @@ void CTxMemPool::UpdateChildrenForRemoval(txiter it)
     }
 }
 
+size_t GetFeeHistogramBucket(const CTxMemPoolEntry& entry)
+{
+    // Compare fee >= bound * size rather than dividing, so that entries right
+    // at a bucket boundary are placed consistently.
+    const CAmount fee{entry.GetModFeesWithAncestors()};
+    const int64_t size{int64_t(entry.GetSizeWithAncestors())};
+    const auto it = std::upper_bound(FEE_HISTOGRAM_BOUNDS.begin() + 1, FEE_HISTOGRAM_BOUNDS.end(), fee,
+        [size](CAmount f, CAmount bound) { return f < bound * size; });
+    return std::distance(FEE_HISTOGRAM_BOUNDS.begin(), it) - 1;
+}
+
+void CTxMemPool::UpdateFeeHistogram(const CTxMemPoolEntry& entry, bool add)
+{
+    FeeHistogramBucket& bucket = m_fee_histogram[GetFeeHistogramBucket(entry)];
+    if (add) {
+        ++bucket.count;
+        bucket.vsize += entry.GetTxSize();
+        bucket.fees += entry.GetModifiedFee();
+    } else {
+        assert(bucket.count > 0);
+        --bucket.count;
+        bucket.vsize -= entry.GetTxSize();
+        bucket.fees -= entry.GetModifiedFee();
+    }
+}
+
 void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants)
 {
-    // For each entry, walk back all ancestors and decrement size associated with this
-    // transaction
+    // Changes to the ancestor/descendant state of the entries that remain in
+    // the mempool are accumulated first and applied once per entry afterwards.
+    // Every mapTx.modify() re-sorts the entry in the score indexes, so when a
+    // whole block is removed at once, this turns one modification per
+    // (removed tx, surviving relative) pair into one per surviving relative.
+    // Entries that are themselves being removed are not updated at all.
+    struct StateDelta {
+        int64_t size{0};
+        CAmount fee{0};
+        int64_t count{0};
+        int64_t sigops{0};
+    };
+    std::map<txiter, StateDelta, CompareIteratorByHash> ancestor_deltas;
+    std::map<txiter, StateDelta, CompareIteratorByHash> descendant_deltas;
+
     const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
     if (updateDescendants) {
         // updateDescendants should be true whenever we're not recursively
@@ -386,15 +428,19 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         for (txiter removeIt : entriesToRemove) {
             setEntries setDescendants;
             CalculateDescendants(removeIt, setDescendants);
-            setDescendants.erase(removeIt); // don't update state for self
-            int64_t modifySize = -((int64_t)removeIt->GetTxSize());
-            CAmount modifyFee = -removeIt->GetModifiedFee();
-            int modifySigOps = -removeIt->GetSigOpCost();
             for (txiter dit : setDescendants) {
-                mapTx.modify(dit, update_ancestor_state(modifySize, modifyFee, -1, modifySigOps));
+                // don't update state for self or any other entry being removed
+                if (entriesToRemove.count(dit)) continue;
+                StateDelta& delta = ancestor_deltas[dit];
+                delta.size -= removeIt->GetTxSize();
+                delta.fee -= removeIt->GetModifiedFee();
+                delta.count -= 1;
+                delta.sigops -= removeIt->GetSigOpCost();
             }
         }
     }
+    // For each entry, walk back all ancestors and decrement size associated with this
+    // transaction
     for (txiter removeIt : entriesToRemove) {
         setEntries setAncestors;
         const CTxMemPoolEntry &entry = *removeIt;
@@ -419,9 +465,26 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // we use the cached notion of ancestor transactions as the set of
         // things to update for removal.
         CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
-        // Note that UpdateAncestorsOf severs the child links that point to
-        // removeIt in the entries for the parents of removeIt.
-        UpdateAncestorsOf(false, removeIt, setAncestors);
+        // Sever the child links that point to removeIt in the entries for the
+        // parents of removeIt.
+        for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) {
+            UpdateChild(mapTx.iterator_to(parent), removeIt, false);
+        }
+        for (txiter ancestorIt : setAncestors) {
+            if (entriesToRemove.count(ancestorIt)) continue;
+            StateDelta& delta = descendant_deltas[ancestorIt];
+            delta.size -= removeIt->GetTxSize();
+            delta.fee -= removeIt->GetModifiedFee();
+            delta.count -= 1;
+        }
+    }
+    for (const auto& [it, delta] : ancestor_deltas) {
+        UpdateFeeHistogram(*it, false);
+        mapTx.modify(it, update_ancestor_state(delta.size, delta.fee, delta.count, delta.sigops));
+        UpdateFeeHistogram(*it, true);
+    }
+    for (const auto& [it, delta] : descendant_deltas) {
+        mapTx.modify(it, update_descendant_state(delta.size, delta.fee, delta.count));
     }
     // After updating all the ancestor sizes, we can now sever the link between each
     // transaction being removed and any mempool children (ie, update CTxMemPoolEntry::m_parents
@@ -511,6 +574,7 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     }
     UpdateAncestorsOf(true, newit, setAncestors);
     UpdateEntryForAncestors(newit, setAncestors);
+    UpdateFeeHistogram(*newit, true);
 
     nTransactionsUpdated++;
     totalTxSize += entry.GetTxSize();
@@ -556,6 +620,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     m_total_fee -= it->GetFee();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+    UpdateFeeHistogram(*it, false);
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
@@ -591,34 +656,45 @@ void CTxMemPool::CalculateDescendants(txiter entryit, setEntries& setDescendants
     }
 }
 
+void CTxMemPool::StageRecursiveRemoval(const CTransaction& origTx, setEntries& setAllRemoves) const
+{
+    AssertLockHeld(cs);
+    txiter origit = mapTx.find(origTx.GetHash());
+    if (origit != mapTx.end()) {
+        CalculateDescendants(origit, setAllRemoves);
+        return;
+    }
+    // When recursively removing but origTx isn't in the mempool
+    // be sure to remove any children that are in the pool. This can
+    // happen during chain re-orgs if origTx isn't re-accepted into
+    // the mempool for any reason.
+    for (unsigned int i = 0; i < origTx.vout.size(); i++) {
+        auto it = mapNextTx.find(COutPoint(origTx.GetHash(), i));
+        if (it == mapNextTx.end())
+            continue;
+        txiter nextit = mapTx.find(it->second->GetHash());
+        assert(nextit != mapTx.end());
+        CalculateDescendants(nextit, setAllRemoves);
+    }
+}
+
 void CTxMemPool::removeRecursive(const CTransaction &origTx, MemPoolRemovalReason reason)
 {
     // Remove transaction from memory pool
     AssertLockHeld(cs);
-        setEntries txToRemove;
-        txiter origit = mapTx.find(origTx.GetHash());
-        if (origit != mapTx.end()) {
-            txToRemove.insert(origit);
-        } else {
-            // When recursively removing but origTx isn't in the mempool
-            // be sure to remove any children that are in the pool. This can
-            // happen during chain re-orgs if origTx isn't re-accepted into
-            // the mempool for any reason.
-            for (unsigned int i = 0; i < origTx.vout.size(); i++) {
-                auto it = mapNextTx.find(COutPoint(origTx.GetHash(), i));
-                if (it == mapNextTx.end())
-                    continue;
-                txiter nextit = mapTx.find(it->second->GetHash());
-                assert(nextit != mapTx.end());
-                txToRemove.insert(nextit);
-            }
-        }
-        setEntries setAllRemoves;
-        for (txiter it : txToRemove) {
-            CalculateDescendants(it, setAllRemoves);
-        }
+    setEntries setAllRemoves;
+    StageRecursiveRemoval(origTx, setAllRemoves);
+    RemoveStaged(setAllRemoves, false, reason);
+}
 
-        RemoveStaged(setAllRemoves, false, reason);
+void CTxMemPool::removeRecursive(const std::vector<CTransactionRef>& txs, MemPoolRemovalReason reason)
+{
+    AssertLockHeld(cs);
+    setEntries setAllRemoves;
+    for (const CTransactionRef& tx : txs) {
+        StageRecursiveRemoval(*tx, setAllRemoves);
+    }
+    RemoveStaged(setAllRemoves, false, reason);
 }
 
 void CTxMemPool::removeForReorg(CChain& chain, std::function<bool(txiter)> check_final_and_mature)
@@ -665,24 +741,25 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
 {
     AssertLockHeld(cs);
     std::vector<const CTxMemPoolEntry*> entries;
+    setEntries stage;
     for (const auto& tx : vtx)
     {
         uint256 hash = tx->GetHash();
 
         indexed_transaction_set::iterator i = mapTx.find(hash);
-        if (i != mapTx.end())
+        if (i != mapTx.end()) {
             entries.push_back(&*i);
+            stage.insert(i);
+        }
     }
     // Before the txs in the new block have been removed from the mempool, update policy estimates
     if (minerPolicyEstimator) {minerPolicyEstimator->processBlock(nBlockHeight, entries);}
+    // All in-mempool ancestors of a transaction in a valid block are in the
+    // block as well, so the block's transactions can be removed as a single
+    // stage: surviving descendants get one aggregated ancestor state update.
+    RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
     for (const auto& tx : vtx)
     {
-        txiter it = mapTx.find(tx->GetHash());
-        if (it != mapTx.end()) {
-            setEntries stage;
-            stage.insert(it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
-        }
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
     }
@@ -698,6 +775,7 @@ void CTxMemPool::_clear()
     totalTxSize = 0;
     m_total_fee = 0;
     cachedInnerUsage = 0;
+    m_fee_histogram = {};
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
@@ -816,6 +894,15 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
     assert(totalTxSize == checkTotal);
     assert(m_total_fee == check_total_fee);
     assert(innerUsage == cachedInnerUsage);
+
+    FeeHistogram check_histogram{};
+    for (const CTxMemPoolEntry& entry : mapTx) {
+        FeeHistogramBucket& bucket = check_histogram[GetFeeHistogramBucket(entry)];
+        ++bucket.count;
+        bucket.vsize += entry.GetTxSize();
+        bucket.fees += entry.GetModifiedFee();
+    }
+    assert(check_histogram == m_fee_histogram);
 }
 
 bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb, bool wtxid)
@@ -920,7 +1007,9 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
         delta += nFeeDelta;
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
+            UpdateFeeHistogram(*it, false);
             mapTx.modify(it, [&delta](CTxMemPoolEntry& e) { e.UpdateFeeDelta(delta); });
+            UpdateFeeHistogram(*it, true);
             // Now update all ancestors' modified fees with descendants
             setEntries setAncestors;
             uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -934,7 +1023,9 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
             CalculateDescendants(it, setDescendants);
             setDescendants.erase(it);
             for (txiter descendantIt : setDescendants) {
+                UpdateFeeHistogram(*descendantIt, false);
                 mapTx.modify(descendantIt, update_ancestor_state(0, nFeeDelta, 0, 0));
+                UpdateFeeHistogram(*descendantIt, true);
             }
             ++nTransactionsUpdated;
         }
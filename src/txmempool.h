@@ -6,6 +6,7 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <array>
 #include <atomic>
 #include <map>
 #include <optional>
@@ -353,6 +354,28 @@ enum class MemPoolRemovalReason {
     REPLACED,    //!< Removed for replacement
 };
 
+/** Lower bounds, in sat/vB, of the buckets of the mempool feerate histogram. */
+static constexpr std::array<CAmount, 35> FEE_HISTOGRAM_BOUNDS{
+    0, 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 25, 30, 40, 50, 60, 80, 100, 120,
+    150, 200, 250, 300, 400, 500, 600, 800, 1000, 1200, 1500, 2000, 3000, 5000, 10000};
+
+/** Totals of the mempool entries whose ancestor feerate falls in one histogram bucket. */
+struct FeeHistogramBucket {
+    uint64_t count{0}; //!< number of transactions
+    int64_t vsize{0};  //!< sum of the transactions' own virtual sizes
+    CAmount fees{0};   //!< sum of the transactions' own modified fees
+
+    bool operator==(const FeeHistogramBucket& other) const
+    {
+        return count == other.count && vsize == other.vsize && fees == other.fees;
+    }
+};
+
+using FeeHistogram = std::array<FeeHistogramBucket, FEE_HISTOGRAM_BOUNDS.size()>;
+
+/** Index into FEE_HISTOGRAM_BOUNDS of the bucket an entry's ancestor feerate falls in. */
+size_t GetFeeHistogramBucket(const CTxMemPoolEntry& entry);
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -436,6 +459,7 @@ protected:
     uint64_t totalTxSize GUARDED_BY(cs);      //!< sum of all mempool tx's virtual sizes. Differs from serialized tx size since witness data is discounted. Defined in BIP 141.
     CAmount m_total_fee GUARDED_BY(cs);       //!< sum of all mempool tx's fees (NOT modified fee)
     uint64_t cachedInnerUsage GUARDED_BY(cs); //!< sum of dynamic memory usage of all the map elements (NOT the maps themselves)
+    FeeHistogram m_fee_histogram GUARDED_BY(cs); //!< entries bucketed by ancestor feerate, see FEE_HISTOGRAM_BOUNDS
 
     mutable int64_t lastRollingFeeUpdate GUARDED_BY(cs);
     mutable bool blockSinceLastRollingFeeBump GUARDED_BY(cs);
@@ -589,6 +613,9 @@ public:
     void addUnchecked(const CTxMemPoolEntry& entry, setEntries& setAncestors, bool validFeeEstimate = true) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
 
     void removeRecursive(const CTransaction& tx, MemPoolRemovalReason reason) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Remove several transactions (or, for those not in the mempool, their
+     *  in-mempool children) and all their descendants as a single stage. */
+    void removeRecursive(const std::vector<CTransactionRef>& txs, MemPoolRemovalReason reason) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** After reorg, filter the entries that would no longer be valid in the next block, and update
      * the entries' cached LockPoints if needed.  The mempool does not have any knowledge of
      * consensus rules. It just appplies the callable function and removes the ones for which it
@@ -744,6 +771,13 @@ public:
         return m_total_fee;
     }
 
+    /** Histogram of the mempool by ancestor feerate, maintained incrementally. */
+    const FeeHistogram& GetFeeHistogram() const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        AssertLockHeld(cs);
+        return m_fee_histogram;
+    }
+
     bool exists(const GenTxid& gtxid) const
     {
         LOCK(cs);
@@ -843,8 +877,14 @@ private:
       * If updateDescendants is true, then also update in-mempool descendants'
       * ancestor state. */
     void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Add tx (or its in-mempool children if tx itself is not in the mempool)
+     *  and all their descendants to setAllRemoves. */
+    void StageRecursiveRemoval(const CTransaction& tx, setEntries& setAllRemoves) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** Sever link between specified transaction and direct children. */
     void UpdateChildrenForRemoval(txiter entry) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Add or remove an entry's contribution to m_fee_histogram. Must bracket
+     *  every change to an in-mempool entry's ancestor state or modified fee. */
+    void UpdateFeeHistogram(const CTxMemPoolEntry& entry, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     /** Before calling removeUnchecked for a given transaction,
      *  UpdateForRemoveFromMempool must be called on the entire (dependent) set
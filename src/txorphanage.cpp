@@ -5,9 +5,11 @@
 #include <txorphanage.h>
 
 #include <consensus/validation.h>
+#include <core_memusage.h>
 #include <logging.h>
 #include <policy/policy.h>
 
+#include <algorithm>
 #include <cassert>
 
 /** Expiration time for orphan transactions in seconds */
@@ -39,17 +41,22 @@ bool TxOrphanage::AddTx(const CTransactionRef& tx, NodeId peer)
         return false;
     }
 
-    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, m_orphan_list.size()});
+    PeerOrphans& peer_orphans = m_peer_orphans[peer];
+    const size_t usage{RecursiveDynamicUsage(tx)};
+    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, peer_orphans.orphans.size(), usage});
     assert(ret.second);
-    m_orphan_list.push_back(ret.first);
+    peer_orphans.orphans.push_back(ret.first);
+    peer_orphans.usage += usage;
+    m_total_usage += usage;
     // Allow for lookups in the orphan pool by wtxid, as well as txid
     m_wtxid_to_orphan_it.emplace(tx->GetWitnessHash(), ret.first);
     for (const CTxIn& txin : tx->vin) {
         m_outpoint_to_orphan_it[txin.prevout].insert(ret.first);
+        m_parent_to_orphan_it[txin.prevout.hash].insert(ret.first);
     }
 
-    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u)\n", hash.ToString(),
-             m_orphans.size(), m_outpoint_to_orphan_it.size());
+    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u usage %u)\n", hash.ToString(),
+             m_orphans.size(), m_outpoint_to_orphan_it.size(), m_total_usage);
     return true;
 }
 
@@ -61,24 +68,36 @@ int TxOrphanage::EraseTx(const uint256& txid)
         return 0;
     for (const CTxIn& txin : it->second.tx->vin)
     {
-        auto itPrev = m_outpoint_to_orphan_it.find(txin.prevout);
-        if (itPrev == m_outpoint_to_orphan_it.end())
+        auto itOut = m_outpoint_to_orphan_it.find(txin.prevout);
+        if (itOut != m_outpoint_to_orphan_it.end()) {
+            itOut->second.erase(it);
+            if (itOut->second.empty())
+                m_outpoint_to_orphan_it.erase(itOut);
+        }
+        auto itPrev = m_parent_to_orphan_it.find(txin.prevout.hash);
+        if (itPrev == m_parent_to_orphan_it.end())
             continue;
         itPrev->second.erase(it);
         if (itPrev->second.empty())
-            m_outpoint_to_orphan_it.erase(itPrev);
+            m_parent_to_orphan_it.erase(itPrev);
     }
 
+    auto peer_it = m_peer_orphans.find(it->second.fromPeer);
+    assert(peer_it != m_peer_orphans.end());
+    std::vector<OrphanMap::iterator>& orphan_list = peer_it->second.orphans;
     size_t old_pos = it->second.list_pos;
-    assert(m_orphan_list[old_pos] == it);
-    if (old_pos + 1 != m_orphan_list.size()) {
-        // Unless we're deleting the last entry in m_orphan_list, move the last
-        // entry to the position we're deleting.
-        auto it_last = m_orphan_list.back();
-        m_orphan_list[old_pos] = it_last;
+    assert(orphan_list[old_pos] == it);
+    if (old_pos + 1 != orphan_list.size()) {
+        // Unless we're deleting the last entry in the peer's list, move the
+        // last entry to the position we're deleting.
+        auto it_last = orphan_list.back();
+        orphan_list[old_pos] = it_last;
         it_last->second.list_pos = old_pos;
     }
-    m_orphan_list.pop_back();
+    orphan_list.pop_back();
+    peer_it->second.usage -= it->second.usage;
+    if (orphan_list.empty()) m_peer_orphans.erase(peer_it);
+    m_total_usage -= it->second.usage;
     m_wtxid_to_orphan_it.erase(it->second.tx->GetWitnessHash());
 
     m_orphans.erase(it);
@@ -90,19 +109,17 @@ void TxOrphanage::EraseForPeer(NodeId peer)
     AssertLockHeld(g_cs_orphans);
 
     int nErased = 0;
-    std::map<uint256, OrphanTx>::iterator iter = m_orphans.begin();
-    while (iter != m_orphans.end())
-    {
-        std::map<uint256, OrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
-        {
-            nErased += EraseTx(maybeErase->second.tx->GetHash());
-        }
+    auto peer_it = m_peer_orphans.find(peer);
+    if (peer_it == m_peer_orphans.end()) return;
+    // Copy the list, as erasing the last orphan also erases the peer's entry.
+    const std::vector<OrphanMap::iterator> orphans{peer_it->second.orphans};
+    for (const auto& it : orphans) {
+        nErased += EraseTx(it->first);
     }
     if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer=%d\n", nErased, peer);
 }
 
-unsigned int TxOrphanage::LimitOrphans(unsigned int max_orphans)
+unsigned int TxOrphanage::LimitOrphans(unsigned int max_orphans, size_t max_usage)
 {
     AssertLockHeld(g_cs_orphans);
 
@@ -128,11 +145,15 @@ unsigned int TxOrphanage::LimitOrphans(unsigned int max_orphans)
         if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
     }
     FastRandomContext rng;
-    while (m_orphans.size() > max_orphans)
+    while (m_orphans.size() > max_orphans || m_total_usage > max_usage)
     {
-        // Evict a random orphan:
-        size_t randompos = rng.randrange(m_orphan_list.size());
-        EraseTx(m_orphan_list[randompos]->first);
+        // Evict a random orphan of the peer using the most memory, so that a
+        // single peer flooding us with orphans only displaces its own.
+        auto peer_it = std::max_element(m_peer_orphans.begin(), m_peer_orphans.end(),
+            [](const auto& a, const auto& b) { return a.second.usage < b.second.usage; });
+        const std::vector<OrphanMap::iterator>& orphan_list = peer_it->second.orphans;
+        size_t randompos = rng.randrange(orphan_list.size());
+        EraseTx(orphan_list[randompos]->first);
         ++nEvicted;
     }
     return nEvicted;
@@ -141,16 +162,24 @@ unsigned int TxOrphanage::LimitOrphans(unsigned int max_orphans)
 void TxOrphanage::AddChildrenToWorkSet(const CTransaction& tx, std::set<uint256>& orphan_work_set) const
 {
     AssertLockHeld(g_cs_orphans);
-    for (unsigned int i = 0; i < tx.vout.size(); i++) {
-        const auto it_by_prev = m_outpoint_to_orphan_it.find(COutPoint(tx.GetHash(), i));
-        if (it_by_prev != m_outpoint_to_orphan_it.end()) {
-            for (const auto& elem : it_by_prev->second) {
-                orphan_work_set.insert(elem->first);
-            }
+    const auto it_by_parent = m_parent_to_orphan_it.find(tx.GetHash());
+    if (it_by_parent != m_parent_to_orphan_it.end()) {
+        for (const auto& elem : it_by_parent->second) {
+            orphan_work_set.insert(elem->first);
         }
     }
 }
 
+TxOrphanageStats TxOrphanage::GetStats() const
+{
+    LOCK(g_cs_orphans);
+    TxOrphanageStats stats;
+    stats.count = m_orphans.size();
+    stats.usage = m_total_usage;
+    stats.peers = m_peer_orphans.size();
+    return stats;
+}
+
 bool TxOrphanage::HaveTx(const GenTxid& gtxid) const
 {
     LOCK(g_cs_orphans);
@@ -9,14 +9,27 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <sync.h>
+#include <util/hasher.h>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 /** Guards orphan transactions and extra txs for compact blocks */
 extern RecursiveMutex g_cs_orphans;
 
+/** Summary of the contents of a TxOrphanage */
+struct TxOrphanageStats {
+    size_t count{0};  //!< number of orphans
+    size_t usage{0};  //!< memory used by the orphan transactions, in bytes
+    size_t peers{0};  //!< number of peers that announced at least one orphan
+};
+
 /** A class to track orphan transactions (failed on TX_MISSING_INPUTS)
  * Since we cannot distinguish orphans from bad transactions with
- * non-existent inputs, we heavily limit the number of orphans
- * we keep and the duration we keep them for.
+ * non-existent inputs, we heavily limit the number and memory usage of
+ * orphans we keep and the duration we keep them for.
  */
 class TxOrphanage {
 public:
@@ -40,8 +53,9 @@ public:
     /** Erase all orphans included in or invalidated by a new block */
     void EraseForBlock(const CBlock& block) LOCKS_EXCLUDED(::g_cs_orphans);
 
-    /** Limit the orphanage to the given maximum */
-    unsigned int LimitOrphans(unsigned int max_orphans) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+    /** Limit the orphanage to the given number of orphans and memory usage in bytes.
+     *  Orphans are evicted at random from the peer whose orphans use the most memory. */
+    unsigned int LimitOrphans(unsigned int max_orphans, size_t max_usage) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
 
     /** Add any orphans that list a particular tx as a parent into a peer's work set
      * (ie orphans that may have found their final missing parent, and so should be reconsidered for the mempool) */
@@ -54,12 +68,16 @@ public:
         return m_orphans.size();
     }
 
+    /** Return the number of orphans, their memory usage and the number of announcing peers */
+    TxOrphanageStats GetStats() const LOCKS_EXCLUDED(::g_cs_orphans);
+
 protected:
     struct OrphanTx {
         CTransactionRef tx;
         NodeId fromPeer;
         int64_t nTimeExpire;
-        size_t list_pos;
+        size_t list_pos; //!< position in the announcing peer's PeerOrphans::orphans
+        size_t usage;
     };
 
     /** Map from txid to orphan transaction record. Limited by
@@ -81,8 +99,22 @@ protected:
      *  to remove orphan transactions from the m_orphans */
     std::map<COutPoint, std::set<OrphanMap::iterator, IteratorComparator>> m_outpoint_to_orphan_it GUARDED_BY(g_cs_orphans);
 
-    /** Orphan transactions in vector for quick random eviction */
-    std::vector<OrphanMap::iterator> m_orphan_list GUARDED_BY(g_cs_orphans);
+    /** Index from the parents' txid into the m_orphans. Used to find the
+     *  orphans a new transaction may resolve with a single lookup */
+    std::unordered_map<uint256, std::set<OrphanMap::iterator, IteratorComparator>, SaltedTxidHasher> m_parent_to_orphan_it GUARDED_BY(g_cs_orphans);
+
+    struct PeerOrphans {
+        /** Orphans announced by the peer, in vector for quick random eviction */
+        std::vector<OrphanMap::iterator> orphans;
+        /** Sum of OrphanTx::usage of the orphans */
+        size_t usage{0};
+    };
+
+    /** Orphans by announcing peer. Only peers with at least one orphan have an entry. */
+    std::map<NodeId, PeerOrphans> m_peer_orphans GUARDED_BY(g_cs_orphans);
+
+    /** Sum of OrphanTx::usage of all orphans */
+    size_t m_total_usage GUARDED_BY(g_cs_orphans){0};
 
     /** Index from wtxid into the m_orphans to lookup orphan
      *  transactions using their witness ids. */
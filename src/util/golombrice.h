@@ -5,11 +5,15 @@
 #ifndef BITCOIN_UTIL_GOLOMBRICE_H
 #define BITCOIN_UTIL_GOLOMBRICE_H
 
+#include <crypto/common.h>
+#include <span.h>
 #include <util/fastrange.h>
 
 #include <streams.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <ios>
 
 template <typename OStream>
 void GolombRiceEncode(BitStreamWriter<OStream>& bitwriter, uint8_t P, uint64_t x)
@@ -42,4 +46,90 @@ uint64_t GolombRiceDecode(BitStreamReader<IStream>& bitreader, uint8_t P)
     return (q << P) + r;
 }
 
+/**
+ * Decodes a stream of Golomb-Rice coded values, as written by GolombRiceEncode,
+ * from a byte span. Unlike GolombRiceDecode on a BitStreamReader, bits are
+ * buffered 64 at a time and the unary quotient is read by counting leading
+ * ones instead of one bit at a time.
+ */
+class GolombRiceReader
+{
+private:
+    Span<const unsigned char> m_data;
+    /** Number of bytes of m_data moved into the buffer */
+    size_t m_pos{0};
+    /** Unread bits, most significant first. Bits below the top m_bits may hold data that is loaded again by the next refill. */
+    uint64_t m_buffer{0};
+    /** Number of unread bits in m_buffer */
+    int m_bits{0};
+
+    void Refill()
+    {
+        if (m_bits > 56) return;
+        if (m_pos + 8 <= m_data.size()) {
+            m_buffer |= ReadBE64(m_data.data() + m_pos) >> m_bits;
+            m_pos += (63 - m_bits) >> 3;
+            m_bits |= 56;
+            return;
+        }
+        while (m_bits <= 56 && m_pos < m_data.size()) {
+            m_buffer |= uint64_t{m_data[m_pos++]} << (56 - m_bits);
+            m_bits += 8;
+        }
+    }
+
+    void Consume(int nbits)
+    {
+        m_buffer = nbits == 64 ? 0 : m_buffer << nbits;
+        m_bits -= nbits;
+    }
+
+public:
+    explicit GolombRiceReader(Span<const unsigned char> data) : m_data{data} {}
+
+    /** Read the next nbits bits as an integer, nbits <= 64. */
+    uint64_t Read(int nbits)
+    {
+        uint64_t value = 0;
+        while (nbits > 0) {
+            Refill();
+            if (m_bits == 0) {
+                throw std::ios_base::failure("GolombRiceReader::Read(): end of data");
+            }
+            const int n = std::min(nbits, m_bits);
+            value = n == 64 ? m_buffer : (value << n) | (m_buffer >> (64 - n));
+            Consume(n);
+            nbits -= n;
+        }
+        return value;
+    }
+
+    /** Read the next value coded with parameter P. */
+    uint64_t Decode(uint8_t P)
+    {
+        // Read unary-encoded quotient: q 1's followed by one 0.
+        uint64_t q = 0;
+        while (true) {
+            Refill();
+            if (m_bits == 0) {
+                throw std::ios_base::failure("GolombRiceReader::Decode(): end of data");
+            }
+            const int ones = std::min(64 - static_cast<int>(CountBits(~m_buffer)), m_bits);
+            q += ones;
+            if (ones < m_bits) {
+                Consume(ones + 1);
+                break;
+            }
+            Consume(ones);
+        }
+
+        uint64_t r = Read(P);
+
+        return (q << P) + r;
+    }
+
+    /** Whether all bytes have been read, except the padding of the last one. */
+    bool empty() const { return m_pos == m_data.size() && m_bits < 8; }
+};
+
 #endif // BITCOIN_UTIL_GOLOMBRICE_H
@@ -0,0 +1,141 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/lz4.h>
+
+#include <crypto/common.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace util {
+namespace {
+//! Minimum length of a back reference
+constexpr size_t MIN_MATCH{4};
+//! A block ends with at least this many literals...
+constexpr size_t LAST_LITERALS{5};
+//! ...and its last back reference starts at least this many bytes before its end.
+constexpr size_t MATCH_FIND_LIMIT{12};
+constexpr size_t MAX_DISTANCE{65535};
+constexpr int HASH_BITS{16};
+
+uint32_t Hash(const uint8_t* p)
+{
+    return (ReadLE32(p) * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void WriteLength(std::vector<uint8_t>& out, size_t length)
+{
+    for (; length >= 255; length -= 255) out.push_back(255);
+    out.push_back(length);
+}
+
+/** Write a sequence of the literals [begin, end) followed by a back reference, if match_length is not zero. */
+void WriteSequence(std::vector<uint8_t>& out, const uint8_t* begin, const uint8_t* end, size_t distance, size_t match_length)
+{
+    const size_t literals = end - begin;
+    const size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    out.push_back((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(match_code, 15));
+    if (literals >= 15) WriteLength(out, literals - 15);
+    out.insert(out.end(), begin, end);
+    if (match_length == 0) return;
+    out.push_back(distance & 0xff);
+    out.push_back(distance >> 8);
+    if (match_code >= 15) WriteLength(out, match_code - 15);
+}
+
+/** Add a length extension at `pos` to length. */
+bool ReadLength(Span<const uint8_t> in, size_t& pos, size_t& length, size_t max)
+{
+    uint8_t byte;
+    do {
+        if (pos == in.size()) return false;
+        byte = in[pos++];
+        length += byte;
+        if (length > max) return false;
+    } while (byte == 255);
+    return true;
+}
+} // namespace
+
+std::vector<uint8_t> LZ4Compress(Span<const uint8_t> data)
+{
+    std::vector<uint8_t> out;
+    out.reserve(data.size() + data.size() / 255 + 16);
+    const uint8_t* const base = data.data();
+    const uint8_t* anchor = base;
+    if (data.size() > MATCH_FIND_LIMIT) {
+        // Most recent position of each hashed 4 byte sequence
+        std::vector<uint32_t> table(size_t{1} << HASH_BITS);
+        const uint8_t* const match_limit = base + data.size() - MATCH_FIND_LIMIT;
+        const uint8_t* const end_limit = base + data.size() - LAST_LITERALS;
+        const uint8_t* p = base;
+        while (p < match_limit) {
+            uint32_t& entry = table[Hash(p)];
+            const uint8_t* match = base + entry;
+            entry = p - base;
+            if (match >= p || size_t(p - match) > MAX_DISTANCE || ReadLE32(match) != ReadLE32(p)) {
+                // Step faster through data that does not compress.
+                p += 1 + ((p - anchor) >> 6);
+                continue;
+            }
+            while (p > anchor && match > base && p[-1] == match[-1]) {
+                --p;
+                --match;
+            }
+            size_t length = MIN_MATCH;
+            while (p + length < end_limit && p[length] == match[length]) ++length;
+            WriteSequence(out, anchor, p, p - match, length);
+            p += length;
+            anchor = p;
+            if (p < match_limit) table[Hash(p - 2)] = p - 2 - base;
+        }
+    }
+    WriteSequence(out, anchor, base + data.size(), 0, 0);
+    return out;
+}
+
+bool LZ4Decompress(Span<const uint8_t> compressed, size_t size, std::vector<uint8_t>& out)
+{
+    out.resize(size);
+    return LZ4Decompress(compressed, out);
+}
+
+bool LZ4Decompress(Span<const uint8_t> compressed, Span<uint8_t> out)
+{
+    const size_t size{out.size()};
+    uint8_t* const base = out.data();
+    size_t in_pos{0}, out_pos{0};
+    while (true) {
+        if (in_pos == compressed.size()) return false;
+        const uint8_t token = compressed[in_pos++];
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !ReadLength(compressed, in_pos, literals, size)) return false;
+        if (literals > compressed.size() - in_pos || literals > size - out_pos) return false;
+        if (literals > 0) std::memcpy(base + out_pos, compressed.data() + in_pos, literals);
+        in_pos += literals;
+        out_pos += literals;
+        if (in_pos == compressed.size()) break;
+
+        if (compressed.size() - in_pos < 2) return false;
+        const size_t distance = compressed[in_pos] | (compressed[in_pos + 1] << 8);
+        in_pos += 2;
+        if (distance == 0 || distance > out_pos) return false;
+        size_t length = (token & 15) + MIN_MATCH;
+        if ((token & 15) == 15 && !ReadLength(compressed, in_pos, length, size)) return false;
+        if (length > size - out_pos) return false;
+        uint8_t* dest = base + out_pos;
+        const uint8_t* src = dest - distance;
+        if (distance >= length) {
+            std::memcpy(dest, src, length);
+        } else {
+            // The reference overlaps the output, repeating its last `distance` bytes.
+            for (size_t i = 0; i < length; ++i) dest[i] = src[i];
+        }
+        out_pos += length;
+    }
+    return out_pos == size;
+}
+} // namespace util
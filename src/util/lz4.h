@@ -0,0 +1,34 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_LZ4_H
+#define BITCOIN_UTIL_LZ4_H
+
+#include <span.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace util {
+/**
+ * Compress data into the LZ4 block format: a sequence of literal runs and
+ * back references of up to 64 KiB, found with a single hash table probe per
+ * position. This favors speed over compression ratio, and decompression is
+ * little more than a memcpy.
+ */
+std::vector<uint8_t> LZ4Compress(Span<const uint8_t> data);
+
+/**
+ * Decompress an LZ4 block that decompresses to exactly `size` bytes into
+ * `out`. The input is untrusted: returns false if it is malformed or does not
+ * decompress to `size` bytes.
+ */
+bool LZ4Decompress(Span<const uint8_t> compressed, size_t size, std::vector<uint8_t>& out);
+
+/** Decompress an LZ4 block that decompresses to exactly `out.size()` bytes into `out`. */
+bool LZ4Decompress(Span<const uint8_t> compressed, Span<uint8_t> out);
+} // namespace util
+
+#endif // BITCOIN_UTIL_LZ4_H
@@ -5,10 +5,16 @@
 #include <util/thread.h>
 
 #include <logging.h>
+#include <sync.h>
+#include <tinyformat.h>
 #include <util/system.h>
 #include <util/threadnames.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <exception>
+#include <thread>
+#include <vector>
 
 void util::TraceThread(const char* thread_name, std::function<void()> thread_func)
 {
@@ -25,3 +31,96 @@ void util::TraceThread(const char* thread_name, std::function<void()> thread_fun
         throw;
     }
 }
+
+namespace {
+/** Worker threads of RunOrderedJobs(). */
+class OrderedJobRunner
+{
+public:
+    using JobFn = std::function<bool(size_t, int)>;
+
+private:
+    enum class State : uint8_t { PENDING, DONE, FAILED };
+
+    const JobFn& m_job;
+    const size_t m_ahead;
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<State> m_states GUARDED_BY(m_mutex);
+    size_t m_next_job GUARDED_BY(m_mutex){0};
+    size_t m_consumed GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_workers;
+
+    void Loop(int worker) LOCKS_EXCLUDED(m_mutex)
+    {
+        while (true) {
+            size_t index;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                    return m_stop || m_next_job == m_states.size() || m_next_job < m_consumed + m_ahead;
+                });
+                if (m_stop || m_next_job == m_states.size()) return;
+                index = m_next_job++;
+            }
+            const bool ok{m_job(index, worker)};
+            WITH_LOCK(m_mutex, m_states[index] = ok ? State::DONE : State::FAILED);
+            m_cv.notify_all();
+        }
+    }
+
+public:
+    OrderedJobRunner(size_t count, int threads, size_t ahead, const std::string& thread_name, const JobFn& job)
+        : m_job{job}, m_ahead{std::max<size_t>(ahead, 1)}
+    {
+        WITH_LOCK(m_mutex, m_states.assign(count, State::PENDING));
+        for (int n = 0; n < threads; ++n) {
+            m_workers.emplace_back([this, n, name = strprintf("%s.%d", thread_name, n)] {
+                util::ThreadRename(std::string{name});
+                Loop(n);
+            });
+        }
+    }
+
+    ~OrderedJobRunner()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cv.notify_all();
+        for (std::thread& worker : m_workers) worker.join();
+    }
+
+    /** Wait for the job of an index to finish and return whether it succeeded. */
+    bool Wait(size_t index) LOCKS_EXCLUDED(m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_states[index] != State::PENDING; });
+        return m_states[index] == State::DONE;
+    }
+
+    /** Mark the result of an index as consumed, allowing jobs further ahead. */
+    void Consumed(size_t index) LOCKS_EXCLUDED(m_mutex)
+    {
+        WITH_LOCK(m_mutex, m_consumed = index + 1);
+        m_cv.notify_all();
+    }
+};
+} // namespace
+
+bool util::RunOrderedJobs(size_t count, int threads, size_t ahead, const std::string& thread_name,
+                          const std::function<bool(size_t, int)>& job,
+                          const std::function<bool(size_t)>& consume)
+{
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!job(i, 0) || !consume(i)) return false;
+        }
+        return true;
+    }
+    OrderedJobRunner runner{count, threads, ahead, thread_name, job};
+    for (size_t i = 0; i < count; ++i) {
+        if (!runner.Wait(i) || !consume(i)) return false;
+        runner.Consumed(i);
+    }
+    return true;
+}
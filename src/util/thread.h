@@ -5,7 +5,9 @@
 #ifndef BITCOIN_UTIL_THREAD_H
 #define BITCOIN_UTIL_THREAD_H
 
+#include <cstddef>
 #include <functional>
+#include <string>
 
 namespace util {
 /**
@@ -13,6 +15,20 @@ namespace util {
  */
 void TraceThread(const char* thread_name, std::function<void()> thread_func);
 
+/**
+ * Call job(index, worker) for each index in [0, count) on `threads` worker
+ * threads named `thread_name`.<worker>, and consume(index) on the calling
+ * thread in index order. Jobs are started in index order and at most `ahead`
+ * indexes past the last consumed one, which bounds the memory held by
+ * finished jobs. With one thread or less everything runs on the calling
+ * thread.
+ *
+ * @return false as soon as a job or consume call returns false.
+ */
+bool RunOrderedJobs(size_t count, int threads, size_t ahead, const std::string& thread_name,
+                    const std::function<bool(size_t index, int worker)>& job,
+                    const std::function<bool(size_t index)>& consume);
+
 } // namespace util
 
 #endif // BITCOIN_UTIL_THREAD_H
@@ -49,6 +49,7 @@
 #include <util/rbf.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/trace.h>
 #include <util/translation.h>
 #include <validationinterface.h>
@@ -60,21 +61,28 @@
 #include <optional>
 #include <string>
 
+using node::BLOCK_RECORD_COMPRESSED;
 using node::BLOCKFILE_CHUNK_SIZE;
+using node::BlockFileRecord;
 using node::BlockManager;
 using node::BlockMap;
 using node::CBlockIndexHeightOnlyComparator;
 using node::CBlockIndexWorkComparator;
 using node::CCoinsStats;
 using node::CoinStatsHashType;
+using node::DecompressBlockData;
 using node::fImporting;
 using node::fPruneMode;
 using node::fReindex;
+using node::GetBlockPosFilename;
 using node::GetUTXOStats;
+using node::LoadChunkedSnapshot;
 using node::nPruneTarget;
 using node::OpenBlockFile;
 using node::ReadBlockFromDisk;
+using node::ScanBlockFile;
 using node::SnapshotMetadata;
+using node::SnapshotThreads;
 using node::UNDOFILE_CHUNK_SIZE;
 using node::UndoReadFromDisk;
 using node::UnlinkPrunedFiles;
@@ -110,6 +118,8 @@ const std::vector<std::string> CHECKLEVEL_DOC {
  *  noticeably interfere with the pruning mechanism.
  * */
 static constexpr int PRUNE_LOCK_BUFFER{10};
+/** Maximum size of the blocks read and checked together ahead of being accepted during -reindex. */
+static constexpr uint64_t REINDEX_BATCH_BYTES{4 << 20};
 
 /**
  * Mutex to guard access to validation specific variables, such as reading
@@ -264,6 +274,9 @@ bool CheckSequenceLocksAtTip(CBlockIndex* tip,
 // Returns the script flags which should be checked for a given block
 static unsigned int GetBlockScriptFlags(const CBlockIndex& block_index, const Consensus::Params& chainparams);
 
+// Checks a block in the context of its parent
+static bool ContextualCheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
+
 static void LimitMempoolSize(CTxMemPool& pool, CCoinsViewCache& coins_cache, size_t limit, std::chrono::seconds age)
     EXCLUSIVE_LOCKS_REQUIRED(::cs_main, pool.cs)
 {
@@ -302,6 +315,7 @@ void CChainState::MaybeUpdateMempoolForReorg(
     AssertLockHeld(cs_main);
     AssertLockHeld(m_mempool->cs);
     std::vector<uint256> vHashUpdate;
+    std::vector<CTransactionRef> vtxRemove;
     // disconnectpool's insertion_order index sorts the entries from
     // oldest to newest, but the oldest entry will be the last tx from the
     // latest mined block that was disconnected.
@@ -317,13 +331,16 @@ void CChainState::MaybeUpdateMempoolForReorg(
                     MempoolAcceptResult::ResultType::VALID) {
             // If the transaction doesn't make it in to the mempool, remove any
             // transactions that depend on it (which would now be orphans).
-            m_mempool->removeRecursive(**it, MemPoolRemovalReason::REORG);
+            // These are removed together once the whole disconnectpool has
+            // been processed.
+            vtxRemove.push_back(*it);
         } else if (m_mempool->exists(GenTxid::Txid((*it)->GetHash()))) {
             vHashUpdate.push_back((*it)->GetHash());
         }
         ++it;
     }
     disconnectpool.queuedTx.clear();
+    m_mempool->removeRecursive(vtxRemove, MemPoolRemovalReason::REORG);
     // AcceptToMemoryPool/addUnchecked all assume that new mempool entries have
     // no in-mempool children, which is generally not true when adding
     // previously-confirmed transactions back to the mempool.
@@ -2018,6 +2035,20 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
         return error("%s: Consensus::CheckBlock: %s", __func__, state.ToString());
     }
 
+    // Blocks stored by a headers-only reindex have not been checked in their context yet.
+    if (pindex->nStatus & BLOCK_UNCHECKED_DATA) {
+        if (!ContextualCheckBlock(block, state, m_params.GetConsensus(), pindex->pprev)) {
+            if (state.GetResult() == BlockValidationResult::BLOCK_MUTATED) {
+                return AbortNode(state, "Corrupt block found indicating potential hardware failure; shutting down");
+            }
+            return error("%s: Consensus::ContextualCheckBlock: %s", __func__, state.ToString());
+        }
+        if (!fJustCheck) {
+            pindex->nStatus &= ~BLOCK_UNCHECKED_DATA;
+            m_blockman.m_dirty_blockindex.insert(pindex);
+        }
+    }
+
     // verify that the view's current state corresponds to the previous block
     uint256 hashPrevBlock = pindex->pprev == nullptr ? uint256() : pindex->pprev->GetBlockHash();
     assert(hashPrevBlock == view.GetBestBlock());
@@ -3273,10 +3304,10 @@ void CChainState::ResetBlockFailureFlags(CBlockIndex *pindex) {
 }
 
 /** Mark a block as having its data received and checked (up to BLOCK_VALID_TRANSACTIONS). */
-void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const FlatFilePos& pos)
+void CChainState::ReceivedBlockTransactions(unsigned int num_tx, CBlockIndex* pindexNew, const FlatFilePos& pos)
 {
     AssertLockHeld(cs_main);
-    pindexNew->nTx = block.vtx.size();
+    pindexNew->nTx = num_tx;
     pindexNew->nChainTx = 0;
     pindexNew->nFile = pos.nFile;
     pindexNew->nDataPos = pos.nPos;
@@ -3697,7 +3728,7 @@ bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>&
 }
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
-bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock)
+bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, uint32_t dbp_size)
 {
     const CBlock& block = *pblock;
 
@@ -3763,12 +3794,12 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, Block
     // Write block to history file
     if (fNewBlock) *fNewBlock = true;
     try {
-        FlatFilePos blockPos{m_blockman.SaveBlockToDisk(block, pindex->nHeight, m_chain, m_params, dbp)};
+        FlatFilePos blockPos{m_blockman.SaveBlockToDisk(block, pindex->nHeight, m_chain, m_params, dbp, dbp_size)};
         if (blockPos.IsNull()) {
             state.Error(strprintf("%s: Failed to find position to write new block to disk", __func__));
             return false;
         }
-        ReceivedBlockTransactions(block, pindex, blockPos);
+        ReceivedBlockTransactions(block.vtx.size(), pindex, blockPos);
     } catch (const std::runtime_error& e) {
         return AbortNode(state, std::string("System error: ") + e.what());
     }
@@ -4160,12 +4191,17 @@ bool ChainstateManager::LoadBlockIndex()
     // Load block index from databases
     bool needs_init = fReindex;
     if (!fReindex) {
+        const int64_t time_start{GetTimeMicros()};
         bool ret = m_blockman.LoadBlockIndexDB();
         if (!ret) return false;
+        const int64_t time_loaded{GetTimeMicros()};
+        LogPrint(BCLog::BENCH, "- Load block index and block file info: %.2fms\n", MILLI * (time_loaded - time_start));
 
         std::vector<CBlockIndex*> vSortedByHeight{m_blockman.GetAllBlockIndices()};
-        std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
-                  CBlockIndexHeightOnlyComparator());
+        if (!std::is_sorted(vSortedByHeight.begin(), vSortedByHeight.end(), CBlockIndexHeightOnlyComparator())) {
+            std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
+                      CBlockIndexHeightOnlyComparator());
+        }
 
         // Find start of assumed-valid region.
         int first_assumed_valid_height = std::numeric_limits<int>::max();
@@ -4229,6 +4265,7 @@ bool ChainstateManager::LoadBlockIndex()
             if (pindex->IsValid(BLOCK_VALID_TREE) && (m_best_header == nullptr || CBlockIndexWorkComparator()(m_best_header, pindex)))
                 m_best_header = pindex;
         }
+        LogPrint(BCLog::BENCH, "- Find block index candidates: %.2fms\n", MILLI * (GetTimeMicros() - time_loaded));
 
         needs_init = m_blockman.m_block_index.empty();
     }
@@ -4263,7 +4300,7 @@ bool CChainState::LoadGenesisBlock()
             return error("%s: writing genesis block to disk failed", __func__);
         }
         CBlockIndex* pindex = m_blockman.AddToBlockIndex(block, m_chainman.m_best_header);
-        ReceivedBlockTransactions(block, pindex, blockPos);
+        ReceivedBlockTransactions(block.vtx.size(), pindex, blockPos);
     } catch (const std::runtime_error& e) {
         return error("%s: failed to write genesis block: %s", __func__, e.what());
     }
@@ -4271,11 +4308,104 @@ bool CChainState::LoadGenesisBlock()
     return true;
 }
 
+bool CChainState::ImportBlock(const std::shared_ptr<const CBlock>& pblock, const FlatFilePos* dbp, uint32_t dbp_size, int& loaded)
+{
+    AssertLockNotHeld(m_chainstate_mutex);
+    const CBlock& block = *pblock;
+    uint256 hash = block.GetHash();
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and store them for later
+        if (hash != m_params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(block.hashPrevBlock)) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                    block.hashPrevBlock.ToString());
+            if (dbp)
+                m_blocks_unknown_parent.insert(std::make_pair(block.hashPrevBlock, std::make_pair(*dbp, dbp_size)));
+            return true;
+        }
+
+        // process in case the block isn't known yet
+        const CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
+        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+          BlockValidationState state;
+          if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr, dbp_size)) {
+              loaded++;
+          }
+          if (state.IsError()) {
+              return false;
+          }
+        } else if (hash != m_params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+            LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+        }
+    }
+
+    // Activate the genesis block so normal node progress can continue
+    if (hash == m_params.GetConsensus().hashGenesisBlock) {
+        BlockValidationState state;
+        if (!ActivateBestChain(state, nullptr)) {
+            return false;
+        }
+    }
+
+    NotifyHeaderTip(*this);
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        auto range = m_blocks_unknown_parent.equal_range(head);
+        while (range.first != range.second) {
+            auto it = range.first;
+            const auto& [pos, size] = it->second;
+            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+            if (ReadBlockFromDisk(*pblockrecursive, pos, m_params.GetConsensus())) {
+                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                        head.ToString());
+                LOCK(cs_main);
+                BlockValidationState dummy;
+                if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &pos, nullptr, size)) {
+                    loaded++;
+                    queue.push_back(pblockrecursive->GetHash());
+                }
+            }
+            range.first++;
+            m_blocks_unknown_parent.erase(it);
+            NotifyHeaderTip(*this);
+        }
+    }
+    return true;
+}
+
+bool CChainState::ImportBlockHeader(const BlockFileRecord& record)
+{
+    AssertLockHeld(cs_main);
+    BlockValidationState state;
+    CBlockIndex* pindex{nullptr};
+    if (!m_chainman.AcceptBlockHeader(record.header, state, m_params, &pindex)) {
+        LogPrint(BCLog::REINDEX, "%s: Block at %s not imported: %s\n", __func__, record.pos.ToString(), state.ToString());
+        return false;
+    }
+    if (pindex->nStatus & BLOCK_HAVE_DATA) return true;
+    if (record.num_tx == 0 || record.num_tx > (record.compressed ? MAX_BLOCK_WEIGHT / MIN_TRANSACTION_WEIGHT : record.size)) {
+        LogPrint(BCLog::REINDEX, "%s: Block at %s not imported: bad transaction count\n", __func__, record.pos.ToString());
+        return true;
+    }
+
+    FlatFilePos pos{record.pos};
+    if (!m_blockman.FindBlockPos(pos, record.size + 8, pindex->nHeight, m_chain, record.header.GetBlockTime(), /*fKnown=*/true)) {
+        return error("%s: FindBlockPos failed", __func__);
+    }
+    pindex->nStatus |= BLOCK_UNCHECKED_DATA;
+    ReceivedBlockTransactions(record.num_tx, pindex, pos);
+    FlushStateToDisk(state, FlushStateMode::NONE);
+    return true;
+}
+
 void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
 {
     AssertLockNotHeld(m_chainstate_mutex);
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
@@ -4301,7 +4431,7 @@ void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
                 }
                 // read size
                 blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                if ((nSize & ~BLOCK_RECORD_COMPRESSED) < 80 || (nSize & ~BLOCK_RECORD_COMPRESSED) > MAX_BLOCK_SERIALIZED_SIZE)
                     continue;
             } catch (const std::exception&) {
                 // no valid block header found; don't complain
@@ -4312,82 +4442,161 @@ void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
                 uint64_t nBlockPos = blkdat.GetPos();
                 if (dbp)
                     dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
                 std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != m_params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
-
-                    // process in case the block isn't known yet
-                    const CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                      BlockValidationState state;
-                      if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr)) {
-                          nLoaded++;
-                      }
-                      if (state.IsError()) {
-                          break;
-                      }
-                    } else if (hash != m_params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
-                    }
+                if (nSize & BLOCK_RECORD_COMPRESSED) {
+                    std::vector<uint8_t> data(nSize & ~BLOCK_RECORD_COMPRESSED);
+                    blkdat.read(MakeWritableByteSpan(data));
+                    if (!DecompressBlockData(data)) throw std::ios_base::failure("corrupt compressed block");
+                    SpanReader{SER_DISK, CLIENT_VERSION, data} >> *pblock;
+                } else {
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat >> *pblock;
                 }
+                nRewind = blkdat.GetPos();
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == m_params.GetConsensus().hashGenesisBlock) {
-                    BlockValidationState state;
-                    if (!ActivateBestChain(state, nullptr)) {
-                        break;
-                    }
+                if (!ImportBlock(pblock, dbp, nSize & ~BLOCK_RECORD_COMPRESSED, nLoaded)) {
+                    break;
                 }
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        AbortNode(std::string("System error: ") + e.what());
+    }
+    LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+}
 
-                NotifyHeaderTip(*this);
+void CChainState::ReindexBlockFiles(int threads, bool headers_only)
+{
+    AssertLockNotHeld(m_chainstate_mutex);
+    int64_t nStart = GetTimeMillis();
 
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
+    // Scan the block files, several at a time, for the positions of their
+    // blocks. Their numbers may have gaps, as left by repackblockfiles, so
+    // all numbers up to the highest one in the blocks directory are tried.
+    int num_files = 0;
+    for (const auto& entry : fs::directory_iterator(gArgs.GetBlocksDirPath())) {
+        const std::string name{fs::PathToString(entry.path().filename())};
+        if (name.size() != 12 || name.compare(0, 3, "blk") != 0 || name.compare(8, 4, ".dat") != 0) continue;
+        if (const auto file{ToIntegral<int>(name.substr(3, 5))}) num_files = std::max(num_files, *file + 1);
+    }
+    std::vector<std::vector<BlockFileRecord>> file_records(num_files);
+    std::vector<BlockFileRecord> records;
+    const bool scanned = util::RunOrderedJobs(
+        num_files, threads, 2 * threads, "reindex",
+        [&](size_t file, int) {
+            if (fs::exists(GetBlockPosFilename(FlatFilePos(file, 0)))) file_records[file] = ScanBlockFile(file, m_params);
+            return !ShutdownRequested();
+        },
+        [&](size_t file) {
+            records.insert(records.end(), file_records[file].begin(), file_records[file].end());
+            file_records[file] = {};
+            return true;
+        });
+    if (!scanned) return;
+    LogPrintf("Found %u blocks in %d block files in %dms\n", records.size(), num_files, GetTimeMillis() - nStart);
+
+    if (headers_only) {
+        // Record indexes of blocks whose parent is not known yet, by parent hash
+        std::multimap<uint256, size_t> unknown_parent;
+        int nLoaded = 0;
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (ShutdownRequested()) return;
+            const uint256 hash{records[i].header.GetHash()};
+            {
+                LOCK(cs_main);
+                if (hash != m_params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(records[i].header.hashPrevBlock)) {
+                    unknown_parent.emplace(records[i].header.hashPrevBlock, i);
+                    continue;
+                }
+                std::deque<size_t> queue{i};
                 while (!queue.empty()) {
-                    uint256 head = queue.front();
+                    const BlockFileRecord& record{records[queue.front()]};
                     queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, m_params.GetConsensus())) {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            BlockValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &it->second, nullptr)) {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip(*this);
-                    }
+                    if (!ImportBlockHeader(record)) continue;
+                    nLoaded++;
+                    const auto range{unknown_parent.equal_range(record.header.GetHash())};
+                    for (auto it = range.first; it != range.second; ++it) queue.push_back(it->second);
+                    unknown_parent.erase(range.first, range.second);
+                }
+            }
+            // Activate the genesis block so normal node progress can continue
+            if (hash == m_params.GetConsensus().hashGenesisBlock) {
+                BlockValidationState state;
+                if (!ActivateBestChain(state, nullptr)) break;
+            }
+            NotifyHeaderTip(*this);
+        }
+        LogPrintf("Loaded %i block headers from %d block files in %dms\n", nLoaded, num_files, GetTimeMillis() - nStart);
+        return;
+    }
+
+    // Read, deserialize and check the blocks ahead in batches of one file and
+    // at most REINDEX_BATCH_BYTES, and accept them in order. The context free
+    // checks are cached in the blocks (CBlock::fChecked) for AcceptBlock.
+    std::vector<std::pair<size_t, size_t>> batches;
+    for (size_t begin = 0, end = 0; begin < records.size(); begin = end) {
+        uint64_t bytes = 0;
+        while (end < records.size() && records[end].pos.nFile == records[begin].pos.nFile &&
+               (end == begin || bytes + records[end].size <= REINDEX_BATCH_BYTES)) {
+            bytes += records[end++].size;
+        }
+        batches.emplace_back(begin, end);
+    }
+    std::vector<std::vector<std::pair<std::shared_ptr<CBlock>, std::string>>> batch_blocks(batches.size());
+    const auto read_batch = [&](size_t batch, int) {
+        const auto [begin, end] = batches[batch];
+        auto& blocks = batch_blocks[batch];
+        CAutoFile filein(OpenBlockFile(records[begin].pos, true), SER_DISK, CLIENT_VERSION);
+        for (size_t i = begin; i < end; ++i) {
+            auto& [block, error] = blocks.emplace_back();
+            try {
+                if (filein.IsNull()) throw std::ios_base::failure("OpenBlockFile failed");
+                if (fseek(filein.Get(), records[i].pos.nPos, SEEK_SET)) throw std::ios_base::failure("fseek failed");
+                std::vector<uint8_t> data(records[i].size);
+                filein.read(MakeWritableByteSpan(data));
+                if (records[i].compressed && !DecompressBlockData(data)) throw std::ios_base::failure("corrupt compressed block");
+                block = std::make_shared<CBlock>();
+                SpanReader{SER_DISK, CLIENT_VERSION, data} >> *block;
+                BlockValidationState state;
+                CheckBlock(*block, state, m_params.GetConsensus());
+            } catch (const std::exception& e) {
+                block.reset();
+                error = e.what();
+            }
+        }
+        return true;
+    };
+    int nLoaded = 0;
+    int logged_file = -1;
+    int stopped_file = -1;
+    const auto accept_batch = [&](size_t batch) {
+        const auto [begin, end] = batches[batch];
+        auto blocks = std::move(batch_blocks[batch]);
+        if (records[begin].pos.nFile == stopped_file) return true;
+        if (records[begin].pos.nFile != logged_file) {
+            logged_file = records[begin].pos.nFile;
+            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)logged_file);
+        }
+        for (size_t i = begin; i < end; ++i) {
+            if (ShutdownRequested()) return false;
+            const auto& [block, error] = blocks[i - begin];
+            try {
+                if (!block) throw std::ios_base::failure(error);
+                if (!ImportBlock(block, &records[i].pos, records[i].size, nLoaded)) {
+                    // Skip the rest of the file, as LoadExternalBlockFile does.
+                    stopped_file = logged_file;
+                    break;
                 }
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
         }
-    } catch (const std::runtime_error& e) {
-        AbortNode(std::string("System error: ") + e.what());
-    }
-    LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+        return true;
+    };
+    util::RunOrderedJobs(batches.size(), threads, 2 * threads, "reindex", read_batch, accept_batch);
+    LogPrintf("Loaded %i blocks from %d block files in %dms\n", nLoaded, num_files, GetTimeMillis() - nStart);
 }
 
 void CChainState::CheckBlockIndex()
@@ -4653,7 +4862,43 @@ bool CChainState::ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
     return ret;
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION_LEGACY = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+
+/** Number of transactions read from mempool.dat before their scripts are checked together */
+static constexpr size_t MEMPOOL_LOAD_BATCH_SIZE{1000};
+
+/**
+ * Verify the scripts of a batch of transactions read from mempool.dat on the
+ * script check worker threads, so that the signature cache is warm when they
+ * are passed to AcceptToMemoryPool() one by one. Transactions may spend
+ * outputs of earlier transactions in the batch. Failures are ignored here and
+ * reported by AcceptToMemoryPool().
+ */
+static void PrecheckMempoolScripts(CChainState& active_chainstate, const CTxMemPool& pool, const std::vector<CTransactionRef>& txs)
+{
+    if (!g_parallel_script_checks) return;
+
+    LOCK2(cs_main, pool.cs);
+    CCoinsViewMemPool view_mempool(&active_chainstate.CoinsTip(), pool);
+    CCoinsViewCache view(&view_mempool);
+    // Each CScriptCheck points into its transaction's precomputed data, so
+    // this vector must not be resized until the checks have completed.
+    std::vector<PrecomputedTransactionData> txdata(txs.size());
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    for (size_t i = 0; i < txs.size(); ++i) {
+        const CTransaction& tx = *txs[i];
+        if (view.HaveInputs(tx)) {
+            TxValidationState state;
+            std::vector<CScriptCheck> checks;
+            if (CheckInputScripts(tx, state, view, STANDARD_SCRIPT_VERIFY_FLAGS, /*cacheSigStore=*/true, /*cacheFullScriptStore=*/true, txdata[i], &checks)) {
+                control.Add(checks);
+            }
+        }
+        AddCoins(view, tx, MEMPOOL_HEIGHT, /*check=*/true);
+    }
+    control.Wait();
+}
 
 bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mockable_fopen_function)
 {
@@ -4675,27 +4920,57 @@ bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mocka
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION_LEGACY && version != MEMPOOL_DUMP_VERSION) {
             return false;
         }
+        if (version == MEMPOOL_DUMP_VERSION) {
+            std::map<uint256, CAmount> mapDeltas;
+            file >> mapDeltas;
+            for (const auto& i : mapDeltas) {
+                pool.PrioritiseTransaction(i.first, i.second);
+            }
+        }
+
         uint64_t num;
         file >> num;
+        std::vector<CTransactionRef> batch;
+        std::vector<int64_t> batch_times;
         while (num) {
-            --num;
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+            batch.clear();
+            batch_times.clear();
+            while (num && batch.size() < MEMPOOL_LOAD_BATCH_SIZE) {
+                --num;
+                CTransactionRef tx;
+                int64_t nTime;
+                file >> tx;
+                if (version == MEMPOOL_DUMP_VERSION) {
+                    uint64_t time;
+                    file >> VARINT(time);
+                    nTime = time;
+                } else {
+                    int64_t nFeeDelta;
+                    file >> nTime;
+                    file >> nFeeDelta;
+
+                    CAmount amountdelta = nFeeDelta;
+                    if (amountdelta) {
+                        pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                    }
+                }
+                if (nTime > nNow - nExpiryTimeout) {
+                    batch.push_back(std::move(tx));
+                    batch_times.push_back(nTime);
+                } else {
+                    ++expired;
+                }
             }
-            if (nTime > nNow - nExpiryTimeout) {
+
+            PrecheckMempoolScripts(active_chainstate, pool, batch);
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const CTransactionRef& tx = batch[i];
                 LOCK(cs_main);
-                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, nTime, /*bypass_limits=*/false, /*test_accept=*/false);
+                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, batch_times[i], /*bypass_limits=*/false, /*test_accept=*/false);
                 if (accepted.m_result_type == MempoolAcceptResult::ResultType::VALID) {
                     ++count;
                 } else {
@@ -4709,17 +4984,18 @@ bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mocka
                         ++failed;
                     }
                 }
-            } else {
-                ++expired;
+                if (ShutdownRequested())
+                    return false;
             }
-            if (ShutdownRequested())
-                return false;
         }
-        std::map<uint256, CAmount> mapDeltas;
-        file >> mapDeltas;
 
-        for (const auto& i : mapDeltas) {
-            pool.PrioritiseTransaction(i.first, i.second);
+        if (version == MEMPOOL_DUMP_VERSION_LEGACY) {
+            std::map<uint256, CAmount> mapDeltas;
+            file >> mapDeltas;
+
+            for (const auto& i : mapDeltas) {
+                pool.PrioritiseTransaction(i.first, i.second);
+            }
         }
 
         std::set<uint256> unbroadcast_txids;
@@ -4739,7 +5015,7 @@ bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mocka
     return true;
 }
 
-bool DumpMempool(const CTxMemPool& pool, FopenFn mockable_fopen_function, bool skip_file_commit)
+bool DumpMempool(const CTxMemPool& pool, bool use_v1, FopenFn mockable_fopen_function, bool skip_file_commit)
 {
     int64_t start = GetTimeMicros();
 
@@ -4769,18 +5045,31 @@ bool DumpMempool(const CTxMemPool& pool, FopenFn mockable_fopen_function, bool s
 
         CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
 
-        uint64_t version = MEMPOOL_DUMP_VERSION;
+        uint64_t version = use_v1 ? MEMPOOL_DUMP_VERSION_LEGACY : MEMPOOL_DUMP_VERSION;
         file << version;
 
-        file << (uint64_t)vinfo.size();
-        for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << int64_t{count_seconds(i.m_time)};
-            file << int64_t{i.nFeeDelta};
-            mapDeltas.erase(i.tx->GetHash());
-        }
+        if (use_v1) {
+            file << (uint64_t)vinfo.size();
+            for (const auto& i : vinfo) {
+                file << *(i.tx);
+                file << int64_t{count_seconds(i.m_time)};
+                file << int64_t{i.nFeeDelta};
+                mapDeltas.erase(i.tx->GetHash());
+            }
 
-        file << mapDeltas;
+            file << mapDeltas;
+        } else {
+            // Fee deltas are only written once, in mapDeltas, which is
+            // applied before any transaction is loaded.
+            file << mapDeltas;
+
+            file << (uint64_t)vinfo.size();
+            for (const auto& i : vinfo) {
+                file << *(i.tx);
+                const uint64_t time{uint64_t(std::max<int64_t>(0, count_seconds(i.m_time)))};
+                file << VARINT(time);
+            }
+        }
 
         LogPrintf("Writing %d unbroadcast transactions to disk.\n", unbroadcast_txids.size());
         file << unbroadcast_txids;
@@ -4975,37 +5264,20 @@ static void FlushSnapshotToDisk(CCoinsViewCache& coins_cache, bool snapshot_load
     coins_cache.Flush();
 }
 
-bool ChainstateManager::PopulateAndValidateSnapshot(
+/**
+ * Load the coins of an unchunked snapshot through the coins cache of the
+ * snapshot chainstate, and hash the resulting coins database.
+ */
+static bool LoadSnapshotCoins(
     CChainState& snapshot_chainstate,
+    CCoinsViewCache& coins_cache,
     CAutoFile& coins_file,
-    const SnapshotMetadata& metadata)
+    const SnapshotMetadata& metadata,
+    int base_height,
+    BlockManager& blockman,
+    uint256& hash_serialized)
 {
-    // It's okay to release cs_main before we're done using `coins_cache` because we know
-    // that nothing else will be referencing the newly created snapshot_chainstate yet.
-    CCoinsViewCache& coins_cache = *WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsTip());
-
-    uint256 base_blockhash = metadata.m_base_blockhash;
-
-    CBlockIndex* snapshot_start_block = WITH_LOCK(::cs_main, return m_blockman.LookupBlockIndex(base_blockhash));
-
-    if (!snapshot_start_block) {
-        // Needed for GetUTXOStats and ExpectedAssumeutxo to determine the height and to avoid a crash when base_blockhash.IsNull()
-        LogPrintf("[snapshot] Did not find snapshot start blockheader %s\n",
-                  base_blockhash.ToString());
-        return false;
-    }
-
-    int base_height = snapshot_start_block->nHeight;
-    auto maybe_au_data = ExpectedAssumeutxo(base_height, ::Params());
-
-    if (!maybe_au_data) {
-        LogPrintf("[snapshot] assumeutxo height in snapshot metadata not recognized " /* Continued */
-                  "(%d) - refusing to load snapshot\n", base_height);
-        return false;
-    }
-
-    const AssumeutxoData& au_data = *maybe_au_data;
-
+    const uint256& base_blockhash = metadata.m_base_blockhash;
     COutPoint outpoint;
     Coin coin;
     const uint64_t coins_count = metadata.m_coins_count;
@@ -5104,15 +5376,66 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     // about the snapshot_chainstate.
     CCoinsViewDB* snapshot_coinsdb = WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
 
-    if (!GetUTXOStats(snapshot_coinsdb, m_blockman, stats, breakpoint_fnc)) {
+    if (!GetUTXOStats(snapshot_coinsdb, blockman, stats, breakpoint_fnc)) {
         LogPrintf("[snapshot] failed to generate coins stats\n");
         return false;
     }
 
+    hash_serialized = stats.hashSerialized;
+    return true;
+}
+
+bool ChainstateManager::PopulateAndValidateSnapshot(
+    CChainState& snapshot_chainstate,
+    CAutoFile& coins_file,
+    const SnapshotMetadata& metadata)
+{
+    // It's okay to release cs_main before we're done using `coins_cache` because we know
+    // that nothing else will be referencing the newly created snapshot_chainstate yet.
+    CCoinsViewCache& coins_cache = *WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsTip());
+
+    uint256 base_blockhash = metadata.m_base_blockhash;
+
+    CBlockIndex* snapshot_start_block = WITH_LOCK(::cs_main, return m_blockman.LookupBlockIndex(base_blockhash));
+
+    if (!snapshot_start_block) {
+        // Needed for GetUTXOStats and ExpectedAssumeutxo to determine the height and to avoid a crash when base_blockhash.IsNull()
+        LogPrintf("[snapshot] Did not find snapshot start blockheader %s\n",
+                  base_blockhash.ToString());
+        return false;
+    }
+
+    int base_height = snapshot_start_block->nHeight;
+    auto maybe_au_data = ExpectedAssumeutxo(base_height, ::Params());
+
+    if (!maybe_au_data) {
+        LogPrintf("[snapshot] assumeutxo height in snapshot metadata not recognized " /* Continued */
+                  "(%d) - refusing to load snapshot\n", base_height);
+        return false;
+    }
+
+    const AssumeutxoData& au_data = *maybe_au_data;
+
+    uint256 hash_serialized;
+    if (!metadata.m_chunks.empty()) {
+        // Chunks are written straight to the coins database, so the coins
+        // cache only needs to record the best block.
+        CCoinsViewDB& snapshot_coinsdb = *WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
+        if (!LoadChunkedSnapshot(coins_file, metadata, base_height, snapshot_coinsdb, SnapshotThreads(), hash_serialized)) {
+            return false;
+        }
+        LogPrintf("[snapshot] loaded %d coins from chunked snapshot %s\n",
+            metadata.m_coins_count, base_blockhash.ToString());
+        coins_cache.SetBestBlock(base_blockhash);
+        FlushSnapshotToDisk(coins_cache, /*snapshot_loaded=*/true);
+    } else if (!LoadSnapshotCoins(snapshot_chainstate, coins_cache, coins_file, metadata, base_height, m_blockman, hash_serialized)) {
+        return false;
+    }
+
     // Assert that the deserialized chainstate contents match the expected assumeutxo value.
-    if (AssumeutxoHash{stats.hashSerialized} != au_data.hash_serialized) {
+    if (AssumeutxoHash{hash_serialized} != au_data.hash_serialized) {
         LogPrintf("[snapshot] bad snapshot content hash: expected %s, got %s\n",
-            au_data.hash_serialized.ToString(), stats.hashSerialized.ToString());
+            au_data.hash_serialized.ToString(), hash_serialized.ToString());
         return false;
     }
 
@@ -82,9 +82,13 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60 * 365;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = false;
 static const bool DEFAULT_TXINDEX = false;
 static constexpr bool DEFAULT_COINSTATSINDEX{false};
+static constexpr bool DEFAULT_ADDRESSINDEX{false};
+static constexpr bool DEFAULT_SPENTINDEX{false};
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -persistmempoolv1 */
+static const bool DEFAULT_PERSIST_V1_DAT = false;
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of ActiveChain().Tip() will not be pruned. */
@@ -602,6 +606,17 @@ public:
     void LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp = nullptr)
         EXCLUSIVE_LOCKS_REQUIRED(!m_chainstate_mutex);
 
+    /**
+     * Rebuild the block index from the block files for -reindex. The files
+     * are scanned for blocks on up to `threads` threads, which then read and
+     * check the blocks ahead of accepting them in file order.
+     *
+     * With headers_only (-reindex-headers), the blocks are added from the
+     * headers and transaction counts found by the scan instead, and checked
+     * when they are connected (see BLOCK_UNCHECKED_DATA).
+     */
+    void ReindexBlockFiles(int threads, bool headers_only = false) EXCLUSIVE_LOCKS_REQUIRED(!m_chainstate_mutex);
+
     /**
      * Update the on-disk chain state.
      * The caches and indexes are flushed depending on the mode we're called with
@@ -646,7 +661,7 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(!m_chainstate_mutex)
         LOCKS_EXCLUDED(::cs_main);
 
-    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, uint32_t dbp_size = 0) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
@@ -717,12 +732,35 @@ public:
     std::string ToString() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
 private:
+    //! Disk positions and record sizes of blocks read during a reindex whose parent is not known yet, by parent hash
+    std::multimap<uint256, std::pair<FlatFilePos, uint32_t>> m_blocks_unknown_parent;
+
+    /**
+     * Accept a block read from a block file at *dbp, with `dbp_size` bytes of
+     * record data, or from an external file if dbp is nullptr, and then the
+     * blocks read earlier that were waiting
+     * for it as their parent. A block from a block file whose parent is not
+     * known yet is put aside in m_blocks_unknown_parent.
+     *
+     * @returns false if importing should stop
+     */
+    bool ImportBlock(const std::shared_ptr<const CBlock>& pblock, const FlatFilePos* dbp, uint32_t dbp_size, int& loaded)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_chainstate_mutex);
+
+    /**
+     * Add a block found in a block file to the block index from its header
+     * and transaction count, for a headers-only reindex.
+     *
+     * @returns whether the header was accepted
+     */
+    bool ImportBlockHeader(const node::BlockFileRecord& record) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     bool ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
     bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
 
     void InvalidBlockFound(CBlockIndex* pindex, const BlockValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-    void ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const FlatFilePos& pos) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    void ReceivedBlockTransactions(unsigned int num_tx, CBlockIndex* pindexNew, const FlatFilePos& pos) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -996,8 +1034,8 @@ public:
 
 using FopenFn = std::function<FILE*(const fs::path&, const char*)>;
 
-/** Dump the mempool to disk. */
-bool DumpMempool(const CTxMemPool& pool, FopenFn mockable_fopen_function = fsbridge::fopen, bool skip_file_commit = false);
+/** Dump the mempool to disk, in the legacy format (version 1) if use_v1 is true. */
+bool DumpMempool(const CTxMemPool& pool, bool use_v1, FopenFn mockable_fopen_function = fsbridge::fopen, bool skip_file_commit = false);
 
 /** Load the mempool from disk. */
 bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mockable_fopen_function = fsbridge::fopen);
@@ -56,6 +56,7 @@ static RPCHelpMan getwalletinfo()
                         {
                             {RPCResult::Type::NUM, "duration", "elapsed seconds since scan start"},
                             {RPCResult::Type::NUM, "progress", "scanning progress percentage [0.0, 1.0]"},
+                            {RPCResult::Type::NUM, "skipped_blocks", "number of blocks skipped so far because their block filter did not match the wallet (requires -blockfilterindex and a descriptor wallet)"},
                         }, /*skip_type_check=*/true},
                         {RPCResult::Type::BOOL, "descriptors", "whether this wallet uses descriptors for scriptPubKey management"},
                         {RPCResult::Type::BOOL, "external_signer", "whether this wallet is configured to use an external signer such as a hardware wallet"},
@@ -114,6 +115,7 @@ static RPCHelpMan getwalletinfo()
         UniValue scanning(UniValue::VOBJ);
         scanning.pushKV("duration", pwallet->ScanningDuration() / 1000);
         scanning.pushKV("progress", pwallet->ScanningProgress());
+        scanning.pushKV("skipped_blocks", pwallet->ScanningSkippedBlocks());
         obj.pushKV("scanning", scanning);
     } else {
         obj.pushKV("scanning", false);
@@ -42,7 +42,9 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <limits>
 #include <optional>
+#include <thread>
 
 using interfaces::FoundBlock;
 
@@ -1684,6 +1686,120 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
     return startTime;
 }
 
+namespace {
+/** Number of blocks whose filters are tested ahead of a rescan, per thread */
+constexpr size_t RESCAN_PREFILTER_BLOCKS_PER_THREAD{64};
+/** Maximum number of threads testing block filters during a rescan */
+constexpr unsigned int MAX_RESCAN_PREFILTER_THREADS{16};
+
+/**
+ * Tests the BIP 157 basic block filters of the blocks being rescanned against
+ * the scriptPubKeys of a descriptor wallet, so that only blocks which may
+ * contain wallet transactions are read. Filters of upcoming blocks are tested
+ * ahead of the scan on several threads.
+ */
+class FastWalletRescanFilter
+{
+public:
+    explicit FastWalletRescanFilter(const CWallet& wallet)
+        : m_wallet{wallet},
+          m_threads{std::clamp(std::thread::hardware_concurrency(), 1U, MAX_RESCAN_PREFILTER_THREADS)}
+    {
+        UpdateIfNeeded();
+    }
+
+    /**
+     * Add the scriptPubKeys of descriptors that are new or were topped up,
+     * e.g. because a scanned block used some of their addresses. Results of
+     * filters tested before are dropped, as they may now match.
+     */
+    void UpdateIfNeeded()
+    {
+        bool updated{false};
+        for (ScriptPubKeyMan* spkm : m_wallet.GetAllScriptPubKeyMans()) {
+            // Fast rescans are only used for descriptor wallets.
+            auto desc_spkm{dynamic_cast<DescriptorScriptPubKeyMan*>(spkm)};
+            assert(desc_spkm != nullptr);
+            const int32_t range_end{desc_spkm->GetEndRange()};
+            auto [it, inserted] = m_last_range_ends.emplace(desc_spkm->GetID(), range_end);
+            if (!inserted && it->second == range_end) continue;
+            it->second = range_end;
+            for (const CScript& script_pub_key : desc_spkm->GetScriptPubKeys()) {
+                m_filter_set.emplace(script_pub_key.begin(), script_pub_key.end());
+            }
+            updated = true;
+        }
+        if (updated) {
+            m_query = GCSFilter::ElementQuery{m_filter_set};
+            m_prefiltered.clear();
+        }
+    }
+
+    /**
+     * Return whether the block may contain wallet transactions, or nullopt if
+     * its filter is not available. Filters of up to max_blocks blocks,
+     * starting at this one, are tested at once.
+     */
+    std::optional<bool> MatchesBlock(const uint256& block_hash, size_t max_blocks)
+    {
+        auto it{m_prefiltered.find(block_hash)};
+        if (it == m_prefiltered.end()) {
+            Prefilter(block_hash, max_blocks);
+            it = m_prefiltered.find(block_hash);
+        }
+        return it->second;
+    }
+
+private:
+    void Prefilter(const uint256& first_block_hash, size_t max_blocks)
+    {
+        std::vector<uint256> block_hashes{first_block_hash};
+        const size_t count{std::min(max_blocks, RESCAN_PREFILTER_BLOCKS_PER_THREAD * m_threads)};
+        while (block_hashes.size() < count) {
+            bool next_block{false};
+            uint256 next_block_hash;
+            m_wallet.chain().findBlock(block_hashes.back(), FoundBlock().nextBlock(FoundBlock().inActiveChain(next_block).hash(next_block_hash)));
+            if (!next_block) break;
+            block_hashes.push_back(next_block_hash);
+        }
+
+        std::vector<std::optional<bool>> matches(block_hashes.size());
+        const size_t threads{std::min<size_t>(m_threads, block_hashes.size())};
+        const auto test_filters{[&](size_t first) {
+            for (size_t i = first; i < block_hashes.size(); i += threads) {
+                try {
+                    matches[i] = m_wallet.chain().blockFilterMatchesAny(BlockFilterType::BASIC, block_hashes[i], m_query);
+                } catch (const std::exception&) {
+                    // Leave the result unset, so the block is read instead.
+                }
+            }
+        }};
+        std::vector<std::thread> workers;
+        for (size_t n = 1; n < threads; ++n) {
+            workers.emplace_back(test_filters, n);
+        }
+        test_filters(0);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        m_prefiltered.clear();
+        for (size_t i = 0; i < block_hashes.size(); ++i) {
+            m_prefiltered.emplace(block_hashes[i], matches[i]);
+        }
+    }
+
+    const CWallet& m_wallet;
+    const unsigned int m_threads;
+    /** Range ends of the descriptors whose scriptPubKeys are in the filter set */
+    std::map<uint256, int32_t> m_last_range_ends;
+    GCSFilter::ElementSet m_filter_set;
+    GCSFilter::ElementQuery m_query{m_filter_set};
+    /** Results of the filters tested ahead of the scan */
+    std::map<uint256, std::optional<bool>> m_prefiltered;
+};
+} // namespace
+
 /**
  * Scan the block chain (starting in start_block) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -1715,7 +1831,11 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
     uint256 block_hash = start_block;
     ScanResult result;
 
-    WalletLogPrintf("Rescan started from block %s...\n", start_block.ToString());
+    std::unique_ptr<FastWalletRescanFilter> fast_rescan_filter;
+    if (!IsLegacy() && chain().hasBlockFilterIndex(BlockFilterType::BASIC)) fast_rescan_filter = std::make_unique<FastWalletRescanFilter>(*this);
+
+    WalletLogPrintf("Rescan started from block %s... (%s)\n", start_block.ToString(),
+                    fast_rescan_filter ? "fast variant using block filters" : "slow variant inspecting all blocks");
 
     fAbortRescan = false;
     ShowProgress(strprintf("%s " + _("Rescanning…").translated, GetDisplayName()), 0); // show rescan progress in GUI as dialog or on splashscreen, if rescan required on startup (e.g. due to corruption)
@@ -1740,9 +1860,21 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
             WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", block_height, progress_current);
         }
 
+        // Skip reading the block if its filter shows that it does not contain
+        // wallet transactions.
+        bool fetch_block{true};
+        if (fast_rescan_filter) {
+            fast_rescan_filter->UpdateIfNeeded();
+            const size_t max_blocks{max_height ? static_cast<size_t>(std::max(1, *max_height - block_height + 1)) : std::numeric_limits<size_t>::max()};
+            if (fast_rescan_filter->MatchesBlock(block_hash, max_blocks) == false) {
+                fetch_block = false;
+                ++m_scanning_skipped_blocks;
+            }
+        }
+
         // Read block data
         CBlock block;
-        chain().findBlock(block_hash, FoundBlock().data(block));
+        if (fetch_block) chain().findBlock(block_hash, FoundBlock().data(block));
 
         // Find next block separately from reading data above, because reading
         // is slow and there might be a reorg while it is read.
@@ -1751,7 +1883,18 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
         uint256 next_block_hash;
         chain().findBlock(block_hash, FoundBlock().inActiveChain(block_still_active).nextBlock(FoundBlock().inActiveChain(next_block).hash(next_block_hash)));
 
-        if (!block.IsNull()) {
+        if (!fetch_block) {
+            if (!block_still_active) {
+                // Abort scan if current block is no longer active, as in the
+                // case of a block that is read below.
+                result.last_failed_block = block_hash;
+                result.status = ScanResult::FAILURE;
+                break;
+            }
+            // The block has no wallet transactions, so it counts as scanned.
+            result.last_scanned_block = block_hash;
+            result.last_scanned_height = block_height;
+        } else if (!block.IsNull()) {
             LOCK(cs_wallet);
             if (!block_still_active) {
                 // Abort scan if current block is no longer active, to prevent
@@ -1804,6 +1947,7 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
         result.status = ScanResult::USER_ABORT;
     } else {
         WalletLogPrintf("Rescan completed in %15dms\n", GetTimeMillis() - start_time);
+        if (fast_rescan_filter) WalletLogPrintf("Rescan skipped %d blocks using block filters\n", m_scanning_skipped_blocks.load());
     }
     return result;
 }
@@ -241,6 +241,7 @@ private:
     std::atomic<bool> m_attaching_chain{false};
     std::atomic<int64_t> m_scanning_start{0};
     std::atomic<double> m_scanning_progress{0};
+    std::atomic<int> m_scanning_skipped_blocks{0};
     friend class WalletRescanReserver;
 
     //! the current wallet version: clients below this version are not able to load the wallet
@@ -472,6 +473,8 @@ public:
     bool IsScanning() const { return fScanningWallet; }
     int64_t ScanningDuration() const { return fScanningWallet ? GetTimeMillis() - m_scanning_start : 0; }
     double ScanningProgress() const { return fScanningWallet ? (double) m_scanning_progress : 0; }
+    //! Number of blocks the current rescan did not read because their block filter did not match the wallet
+    int ScanningSkippedBlocks() const { return fScanningWallet ? (int) m_scanning_skipped_blocks : 0; }
 
     //! Upgrade stored CKeyMetadata objects to store key origin info as KeyOriginInfo
     void UpgradeKeyMetadata() EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
@@ -916,6 +919,7 @@ public:
         }
         m_wallet.m_scanning_start = GetTimeMillis();
         m_wallet.m_scanning_progress = 0;
+        m_wallet.m_scanning_skipped_blocks = 0;
         m_could_reserve = true;
         return true;
     }
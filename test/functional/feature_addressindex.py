@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the address index and its RPCs and REST endpoints.
+
+- Receive to and spend from an address, and check getaddresshistory,
+  getaddressutxos, getaddressbalance and /rest/address/ against the
+  transactions.
+- Reorg the spend out and back in, which rewinds the index.
+- Restart the node cleanly and after a kill, which makes the index reverse
+  the blocks it wrote past its last committed best block.
+"""
+from decimal import Decimal
+import http.client
+import json
+import urllib.parse
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+)
+
+
+class AddressIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-addressindex", "-rest", "-walletbroadcast=0"]]
+        self.supports_cli = False
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def rest_address(self, query, address, status=200, **query_params):
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        uri = f'/rest/address/{query}/{address}.json'
+        if query_params:
+            uri += f'?{urllib.parse.urlencode(query_params)}'
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', uri)
+        response = conn.getresponse()
+        assert_equal(response.status, status)
+        body = response.read().decode('utf-8')
+        return json.loads(body, parse_float=Decimal) if status == 200 else body
+
+    def address_state(self, address):
+        """Return the history, utxos and balance of an address, checking that REST agrees with the RPCs"""
+        node = self.nodes[0]
+        history = node.getaddresshistory(address)
+        utxos = node.getaddressutxos(address)
+        balance = node.getaddressbalance(address)
+        assert_equal(self.rest_address('history', address), history)
+        assert_equal(self.rest_address('utxos', address), utxos)
+        assert_equal(self.rest_address('balance', address), balance)
+        assert_equal(balance['balance'], sum(utxo['amount'] for utxo in utxos))
+        assert_equal(balance['utxos'], len(utxos))
+        return history, utxos, balance
+
+    def send(self, to_address, amount, from_address=None):
+        """Send amount to to_address, spending the outputs of from_address if set, and mine the transaction"""
+        node = self.nodes[0]
+        if from_address is None:
+            # Without wallet broadcasting the transaction is only added to the wallet.
+            txid = node.sendtoaddress(to_address, amount)
+            node.sendrawtransaction(node.gettransaction(txid)['hex'])
+        else:
+            inputs = [{'txid': u['txid'], 'vout': u['vout']} for u in node.listunspent(addresses=[from_address])]
+            raw_tx = node.createrawtransaction(inputs, {to_address: amount}, 0, False)
+            funded = node.fundrawtransaction(raw_tx, {'changeAddress': node.getnewaddress()})
+            txid = node.sendrawtransaction(node.signrawtransactionwithwallet(funded['hex'])['hex'])
+        block_hash = self.generatetoaddress(node, 1, node.getnewaddress())[0]
+        return txid, block_hash
+
+    def test_queries(self):
+        node = self.nodes[0]
+        self.log.info("Receive to and spend from an address")
+        self.generatetoaddress(node, 101, node.getnewaddress())
+        address = node.getnewaddress()
+        other = node.getnewaddress()
+        txid1, _ = self.send(address, 1)
+        txid2, _ = self.send(address, 2)
+        height2 = node.getblockcount()
+        txid3, _ = self.send(other, 2.5, from_address=address)
+        height3 = node.getblockcount()
+
+        history, utxos, balance = self.address_state(address)
+        assert_equal([(e['txid'], e['type']) for e in history], [(txid1, 'receive'), (txid2, 'receive'), (txid3, 'spend'), (txid3, 'spend')])
+        assert_equal([e['amount'] for e in history[:2]], [1, 2])
+        # The spend lists its inputs in the order the wallet picked them.
+        assert_equal(sorted(e['amount'] for e in history[2:]), [1, 2])
+        assert all(e['height'] == height3 for e in history[2:])
+        assert_equal(utxos, [])
+        assert_equal(balance, {'balance': 0, 'utxos': 0})
+        _, other_utxos, other_balance = self.address_state(other)
+        assert_equal([(u['txid'], u['amount'], u['coinbase']) for u in other_utxos], [(txid3, Decimal('2.5'), False)])
+        assert_equal(other_balance['balance'], Decimal('2.5'))
+
+        self.log.info("Page through the history")
+        assert_equal(node.getaddresshistory(address, 0, 2, 1), history[1:3])
+        assert_equal(node.getaddresshistory(address, height2), history[1:])
+        assert_equal(self.rest_address('history', address, count=2, skip=1, start_height=0), history[1:3])
+        assert_equal(self.rest_address('utxos', other, count=1), other_utxos)
+
+        self.log.info("Coinbase outputs are indexed")
+        mining_address = node.getnewaddress()
+        self.generatetoaddress(node, 2, mining_address)
+        _, mining_utxos, _ = self.address_state(mining_address)
+        assert_equal([u['coinbase'] for u in mining_utxos], [True, True])
+
+        self.log.info("Invalid requests are rejected")
+        assert_raises_rpc_error(-5, "Invalid address", node.getaddresshistory, "notanaddress")
+        assert_raises_rpc_error(-8, "count must be between 1 and", node.getaddressutxos, address, 0)
+        assert_raises_rpc_error(-8, "skip must not be negative", node.getaddressutxos, address, 1, -1)
+        assert "Unknown address query" in self.rest_address('spends', address, status=400)
+        assert "Invalid address" in self.rest_address('balance', 'notanaddress', status=400)
+        assert "Count is invalid" in self.rest_address('history', address, status=400, count=0)
+        return address, other
+
+    def test_reorg(self, address, other):
+        node = self.nodes[0]
+        self.log.info("A reorg removes the spend from the index")
+        state = self.address_state(address)
+        other_state = self.address_state(other)
+        spend_hash = node.getblockhash(node.getblockcount() - 2)
+        node.invalidateblock(spend_hash)
+        # Mine a longer fork without the spend, which is back in the mempool.
+        fork = [self.generateblock(node, node.get_deterministic_priv_key().address, [])['hash'] for _ in range(4)]
+        history, utxos, balance = self.address_state(address)
+        assert_equal([e['type'] for e in history], ['receive', 'receive'])
+        assert_equal(sorted(u['amount'] for u in utxos), [1, 2])
+        assert_equal(balance, {'balance': 3, 'utxos': 2})
+        assert_equal(self.address_state(other), ([], [], {'balance': 0, 'utxos': 0}))
+
+        self.log.info("Reorging back restores the spend")
+        node.invalidateblock(fork[0])
+        node.reconsiderblock(spend_hash)
+        assert_equal(self.address_state(address), state)
+        assert_equal(self.address_state(other), other_state)
+
+    def kill_and_restart(self, addresses, states):
+        """Kill and restart the node, and check the index against the state recorded for the tip it comes back with"""
+        node = self.nodes[0]
+        node.kill_process()
+        self.start_node(0)
+        # Blocks connected since the last flush of the chainstate may be lost.
+        tip = node.getbestblockhash()
+        assert tip in states
+        assert_equal([self.address_state(address) for address in addresses], states[tip])
+
+    def test_restart(self, address, other):
+        node = self.nodes[0]
+        addresses = [address, other]
+        self.log.info("The index is kept across a restart")
+        state = [self.address_state(address) for address in addresses]
+        self.restart_node(0)
+        assert_equal([self.address_state(address) for address in addresses], state)
+
+        self.log.info("The index recovers the blocks written past its best block after a kill")
+        # Flushing the chainstate commits the best block of the index.
+        node.gettxoutsetinfo()
+        states = {node.getbestblockhash(): [self.address_state(address) for address in addresses]}
+        self.send(other, 1)
+        self.generatetoaddress(node, 5, node.getnewaddress())
+        states[node.getbestblockhash()] = [self.address_state(address) for address in addresses]
+        self.kill_and_restart(addresses, states)
+
+        self.log.info("The index recovers after a kill following a reorg")
+        node.gettxoutsetinfo()
+        states = {node.getbestblockhash(): [self.address_state(address) for address in addresses]}
+        node.invalidateblock(node.getblockhash(node.getblockcount() - 5))
+        self.generatetoaddress(node, 6, node.get_deterministic_priv_key().address)
+        states[node.getbestblockhash()] = [self.address_state(address) for address in addresses]
+        self.kill_and_restart(addresses, states)
+
+    def run_test(self):
+        address, other = self.test_queries()
+        self.test_reorg(address, other)
+        self.test_restart(address, other)
+
+
+if __name__ == '__main__':
+    AddressIndexTest().main()
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test storing blocks and undo data compressed with -blockcompression.
+
+- Mine blocks with transactions, which are stored compressed.
+- Read the blocks back with getblock, getblockstats and the transaction index,
+  after a restart, a -reindex and a -reindex-headers.
+- Convert the block files to uncompressed records and back with
+  repackblockfiles, and check that the compressed files are smaller.
+"""
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+)
+
+
+class BlockCompressionTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-blockcompression", "-txindex"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def read_chain(self, use_txindex=True):
+        """Return the blocks, block stats and transactions of the active chain"""
+        node = self.nodes[0]
+        blocks = []
+        for height in range(node.getblockcount() + 1):
+            block_hash = node.getblockhash(height)
+            block = node.getblock(block_hash, 0)
+            # The genesis block has no undo data.
+            stats = node.getblockstats(height) if height > 0 else None
+            txs = [node.getrawtransaction(txid) for txid in node.getblock(block_hash)['tx']] if use_txindex and height > 0 else None
+            blocks.append((block_hash, block, stats, txs))
+        return blocks
+
+    def strip_txs(self, chain):
+        return [(block_hash, block, stats, None) for block_hash, block, stats, _ in chain]
+
+    def restart_and_wait(self, extra_args):
+        node = self.nodes[0]
+        tip = node.getbestblockhash()
+        self.restart_node(0, extra_args)
+        self.wait_until(lambda: node.getbestblockhash() == tip)
+        if "-txindex" in extra_args:
+            self.wait_until(lambda: node.getindexinfo('txindex')['txindex']['synced'])
+        assert node.verifychain(4, 0)
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.log.info("Mine blocks with transactions")
+        self.generatetoaddress(node, 101, node.getnewaddress())
+        for _ in range(10):
+            for _ in range(20):
+                node.sendtoaddress(node.getnewaddress(), 0.1)
+            self.generatetoaddress(node, 1, node.getnewaddress())
+        self.wait_until(lambda: node.getindexinfo('txindex')['txindex']['synced'])
+        chain = self.read_chain()
+
+        self.log.info("Blocks are read back after a restart")
+        self.restart_and_wait(["-blockcompression", "-txindex"])
+        assert_equal(self.read_chain(), chain)
+
+        self.log.info("Blocks are read back after a -reindex")
+        self.restart_and_wait(["-blockcompression", "-txindex", "-reindex"])
+        assert_equal(self.read_chain(), chain)
+
+        self.log.info("Blocks are read back after a -reindex-headers")
+        self.restart_and_wait(["-blockcompression", "-txindex", "-reindex-headers"])
+        assert_equal(self.read_chain(), chain)
+
+        self.log.info("repackblockfiles stores the blocks uncompressed without -blockcompression")
+        # The transaction index refers to the positions of the blocks, so it
+        # is removed by a repack and rebuilt afterwards.
+        self.restart_and_wait(["-blockcompression=0"])
+        uncompressed_size = node.repackblockfiles()['bytes_after']
+        assert_equal(self.read_chain(use_txindex=False), self.strip_txs(chain))
+        self.restart_and_wait(["-blockcompression=0", "-txindex"])
+        assert_equal(self.read_chain(), chain)
+
+        self.log.info("repackblockfiles compresses the blocks with -blockcompression")
+        self.restart_and_wait(["-blockcompression"])
+        result = node.repackblockfiles()
+        assert_equal(result['bytes_before'], uncompressed_size)
+        assert_greater_than(uncompressed_size, result['bytes_after'])
+        assert_equal(self.read_chain(use_txindex=False), self.strip_txs(chain))
+        self.restart_and_wait(["-blockcompression", "-txindex", "-reindex"])
+        assert_equal(self.read_chain(), chain)
+
+
+if __name__ == '__main__':
+    BlockCompressionTest().main()
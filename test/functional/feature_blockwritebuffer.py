@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test writing block and undo data in the background with -blockwritebuffer.
+
+- Mine blocks and a stale fork, and check that the blocks and their undo data
+  are read back.
+- Kill the node after a flush, and check that everything flushed survived.
+- Kill the node before the blocks mined since the last flush are flushed,
+  and check that the node restarts from consistent block and undo data.
+- Check that invalid values are rejected.
+"""
+from test_framework.descriptors import descsum_create
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+
+class BlockWriteBufferTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-blockwritebuffer=16", "-walletbroadcast=0"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def read_chain(self):
+        """Read the blocks and undo data of the active chain, and return the blocks"""
+        node = self.nodes[0]
+        blocks = []
+        for height in range(node.getblockcount() + 1):
+            block_hash = node.getblockhash(height)
+            blocks.append(node.getblock(block_hash, 0))
+            # getblockstats reads the undo data of the block.
+            if height > 0:
+                assert_equal(node.getblockstats(height)['blockhash'], block_hash)
+        assert node.verifychain(4, 0)
+        return blocks
+
+    def mine_with_transactions(self, blocks):
+        node = self.nodes[0]
+        hashes = []
+        for _ in range(blocks):
+            for _ in range(5):
+                txid = node.sendtoaddress(node.getnewaddress(), 0.1)
+                node.sendrawtransaction(node.gettransaction(txid)['hex'])
+            hashes += self.generatetoaddress(node, 1, node.getnewaddress())
+        return hashes
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.log.info("Mine blocks and a stale fork")
+        # Enough mature outputs that the wallet can still spend after the reorg
+        # leaves some of its transactions out of the mempool.
+        self.generatetoaddress(node, 200, node.getnewaddress())
+        stale_hashes = self.mine_with_transactions(10)
+        node.invalidateblock(stale_hashes[0])
+        # The transactions of the stale blocks that return to the mempool are
+        # mined again in the new branch.
+        self.mine_with_transactions(15)
+        stale_blocks = [node.getblock(block_hash, 0) for block_hash in stale_hashes]
+        chain = self.read_chain()
+
+        self.log.info("Flushed blocks and undo data survive a kill")
+        node.gettxoutsetinfo()
+        node.kill_process()
+        self.start_node(0)
+        assert_equal(self.read_chain(), chain)
+        assert_equal([node.getblock(block_hash, 0) for block_hash in stale_hashes], stale_blocks)
+
+        self.log.info("A kill before the next flush loses at most the blocks mined since the flush")
+        node.gettxoutsetinfo()
+        self.mine_with_transactions(10)
+        node.kill_process()
+        self.start_node(0)
+        restarted_chain = self.read_chain()
+        assert_equal(restarted_chain[:len(chain)], chain)
+
+        self.log.info("Blocks are written again after the restart")
+        # The wallet may still count on outputs of lost blocks, so mine without it.
+        self.generatetodescriptor(node, 10, descsum_create('raw(51)'))
+        chain = self.read_chain()
+        assert_equal(chain[:len(restarted_chain)], restarted_chain)
+        self.restart_node(0)
+        assert_equal(self.read_chain(), chain)
+
+        self.log.info("Blocks written in the background are read without a write buffer")
+        self.restart_node(0, ["-blockwritebuffer=0"])
+        assert_equal(self.read_chain(), chain)
+        self.generatetodescriptor(node, 5, descsum_create('raw(51)'))
+        chain = self.read_chain()
+        self.restart_node(0)
+        assert_equal(self.read_chain(), chain)
+
+        self.log.info("Invalid values are rejected")
+        self.stop_node(0)
+        for value in ["-1", "1025"]:
+            node.assert_start_raises_init_error([f"-blockwritebuffer={value}"], "Error: -blockwritebuffer must be between 0 and 1024 MiB.")
+
+
+if __name__ == '__main__':
+    BlockWriteBufferTest().main()
@@ -23,18 +23,24 @@ class FeatureIndexPruneTest(BitcoinTestFramework):
         ]
 
     def sync_index(self, height):
+        def status(node):
+            info = node.getindexinfo()
+            for index in info.values():
+                index.pop("shared_block_reads")
+            return info
+
         expected_filter = {
-            'basic block filter index': {'synced': True, 'best_block_height': height},
+            'basic block filter index': {'synced': True, 'best_block_height': height, 'progress': 1},
         }
-        self.wait_until(lambda: self.nodes[0].getindexinfo() == expected_filter)
+        self.wait_until(lambda: status(self.nodes[0]) == expected_filter)
 
         expected_stats = {
-            'coinstatsindex': {'synced': True, 'best_block_height': height}
+            'coinstatsindex': {'synced': True, 'best_block_height': height, 'progress': 1}
         }
-        self.wait_until(lambda: self.nodes[1].getindexinfo() == expected_stats)
+        self.wait_until(lambda: status(self.nodes[1]) == expected_stats)
 
         expected = {**expected_filter, **expected_stats}
-        self.wait_until(lambda: self.nodes[2].getindexinfo() == expected)
+        self.wait_until(lambda: status(self.nodes[2]) == expected)
 
     def reconnect_nodes(self):
         self.connect_nodes(0,1)
@@ -2,16 +2,25 @@
 # Copyright (c) 2014-2021 The Bitcoin Core developers
 # Distributed under the MIT software license, see the accompanying
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
-"""Test running bitcoind with -reindex and -reindex-chainstate options.
+"""Test running bitcoind with -reindex, -reindex-chainstate and -reindex-headers options.
 
 - Start a single node and generate 3 blocks.
 - Stop the node and restart it with -reindex. Verify that the node has reindexed up to block 3.
 - Stop the node and restart it with -reindex-chainstate. Verify that the node has reindexed up to block 3.
+- Restart with -reindex-headers and verify that the chain matches the one of a full -reindex.
+- Corrupt a block in the block files and verify that -reindex-headers shuts the
+  node down when it connects the block, while a full -reindex skips it.
 """
 
+import os
+import tempfile
+
 from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import assert_equal
 
+# Fields of getblockchaininfo that depend on the current time or on the log
+CHAIN_INFO_VOLATILE = ('verificationprogress', 'initialblockdownload', 'warnings')
+
 
 class ReindexTest(BitcoinTestFramework):
     def set_test_params(self):
@@ -27,11 +36,71 @@ class ReindexTest(BitcoinTestFramework):
         assert_equal(self.nodes[0].getblockcount(), blockcount)  # start_node is blocking on reindex
         self.log.info("Success")
 
+    def restart_and_get_chain_info(self, extra_args, blockcount):
+        node = self.nodes[0]
+        self.restart_node(0, extra_args)
+        self.wait_until(lambda: node.getblockcount() == blockcount)
+        assert node.verifychain(4, 0)
+        info = node.getblockchaininfo()
+        for field in CHAIN_INFO_VOLATILE:
+            info.pop(field, None)
+        return info
+
+    def reindex_headers(self):
+        node = self.nodes[0]
+        self.generatetoaddress(node, 20, node.get_deterministic_priv_key().address)
+        blockcount = node.getblockcount()
+
+        self.log.info("Compare -reindex-headers with a full -reindex")
+        full = self.restart_and_get_chain_info(["-reindex"], blockcount)
+        headers_only = self.restart_and_get_chain_info(["-reindex-headers"], blockcount)
+        assert_equal(headers_only, full)
+
+        self.log.info("The deferred checks of the reindexed blocks are persisted")
+        assert_equal(self.restart_and_get_chain_info([], blockcount), full)
+
+    def corrupt_block(self, raw_block):
+        """Flip the last byte of a block in the block files, which changes the
+        lock time of its last transaction and so its merkle root."""
+        node = self.nodes[0]
+        blk_path = os.path.join(node.chain_path, 'blocks', 'blk00000.dat')
+        with open(blk_path, 'r+b') as blk:
+            data = blk.read()
+            offset = data.find(raw_block)
+            assert offset >= 0
+            blk.seek(offset + len(raw_block) - 1)
+            blk.write(bytes([raw_block[-1] ^ 0xff]))
+
+    def reindex_corrupt_block(self):
+        node = self.nodes[0]
+        blockcount = node.getblockcount()
+        bad_height = blockcount - 5
+        good_hash = node.getblockhash(bad_height - 1)
+        raw_block = bytes.fromhex(node.getblock(node.getblockhash(bad_height), 0))
+        self.stop_node(0)
+        self.corrupt_block(raw_block)
+
+        self.log.info("A corrupt block shuts the node down when -reindex-headers connects it")
+        with tempfile.NamedTemporaryFile(dir=node.stderr_dir, delete=False) as log_stderr:
+            with node.assert_debug_log(["Corrupt block found indicating potential hardware failure; shutting down"], timeout=60):
+                node.start(["-reindex-headers"], stderr=log_stderr)
+                node.wait_until_stopped()
+            log_stderr.seek(0)
+            assert "A fatal internal error occurred" in log_stderr.read().decode('utf-8')
+
+        self.log.info("A full -reindex skips the corrupt block and its descendants")
+        self.start_node(0, ["-reindex"])
+        self.wait_until(lambda: node.getblockcount() == bad_height - 1)
+        assert_equal(node.getbestblockhash(), good_hash)
+        assert node.verifychain(4, 0)
+
     def run_test(self):
         self.reindex(False)
         self.reindex(True)
         self.reindex(False)
         self.reindex(True)
+        self.reindex_headers()
+        self.reindex_corrupt_block()
 
 if __name__ == '__main__':
     ReindexTest().main()
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the repackblockfiles RPC.
+
+- Build a chain with a stale fork on two nodes using small block files
+  (-fastprune), one of them pruned.
+- Repack the block files and check that the stale blocks are dropped while
+  the active chain stays readable.
+- Check that indexes keep working across a repack, and that blocks mined
+  afterwards are stored.
+- Reindex from the repacked files and check that the tip is unchanged.
+- Check that a transaction index is removed by a repack and rebuilt from the
+  repacked files.
+"""
+import os
+
+from test_framework.descriptors import descsum_create
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    assert_greater_than_or_equal,
+    assert_raises_rpc_error,
+)
+
+FORK_HEIGHT = 100    # last block shared by the active chain and the stale fork
+STALE_BLOCKS = 400   # blocks of the stale fork, more than a 64 KiB block file holds
+ACTIVE_BLOCKS = 500  # blocks of the active chain above FORK_HEIGHT
+
+
+class RepackBlockFilesTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [
+            ["-fastprune", "-blockfilterindex", "-coinstatsindex"],
+            ["-fastprune", "-prune=1"],
+        ]
+
+    def setup_network(self):
+        # The nodes build their chains independently.
+        self.setup_nodes()
+
+    def build_stale_fork(self, node):
+        """Mine a fork that becomes stale, and return the hash of one of its blocks."""
+        self.generatetoaddress(node, FORK_HEIGHT + STALE_BLOCKS, node.get_deterministic_priv_key().address, sync_fun=self.no_op)
+        stale_hash = node.getblockhash(FORK_HEIGHT + 1)
+        node.invalidateblock(stale_hash)
+        # Mine to another output, so that the new blocks differ from the invalidated ones.
+        self.generatetodescriptor(node, ACTIVE_BLOCKS, descsum_create('raw(51)'), sync_fun=self.no_op)
+        node.reconsiderblock(stale_hash)
+        assert_equal(node.getblockcount(), FORK_HEIGHT + ACTIVE_BLOCKS)
+        assert node.getblockhash(FORK_HEIGHT + 1) != stale_hash
+        return stale_hash
+
+    def repack(self, node):
+        result = node.repackblockfiles()
+        self.log.debug(f"-> {result}")
+        assert_greater_than(result['files_before'], result['files_after'])
+        assert_greater_than(result['bytes_before'], result['bytes_after'])
+        assert_equal(result['dropped'], STALE_BLOCKS)
+        assert_equal(result['blocks'], node.getblockcount() + 1)
+        return result
+
+    def check_active_chain(self, node):
+        for height in [0, FORK_HEIGHT, FORK_HEIGHT + 1, node.getblockcount()]:
+            block = node.getblock(node.getblockhash(height))
+            assert_equal(block['height'], height)
+        assert node.verifychain(4, 0)
+
+    def count_block_files(self, node):
+        blocks_dir = os.path.join(node.chain_path, 'blocks')
+        return len([name for name in os.listdir(blocks_dir) if name.startswith('blk')])
+
+    def test_repack(self):
+        node = self.nodes[0]
+        self.log.info("Repack block files with a stale fork")
+        stale_hash = self.build_stale_fork(node)
+        tip = node.getbestblockhash()
+        node.getblock(stale_hash)
+        self.wait_until(lambda: all(i['synced'] for i in node.getindexinfo().values()))
+        result = self.repack(node)
+        assert_equal(self.count_block_files(node), result['files_after'])
+
+        self.log.info("The active chain is readable and stale blocks are headers only")
+        self.check_active_chain(node)
+        assert_raises_rpc_error(-1, "Block not found on disk", node.getblock, stale_hash)
+        assert_equal(node.getblockheader(stale_hash)['hash'], stale_hash)
+        stale_tips = [t for t in node.getchaintips() if t['status'] != 'active']
+        assert_equal([t['status'] for t in stale_tips], ['headers-only'])
+
+        self.log.info("Indexes read the repacked files, and new blocks are stored")
+        self.wait_until(lambda: all(i['synced'] for i in node.getindexinfo().values()))
+        utxo_stats = node.gettxoutsetinfo(hash_type='muhash')
+        assert_equal(node.gettxoutsetinfo(hash_type='muhash', hash_or_height=node.getblockcount(), use_index=True)['muhash'], utxo_stats['muhash'])
+        node.getblockfilter(node.getblockhash(FORK_HEIGHT + 1))
+        new_hashes = self.generatetodescriptor(node, 3, descsum_create('raw(51)'), sync_fun=self.no_op)
+        self.wait_until(lambda: all(i['best_block_height'] == node.getblockcount() for i in node.getindexinfo().values()))
+        for block_hash in new_hashes:
+            node.getblockfilter(block_hash)
+            node.getblock(block_hash)
+        tip = node.getbestblockhash()
+
+        self.log.info("Repacking again keeps all blocks")
+        result = node.repackblockfiles()
+        assert_equal(result['dropped'], 0)
+        assert_greater_than_or_equal(result['files_before'], result['files_after'])
+
+        self.log.info("Reindex from the repacked block files")
+        self.restart_node(0, extra_args=["-fastprune", "-reindex"])
+        self.wait_until(lambda: node.getbestblockhash() == tip)
+        self.check_active_chain(node)
+        assert_raises_rpc_error(-5, "Block not found", node.getblock, stale_hash)
+
+    def test_txindex(self):
+        node = self.nodes[0]
+        self.log.info("Repacking is refused with -txindex")
+        self.restart_node(0, extra_args=["-fastprune", "-txindex"])
+        self.wait_until(lambda: node.getindexinfo('txindex')['txindex']['synced'])
+        assert_raises_rpc_error(-1, "Cannot repack block files with -txindex enabled.", node.repackblockfiles)
+
+        self.log.info("A repack removes the transaction index left from an earlier run")
+        self.restart_node(0, extra_args=["-fastprune"])
+        txindex_dir = os.path.join(node.chain_path, 'indexes', 'txindex')
+        assert os.path.isdir(txindex_dir)
+        node.repackblockfiles()
+        assert not os.path.exists(txindex_dir)
+
+        self.log.info("The transaction index is rebuilt from the repacked block files")
+        self.restart_node(0, extra_args=["-fastprune", "-txindex"])
+        self.wait_until(lambda: node.getindexinfo('txindex')['txindex']['synced'])
+        for height in [1, FORK_HEIGHT + 1, node.getblockcount()]:
+            txid = node.getblock(node.getblockhash(height))['tx'][0]
+            assert_equal(node.decoderawtransaction(node.getrawtransaction(txid))['txid'], txid)
+
+    def test_prune(self):
+        node = self.nodes[1]
+        self.log.info("Repack block files of a pruned node")
+        stale_hash = self.build_stale_fork(node)
+        tip = node.getbestblockhash()
+        self.repack(node)
+
+        self.log.info("The active chain is readable and stale blocks are pruned")
+        self.check_active_chain(node)
+        assert_raises_rpc_error(-1, "Block not available (pruned data)", node.getblock, stale_hash)
+        assert node.getblockchaininfo()['pruned']
+
+        self.log.info("The repacked files are kept after a restart")
+        self.restart_node(1)
+        assert_equal(node.getbestblockhash(), tip)
+        self.check_active_chain(node)
+        assert_raises_rpc_error(-1, "Block not available (pruned data)", node.getblock, stale_hash)
+
+    def run_test(self):
+        self.test_repack()
+        self.test_txindex()
+        self.test_prune()
+
+
+if __name__ == '__main__':
+    RepackBlockFilesTest().main()
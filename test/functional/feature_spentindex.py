@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test gettxspendingprevout with and without the spent index.
+
+- Spends in the mempool are found with or without -spentindex.
+- Confirmed spends are found with -spentindex, along with their block height.
+- A reorg moves a confirmed spend back to the mempool.
+- A spend whose block was lost in an unclean shutdown stays in the index,
+  pointing at a block that is not in the active chain, and is not reported.
+"""
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+)
+
+
+class SpentIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        # Keep the wallet from broadcasting transactions again after a restart.
+        self.extra_args = [["-spentindex", "-walletbroadcast=0"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def spend(self, outpoint, amount=1):
+        """Create and broadcast a transaction spending outpoint, and return its txid"""
+        node = self.nodes[0]
+        raw_tx = node.createrawtransaction([outpoint], {node.getnewaddress(): amount})
+        funded = node.fundrawtransaction(raw_tx, {'add_inputs': False, 'changeAddress': node.getnewaddress()})
+        return node.sendrawtransaction(node.signrawtransactionwithwallet(funded['hex'])['hex'])
+
+    def new_output(self):
+        """Send to the wallet, confirm the transaction and return the output"""
+        node = self.nodes[0]
+        txid = node.sendtoaddress(node.getnewaddress(), 2)
+        node.sendrawtransaction(node.gettransaction(txid)['hex'])
+        self.generatetoaddress(node, 1, node.getnewaddress())
+        vout = next(u['vout'] for u in node.listunspent() if u['txid'] == txid and u['amount'] == 2)
+        return {'txid': txid, 'vout': vout}
+
+    def test_mempool_and_confirmed(self):
+        node = self.nodes[0]
+        self.generatetoaddress(node, 101, node.getnewaddress())
+        outpoint = self.new_output()
+        unspent = self.new_output()
+
+        self.log.info("Unspent outputs have no spend")
+        assert_equal(node.gettxspendingprevout([unspent]), [unspent])
+
+        self.log.info("A spend in the mempool is found")
+        spending_txid = self.spend(outpoint)
+        assert_equal(node.gettxspendingprevout([outpoint, unspent]),
+                     [dict(outpoint, spendingtxid=spending_txid, spendingvin=0), unspent])
+
+        self.log.info("A confirmed spend is found in the spent index")
+        block_hash = self.generatetoaddress(node, 1, node.getnewaddress())[0]
+        height = node.getblockcount()
+        confirmed = dict(outpoint, spendingtxid=spending_txid, spendingvin=0, blockheight=height)
+        assert_equal(node.gettxspendingprevout([outpoint]), [confirmed])
+
+        self.log.info("Without -spentindex only spends in the mempool are found")
+        self.restart_node(0, ["-walletbroadcast=0"])
+        assert_equal(node.gettxspendingprevout([outpoint]), [outpoint])
+        self.restart_node(0)
+        assert_equal(node.gettxspendingprevout([outpoint]), [confirmed])
+
+        self.log.info("Invalid outputs are rejected")
+        assert_raises_rpc_error(-8, "Invalid parameter, outputs are missing", node.gettxspendingprevout, [])
+        assert_raises_rpc_error(-8, "Invalid parameter, vout cannot be negative", node.gettxspendingprevout, [{'txid': outpoint['txid'], 'vout': -1}])
+        return outpoint, spending_txid, block_hash
+
+    def test_reorg(self, outpoint, spending_txid, block_hash):
+        node = self.nodes[0]
+        self.log.info("A reorg moves the spend back to the mempool")
+        node.invalidateblock(block_hash)
+        assert spending_txid in node.getrawmempool()
+        # A longer fork without the spend, which stays in the mempool.
+        fork_hashes = [self.generateblock(node, node.get_deterministic_priv_key().address, [])['hash'] for _ in range(2)]
+        assert_equal(node.gettxspendingprevout([outpoint]), [dict(outpoint, spendingtxid=spending_txid, spendingvin=0)])
+
+        self.log.info("The spend is confirmed again on another block")
+        self.generatetoaddress(node, 1, node.getnewaddress())
+        assert_equal(node.gettxspendingprevout([outpoint]),
+                     [dict(outpoint, spendingtxid=spending_txid, spendingvin=0, blockheight=node.getblockcount())])
+        assert_equal(node.getblockhash(node.getblockcount() - 2), fork_hashes[0])
+
+    def test_lost_block(self):
+        node = self.nodes[0]
+        self.log.info("A spend whose block was lost in an unclean shutdown is not reported")
+        outpoint = self.new_output()
+        # Flush the chainstate and the index locators before the spend.
+        node.gettxoutsetinfo()
+        height = node.getblockcount()
+        spending_txid = self.spend(outpoint)
+        lost_hash = self.generatetoaddress(node, 1, node.getnewaddress())[0]
+        self.wait_until(lambda: node.getindexinfo('spentindex')['spentindex']['best_block_height'] == height + 1)
+        assert_equal(node.gettxspendingprevout([outpoint])[0]['spendingtxid'], spending_txid)
+        node.kill_process()
+        self.start_node(0)
+        assert_equal(node.getblockcount(), height)
+        assert_raises_rpc_error(-5, "Block not found", node.getblock, lost_hash)
+        assert_equal(node.gettxspendingprevout([outpoint]), [outpoint])
+
+        self.log.info("The returned block hash is stale once another block takes the height")
+        self.generateblock(node, node.get_deterministic_priv_key().address, [])
+        assert node.getbestblockhash() != lost_hash
+        assert_equal(node.gettxspendingprevout([outpoint]), [outpoint])
+
+        self.log.info("A new spend replaces the stale entry")
+        node.abandontransaction(spending_txid)
+        new_spending_txid = self.spend(outpoint, amount=1.5)
+        self.generatetoaddress(node, 1, node.getnewaddress())
+        assert_equal(node.gettxspendingprevout([outpoint]),
+                     [dict(outpoint, spendingtxid=new_spending_txid, spendingvin=0, blockheight=height + 2)])
+
+    def run_test(self):
+        outpoint, spending_txid, block_hash = self.test_mempool_and_confirmed()
+        self.test_reorg(outpoint, spending_txid, block_hash)
+        self.test_lost_block()
+
+
+if __name__ == '__main__':
+    SpentIndexTest().main()
@@ -341,6 +341,12 @@ class RESTTest (BitcoinTestFramework):
             assert_equal(json_obj[tx]['spentby'], txs[i + 1:i + 2])
             assert_equal(json_obj[tx]['depends'], txs[i - 1:i])
 
+        # Check that the feerate histogram accounts for all three transactions
+        histogram = self.test_rest_request("/mempool/feehistogram")
+        assert_equal(histogram, self.nodes[0].getmempoolfeehistogram())
+        assert_equal(sum(bucket['count'] for bucket in histogram['buckets']), 3)
+        assert_equal(histogram['total_vsize'], sum(entry['vsize'] for entry in raw_mempool_verbose.values()))
+
         # Now mine the transactions
         newblockhash = self.generate(self.nodes[1], 1)
 
@@ -24,6 +24,8 @@ class MempoolCompatibilityTest(BitcoinTestFramework):
     def set_test_params(self):
         self.num_nodes = 2
         self.wallet_names = [None]
+        # The old node can only read the legacy mempool.dat format
+        self.extra_args = [[], ["-persistmempoolv1"]]
 
     def skip_test_if_missing_module(self):
         self.skip_if_no_previous_releases()
@@ -32,7 +34,7 @@ class MempoolCompatibilityTest(BitcoinTestFramework):
         self.add_nodes(self.num_nodes, versions=[
             190100,  # oldest version with getmempoolinfo.loaded (used to avoid intermittent issues)
             None,
-        ])
+        ], extra_args=self.extra_args)
         self.start_nodes()
         self.import_deterministic_coinbase_privkeys()
 
@@ -145,6 +145,12 @@ class MempoolPersistTest(BitcoinTestFramework):
         assert self.nodes[0].getmempoolinfo()["loaded"]
         assert_equal(len(self.nodes[0].getrawmempool()), 6)
 
+        self.log.debug("Stop-start node0 with -persistmempoolv1. Verify that the legacy format is loaded.")
+        self.restart_node(0, extra_args=["-persistmempoolv1"])
+        with self.nodes[0].assert_debug_log(["Imported mempool transactions from disk: 6 succeeded"]):
+            self.restart_node(0)
+        assert_equal(len(self.nodes[0].getrawmempool()), 6)
+
         mempooldat0 = os.path.join(self.nodes[0].datadir, self.chain, 'mempool.dat')
         mempooldat1 = os.path.join(self.nodes[1].datadir, self.chain, 'mempool.dat')
         self.log.debug("Remove the mempool.dat file. Verify that savemempool to disk via RPC re-creates it")
@@ -49,6 +49,17 @@ class DumptxoutsetTest(BitcoinTestFramework):
             out['txoutset_hash'], '1f7e3befd45dc13ae198dfbb22869a9c5c4196f8e9ef9735831af1288033f890')
         assert_equal(out['nchaintx'], 101)
 
+        # A chunked snapshot holds the same coins, hashed the same way.
+        chunked = node.dumptxoutset('txoutset_chunked.dat', 16)
+        assert_equal(chunked['coins_written'], 100)
+        assert_equal(chunked['base_hash'], out['base_hash'])
+        assert_equal(chunked['txoutset_hash'], out['txoutset_hash'])
+        assert_equal(chunked['chunks'], 16)
+        assert_equal(out['chunks'], 0)
+
+        assert_raises_rpc_error(
+            -8, 'chunks must be between 0 and 65536', node.dumptxoutset, 'txoutset_bad.dat', 65537)
+
         # Specifying a path to an existing file will fail.
         assert_raises_rpc_error(
             -8, '{} already exists'.format(FILENAME),  node.dumptxoutset, FILENAME)
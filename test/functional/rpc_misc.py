@@ -83,10 +83,16 @@ class RpcMiscTest(BitcoinTestFramework):
         self.restart_node(0, ["-txindex", "-blockfilterindex", "-coinstatsindex"])
         self.wait_until(lambda: all(i["synced"] for i in node.getindexinfo().values()))
 
-        # Returns a list of all running indices by default
-        values = {"synced": True, "best_block_height": 200}
+        # Returns a list of all running indices by default. How many blocks
+        # the indices shared while syncing depends on timing.
+        def status(info):
+            for index in info.values():
+                assert index.pop("shared_block_reads") >= 0
+            return info
+
+        values = {"synced": True, "best_block_height": 200, "progress": 1}
         assert_equal(
-            node.getindexinfo(),
+            status(node.getindexinfo()),
             {
                 "txindex": values,
                 "basic block filter index": values,
@@ -95,7 +101,7 @@ class RpcMiscTest(BitcoinTestFramework):
         )
         # Specifying an index by name returns only the status of that index
         for i in {"txindex", "basic block filter index", "coinstatsindex"}:
-            assert_equal(node.getindexinfo(i), {i: values})
+            assert_equal(status(node.getindexinfo(i)), {i: values})
 
         # Specifying an unknown index name returns an empty result
         assert_equal(node.getindexinfo("foo"), {})
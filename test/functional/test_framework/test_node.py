@@ -12,6 +12,7 @@ import http.client
 import json
 import logging
 import os
+import platform
 import re
 import subprocess
 import tempfile
@@ -357,7 +358,7 @@ class TestNode():
         if wait_until_stopped:
             self.wait_until_stopped()
 
-    def is_node_stopped(self):
+    def is_node_stopped(self, *, expected_ret_code=0):
         """Checks whether the node has stopped.
 
         Returns True if the node has stopped. False otherwise.
@@ -368,9 +369,9 @@ class TestNode():
         if return_code is None:
             return False
 
-        # process has stopped. Assert that it didn't return an error code.
-        assert return_code == 0, self._node_msg(
-            "Node returned non-zero exit code (%d) when stopping" % return_code)
+        # process has stopped. Assert that it returned the expected code.
+        assert return_code == expected_ret_code, self._node_msg(
+            "Node returned unexpected exit code (%d) vs (%d) when stopping" % (return_code, expected_ret_code))
         self.running = False
         self.process = None
         self.rpc_connected = False
@@ -378,8 +379,13 @@ class TestNode():
         self.log.debug("Node stopped")
         return True
 
-    def wait_until_stopped(self, timeout=BITCOIND_PROC_WAIT_TIMEOUT):
-        wait_until_helper(self.is_node_stopped, timeout=timeout, timeout_factor=self.timeout_factor)
+    def wait_until_stopped(self, timeout=BITCOIND_PROC_WAIT_TIMEOUT, *, expected_ret_code=0):
+        wait_until_helper(lambda: self.is_node_stopped(expected_ret_code=expected_ret_code), timeout=timeout, timeout_factor=self.timeout_factor)
+
+    def kill_process(self):
+        """Kill the node without a clean shutdown, as a crash or power loss would."""
+        self.process.kill()
+        self.wait_until_stopped(expected_ret_code=1 if platform.system() == "Windows" else -9)
 
     @property
     def chain_path(self) -> Path:
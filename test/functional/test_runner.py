@@ -131,6 +131,11 @@ BASE_SCRIPTS = [
     'feature_bip68_sequence.py',
     'p2p_feefilter.py',
     'feature_reindex.py',
+    'feature_repackblockfiles.py',
+    'feature_blockcompression.py',
+    'feature_addressindex.py',
+    'feature_spentindex.py',
+    'feature_blockwritebuffer.py',
     'feature_abortnode.py',
     # vv Tests less than 30s vv
     'wallet_keypool_topup.py --legacy-wallet',
@@ -187,6 +192,7 @@ BASE_SCRIPTS = [
     'wallet_groups.py --legacy-wallet',
     'wallet_transactiontime_rescan.py --descriptors',
     'wallet_transactiontime_rescan.py --legacy-wallet',
+    'wallet_fast_rescan.py --descriptors',
     'p2p_addrv2_relay.py',
     'wallet_groups.py --descriptors',
     'p2p_compactblocks_hb.py',
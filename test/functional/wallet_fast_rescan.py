@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that fast rescan using block filters for descriptor wallets detects
+   top-ups correctly and finds the same transactions as the slow variant."""
+import os
+import re
+
+from test_framework.blocktools import COINBASE_MATURITY
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+)
+
+
+KEYPOOL_SIZE = 10     # smaller than default size to speed-up test
+NUM_DESCRIPTORS = 8   # number of descriptors (8 default ranged ones)
+NUM_BLOCKS = 6        # number of blocks to mine
+
+
+class WalletFastRescanTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [[f'-keypool={KEYPOOL_SIZE}', '-blockfilterindex=1']]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+        self.skip_if_no_sqlite()
+
+    def get_wallet_txids(self, node, wallet_name):
+        w = node.get_wallet_rpc(wallet_name)
+        txs = w.listtransactions('*', 1000000)
+        return [tx['txid'] for tx in txs]
+
+    def get_skipped_blocks(self, node):
+        """Return the block count of the last "Rescan skipped" log line."""
+        with open(node.debug_log_path, encoding='utf-8') as dl:
+            counts = re.findall(r'Rescan skipped (\d+) blocks using block filters', dl.read())
+        assert counts, "no fast rescan found in debug log"
+        return int(counts[-1])
+
+    def run_test(self):
+        node = self.nodes[0]
+        funding_wallet = node.get_wallet_rpc(self.default_wallet_name)
+        self.generatetoaddress(node, COINBASE_MATURITY + 1, funding_wallet.getnewaddress())
+
+        self.log.info("Create descriptor wallet with backup")
+        WALLET_BACKUP_FILENAME = os.path.join(node.datadir, 'wallet.bak')
+        node.createwallet(wallet_name='topup_test', descriptors=True)
+        w = node.get_wallet_rpc('topup_test')
+        fixed_key = w.getnewaddress(address_type='bech32')
+        w.backupwallet(WALLET_BACKUP_FILENAME)
+        descriptors = w.listdescriptors()['descriptors']
+        assert_equal(len(descriptors), NUM_DESCRIPTORS)
+
+        self.log.info("Create txs sending to end range address of each descriptor, triggering top-ups")
+        for i in range(NUM_BLOCKS):
+            self.log.info(f"Block {i+1}/{NUM_BLOCKS}")
+            for desc_info in w.listdescriptors()['descriptors']:
+                if 'range' not in desc_info:
+                    continue
+                start_range, end_range = desc_info['range']
+                addr = w.deriveaddresses(desc_info['desc'], [end_range, end_range])[0]
+                spk = w.getaddressinfo(addr)['scriptPubKey']
+                self.log.info(f"-> range [{start_range},{end_range}], last address {addr}")
+                txid = funding_wallet.sendtoaddress(addr, 0.001)
+                self.log.debug(f"   sent to {spk} in {txid}")
+            self.generatetoaddress(node, 1, funding_wallet.getnewaddress())
+            # Blocks that contain nothing for the wallet, to be skipped by the filter
+            self.generatetoaddress(node, 2, funding_wallet.getnewaddress())
+
+        self.log.info("Send to a fixed address")
+        funding_wallet.sendtoaddress(fixed_key, 0.001)
+        self.generatetoaddress(node, 11, funding_wallet.getnewaddress())
+
+        self.log.info("Import wallet backup with block filter index")
+        with node.assert_debug_log(['fast variant using block filters']):
+            node.restorewallet('rescan_fast', WALLET_BACKUP_FILENAME)
+        txids_fast = self.get_wallet_txids(node, 'rescan_fast')
+        assert_greater_than(self.get_skipped_blocks(node), 0)
+
+        self.log.info("Rescan the restored wallet with block filter index")
+        with node.assert_debug_log(['fast variant using block filters']):
+            node.get_wallet_rpc('rescan_fast').rescanblockchain()
+        assert_equal(self.get_wallet_txids(node, 'rescan_fast'), txids_fast)
+        assert_greater_than(self.get_skipped_blocks(node), 0)
+
+        self.log.info("Import non-active descriptors with block filter index")
+        node.createwallet(wallet_name='rescan_fast_nonactive', descriptors=True, disable_private_keys=True, blank=True)
+        with node.assert_debug_log(['fast variant using block filters']):
+            w = node.get_wallet_rpc('rescan_fast_nonactive')
+            w.importdescriptors([{"desc": descriptor['desc'], "timestamp": 0} for descriptor in descriptors])
+        txids_fast_nonactive = self.get_wallet_txids(node, 'rescan_fast_nonactive')
+
+        self.restart_node(0, [f'-keypool={KEYPOOL_SIZE}', '-blockfilterindex=0'])
+        self.log.info("Import wallet backup w/o block filter index")
+        with node.assert_debug_log(['slow variant inspecting all blocks']):
+            node.restorewallet('rescan_slow', WALLET_BACKUP_FILENAME)
+        txids_slow = self.get_wallet_txids(node, 'rescan_slow')
+
+        self.log.info("Import non-active descriptors w/o block filter index")
+        node.createwallet(wallet_name='rescan_slow_nonactive', descriptors=True, disable_private_keys=True, blank=True)
+        with node.assert_debug_log(['slow variant inspecting all blocks']):
+            w = node.get_wallet_rpc('rescan_slow_nonactive')
+            w.importdescriptors([{"desc": descriptor['desc'], "timestamp": 0} for descriptor in descriptors])
+        txids_slow_nonactive = self.get_wallet_txids(node, 'rescan_slow_nonactive')
+
+        self.log.info("Verify that all rescans found the same txs in slow and fast variants")
+        assert_equal(len(txids_slow), NUM_DESCRIPTORS * NUM_BLOCKS + 1)
+        assert_equal(len(txids_fast), NUM_DESCRIPTORS * NUM_BLOCKS + 1)
+        assert_equal(len(txids_fast_nonactive), NUM_DESCRIPTORS * NUM_BLOCKS + 1)
+        assert_equal(len(txids_slow_nonactive), NUM_DESCRIPTORS * NUM_BLOCKS + 1)
+        assert_equal(sorted(txids_slow), sorted(txids_fast))
+        assert_equal(sorted(txids_slow_nonactive), sorted(txids_fast_nonactive))
+
+        self.log.info("Rescan with block filter index enabled but without filters")
+        # Filters that cannot be read, as for blocks the index has not synced
+        # yet, make the rescan read the block instead.
+        self.stop_node(0)
+        filter_dir = os.path.join(node.chain_path, 'indexes', 'blockfilter', 'basic')
+        for filename in os.listdir(filter_dir):
+            if filename.startswith('fltr'):
+                os.remove(os.path.join(filter_dir, filename))
+        self.start_node(0, [f'-keypool={KEYPOOL_SIZE}', '-blockfilterindex=1'])
+        with node.assert_debug_log(['fast variant using block filters', 'Rescan skipped 0 blocks using block filters']):
+            node.restorewallet('rescan_fallback', WALLET_BACKUP_FILENAME)
+        assert_equal(sorted(self.get_wallet_txids(node, 'rescan_fallback')), sorted(txids_slow))
+
+
+if __name__ == '__main__':
+    WalletFastRescanTest().main()